@@ -0,0 +1,73 @@
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <stddef.h>
+
+// QUÉ: E/S asíncrona del lote: lectura anticipada de las entradas y escritura
+// en segundo plano de las salidas ya codificadas.
+// CÓMO: En Linux se usa io_uring con las llamadas al sistema directas (sin
+// liburing): los hilos del lote preparan las peticiones (lecturas en búferes
+// registrados, escrituras del archivo codificado) y un hilo propio recoge las
+// completaciones. Si io_uring no está disponible (kernel antiguo, seccomp en
+// contenedores, io_uring_disabled) las mismas peticiones las atienden hilos
+// con read()/write() bloqueantes.
+// POR QUÉ: En lotes de miles de archivos pequeños, fopen/fread dentro de stb y
+// la escritura dentro del codificador dejan los núcleos esperando a la caché
+// de páginas y al disco; así la E/S del archivo N+1 se solapa con la
+// decodificación del N.
+
+// QUÉ: Modo de E/S de un lote.
+// CÓMO: ES_SINCRONA no crea esta capa (stb y los codificadores leen y
+// escriben por su cuenta); ES_AUTOMATICA usa io_uring si el kernel lo
+// permite y si no hilos; ES_HILOS fuerza los hilos.
+typedef enum { ES_SINCRONA = 0, ES_AUTOMATICA = 1, ES_HILOS = 2 } ModoES;
+
+// QUÉ: Tamaño de cada búfer registrado de lectura.
+// CÓMO: Hay uno por archivo de la ventana; los archivos más grandes se leen en
+// un búfer propio sin registrar.
+#define TAM_RANURA_ES (1 << 20)
+
+// QUÉ: Bytes máximos leídos por adelantado y aún no devueltos (límite blando:
+// siempre se admite un archivo aunque sea más grande).
+#define LIMITE_VENTANA_ES ((size_t)64 << 20)
+
+typedef struct ESAsincrona ESAsincrona;
+
+// QUÉ: Aviso de fin de una escritura (ok = 1 si el archivo quedó completo).
+// CÓMO: Se llama una vez por escritura aceptada, desde el hilo de E/S.
+typedef void (*AlTerminarEscritura)(void* contexto, int ok);
+
+// QUÉ: Crear la capa de E/S para un lote y empezar a leer sus primeros archivos.
+// CÓMO: Los archivos se leen en orden, como mucho "ventana" por delante de
+// los ya devueltos. La ruta "-" y lo que no es un archivo regular no se leen
+// por adelantado (tomarArchivoLeido devuelve -1).
+// Devuelve NULL si no hay memoria o modo es ES_SINCRONA.
+ESAsincrona* crearESAsincrona(const char* const* rutas, int numArchivos, int ventana, ModoES modo);
+
+// QUÉ: Nombre del mecanismo en uso ("io_uring", "io_uring sin búferes
+// registrados" o "hilos").
+const char* nombreMotorES(const ESAsincrona* es);
+
+// QUÉ: Esperar a que el archivo "indice" esté en memoria.
+// Devuelve 1 con *datos y *tam válidos hasta devolverArchivoLeido, 0 si la
+// lectura falló (ya se informó del error) o -1 si este archivo se debe leer
+// por la ruta.
+int tomarArchivoLeido(ESAsincrona* es, int indice, const unsigned char** datos, size_t* tam);
+
+// QUÉ: Liberar el búfer de un archivo y dejar sitio en la ventana.
+// CÓMO: Se debe llamar una vez por archivo, se haya tomado o no (si la
+// lectura sigue en curso, el búfer se libera al completarse).
+void devolverArchivoLeido(ESAsincrona* es, int indice);
+
+// QUÉ: Escribir un archivo codificado en segundo plano.
+// CÓMO: La capa se queda con "datos" (se liberan con free al terminar). Si la
+// escritura falla, el archivo incompleto se borra.
+// Devuelve 1 si la escritura quedó en marcha (alTerminar se llamará), 0 si
+// no se pudo ni empezar (alTerminar no se llama y los datos ya se liberaron).
+int escribirArchivoAsincrono(ESAsincrona* es, const char* ruta, unsigned char* datos, size_t tam,
+                             AlTerminarEscritura alTerminar, void* contexto);
+
+// QUÉ: Esperar a que terminen todas las escrituras y liberar la capa.
+void destruirESAsincrona(ESAsincrona* es);
+
+#endif // ASYNC_IO_H
@@ -0,0 +1,83 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "async_io.h"
+#include "image.h"
+#include <stddef.h>
+
+// QUÉ: Procesado por lotes en tubería: decodificar -> procesar -> codificar.
+// CÓMO: Cada etapa tiene sus propios hilos y las etapas se comunican con colas
+// acotadas. Mientras unos hilos aplican los filtros a la imagen N, otros ya
+// decodifican la N+1 y codifican la N-1. Un presupuesto de memoria limita las
+// imágenes en vuelo: antes de decodificar otra se espera a que la memoria
+// ocupada baje del presupuesto (límite blando: como mucho una imagen más por
+// hilo decodificador, porque el tamaño solo se conoce tras decodificar).
+// POR QUÉ: Procesando archivo a archivo, los núcleos quedan ociosos durante la
+// lectura y la compresión, que son buena parte del tiempo total.
+// Con modoES la E/S de archivos sale de las etapas (ver async_io.h): los
+// decodificadores reciben los archivos ya leídos y los codificadores entregan
+// el PNG en memoria para que se escriba en segundo plano; un archivo cuenta
+// como correcto cuando termina su escritura.
+
+// QUÉ: Operación de la etapa central. Puede reemplazar la imagen (por ejemplo
+// al escalar). Devuelve 1 si tuvo éxito, 0 si falló.
+typedef int (*ProcesarImagenFn)(ImagenInfo* imagen, void* contexto);
+
+// QUÉ: Procesar un archivo de principio a fin sin pasar por las colas (por
+// ejemplo en flujo, ver flujo.h). Devuelve 1 si se guardó, 0 si falló o -1 si
+// no aplica a este archivo y debe seguir la ruta normal.
+typedef int (*ProcesarArchivoFn)(const char* entrada, const char* salida, void* contexto);
+
+// QUÉ: Etapas de la tubería (índices de los arreglos de ResumenLote).
+enum { ETAPA_DECODIFICAR = 0, ETAPA_PROCESAR = 1, ETAPA_CODIFICAR = 2, NUM_ETAPAS = 3 };
+
+// QUÉ: Tiempos de un archivo en cada etapa (segundos); ok = 1 si se guardó.
+typedef struct {
+    double segundos[NUM_ETAPAS];
+    int ok;
+} TiemposArchivo;
+
+// QUÉ: Configuración de un lote.
+typedef struct {
+    const char* const* entradas;    // Rutas de entrada
+    const char* const* salidas;     // Ruta de salida de cada entrada
+    int numArchivos;
+    ProcesarImagenFn procesar;      // NULL = solo convertir formato
+    void* contexto;
+    int hilos[NUM_ETAPAS];          // Hilos de cada etapa (mínimo 1)
+    int capacidadCola;              // Imágenes máximas esperando entre etapas
+    size_t presupuestoMemoria;      // Bytes de imágenes en vuelo (0 = sin límite)
+    TiemposArchivo* tiempos;        // Opcional: numArchivos entradas
+    int canalesEntrada;             // 0 = formato nativo, 1 = decodificar a grises
+    ProcesarArchivoFn procesarArchivo; // Opcional: se intenta antes de decodificar;
+                                       // corre en el hilo decodificador, su tiempo
+                                       // se anota en la columna de proceso y no
+                                       // cuenta en el presupuesto de memoria
+    ModoES modoES;                  // ES_SINCRONA = stb y los codificadores leen y
+                                    // escriben por su cuenta; si no, lectura
+                                    // anticipada y escritura en segundo plano
+} OpcionesLote;
+
+// QUÉ: Resultado agregado de un lote.
+// CÓMO: ocupado[e] suma el tiempo de trabajo de todos los hilos de la etapa;
+// la utilización es ocupado[e] / (segundosTotales * hilos[e]).
+typedef struct {
+    double segundosTotales;
+    double ocupado[NUM_ETAPAS];
+    int hilos[NUM_ETAPAS];
+    int correctos;
+    int fallidos;
+    size_t picoMemoria;             // Máximo de bytes de imágenes en vuelo
+    int picoImagenes;               // Máximo de imágenes en vuelo
+    const char* motorES;            // Mecanismo de E/S asíncrona o NULL
+} ResumenLote;
+
+// QUÉ: Ejecutar el lote completo. Los errores de un archivo no detienen el resto.
+// Devuelve 1 si todos los archivos se procesaron, 0 si alguno falló o no se
+// pudo arrancar la tubería.
+int ejecutarLote(const OpcionesLote* opciones, ResumenLote* resumen);
+
+// QUÉ: Imprimir tiempo total, rendimiento, utilización por etapa y memoria pico.
+void imprimirResumenLote(const ResumenLote* resumen);
+
+#endif // BATCH_H
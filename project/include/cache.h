@@ -0,0 +1,90 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "image.h"
+#include "operaciones.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// QUÉ: Caché de resultados direccionada por contenido.
+// CÓMO: La clave es un hash de los píxeles de entrada (hashImagen), sus
+// dimensiones y un hash de la cadena de operaciones con sus parámetros
+// (hashCadena). Dos niveles:
+//   memoria: tabla hash con lista LRU, limitada en bytes; al llenarse se
+//     expulsa el resultado usado hace más tiempo.
+//   disco (opcional): un archivo PNM crudo por clave en un directorio
+//     (<píxeles>-<operación>.pnm), que sobrevive entre ejecuciones; un
+//     acierto en disco sube el resultado a memoria.
+// Es segura entre hilos (los trabajadores del lote la comparten).
+// POR QUÉ: El mismo archivo llega varias veces con las mismas operaciones
+// (reintentos, subidas duplicadas); hashear la entrada cuesta una lectura
+// de memoria, mucho menos que repetir blur, Sobel o un escalado.
+
+// QUÉ: Bytes de cada bloque que se hashea por separado.
+// CÓMO: Los bloques se reparten entre hilos y sus hashes se combinan en
+// orden, así el resultado no depende del número de hilos (las claves en
+// disco valen entre ejecuciones con distinta configuración).
+#define BLOQUE_HASH_CACHE (1 << 20)
+
+// QUÉ: Capacidad que sugiere el menú al activar la caché (opción 23, MB).
+#define CAPACIDAD_CACHE_MENU_MB 256
+
+// QUÉ: Clave de un resultado.
+typedef struct {
+    uint64_t pixeles;       // hashImagen de la entrada (incluye dimensiones y formato)
+    uint64_t operacion;     // hashCadena de las operaciones
+} ClaveCache;
+
+// QUÉ: Hash de 64 bits de un bloque de bytes (algoritmo XXH64).
+uint64_t hashBytes(const void* datos, size_t largo, uint64_t semilla);
+
+// QUÉ: Hash de los píxeles, dimensiones y canales de una imagen.
+// CÓMO: Bloques de BLOQUE_HASH_CACHE bytes hasheados en paralelo con
+// NUM_HILOS_GLOBAL hilos (cada tarea toma el siguiente bloque con un
+// contador atómico) y hash de la lista de hashes de bloque.
+uint64_t hashImagen(const ImagenInfo* imagen);
+
+// QUÉ: Hash de una cadena de operaciones y de los ajustes globales que
+// cambian su resultado (LUZ_LINEAL_GLOBAL para rotar y escalar).
+uint64_t hashCadena(const CadenaOperaciones* cadena);
+
+// QUÉ: Configurar la caché.
+// CÓMO: capacidadBytes = 0 desactiva el nivel de memoria; directorio NULL
+// desactiva el de disco (se crea si no existe). Vacía lo que hubiera.
+// Se llama antes de que los hilos empiecen a usarla.
+// Devuelve 1 si tuvo éxito, 0 si el directorio no se puede usar.
+int configurarCache(size_t capacidadBytes, const char* directorio);
+
+// QUÉ: 1 si algún nivel está activo.
+int cacheActiva(void);
+
+// QUÉ: Buscar el resultado de una clave.
+// CÓMO: Primero en memoria y luego en disco. En un acierto, 'resultado'
+// recibe una imagen nueva (la libera el llamador). Un fallo deja la clave
+// "en cálculo": quien la busque después espera a que el llamador llame a
+// guardarEnCache (o a abandonarClaveCache si no pudo calcularla), en lugar
+// de repetir el mismo cálculo a la vez en otro hilo.
+// Devuelve 1 si hubo acierto, 0 si no (cuenta como fallo).
+int buscarEnCache(const ClaveCache* clave, ImagenInfo* resultado);
+
+// QUÉ: Guardar una copia del resultado de una clave en los niveles activos
+// y despertar a quien espere por ella.
+// CÓMO: Los resultados mayores que la capacidad de memoria solo van a disco.
+// El archivo se escribe con un nombre temporal y se renombra, así otro
+// proceso nunca lee uno a medias.
+void guardarEnCache(const ClaveCache* clave, const ImagenInfo* resultado);
+
+// QUÉ: Renunciar a una clave que buscarEnCache dejó en cálculo (error al
+// procesar); el siguiente que la busque la calculará.
+void abandonarClaveCache(const ClaveCache* clave);
+
+// QUÉ: Imprimir consultas, aciertos por nivel, tasa de aciertos y ocupación.
+void imprimirEstadisticasCache(void);
+
+// QUÉ: Línea de estado breve para el menú (nada si aún no hubo consultas).
+void imprimirEstadoCache(void);
+
+// QUÉ: Liberar el nivel de memoria (los archivos del disco se conservan).
+void liberarCache(void);
+
+#endif // CACHE_H
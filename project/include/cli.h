@@ -0,0 +1,17 @@
+#ifndef CLI_H
+#define CLI_H
+
+// QUÉ: Modo por lotes sin menú, para ejecuciones que se puedan automatizar.
+// CÓMO:
+//   img_processor -i 'fotos/*.png' -p 'blur:5,1.5|sobel|scale:800x600'
+//                 -o 'salida/{name}_bordes.png' [-t hilos] [-j trabajos] [-v]
+// Las entradas pueden ser archivos, directorios o patrones glob; la salida es
+// un patrón con {name}, {ext}, {dir} e {index}. El lote corre sobre la tubería
+// de batch.c y al final se imprimen los tiempos por archivo y el resumen.
+// POR QUÉ: El menú interactivo (preguntas con scanf, salida fija en results/,
+// rutas de 256 bytes) no permite medir ni automatizar lotes grandes.
+// Devuelve el código de salida: 0 si todo fue bien, 1 si falló algún archivo,
+// 2 si los argumentos no son válidos.
+int ejecutarCLI(int argc, char* argv[]);
+
+#endif // CLI_H
@@ -0,0 +1,37 @@
+#ifndef DEEPZOOM_H
+#define DEEPZOOM_H
+
+#include "image.h"
+
+// QUÉ: Organización de las teselas en disco.
+// CÓMO: DEEPZOOM escribe <base>.dzi y <base>_files/<nivel>/<col>_<fila>.png
+// (nivel 0 = 1x1, último nivel = resolución completa). XYZ escribe
+// <base>/<z>/<x>/<y>.png, donde z = 0 es el primer nivel que cabe en una tesela.
+// POR QUÉ: Son los dos formatos que consumen los visores web habituales.
+typedef enum {
+    TESELAS_DEEPZOOM = 0,
+    TESELAS_XYZ = 1
+} FormatoTeselas;
+
+// QUÉ: Parámetros de la exportación.
+typedef struct {
+    int tamTesela;          // Lado de la tesela (por defecto 256)
+    int solapamiento;       // Píxeles repetidos con cada vecina (DeepZoom suele usar 1)
+    FormatoTeselas formato;
+} OpcionesTeselas;
+
+// QUÉ: Exportar la imagen como pirámide de teselas PNG directamente desde memoria.
+// CÓMO: Recorre los niveles de mayor a menor resolución. En un pool de
+// NUM_HILOS_GLOBAL hilos se codifican las teselas de cada nivel y, por
+// franjas de filas (reducirNivelCaja), se reduce 2x (caja) el siguiente;
+// los hilos que terminan las teselas de un nivel toman las franjas del
+// siguiente. Un nivel se libera en cuanto sus teselas están escritas.
+// Las teselas son de 8 bits; una imagen de 16 bits se redondea antes y una RGBX
+// se escribe como RGB.
+// POR QUÉ: Evita escribir y releer un PNG de resolución completa; como mucho
+// conviven el original y tres niveles reducidos (≤ 1/4 + 1/16 + 1/64 del
+// original), así que la memoria queda acotada aun con imágenes enormes.
+// Devuelve 1 si todas las teselas se escribieron, 0 en caso de error.
+int exportarTeselas(const ImagenInfo* info, const char* rutaBase, const OpcionesTeselas* opciones);
+
+#endif // DEEPZOOM_H
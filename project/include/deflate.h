@@ -0,0 +1,55 @@
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stddef.h>
+
+// QUÉ: Búfer de bytes que crece según se necesita.
+typedef struct {
+    unsigned char* datos;
+    size_t tam;
+    size_t capacidad;
+} BufferBytes;
+
+// QUÉ: Asegurar espacio para 'extra' bytes más. Devuelve 1 si tuvo éxito.
+int reservarBuffer(BufferBytes* buffer, size_t extra);
+
+// QUÉ: Liberar el búfer y dejarlo vacío.
+void liberarBuffer(BufferBytes* buffer);
+
+// QUÉ: Parámetros del compresor deflate.
+// CÓMO: maxCadena es cuántos candidatos de la cadena de hash se prueban por
+// posición (más = mejor ratio y más lento); longitudBuena corta la búsqueda
+// al encontrar una coincidencia así de larga; perezoso activa la evaluación
+// perezosa (probar la posición siguiente antes de aceptar una coincidencia).
+// Con maxCadena <= 0 solo se codifican literales (Huffman sin LZ77); con
+// almacenar a 1 se emiten bloques sin compresión, sin tablas ni búsqueda.
+typedef struct {
+    int maxCadena;
+    int longitudBuena;
+    int perezoso;
+    int almacenar;
+} ParametrosDeflate;
+
+// QUÉ: Comprimir base[inicio, fin) como bloques deflate (RFC 1951).
+// CÓMO: Las coincidencias pueden apuntar hasta 32 KB antes de 'inicio' (el
+// final del trozo anterior actúa como diccionario). Si final es 1 el último
+// bloque lleva BFINAL; si no, se termina con un vaciado de sincronización
+// (bloque almacenado vacío), de modo que la salida acaba alineada a byte y se
+// puede concatenar con la del trozo siguiente. Cada bloque se emite con
+// Huffman dinámico, fijo o sin compresión, el que resulte más corto.
+// POR QUÉ: Permite comprimir trozos en paralelo (al estilo de pigz) y unirlos
+// en un único flujo deflate válido.
+// Añade la salida al final de 'salida'. Devuelve 1 si tuvo éxito, 0 si no.
+int comprimirDeflate(const unsigned char* base, size_t inicio, size_t fin, int final,
+                     const ParametrosDeflate* parametros, BufferBytes* salida);
+
+// QUÉ: Sumas de verificación de zlib y PNG.
+// CÓMO: adler32Actualizar y crc32Actualizar continúan una suma previa
+// (empezar con 1 y 0 respectivamente). combinarAdler32 calcula la suma de
+// A+B a partir de las de A y B y la longitud de B.
+// POR QUÉ: Cada hilo calcula el Adler-32 de su trozo y se combinan al final.
+unsigned long adler32Actualizar(unsigned long adler, const unsigned char* datos, size_t n);
+unsigned long combinarAdler32(unsigned long adler1, unsigned long adler2, size_t longitud2);
+unsigned long crc32Actualizar(unsigned long crc, const unsigned char* datos, size_t n);
+
+#endif // DEFLATE_H
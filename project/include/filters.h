@@ -6,7 +6,14 @@
 // QUÉ: Ajustar brillo de la imagen usando múltiples hilos con monitoreo.
 // CÓMO: Divide las filas entre hilos, registra tiempos y muestra estadísticas.
 // POR QUÉ: Demuestra paralelización con evidencia visual clara.
-void ajustarBrilloConcurrente(ImagenInfo* info, int delta);
+// Devuelve 1 si tuvo éxito, 0 si falla la memoria o un hilo (las filas de
+// los hilos que llegaron a correr quedan cambiadas).
+int ajustarBrilloConcurrente(ImagenInfo* info, int delta);
+
+// QUÉ: Ajustar el brillo solo en el rectángulo (x, y, ancho, alto).
+// CÓMO: El rectángulo se recorta a la imagen; fuera de él nada cambia.
+// Devuelve 1 si tuvo éxito, 0 si la región queda fuera de la imagen.
+int ajustarBrilloRegion(ImagenInfo* info, int x, int y, int ancho, int alto, int delta);
 
 // QUÉ: Aplicar filtro Gaussiano a la imagen usando convolución concurrente.
 // CÓMO: Genera kernel, crea matriz destino, divide trabajo entre hilos.
@@ -18,4 +25,32 @@ int aplicarConvolucionGaussiana(ImagenInfo* info, int tamKernel, float sigma);
 // POR QUÉ: Detecta bordes calculando cambios bruscos de intensidad en todas direcciones.
 int aplicarSobel(ImagenInfo* info);
 
+// --- Núcleos por fila (modo en flujo, ver flujo.h) ---
+// Calculan exactamente lo mismo que las funciones de imagen completa, pero
+// sobre filas sueltas: el llamador guarda las filas vecinas que necesitan.
+
+// QUÉ: Sumar delta a los canales de color de una fila (el alfa no cambia).
+// bytesMuestra es 1 (8 bits) o 2 (16 bits; delta se escala por 257).
+void ajustarBrilloFila(unsigned char* fila, int ancho, int canales, int delta, int bytesMuestra);
+
+// QUÉ: Kernel Gaussiano precalculado (tam x tam pesos normalizados).
+typedef struct {
+    float** pesos;
+    int tam;
+} KernelGaussiano;
+
+// QUÉ: Crear el kernel con la misma validación que aplicarConvolucionGaussiana.
+// Devuelve 1 si tuvo éxito; si no, imprime el motivo en stderr y devuelve 0.
+int crearKernelGaussiano(KernelGaussiano* kernel, int tamKernel, float sigma);
+void liberarKernelGaussiano(KernelGaussiano* kernel);
+
+// QUÉ: Convolucionar una fila. filas[k] es la fila y + k - tam/2 ya recortada
+// al borde de la imagen (tam punteros a filas de 8 bits de ancho * canales bytes).
+void convolucionarFilaGaussiana(const KernelGaussiano* kernel, const unsigned char* const* filas,
+                                int ancho, int canales, unsigned char* destino);
+
+// QUÉ: Magnitud Sobel de una fila de grises. filas[0..2] son las filas y - 1,
+// y e y + 1 ya recortadas al borde.
+void sobelFila(const unsigned char* const* filas, int ancho, unsigned char* destino);
+
 #endif // FILTERS_H
@@ -0,0 +1,49 @@
+#ifndef FLUJO_H
+#define FLUJO_H
+
+#include "operaciones.h"
+#include "png_encoder.h"
+#include <stddef.h>
+
+// QUÉ: Resultados de la ejecución en flujo.
+// CÓMO: FLUJO_NO_APLICA indica que este archivo o esta cadena no se pueden
+// procesar por filas (entrada que no es PNG, es entrelazada o tiene tRNS, salida que no
+// es PNG, rotación o escalado que no es reducción por área); el llamador
+// debe usar la ruta normal con la imagen completa. Se decide antes de
+// escribir nada en la salida.
+#define FLUJO_OK 1
+#define FLUJO_ERROR 0
+#define FLUJO_NO_APLICA (-1)
+
+// QUÉ: Filas que cada etapa con vecindario calcula de una vez.
+// CÓMO: La franja se reparte entre NUM_HILOS_GLOBAL hilos; el anillo de
+// entrada guarda FILAS_FRANJA_FLUJO + 2 * radio filas.
+// POR QUÉ: Con una sola fila por vez el coste de sincronizar los hilos
+// superaría al del cálculo; 32 filas siguen siendo una fracción mínima de la
+// imagen.
+#define FILAS_FRANJA_FLUJO 32
+
+// QUÉ: ¿Puede la cadena ejecutarse en flujo?
+// CÓMO: Admite blur, sobel, gray, brightness y scale en modo auto o area; si
+// un scale resulta no ser una reducción por área, o el PNG es de 16 bits, se
+// sabe al leer la cabecera y ejecutarCadenaEnFlujo devuelve FLUJO_NO_APLICA.
+int cadenaAdmiteFlujo(const CadenaOperaciones* cadena);
+
+// QUÉ: Decodificar, procesar y codificar un PNG sin materializar imágenes.
+// CÓMO: El decodificador por filas (png_decoder) empuja cada fila a la
+// primera etapa; cada etapa entrega sus filas a la siguiente en cuanto las
+// tiene y la última las pasa al codificador PNG incremental. Las etapas
+// puntuales (brightness, gray) trabajan fila a fila; las de vecindario (blur,
+// sobel) guardan un anillo con las filas de halo y calculan franjas de
+// FILAS_FRANJA_FLUJO filas en paralelo; scale usa el reductor de área en flujo.
+// Si la cadena llega a sobel o gray por operaciones lineales, la primera
+// etapa reduce a grises (como cargarImagenCanales en el lote normal).
+// Los píxeles resultantes son idénticos a los de aplicarCadena.
+// POR QUÉ: La memoria máxima es O(ancho * (alto del kernel + franja) * etapas)
+// e independiente del alto de la imagen, así que se pueden procesar
+// imágenes que no caben en memoria.
+// Devuelve FLUJO_OK, FLUJO_ERROR o FLUJO_NO_APLICA.
+int ejecutarCadenaEnFlujo(const char* rutaEntrada, const char* rutaSalida, const CadenaOperaciones* cadena,
+                          PerfilPNG perfil);
+
+#endif // FLUJO_H
@@ -0,0 +1,131 @@
+#ifndef GRAFO_H
+#define GRAFO_H
+
+#include "filters.h"
+#include "image.h"
+#include "operaciones.h"
+
+// QUÉ: Filas de cada franja en las etapas puntuales.
+// CÓMO: Cada hilo toma franjas de FILAS_TESELA_GRAFO filas y pasa cada fila
+// por todo el programa antes de seguir (no hay halo: la forma da igual).
+#define FILAS_TESELA_GRAFO 32
+
+// QUÉ: Tamaño de las teselas de las pasadas de vecindario (píxeles).
+// CÓMO: 0 (por defecto) = elegirlo en cada pasada según la caché L2, la
+// imagen y el halo (ver elegirTeselaGrafo); si no, se usa tal cual,
+// recortado a la imagen. Se fija antes de ejecutar planes (--tile).
+extern int ANCHO_TESELA_GRAFO_GLOBAL;
+extern int ALTO_TESELA_GRAFO_GLOBAL;
+
+// QUÉ: Reducción de canales dentro de un programa puntual.
+// CÓMO: GRISES es la de "gray" (RGBA pasa a grises + alfa); LUMA es la que
+// hace Sobel antes de calcular (un solo canal, sin alfa). Ninguna hace nada
+// sobre una imagen que ya tiene los canales de destino.
+typedef enum {
+    REDUCIR_NADA = 0,
+    REDUCIR_GRISES = 1,
+    REDUCIR_LUMA = 2
+} ReduccionPuntual;
+
+// QUÉ: Secuencia de operaciones puntuales compilada a su forma mínima.
+// CÓMO: Cualquier mezcla de brightness y gray equivale a una tabla antes de
+// la reducción, la reducción y otra tabla después: los brillos consecutivos
+// se componen en una tabla de 256 entradas (con la misma saturación que
+// paso a paso, así que el resultado es idéntico) y dos reducciones seguidas
+// se quedan en la más fuerte. Las tablas se aplican a los canales de color;
+// el alfa no cambia.
+typedef struct {
+    int usaTablaAntes;
+    unsigned char tablaAntes[256];
+    ReduccionPuntual reduccion;
+    int usaTablaDespues;
+    unsigned char tablaDespues[256];
+    int numOps;                    // Operaciones de la cadena que contiene
+} ProgramaPuntual;
+
+// QUÉ: Clases de etapa del plan.
+// CÓMO:
+//   ETAPA_PUNTUAL:    solo un programa puntual (una pasada, en su sitio si
+//                     no cambian los canales).
+//   ETAPA_VECINDARIO: programa de entrada + blur o sobel + programa de salida.
+//                     Las etapas de vecindario seguidas forman una sola
+//                     pasada (un grupo, ver ejecutarPlan).
+//   ETAPA_BARRERA:    rotate o scale, que mueven píxeles entre filas lejanas y
+//                     se ejecutan con su función de imagen completa.
+typedef enum {
+    ETAPA_PUNTUAL = 0,
+    ETAPA_VECINDARIO = 1,
+    ETAPA_BARRERA = 2
+} TipoEtapaGrafo;
+
+// QUÉ: Una pasada del plan sobre la imagen.
+// CÓMO: primeraOp y numOps dicen qué operaciones de la cadena cubre; en las
+// etapas puntuales el programa está en 'entrada'.
+typedef struct {
+    TipoEtapaGrafo tipo;
+    int primeraOp;
+    int numOps;
+    ProgramaPuntual entrada;
+    Operacion nucleo;              // blur/sobel, o rotate/scale en las barreras
+    ProgramaPuntual salida;
+    KernelGaussiano kernel;        // Solo en blur
+    int radio;                     // Filas de halo del núcleo
+} EtapaGrafo;
+
+// QUÉ: Plan fusionado de una cadena de operaciones.
+// CÓMO: Guarda una copia de las operaciones, así no depende de la cadena.
+// Es de solo lectura durante la ejecución: varios hilos pueden ejecutar el
+// mismo plan sobre imágenes distintas a la vez.
+typedef struct {
+    Operacion* ops;
+    int numOps;
+    EtapaGrafo* etapas;
+    int numEtapas;
+} PlanGrafo;
+
+// QUÉ: Construir el plan fusionado de una cadena.
+// CÓMO: Recorre la cadena una vez: las operaciones puntuales se acumulan en
+// un programa que se une a la salida del último blur/sobel (o, si aún no hay
+// ninguno, a la entrada del siguiente); rotate y scale cierran la etapa en
+// curso. Sobel lleva siempre en su entrada la reducción a luma.
+// POR QUÉ: brightness -> blur -> brightness -> sobel pasa de cinco recorridos
+// completos de la imagen (la luma de Sobel es otro) a dos.
+// Devuelve 1 si tuvo éxito, 0 si falta memoria o un blur no es válido.
+int planificarCadena(const CadenaOperaciones* cadena, PlanGrafo* plan);
+
+// QUÉ: Ejecutar el plan sobre la imagen (la sustituye por el resultado).
+// CÓMO: Las etapas puntuales se reparten por franjas de filas entre los
+// hilos de un pool. Cada grupo de etapas de vecindario seguidas (blur ->
+// sobel, por ejemplo) se calcula tesela a tesela de la salida: para cada
+// tesela se lee la región de entrada ampliada con la suma de los radios
+// (el halo) y se pasa por todas las etapas del grupo en búferes del hilo,
+// recalculando el halo en cada tesela; los intermedios no se escriben en
+// imágenes completas. Las barreras llaman a rotateImageConcurrent o
+// scaleImageWithMode. Con una imagen de 16 bits las pasadas no se fusionan:
+// cada operación se aplica con su función de imagen completa.
+// POR QUÉ: Etapa a etapa, cada intermedio recorre la memoria principal una
+// vez al escribirse y otra al leerse; con teselas que caben en la L2 solo
+// se leen la entrada y se escribe la salida.
+// Los píxeles resultantes son idénticos a los de aplicarCadena. La imagen
+// puede llegar compartida (compartirImagen): las etapas puntuales solo
+// escriben en su sitio si nadie más tiene su bloque.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int ejecutarPlan(ImagenInfo* imagen, const PlanGrafo* plan);
+
+// QUÉ: Elegir la tesela de un grupo de etapas de vecindario.
+// CÓMO: Prueba anchos (la imagen entera y de 1024 a 64) y altos (de 8 a
+// 256) y se queda con el que menos trabajo repite en el halo entre los que
+// caben en media L2 por hilo (los búferes de todas las etapas) y dan al
+// menos cuatro teselas por hilo. Con ANCHO/ALTO_TESELA_GRAFO_GLOBAL fijados
+// devuelve esos. canales y relleno son los de la imagen que entra al grupo.
+void elegirTeselaGrafo(const EtapaGrafo* etapas, int numEtapas, int ancho, int alto, int canales, int relleno,
+                       int hilos, int* anchoTesela, int* altoTesela);
+
+// QUÉ: Imprimir el plan: qué operaciones forman cada pasada y cómo se
+// compilaron (tablas, reducciones, halo de las teselas).
+void explicarPlan(const PlanGrafo* plan);
+
+// QUÉ: Liberar el plan (kernels y copias de las operaciones).
+void liberarPlan(PlanGrafo* plan);
+
+#endif // GRAFO_H
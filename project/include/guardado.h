@@ -0,0 +1,46 @@
+#ifndef GUARDADO_H
+#define GUARDADO_H
+
+#include "image.h"
+
+// QUÉ: Guardado en segundo plano para el menú interactivo.
+// CÓMO: Guardar toma una instantánea de la imagen sin copiar píxeles: el
+// bloque de la matriz pasa a estar compartido (compartirImagen, con un
+// contador de referencias) entre el menú y los trabajos pendientes, que un
+// hilo propio codifica y escribe en orden. Si el menú va a modificar la
+// imagen mientras la comparte (con guardados o con el historial), primero se
+// queda con una copia privada (copia en escritura) y el bloque original
+// sigue siendo de los demás; el último en soltarlo lo libera.
+// POR QUÉ: Codificar un PNG grande con el perfil máximo tarda segundos y el
+// menú quedaba bloqueado en guardarPNG; así se puede seguir editando.
+// Todas las funciones se llaman solo desde el hilo del menú.
+
+// QUÉ: Encolar el guardado de la imagen actual en ruta.
+// CÓMO: Formato por la extensión (guardarImagenConPerfil) y el perfil PNG
+// vigente al pedirlo. Si la cola está llena, espera a que haya hueco.
+// Devuelve 1 si el trabajo quedó encolado, 0 en caso de error.
+int guardarEnSegundoPlano(const ImagenInfo* imagen, const char* ruta);
+
+// QUÉ: Preparar la imagen para modificarla en su sitio (brillo, ...).
+// CÓMO: Si otros comparten su bloque (guardados pendientes, historial), la
+// sustituye por una copia privada; si no, no hace nada. Los filtros que
+// crean una imagen nueva no la necesitan (ver compartirImagen).
+// Devuelve 1 si se puede modificar, 0 si no hubo memoria para la copia.
+int prepararModificacion(ImagenInfo* imagen);
+
+// QUÉ: Soltar la imagen del menú.
+// CÓMO: Suelta la referencia del menú (liberarImagen); si la comparten
+// guardados pendientes, el bloque se libera al terminar el último de ellos.
+void soltarImagen(ImagenInfo* imagen);
+
+// QUÉ: Esperar a que terminen todos los guardados encolados.
+// CÓMO: Cierra el hilo de guardado; el siguiente guardado lo vuelve a crear.
+// POR QUÉ: Al salir, y antes de cambiar NUM_HILOS_GLOBAL, que el codificador
+// lee mientras trabaja.
+void esperarGuardados(void);
+
+// QUÉ: Imprimir el estado de los guardados (pendientes y último resultado).
+// CÓMO: No imprime nada si todavía no se ha guardado en segundo plano.
+void imprimirEstadoGuardados(void);
+
+#endif // GUARDADO_H
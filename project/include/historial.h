@@ -0,0 +1,102 @@
+#ifndef HISTORIAL_H
+#define HISTORIAL_H
+
+#include "image.h"
+#include <stddef.h>
+
+// QUÉ: Historial de versiones de la imagen del menú, para deshacer y rehacer.
+// CÓMO: Cada versión es una rejilla de teselas de TAM_TESELA_HISTORIAL x
+// TAM_TESELA_HISTORIAL píxeles con contador de referencias. Al registrar una
+// versión nueva se indica la región que cambió: las teselas que no la tocan
+// son el mismo puntero que en la versión anterior (una referencia más).
+//   - Región = imagen entera (cargar, blur, rotar, ...): la versión adopta la
+//     imagen del menú sin copiarla (compartirImagen) y sus teselas son
+//     vistas de ese bloque.
+//   - Región parcial (brillo en una región): se copian solo las teselas
+//     tocadas.
+// Las teselas guardadas nunca cambian. La imagen de trabajo sigue siendo un
+// ImagenInfo contiguo (los filtros lo necesitan); los que crean una imagen
+// nueva solo leen la adoptada, y antes de escribir en su sitio se llama a
+// prepararEdicion, que copia las vistas de la región que se va a escribir.
+// Deshacer reutiliza el bloque adoptado de la versión de destino o copia en
+// la imagen solo las teselas en que difieren la versión actual y la de
+// destino.
+// POR QUÉ: Con la matriz contigua, registrar o deshacer exigía una copia
+// completa de la imagen por paso; así un filtro completo cuesta O(teselas)
+// punteros y un cambio en una región, sus teselas.
+// Todas las funciones se llaman solo desde el hilo del menú.
+
+// QUÉ: Lado de las teselas (píxeles).
+// POR QUÉ: 64x64 RGBA son 16 KB: una región pequeña se copia con pocas
+// teselas y una imagen de 3000x2000 tiene unos 1500 punteros por versión.
+#define TAM_TESELA_HISTORIAL 64
+
+// QUÉ: Versiones que se conservan; al pasar de ahí se olvida la más antigua.
+#define MAX_VERSIONES_HISTORIAL 24
+
+// QUÉ: Memoria máxima del historial (MB de píxeles únicos, ver
+// memoriaHistorial); al pasar de ahí se olvidan las versiones más antiguas,
+// aunque no se llegue a MAX_VERSIONES_HISTORIAL. La actual se conserva
+// siempre.
+// POR QUÉ: Con 24 versiones de una imagen RGB de 60 MP serían unos 4 GB.
+#define MEMORIA_MAXIMA_HISTORIAL_MB 1024
+
+// QUÉ: Empezar un historial nuevo con la imagen recién cargada.
+// CÓMO: Descarta el anterior; la versión 0 adopta la imagen.
+// Devuelve 1 si tuvo éxito, 0 si falta memoria (el historial queda vacío).
+int iniciarHistorial(const ImagenInfo* imagen, const char* descripcion);
+
+// QUÉ: Registrar la imagen de trabajo como versión nueva tras una edición.
+// CÓMO: (x, y, ancho, alto) es la región que pudo cambiar; fuera de ella la
+// imagen debe ser idéntica a la versión actual. Si es toda la imagen, o
+// cambiaron las dimensiones o los canales, se adopta. Las versiones que se
+// podían rehacer se descartan.
+// Devuelve 1 si tuvo éxito, 0 si falta memoria (se vacía el historial).
+int registrarVersion(const ImagenInfo* imagen, const char* descripcion, int x, int y, int ancho, int alto);
+
+// QUÉ: Registrar una edición de la imagen completa.
+int registrarVersionCompleta(const ImagenInfo* imagen, const char* descripcion);
+
+// QUÉ: Preparar la imagen del menú para escribir en su sitio en la región
+// (x, y, ancho, alto) (brillo, ...).
+// CÓMO: Si la comparten guardados pendientes, prepararModificacion
+// (guardado.h); si la comparte el historial, copia las teselas que la miran
+// en esa región.
+// Devuelve 1 si se puede escribir, 0 si falta memoria.
+int prepararEdicion(ImagenInfo* imagen, int x, int y, int ancho, int alto);
+
+// QUÉ: Volver a la versión anterior (deshacer) o a la siguiente (rehacer).
+// CÓMO: Si el destino es una imagen adoptada entera, la imagen pasa a ser
+// ese bloque; si las dimensiones coinciden se copian en la imagen solo las
+// teselas cuyo puntero difiere entre las dos versiones; si no, se
+// reconstruye la imagen entera.
+// Devuelve 1 si cambió la imagen, 0 si no había a dónde ir o hubo error.
+int deshacer(ImagenInfo* imagen);
+int rehacer(ImagenInfo* imagen);
+
+// QUÉ: Devolver la imagen a la versión actual cuando una edición falla
+// después de escribir parte de ella (brillo sin hilos, ...).
+// CÓMO: Copia las teselas de la versión actual que no comparte ya la imagen
+// (o reconstruye la imagen, si cambió de tamaño). Sin ella, la imagen y el
+// historial dejarían de coincidir y deshacer restauraría solo parte.
+// Devuelve 1 si la imagen vuelve a coincidir, 0 si no hay historial o falta
+// memoria.
+int restaurarVersionActual(ImagenInfo* imagen);
+
+// QUÉ: Memoria del historial.
+// CÓMO: unicos = bytes de teselas copiadas distintas más los bloques
+// adoptados enteros (lo que ocupa de verdad; el de la versión actual suele
+// ser también la imagen del menú); compartidos = bytes que ocuparían de más
+// si cada versión tuviera su copia.
+void memoriaHistorial(size_t* unicos, size_t* compartidos);
+
+// QUÉ: Imprimir las versiones (marcando la actual) y la memoria.
+void imprimirHistorial(void);
+
+// QUÉ: Línea de estado breve para el menú (nada si el historial está vacío).
+void imprimirEstadoHistorial(void);
+
+// QUÉ: Liberar todas las versiones.
+void liberarHistorial(void);
+
+#endif // HISTORIAL_H
@@ -1,32 +1,179 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <stddef.h>
+
 // QUÉ: Estructura para almacenar la imagen (ancho, alto, canales, píxeles).
 // CÓMO: Usa matriz 3D para píxeles (alto x ancho x canales), donde canales es
-// 1 (grises) o 3 (RGB). Píxeles son unsigned char (0-255).
+// 1 (grises), 2 (grises + alfa), 3 (RGB) o 4 (RGBA); el alfa siempre es el
+// último canal y no está premultiplicado. profundidad son los bits por
+// muestra: 8 (unsigned char, 0-255) o 16 (unsigned short en el orden nativo,
+// 0-65535); pixeles[y][x] apunta al primer byte del píxel y con 16 bits se
+// lee como unsigned short. Si relleno vale 1 la imagen es RGBX: 4 canales
+// donde el cuarto no es alfa sino relleno (siempre al máximo) que los
+// guardados descartan. Los datos viven en un bloque contiguo (ver
+// crearImagen): cada fila ocupa ancho*bytesPixel(info) bytes.
 // POR QUÉ: Permite manejar tanto grises como color, con memoria dinámica para
-// flexibilidad y evitar desperdicio.
+// flexibilidad y evitar desperdicio; RGBX alinea cada píxel a 4 muestras.
 typedef struct {
     int ancho;           // Ancho de la imagen en píxeles
     int alto;            // Alto de la imagen en píxeles
-    int canales;         // 1 (escala de grises) o 3 (RGB)
-    unsigned char*** pixeles; // Matriz 3D: [alto][ancho][canales]
+    int canales;         // 1 (grises), 2 (grises + alfa), 3 (RGB) o 4 (RGBA/RGBX)
+    int profundidad;     // Bits por muestra: 8 o 16 (0 en una imagen vacía)
+    int relleno;         // 1 si el cuarto canal es relleno (RGBX), no alfa
+    unsigned char*** pixeles; // Matriz 3D: [alto][ancho][canales * bytes por muestra]
 } ImagenInfo;
 
+// QUÉ: Bytes por muestra (1 u 2) y por píxel.
+// CÓMO: Cualquier profundidad que no sea 16 cuenta como 8 bits.
+static inline int bytesMuestra(const ImagenInfo* info) {
+    return info->profundidad == 16 ? 2 : 1;
+}
+
+static inline int bytesPixel(const ImagenInfo* info) {
+    return info->canales * bytesMuestra(info);
+}
+
+// QUÉ: Valor máximo de una muestra (255 o 65535).
+static inline int maximoMuestra(const ImagenInfo* info) {
+    return info->profundidad == 16 ? 65535 : 255;
+}
+
+// QUÉ: Canales con información (RGBX cuenta como RGB).
+static inline int canalesVisibles(const ImagenInfo* info) {
+    return info->relleno ? 3 : info->canales;
+}
+
+// QUÉ: Leer y escribir la muestra i de una fila de 8 (bytes = 1) o 16 bits
+// (bytes = 2).
+// CÓMO: Los núcleos las llaman con bytes constante dentro de funciones
+// always_inline, así cada tipo de muestra tiene su copia sin saltos.
+static inline unsigned int leerMuestra(const unsigned char* fila, size_t i, int bytes) {
+    return bytes == 2 ? ((const unsigned short*)fila)[i] : fila[i];
+}
+
+static inline void escribirMuestra(unsigned char* fila, size_t i, unsigned int valor, int bytes) {
+    if (bytes == 2) {
+        ((unsigned short*)fila)[i] = (unsigned short)valor;
+    } else {
+        fila[i] = (unsigned char)valor;
+    }
+}
+
+// QUÉ: Reservar una imagen nueva (sin inicializar) de ancho x alto x canales.
+// CÓMO: Un solo bloque contiguo de datos más los arreglos de punteros que
+// forman la matriz 3D; pixeles[y][0] apunta a una fila de ancho*canales bytes.
+// El bloque empieza con una referencia (ver compartirImagen). La imagen es
+// de 8 bits y sin relleno.
+// POR QUÉ: Centraliza la reserva y garantiza filas contiguas para memcpy/SIMD.
+// Devuelve 1 si tuvo éxito, 0 si falla la memoria o las dimensiones.
+int crearImagen(ImagenInfo* info, int ancho, int alto, int canales);
+
+// QUÉ: Igual que crearImagen con profundidad (8 o 16) y relleno explícitos.
+// relleno solo se admite con 4 canales.
+int crearImagenFormato(ImagenInfo* info, int ancho, int alto, int canales, int profundidad, int relleno);
+
+// QUÉ: Reservar una imagen de ancho x alto con el formato de 'modelo'
+// (canales, profundidad y relleno). Es la forma de crear el destino de un
+// filtro que no cambia el formato de píxel.
+int crearImagenComo(ImagenInfo* info, const ImagenInfo* modelo, int ancho, int alto);
+
+// QUÉ: Enlazar los punteros [y][x] de una matriz 3D sobre un bloque contiguo.
+// CÓMO: filas debe tener alto entradas y punteros alto*ancho; no reserva nada.
+// bytesPixel es el tamaño de cada píxel (canales * bytes por muestra).
+// POR QUÉ: Permite crear vistas ImagenInfo sobre memoria ajena (no deben
+// liberarse con liberarImagen).
+void enlazarMatriz(unsigned char*** filas, unsigned char** punteros, unsigned char* datos,
+                   int ancho, int alto, int bytesPixel);
+
 // QUÉ: Liberar memoria asignada para la imagen.
-// CÓMO: Libera cada fila y canal de la matriz 3D, luego el arreglo de filas y
-// reinicia la estructura.
+// CÓMO: Suelta la referencia de 'info' y reinicia la estructura; las reservas
+// hechas por crearImagen se liberan al soltar la última.
 // POR QUÉ: Evita fugas de memoria, esencial en C para manejar recursos manualmente.
 void liberarImagen(ImagenInfo* info);
 
+// QUÉ: Compartir el bloque de una imagen sin copiar píxeles.
+// CÓMO: 'copia' recibe la misma matriz y una referencia más (atómica: la
+// puede soltar otro hilo). Cada referencia se suelta con liberarImagen.
+// Mientras haya más de una, nadie debe escribir en los píxeles: quien
+// quiera modificarla pide antes una copia privada (prepararModificacion en
+// el menú). Los filtros que sustituyen la imagen por otra nueva (blur,
+// rotar, escalar, ...) sí pueden recibirla compartida: solo la leen y
+// sueltan su referencia.
+// POR QUÉ: Los guardados en segundo plano y el historial del menú se
+// quedan con la imagen tal como está sin copiarla.
+void compartirImagen(const ImagenInfo* origen, ImagenInfo* copia);
+
+// QUÉ: Referencias vivas al bloque de la imagen (1 si solo es de 'info').
+int referenciasImagen(const ImagenInfo* info);
+
 // QUÉ: Verificar si hay una imagen cargada en memoria.
 // CÓMO: Comprueba que el puntero de píxeles no sea NULL.
 // POR QUÉ: Evita código repetitivo y centraliza la validación.
 int imagenCargada(const ImagenInfo* info);
 
+// QUÉ: ¿El último canal es alfa? (2 o 4 canales)
+int tieneAlfa(int canales);
+
+// QUÉ: ¿La imagen tiene alfa? Como tieneAlfa, pero RGBX no cuenta.
+int imagenConAlfa(const ImagenInfo* info);
+
+// QUÉ: Nombre del formato de píxel para los mensajes ("grises", "RGBA", ...).
+const char* nombreFormato(int canales);
+
+// QUÉ: Nombre del formato de una imagen, con RGBX y la profundidad
+// ("RGBX", "grises, 16 bits", ...).
+const char* nombreFormatoImagen(const ImagenInfo* info);
+
+// QUÉ: Convertir una fila de ancho píxeles RGB (canales = 3) o RGBA (canales = 4)
+// a escala de grises con ponderación BT.601.
+// POR QUÉ: Compartida por convertirAGrayscale y los cargadores que decodifican
+// directamente a grises, para que ambos caminos den los mismos valores.
+void filaAGrises(const unsigned char* origen, int canales, unsigned char* destino, int ancho);
+
+// QUÉ: Convertir una fila RGBA a grises + alfa (el alfa se copia tal cual).
+void filaAGrisesConAlfa(const unsigned char* origen, unsigned char* destino, int ancho);
+
+// QUÉ: filaAGrises y filaAGrisesConAlfa para muestras de bytesMuestra bytes
+// (1 u 2; con 2 las filas son de unsigned short).
+void filaAGrisesMuestras(const unsigned char* origen, int canales, unsigned char* destino, int ancho,
+                         int bytesMuestra);
+void filaAGrisesConAlfaMuestras(const unsigned char* origen, unsigned char* destino, int ancho,
+                                int bytesMuestra);
+
+// QUÉ: Pasar 'ancho' píxeles RGB a RGBX (relleno al máximo) y al revés.
+// CÓMO: ensancharFilaRGBX recorre de derecha a izquierda, así que puede
+// trabajar en su sitio (origen == destino); compactarFilaRGBX recorre de
+// izquierda a derecha y también. bytesMuestra es 1 u 2.
+// POR QUÉ: Los cargadores reciben RGB empaquetado y los formatos de archivo
+// no tienen RGBX.
+void ensancharFilaRGBX(const unsigned char* origen, unsigned char* destino, size_t ancho, int bytesMuestra);
+void compactarFilaRGBX(const unsigned char* origen, unsigned char* destino, size_t ancho, int bytesMuestra);
+
+// QUÉ: Obtener una versión de 8 bits de la imagen para lo que solo admite 8.
+// CÓMO: Si ya es de 8 bits, 'destino' comparte el bloque (compartirImagen);
+// si es de 16, recibe una copia redondeada con (v*255+32767)/65535. En ambos
+// casos se suelta con liberarImagen. El relleno se conserva.
+// POR QUÉ: Los niveles de la pirámide y las teselas solo existen en 8 bits.
+// Devuelve 1 si tuvo éxito, 0 si falta memoria.
+int imagenEn8Bits(const ImagenInfo* origen, ImagenInfo* destino);
+
+// QUÉ: Versión de la imagen que admite un formato de archivo: sin relleno y,
+// si admite16 es 0, de 8 bits.
+// CÓMO: Como imagenEn8Bits: comparte el bloque si no hay nada que cambiar y
+// si no hace la copia (compactada y redondeada) en una sola pasada.
+// POR QUÉ: Ningún formato guarda RGBX, y QOI y los de stb_image_write
+// solo tienen 8 bits.
+int imagenParaGuardar(const ImagenInfo* origen, ImagenInfo* destino, int admite16);
+
 // QUÉ: Convertir imagen RGB a escala de grises.
-// CÓMO: Usa ponderación perceptual (0.299R + 0.587G + 0.114B).
+// CÓMO: Usa ponderación perceptual (0.299R + 0.587G + 0.114B). RGBA pasa a
+// grises + alfa (el alfa se copia) y RGBX a grises; 1 y 2 canales ya son grises.
 // POR QUÉ: Sobel requiere imagen de un solo canal para calcular gradientes.
 int convertirAGrayscale(ImagenInfo* info);
 
+// QUÉ: Reducir la imagen a un único canal de luma, descartando el alfa.
+// POR QUÉ: Sobel y los histogramas solo miran la luminancia.
+int convertirALuma(ImagenInfo* info);
+
 #endif // IMAGE_H
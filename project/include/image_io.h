@@ -2,22 +2,77 @@
 #define IMAGE_IO_H
 
 #include "image.h"
+#include "png_encoder.h"
+#include <stddef.h>
+
+// QUÉ: Indica si se puede preguntar al usuario por la entrada estándar.
+// CÓMO: Vale 1 en el menú; el modo por lotes lo pone a 0 y las imágenes muy
+// grandes se cargan solo con un aviso en vez de pedir confirmación.
+// POR QUÉ: En una ejecución sin terminal la pregunta bloquearía el lote o
+// consumiría datos de la entrada estándar.
+extern int MODO_INTERACTIVO;
 
 // QUÉ: Cargar una imagen PNG desde un archivo.
-// CÓMO: Usa stbi_load para leer el archivo, detecta canales (1 o 3), y convierte
-// los datos a una matriz 3D (alto x ancho x canales).
+// CÓMO: Usa stbi_load para leer el archivo, detecta canales (1 a 4, con alfa
+// si lo tiene; 16 bits se conservan) y convierte los datos a una matriz 3D
+// (alto x ancho x canales); RGB se ensancha a RGBX. Los archivos QOI y
+// PNM se detectan por sus bytes mágicos (cargarQOI, cargarPNM); la ruta "-"
+// lee un PNM de la entrada estándar. Los PNG los decodifica png_decoder si
+// DECODIFICADOR_PNG_PROPIO vale 1 (stb solo para Adam7 y tRNS), con los
+// mismos píxeles que stb.
 // POR QUÉ: La matriz 3D es intuitiva para principiantes y permite procesar
-// píxeles y canales individualmente.
+// píxeles y canales individualmente; con 4 muestras por píxel los filtros
+// trabajan siempre con píxeles alineados.
 int cargarImagen(const char* ruta, ImagenInfo* info);
 
+// QUÉ: Cargar una imagen decodificando directamente al número de canales pedido.
+// CÓMO: canalesDeseados = 1 reduce a luma (filaAGrises) durante la copia del
+// decodificador a la matriz, en PNG/JPG, QOI y PPM/PAM; el alfa se conserva,
+// así que RGBA da 2 canales, igual que convertirAGrayscale. 0 conserva el
+// formato nativo, igual que cargarImagen.
+// POR QUÉ: Si el proceso solo usa luma (Sobel, grises) se evita la pasada de
+// convertirAGrayscale y la imagen ocupa un tercio de la memoria.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int cargarImagenCanales(const char* ruta, ImagenInfo* info, int canalesDeseados);
+
+// QUÉ: Cargar una imagen cuyo archivo ya está en memoria (lectura anticipada
+// del lote, ver async_io.h).
+// CÓMO: Igual que cargarImagenCanales con stbi_load_from_memory (o
+// decodificarPNGMemoriaPorFilas) y cargarQOIMemoria; PNM se lee por la ruta porque su lector copia la trama
+// del descriptor directamente a la matriz. La ruta se usa en los mensajes.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int cargarImagenMemoria(const unsigned char* datos, size_t tam, const char* ruta, ImagenInfo* info,
+                        int canalesDeseados);
+
 // QUÉ: Mostrar la matriz de píxeles (primeras 10 filas).
-// CÓMO: Imprime los valores de los píxeles, agrupando canales por píxel (grises o RGB).
+// CÓMO: Imprime los valores de los píxeles, agrupando canales por píxel.
 // POR QUÉ: Ayuda a visualizar la matriz para entender la estructura de datos.
 void mostrarMatriz(const ImagenInfo* info);
 
-// QUÉ: Guardar la matriz como PNG (grises o RGB).
-// CÓMO: Aplana la matriz 3D a 1D y usa stbi_write_png con el número de canales correcto.
-// POR QUÉ: Respeta el formato original (grises o RGB) para consistencia.
+// QUÉ: Guardar la matriz como PNG (1 a 4 canales).
+// CÓMO: Usa el codificador paralelo (escribirPNGParalelo) con el perfil
+// PERFIL_PNG_GLOBAL e informa del tiempo y el ratio; si falla, usa
+// stbi_write_png sobre una copia de 8 bits sin relleno (imagenParaGuardar).
+// POR QUÉ: Respeta el formato original (grises, grises + alfa, RGB o RGBA).
 int guardarPNG(const ImagenInfo* info, const char* rutaSalida);
 
+// QUÉ: Guardar la imagen eligiendo el formato por la extensión.
+// CÓMO: ".qoi" -> guardarQOI, ".qoip" -> guardarQOIParalelo, ".pgm"/".ppm"/
+// ".pnm"/".pam" o "-" (salida estándar) -> guardarPNM, otra -> guardarPNG.
+// POR QUÉ: QOI es mucho más rápido para archivos intermedios y de caché.
+int guardarImagen(const ImagenInfo* info, const char* rutaSalida);
+
+// QUÉ: guardarImagen con el perfil PNG indicado en vez de PERFIL_PNG_GLOBAL.
+// POR QUÉ: Un guardado en segundo plano usa el perfil vigente al pedirlo,
+// aunque el menú lo cambie mientras se codifica.
+int guardarImagenConPerfil(const ImagenInfo* info, const char* rutaSalida, PerfilPNG perfil);
+
+// QUÉ: Codificar la imagen en memoria en vez de escribirla.
+// CÓMO: PNG con codificarPNGParaleloMemoria (respaldo: stb); *datos se libera
+// con free. QOI y PNM se escriben a medida que se codifican, así que para
+// ellos devuelve -1 y se usa guardarImagen.
+// Devuelve 1 si tuvo éxito, 0 en caso de error, -1 si el formato no aplica.
+int codificarImagenMemoria(const ImagenInfo* info, const char* rutaSalida, unsigned char** datos,
+                           size_t* tam);
+
 #endif // IMAGE_IO_H
@@ -43,6 +43,7 @@ typedef struct {
     int srcWidth;                  /**< Width of the source image. */
     int srcHeight;                 /**< Height of the source image. */
     int channels;                  /**< Number of channels (1 for grayscale, 3 for RGB). */
+    int linearLight;               /**< Non-zero to interpolate in linear light (LUZ_LINEAL_GLOBAL). */
 } RotationThreadArgs;
 
 /**
@@ -0,0 +1,85 @@
+#ifndef OPERACIONES_H
+#define OPERACIONES_H
+
+#include "image.h"
+#include <stddef.h>
+
+// QUÉ: Cadena declarativa de operaciones, por ejemplo "blur:5,1.5|sobel|scale:800x600".
+// CÓMO: Operaciones separadas por '|'; cada una es un nombre y, tras ':',
+// sus parámetros separados por ','. Se interpreta una sola vez y luego se
+// aplica a cada imagen del lote.
+// POR QUÉ: Permite describir el procesado en la línea de órdenes y reutilizar
+// los mismos filtros que el menú sin preguntas interactivas.
+//
+// Operaciones:
+//   blur[:tam[,sigma]]        Gaussiano (por defecto 5, 1.0)
+//   sobel                     Bordes (convierte a grises)
+//   brightness:delta          Brillo (-255..255)
+//   rotate:grados             Rotación
+//   scale:AxB[,modo]          Escalado; A o B a 0 conserva la proporción;
+//   scale:P%[,modo]           modo = auto | bilinear | area | nearest
+//   gray                      Escala de grises
+
+typedef enum {
+    OP_BLUR,
+    OP_SOBEL,
+    OP_BRILLO,
+    OP_ROTAR,
+    OP_ESCALAR,
+    OP_GRISES
+} TipoOperacion;
+
+// QUÉ: Una operación con sus parámetros ya interpretados.
+typedef struct {
+    TipoOperacion tipo;
+    int entero[3];          // blur: tam; brightness: delta; scale: ancho, alto, modo
+    float real;             // blur: sigma; rotate: grados; scale: porcentaje (0 = usar ancho/alto)
+} Operacion;
+
+typedef struct {
+    Operacion* ops;
+    int numOps;
+} CadenaOperaciones;
+
+// QUÉ: Interpretar el texto de la cadena.
+// Devuelve 1 si es válida; si no, imprime en stderr la operación culpable y devuelve 0.
+int interpretarCadena(const char* texto, CadenaOperaciones* cadena);
+
+// QUÉ: Añadir una operación al final de la cadena.
+// CÓMO: Para construir cadenas desde código (el menú, el grafo de grafo.h)
+// sin pasar por el texto. Devuelve 1 si tuvo éxito, 0 si falta memoria.
+int agregarOperacion(CadenaOperaciones* cadena, const Operacion* op);
+
+// QUÉ: Aplicar una operación con su filtro de imagen completa.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int aplicarOperacion(ImagenInfo* imagen, const Operacion* op);
+
+// QUÉ: 1 si aplicarOperacion escribe en los píxeles de la imagen que recibe
+// (brightness; sobel sobre grises); 0 si solo la lee y la sustituye por una
+// nueva, de modo que puede recibirla compartida (ver compartirImagen).
+int operacionEnSuSitio(const Operacion* op, int canales);
+
+// QUÉ: Aplicar todas las operaciones en orden sobre la imagen.
+// CÓMO: Cada filtro reparte su trabajo en NUM_HILOS_GLOBAL hilos y recorre la
+// imagen completa; planificarCadena (grafo.h) hace lo mismo en menos pasadas.
+// Devuelve 1 si todas tuvieron éxito, 0 en cuanto una falla.
+int aplicarCadena(ImagenInfo* imagen, const CadenaOperaciones* cadena);
+
+// QUÉ: Dimensiones de salida de una operación scale sobre una imagen ancho x alto.
+void dimensionesEscala(const Operacion* op, int ancho, int alto, int* nuevoAncho, int* nuevoAlto);
+
+// QUÉ: Número de canales con que conviene decodificar para esta cadena.
+// CÓMO: Devuelve 1 si la cadena llega a sobel o gray pasando solo por
+// operaciones lineales por canal (blur, rotate, scale), que conmutan con la
+// ponderación de luma salvo el redondeo (±1); 0 (formato nativo) en otro caso.
+// POR QUÉ: Con 1 se decodifica directamente a grises (cargarImagenCanales) y
+// las operaciones previas trabajan con un tercio de los datos.
+int canalesNecesarios(const CadenaOperaciones* cadena);
+
+// QUÉ: Escribir la cadena en forma canónica (parámetros explícitos).
+void describirCadena(const CadenaOperaciones* cadena, char* salida, size_t tam);
+
+// QUÉ: Liberar la cadena.
+void liberarCadena(CadenaOperaciones* cadena);
+
+#endif // OPERACIONES_H
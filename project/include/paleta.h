@@ -0,0 +1,72 @@
+#ifndef PALETA_H
+#define PALETA_H
+
+#include "image.h"
+#include "threading.h"
+#include <stddef.h>
+
+// QUÉ: Cuándo escribe guardarPNG una imagen indexada (PLTE) en vez de
+// muestras de 8 bits.
+// CÓMO:
+//   PALETA_NO:        siempre gris/RGB/RGBA de 8 bits, como antes.
+//   PALETA_EXACTA:    solo si la imagen cabe sin pérdida: RGB/RGBA con hasta
+//                     COLORES_PALETA_GLOBAL colores, o grises cuyos niveles
+//                     caben en 1, 2 o 4 bits.
+//   PALETA_CUANTIZAR: como la exacta y, si no cabe, reduce RGB a
+//                     COLORES_PALETA_GLOBAL colores (con pérdida) y grises a
+//                     2, 4 o 16 niveles si se piden 16 colores o menos.
+// POR QUÉ: Mapas de bordes, máscaras y recursos de interfaz tienen pocos
+// colores; con índices de 1-8 bits el archivo y el trabajo de deflate bajan.
+typedef enum {
+    PALETA_NO = 0,
+    PALETA_EXACTA = 1,
+    PALETA_CUANTIZAR = 2
+} ModoPaleta;
+
+// QUÉ: Modo y número máximo de colores (2-256) que usa el codificador PNG.
+extern ModoPaleta MODO_PALETA_GLOBAL;
+extern int COLORES_PALETA_GLOBAL;
+
+// QUÉ: Nombre legible de un modo ("no", "exacta", "cuantizar").
+const char* nombreModoPaleta(ModoPaleta modo);
+
+// QUÉ: Paleta de hasta 256 colores.
+// CÓMO: canales es el de la imagen (1, 3 o 4); cada entrada guarda sus
+// canales al principio de colores[i] (en grises, colores[i][0] es el nivel).
+typedef struct {
+    int numColores;
+    int canales;
+    unsigned char colores[256][4];
+} Paleta;
+
+// QUÉ: Buscar los colores distintos de la imagen si son como mucho maxColores.
+// CÓMO: Cada tarea del pool recorre un rango de filas con una tabla hash
+// pequeña y se detiene en cuanto supera el límite (o lo supera otra tarea);
+// después se unen los conjuntos. La paleta queda ordenada por valor, con las
+// entradas translúcidas primero (así el chunk tRNS es más corto).
+// POR QUÉ: En una foto se aborta tras unos pocos miles de píxeles, así que
+// comprobarlo antes de cada guardado sale casi gratis.
+// Devuelve 1 si la imagen cabe en la paleta, 0 si tiene más colores o hubo error.
+int buscarPaletaExacta(const ImagenInfo* info, int maxColores, PoolHilos* pool, Paleta* paleta);
+
+// QUÉ: Reducir una imagen RGB a numColores colores (2-256).
+// CÓMO: Histograma de 5 bits por canal sobre una muestra de ~1M píxeles
+// (histogramas por tarea que luego se suman), corte por la mediana de la caja
+// con más error cuadrático y dos iteraciones de k-means sobre las celdas.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int cuantizarPaleta(const ImagenInfo* info, int numColores, PoolHilos* pool, Paleta* paleta);
+
+// QUÉ: Bytes de una fila de índices de ancho píxeles a bits por píxel.
+size_t bytesFilaIndexada(int ancho, int bits);
+
+// QUÉ: Convertir la imagen en filas de índices empaquetados (1, 2, 4 u 8 bits,
+// el píxel de la izquierda en los bits altos, como pide PNG).
+// CÓMO: Con exacta = 1 cada color se busca en una tabla hash de la paleta;
+// si no, se usa el color más cercano (distancia euclídea) con SSE2/AVX2 y una
+// caché por tarea de los colores ya vistos. En grises se usa una tabla de 256
+// niveles. destino recibe alto * bytesFilaIndexada(ancho, bits) bytes.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int indexarImagen(const ImagenInfo* info, const Paleta* paleta, int exacta, int bits, PoolHilos* pool,
+                  unsigned char* destino);
+
+#endif // PALETA_H
@@ -0,0 +1,54 @@
+#ifndef PEREZOSO_H
+#define PEREZOSO_H
+
+#include "image.h"
+#include "operaciones.h"
+
+// QUÉ: Evaluación perezosa para el menú interactivo.
+// CÓMO: Con MODO_PEREZOSO_GLOBAL activo, brillo, blur, Sobel, rotar y escalar
+// no tocan la imagen: se añaden a una cadena pendiente, simplificándola con
+// la última operación (ver posponerOperacion). La cadena se ejecuta de una
+// vez, con el plan fusionado de grafo.h, cuando algo necesita los píxeles:
+// guardar, mostrar la matriz, el benchmark, la información, la pirámide o
+// las teselas (materializarImagen).
+// POR QUÉ: En una sesión se prueba una operación, se cambia de idea y se
+// aplica otra antes de guardar; así los pasos que se anulan no se calculan y
+// los que quedan se ejecutan en menos pasadas.
+// Todas las funciones se llaman solo desde el hilo del menú.
+
+// QUÉ: 1 si las operaciones del menú se posponen (por defecto 0).
+extern int MODO_PEREZOSO_GLOBAL;
+
+// QUÉ: Añadir una operación a la cadena pendiente.
+// CÓMO: Se compara con la última pendiente:
+//   brightness tras brightness del mismo signo: se suman (con la saturación
+//     el resultado es idéntico); brightness:0 desaparece. Con signos
+//     opuestos no son equivalentes a uno solo, pero el plan los compone en
+//     una tabla y no cuestan una pasada más.
+//   rotate tras rotate: se suman los ángulos (un solo remuestreo, con el
+//     lienzo de la rotación total); si la suma es múltiplo de 360, ambas
+//     desaparecen.
+//   scale tras scale: queda solo el último tamaño, escalado una vez.
+//   gray tras gray: el segundo no hace nada.
+// Los parámetros de blur se validan aquí, como haría el filtro.
+// Devuelve 1 si se aceptó, 0 si no es válida o falta memoria.
+int posponerOperacion(const Operacion* op);
+
+// QUÉ: Ejecutar las operaciones pendientes sobre la imagen del menú.
+// CÓMO: Copia en escritura si un guardado la comparte (guardado.h), plan
+// fusionado y ejecución por teselas. Si no hay pendientes no hace nada.
+// Devuelve 1 si la imagen está al día, 0 si falló (las pendientes se
+// descartan igualmente; la imagen puede quedar a medio procesar).
+int materializarImagen(ImagenInfo* imagen);
+
+// QUÉ: Olvidar las operaciones pendientes (al cargar otra imagen o salir).
+void descartarPendientes(void);
+
+// QUÉ: Número de operaciones pendientes.
+int numeroPendientes(void);
+
+// QUÉ: Imprimir la cadena pendiente y lo ahorrado hasta ahora (menú).
+// CÓMO: No imprime nada si el modo está desactivado y no hay pendientes.
+void imprimirPendientes(void);
+
+#endif // PEREZOSO_H
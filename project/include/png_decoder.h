@@ -0,0 +1,61 @@
+#ifndef PNG_DECODER_H
+#define PNG_DECODER_H
+
+#include <stddef.h>
+
+// QUÉ: Resultados de la decodificación por filas.
+// CÓMO: PNG_NO_SOPORTADO indica un archivo válido que esta ruta no procesa
+// (no es PNG, es entrelazado Adam7 o tiene transparencia tRNS, que stb_image
+// convierte en alfa); el llamador debe usar stb_image.
+#define PNG_OK 1
+#define PNG_ERROR 0
+#define PNG_NO_SOPORTADO (-1)
+
+// QUÉ: Cargar las imágenes PNG completas con este decodificador (1, por
+// defecto) o con stb_image (0).
+// CÓMO: Lo consultan cargarImagenCanales y cargarImagenMemoria; el modo por
+// lotes lo cambia con --png-decoder. Los píxeles son idénticos en ambos casos.
+// POR QUÉ: El inflate con tabla rápida y los filtros SIMD de este módulo son
+// más rápidos que los de stb; stb queda como respaldo y para comparar.
+extern int DECODIFICADOR_PNG_PROPIO;
+
+// QUÉ: Datos de la cabecera IHDR y formato de las filas entregadas.
+// CÓMO: 1 canal para grises, 2 para grises + alfa, 3 para RGB y paleta y 4
+// para RGBA. Las filas se entregan en 8 bits (las muestras de 16 bits se
+// redondean) salvo que alCabecera ponga bytesMuestra = 2 en un archivo de 16
+// bits: entonces son unsigned short en el orden nativo.
+typedef struct {
+    int ancho;
+    int alto;
+    int profundidad;     // Bits por muestra en el archivo (1, 2, 4, 8 o 16)
+    int tipoColor;       // 0 grises, 2 RGB, 3 paleta, 4 grises+alfa, 6 RGBA
+    int canalesSalida;   // 1 a 4
+    int bytesMuestra;    // 1 (por defecto) o 2, solo si profundidad == 16
+} CabeceraPNG;
+
+// QUÉ: Callbacks del decodificador. Devuelven 1 para continuar o 0 para abortar.
+// alCabecera puede cambiar cabecera->bytesMuestra (ver CabeceraPNG).
+typedef int (*AlRecibirCabecera)(void* contexto, CabeceraPNG* cabecera);
+typedef int (*AlRecibirFila)(void* contexto, const unsigned char* fila, int y);
+
+// QUÉ: Decodificar un PNG entregando cada fila en cuanto está lista.
+// CÓMO: Lee los chunks IDAT del archivo por bloques, los descomprime con un
+// inflate propio (ventana de 32 KB; códigos de hasta 10 bits resueltos con una
+// consulta a tabla, que emite dos literales cuando caben), deshace el filtro
+// de cada scanline con la fila anterior (Up con AVX2/SSE2; Sub, Average y
+// Paeth con SSE2 para 3 y 4 bytes por píxel, Sub también con 1) y convierte al
+// formato de salida antes de llamar a alFila(y) en orden. La fila entregada solo es
+// válida durante la llamada.
+// POR QUÉ: La memoria usada es O(ancho) (dos scanlines, la ventana y un búfer
+// de entrada) sin importar el alto, a diferencia de stbi_load que materializa
+// la imagen completa. Permite procesar imágenes enormes en flujo.
+// Devuelve PNG_OK, PNG_ERROR o PNG_NO_SOPORTADO.
+int decodificarPNGPorFilas(const char* ruta, AlRecibirCabecera alCabecera,
+                           AlRecibirFila alFila, void* contexto);
+
+// QUÉ: Igual que decodificarPNGPorFilas con el archivo ya en memoria
+// (lectura anticipada del lote). La ruta solo se usa en los mensajes.
+int decodificarPNGMemoriaPorFilas(const unsigned char* datos, size_t tam, const char* ruta,
+                                  AlRecibirCabecera alCabecera, AlRecibirFila alFila, void* contexto);
+
+#endif // PNG_DECODER_H
@@ -0,0 +1,113 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+#include "deflate.h"
+#include "image.h"
+#include <stdio.h>
+#include <stddef.h>
+
+// QUÉ: Perfiles de codificación PNG, del más rápido al más compacto.
+// CÓMO:
+//   PNG_ALMACENAR: sin filtro y bloques deflate almacenados (solo copia y sumas).
+//   PNG_RAPIDO:    filtro Paeth fijo y LZ77 voraz con un único candidato.
+//   PNG_DEFECTO:   filtro elegido por fila (heurística) y nivel medio.
+//   PNG_MAXIMO:    búsqueda de filtro por fila comprimiendo de prueba los cinco
+//                  candidatos y cadenas de hash largas.
+// POR QUÉ: Los archivos intermedios de un flujo solo necesitan velocidad; los
+// de entrega final, tamaño.
+typedef enum {
+    PNG_ALMACENAR = 0,
+    PNG_RAPIDO = 1,
+    PNG_DEFECTO = 2,
+    PNG_MAXIMO = 3
+} PerfilPNG;
+
+// QUÉ: Perfil usado por guardarPNG (se cambia desde el menú).
+extern PerfilPNG PERFIL_PNG_GLOBAL;
+
+// QUÉ: Resultado de una codificación: tiempo y tamaños para calcular el ratio.
+typedef struct {
+    double segundos;        // Tiempo de reloj de la codificación completa
+    size_t bytesCrudos;     // Bytes de píxeles sin comprimir (ancho * alto * bytes por píxel)
+    size_t bytesArchivo;    // Tamaño del archivo PNG escrito
+    int coloresPaleta;      // Entradas de la paleta (o niveles de gris) si se indexó; 0 si no
+    int bitsPixel;          // Bits por muestra del archivo (1, 2, 4, 8 o 16)
+    int paletaExacta;       // 1 si la paleta es sin pérdida, 0 si se cuantizó
+} EstadisticasPNG;
+
+// QUÉ: Nombre legible de un perfil ("almacenar", "rápido", ...).
+const char* nombrePerfilPNG(PerfilPNG perfil);
+
+// QUÉ: Guardar una imagen como PNG comprimiendo en paralelo.
+// CÓMO: 1) Los hilos eligen el filtro de cada scanline (fijo, heurístico o
+// por compresión de prueba, según el perfil) y la filtran. 2) El resultado se corta en trozos de
+// ~256 KB que se comprimen cada uno en un hilo, con los 32 KB previos como
+// diccionario y vaciado de sincronización al final (estilo pigz). 3) Cada
+// trozo va en su propio chunk IDAT con su CRC; el Adler-32 total se combina
+// a partir de los de cada trozo.
+// POR QUÉ: stbi_write_png comprime en un solo hilo y suele ser el paso más
+// lento del flujo; aquí la compresión escala con NUM_HILOS_GLOBAL y el
+// archivo sigue siendo un único flujo zlib válido.
+// Antes, según MODO_PALETA_GLOBAL (paleta.h), la imagen puede pasar a índices
+// de 1-8 bits (PLTE) o a grises de 1-4 bits; entonces se comprimen los índices.
+// Las imágenes de 16 bits se escriben con muestras de 16 bits (big-endian)
+// y nunca se indexan; las RGBX, como RGB desde una copia sin el relleno.
+// El perfil decide filtros y nivel de compresión; si estadisticas no es NULL
+// se rellena con el tiempo y los tamaños.
+// Devuelve 1 si el archivo se escribió, 0 en caso de error.
+int escribirPNGParalelo(const ImagenInfo* info, const char* ruta, PerfilPNG perfil,
+                        EstadisticasPNG* estadisticas);
+
+// QUÉ: Igual que escribirPNGParalelo, pero el archivo queda en memoria.
+// CÓMO: *datos se libera con free. El lote lo usa para escribir la salida en
+// segundo plano (ver async_io.h) mientras el hilo codifica la siguiente imagen.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int codificarPNGParaleloMemoria(const ImagenInfo* info, PerfilPNG perfil, unsigned char** datos, size_t* tam,
+                                EstadisticasPNG* estadisticas);
+
+// QUÉ: Codificador PNG incremental: recibe las filas de una en una.
+// Siempre escribe muestras de 8 bits (el flujo solo admite PNG de 8 bits):
+// sin ver la imagen entera no puede saber si cabe en una paleta.
+// CÓMO: Cada fila se filtra al llegar (mismos filtros y perfiles que
+// escribirPNGParalelo) y se añade a un búfer pendiente; cuando este supera un
+// trozo se comprime con los 32 KB anteriores como diccionario, se escribe como
+// chunk IDAT y solo se conservan esos 32 KB. Al terminar se cierra el flujo
+// zlib, se añade el Adler-32 y el IEND.
+// POR QUÉ: La memoria es O(ancho + trozo) sin importar el alto; permite
+// escribir la salida de una cadena en flujo sin materializar la imagen. La
+// compresión es secuencial (un trozo tras otro) porque cada trozo usa el final
+// del anterior.
+typedef struct {
+    FILE* archivo;
+    char* ruta;
+    PerfilPNG perfil;
+    int ancho;
+    int alto;
+    int canales;
+    size_t bytesFila;
+    int filasEscritas;
+    unsigned char* filaPrevia;      // Última fila recibida, sin filtrar
+    void* auxiliar;                 // Búferes de elección de filtro
+    BufferBytes pendiente;          // [diccionario (<= 32 KB) | filtrado sin comprimir]
+    size_t inicioPendiente;         // Primer byte aún sin comprimir
+    int trozos;                     // Chunks IDAT escritos
+    BufferBytes chunk;              // Chunk IDAT en preparación
+    unsigned long adler;            // Adler-32 de todos los datos filtrados
+    size_t bytesArchivo;
+    int ok;
+} CodificadorPNG;
+
+// QUÉ: Abrir ruta y escribir firma e IHDR. canales de 1 a 4.
+// Devuelve 1 si tuvo éxito; si no, imprime el error y devuelve 0.
+int iniciarCodificadorPNG(CodificadorPNG* codificador, const char* ruta, int ancho, int alto, int canales,
+                          PerfilPNG perfil);
+
+// QUÉ: Añadir la siguiente fila (ancho * canales bytes). Devuelve 1 si tuvo éxito.
+int escribirFilaPNG(CodificadorPNG* codificador, const unsigned char* fila);
+
+// QUÉ: Cerrar el archivo. Si se recibieron todas las filas y no hubo errores,
+// termina el PNG y devuelve 1; si no, borra el archivo incompleto y devuelve 0.
+// Libera siempre los recursos del codificador.
+int terminarCodificadorPNG(CodificadorPNG* codificador);
+
+#endif // PNG_ENCODER_H
@@ -0,0 +1,54 @@
+#ifndef PNM_H
+#define PNM_H
+
+#include "image.h"
+
+// QUÉ: Formatos PNM binarios: P5 (PGM, grises) y P6 (PPM, RGB), de 8 o 16 bits,
+// y P7 (PAM) para las imágenes con alfa (grises + alfa y RGBA).
+// CÓMO: Cabecera de texto ("P5 ancho alto maxval"; en PAM, líneas WIDTH,
+// HEIGHT, DEPTH, MAXVAL, TUPLTYPE y ENDHDR) seguida de las muestras
+// crudas (big-endian si maxval > 255). La ruta "-" es la entrada o la
+// salida estándar, para usar el programa en una tubería sin archivos temporales.
+// POR QUÉ: Las herramientas de cámara producen PGM/PPM; pasar por PNG solo
+// para llegar a cargarImagen cuesta una compresión y descompresión completas.
+
+// QUÉ: Descriptor al que guardarPNM escribe la ruta "-" (STDOUT_FILENO por
+// defecto).
+// POR QUÉ: El modo por lotes guarda aquí la salida estándar original y
+// desvía stdout a stderr, para que los mensajes no se mezclen con la imagen.
+extern int DESCRIPTOR_SALIDA_PNM;
+
+// QUÉ: Comprobar si un archivo empieza por "P5", "P6" o "P7".
+int esArchivoPNM(const char* ruta);
+
+// QUÉ: Cargar un PGM/PPM/PAM binario (ruta "-" = entrada estándar).
+// CÓMO: Lee la cabecera en un búfer pequeño y el resto de la trama con una
+// sola llamada read() directamente en el bloque de la imagen (en tuberías se
+// repite hasta completarla). Con maxval > 255 la imagen es de 16 bits (las
+// muestras pasan al orden nativo); un maxval distinto de 255 o 65535 se
+// reescala al máximo de su profundidad. Con canalesDeseados = 1 un PPM (o PAM RGBA) se
+// reduce a luma, conservando el alfa, al copiarlo; 0 conserva el formato,
+// salvo que un PPM se ensancha a RGBX.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int cargarPNM(const char* ruta, ImagenInfo* info, int canalesDeseados);
+
+// QUÉ: cargarPNM conservando el formato y sin el mensaje "Imagen cargada".
+// POR QUÉ: Para archivos internos (nivel de disco de la caché), cuya lectura
+// no es una carga que el usuario haya pedido.
+int cargarPNMSinAviso(const char* ruta, ImagenInfo* info);
+
+// QUÉ: Escribir la imagen como P5 (1 canal), P6 (3 canales o RGBX) o P7 (2
+// o 4 canales con alfa) en un descriptor.
+// CÓMO: Maxval 255 u, en las imágenes de 16 bits, 65535. Con 8 bits, una
+// llamada writev con la cabecera y un iovec por fila (los punteros de fila
+// de la matriz), sin búfer intermedio; con 16, las filas pasan a big-endian
+// por lotes de 1 MB. Las RGBX se escriben desde una copia sin relleno
+// (imagenParaGuardar).
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int escribirPNM(const ImagenInfo* info, int fd);
+
+// QUÉ: Guardar la imagen como PGM/PPM/PAM (ruta "-" = salida estándar).
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int guardarPNM(const ImagenInfo* info, const char* ruta);
+
+#endif // PNM_H
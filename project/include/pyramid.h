@@ -0,0 +1,60 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <stddef.h>
+#include "image.h"
+
+// QUÉ: Número máximo de niveles (suficiente para lados de hasta 2^31 píxeles).
+#define MAX_NIVELES_PIRAMIDE 32
+
+// QUÉ: Filtro de reducción 2x entre niveles.
+// CÓMO: CAJA promedia bloques 2x2; GAUSSIANA aplica el binomial [1 2 1]/4 en
+// cada eje antes de submuestrear.
+// POR QUÉ: La caja es la más rápida; la gaussiana suaviza mejor los bordes a
+// costa de leer un vecindario 3x3. Las dos se fusionan por teselas.
+typedef enum {
+    PIRAMIDE_CAJA = 0,
+    PIRAMIDE_GAUSSIANA = 1
+} FiltroPiramide;
+
+// QUÉ: Pirámide de imágenes (mipmaps) con todos los niveles potencia de dos.
+// CÓMO: El nivel 0 es una copia del original y cada nivel mide
+// ceil(ancho/2) x ceil(alto/2) del anterior, hasta llegar a 1x1. Los píxeles de
+// todos los niveles viven en una sola reserva (datos) y niveles[i] son vistas
+// ImagenInfo sobre ella.
+// POR QUÉ: Una reserva contigua evita fragmentación y las vistas permiten usar
+// cualquier función del proyecto sobre un nivel. Las vistas NO deben liberarse
+// con liberarImagen: se liberan juntas con liberarPiramide.
+typedef struct {
+    int numNiveles;
+    ImagenInfo niveles[MAX_NIVELES_PIRAMIDE];
+    unsigned char* datos;       // Píxeles de todos los niveles
+    unsigned char** punteros;   // Punteros a píxel de todos los niveles
+    unsigned char*** filas;     // Punteros a fila de todos los niveles
+    size_t totalBytes;          // Tamaño de datos
+} Piramide;
+
+// QUÉ: Construir la pirámide completa de una imagen usando NUM_HILOS_GLOBAL hilos.
+// CÓMO: Con CAJA reparte teselas del nivel 0 entre hilos y cada hilo encadena
+// las reducciones de su tesela mientras siguen en caché; los niveles más
+// pequeños que una tesela se terminan al final. Con GAUSSIANA encadena los
+// niveles de tres en tres por teselas, recalculando un halo de 7 píxeles
+// (el vecindario 3x3 lee de las teselas vecinas); cuando quedan menos filas
+// de teselas que hilos, sigue nivel a nivel repartiendo filas.
+// POR QUÉ: Cada nivel se calcula del anterior (no del original) y se reutiliza
+// el nivel recién escrito antes de que salga de la caché.
+// Los niveles son siempre de 8 bits: una imagen de 16 bits se redondea antes;
+// una RGBX da niveles RGBX.
+// Devuelve 1 si tuvo éxito, 0 en caso de error (la pirámide queda vacía).
+int construirPiramide(const ImagenInfo* origen, Piramide* piramide, FiltroPiramide filtro);
+
+// QUÉ: Reducir 2x con caja las filas [yIni, yFin) de destino a partir de origen.
+// CÓMO: destino debe medir ceil(ancho/2) x ceil(alto/2) del origen; los bordes
+// impares se replican.
+// POR QUÉ: Permite construir un nivel por franjas, por ejemplo en tareas de un pool.
+void reducirNivelCaja(const ImagenInfo* origen, ImagenInfo* destino, int yIni, int yFin);
+
+// QUÉ: Liberar la memoria de una pirámide y reiniciar la estructura.
+void liberarPiramide(Piramide* piramide);
+
+#endif // PYRAMID_H
@@ -0,0 +1,53 @@
+#ifndef QOI_H
+#define QOI_H
+
+#include "image.h"
+#include <stddef.h>
+
+// QUÉ: Formato QOI ("Quite OK Image", qoiformat.org), sin pérdida y muy rápido.
+// CÓMO: Cada píxel se codifica como repetición, índice a una tabla hash de 64
+// colores recientes, diferencia pequeña con el anterior o valor literal. No
+// hay entropía ni búsqueda: una pasada lineal en cada sentido.
+// POR QUÉ: Para archivos intermedios y caché codifica y decodifica un orden de
+// magnitud más rápido que PNG con un tamaño comparable.
+
+// QUÉ: Comprobar si los primeros bytes de un archivo son de QOI.
+// CÓMO: Reconoce "qoif" (QOI estándar) y "qoip" (contenedor de franjas).
+// Devuelve 1 si el archivo es QOI o contenedor, 0 si no.
+int esArchivoQOI(const char* ruta);
+
+// QUÉ: Cargar un archivo QOI o un contenedor de franjas QOI.
+// CÓMO: Lee el archivo entero con una sola lectura y decodifica a la matriz.
+// En el contenedor cada franja se decodifica en un hilo (NUM_HILOS_GLOBAL).
+// QOI estándar solo admite 3 o 4 canales: se respeta el alfa de la cabecera y,
+// si todos los píxeles son grises (R = G = B), la imagen se devuelve con 1
+// canal (2 con alfa). Con canalesDeseados = 1 cada fila se reduce a luma
+// (filaAGrises, conservando el alfa) según se decodifica; 0 conserva el
+// formato guardado, salvo que RGB se decodifica como RGBX.
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int cargarQOI(const char* ruta, ImagenInfo* info, int canalesDeseados);
+
+// QUÉ: Igual que cargarQOI, con el archivo ya leído en memoria (lectura
+// anticipada del lote, ver async_io.h). La ruta solo se usa en los mensajes.
+int cargarQOIMemoria(const unsigned char* datos, size_t tam, const char* ruta, ImagenInfo* info,
+                     int canalesDeseados);
+
+// QUÉ: Guardar la imagen como QOI estándar (un solo flujo, un hilo).
+// CÓMO: Las imágenes en grises se escriben como RGB con R = G = B; las de 16 bits
+// se redondean a 8 (QOI no tiene otra profundidad).
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int guardarQOI(const ImagenInfo* info, const char* ruta);
+
+// QUÉ: Guardar la imagen como contenedor de franjas QOI codificadas en paralelo.
+// CÓMO: La imagen se corta en franjas horizontales; cada una es un flujo QOI
+// completo e independiente (con su cabecera "qoif") codificado en un hilo.
+// Formato (enteros big-endian, como QOI):
+//   "qoip" | ancho u32 | alto u32 | canales u8 | espacio de color u8 |
+//   número de franjas u32 | por franja: filas u32, bytes u64 | franjas
+// POR QUÉ: QOI es secuencial por diseño; con franjas independientes tanto la
+// codificación como la decodificación usan todos los núcleos. El contenedor
+// guarda además el número real de canales (grises se conservan).
+// Devuelve 1 si tuvo éxito, 0 en caso de error.
+int guardarQOIParalelo(const ImagenInfo* info, const char* ruta);
+
+#endif // QOI_H
@@ -6,17 +6,121 @@
 
 #include "image.h"
 
+// Tabla de coeficientes de un eje (precalculada una vez por escalado).
+// indice0/indice1 son desplazamientos en bytes dentro de la fila (o índices de
+// fila en el eje Y) y peso es la fracción del vecino siguiente en punto fijo.
+typedef struct {
+    int* indice0;
+    int* indice1;
+    int* peso;
+} TablaEje;
+
+// Tabla de huellas de un eje para el promedio de área: el píxel destino d
+// promedia cuenta[d] píxeles origen desde inicio[d], con pesos en punto fijo
+// (16 bits, suman exactamente 2^16) en pesos[d * maxCuenta ...].
+typedef struct {
+    int* inicio;
+    int* cuenta;
+    unsigned int* pesos;
+    int maxCuenta;
+} TablaArea;
+
+// Modo de remuestreo. SCALE_AUTO usa área para reducciones por debajo de 0.5
+// y bilineal en el resto de casos; SCALE_NEAREST solo se usa si se pide
+// explícitamente (pixel art, máscaras de etiquetas).
+typedef enum {
+    SCALE_AUTO = 0,
+    SCALE_BILINEAR = 1,
+    SCALE_AREA = 2,
+    SCALE_NEAREST = 3
+} ScaleMode;
+
 // Estructura para pasar argumentos a cada hilo de escalado
 typedef struct {
     ImagenInfo* originalImage;
     ImagenInfo* resultImage;
     int startRow;
     int endRow;
-    float scaleFactorX;
-    float scaleFactorY;
+    const TablaEje* tablaX;
+    const TablaEje* tablaY;
+    const TablaArea* areaX;
+    const TablaArea* areaY;
+    int factor;              // 2, 4 u 8 en la reducción exacta por bloques;
+                             // k de ampliación entera en vecino más cercano
+    int lineal;              // 1 si se interpola en luz lineal (LUZ_LINEAL_GLOBAL)
+    int ok;                  // 1 si el hilo terminó sin errores
 } ScaleArgs;
 
-// Función principal que llama a los hilos
+// Callback del reductor en flujo: recibe cada fila destino en orden
+// (anchoDestino * canales bytes, válida solo durante la llamada).
+// Devuelve 1 para continuar o 0 para abortar.
+typedef int (*AlCerrarFilaArea)(void* contexto, const unsigned char* fila);
+
+// Reductor de área en flujo: recibe las filas origen en orden y escribe cada
+// fila destino en cuanto su huella está completa. Mantiene solo dos filas de
+// acumuladores, así que no necesita la imagen origen completa en memoria.
+// Las filas destino van a una imagen (iniciarReductorArea) o a un callback
+// (iniciarReductorAreaFlujo), y entonces tampoco se guarda el destino.
+typedef struct {
+    ImagenInfo* destino;             // NULL si las filas van a alFila
+    AlCerrarFilaArea alFila;
+    void* contexto;
+    unsigned char* filaSalida;       // Fila destino entregada a alFila
+    int lineal;                      // Promedio en luz lineal (LUZ_LINEAL_GLOBAL al iniciar)
+    int bytes;                       // Bytes por muestra de las filas (1 u 2)
+    int anchoOrigen;
+    int altoOrigen;
+    int anchoDestino;
+    int altoDestino;
+    int canales;
+    TablaArea tablaX;
+    TablaArea tablaY;
+    unsigned int* filaH;             // Fila origen reducida horizontalmente
+    unsigned int* acumuladores[2];   // Filas destino en curso (pares / impares)
+    int filaOrigen;                  // Próxima fila origen esperada
+    int siguienteSalida;             // Próxima fila destino a completar
+} ReductorArea;
+
+// Liberar la memoria de una tabla de coeficientes
+void liberarTablaEje(TablaEje* tabla);
+
+// Liberar la memoria de una tabla de huellas
+void liberarTablaArea(TablaArea* tabla);
+
+// Preparar un reductor hacia destino (ya creado con crearImagen y del mismo
+// número de canales y profundidad que las filas que se empujarán). Solo reducción.
+int iniciarReductorArea(ReductorArea* reductor, int anchoOrigen, int altoOrigen, ImagenInfo* destino);
+
+// Preparar un reductor que entrega las filas destino a alFila en lugar de
+// escribirlas en una imagen. Solo reducción y filas de 8 bits.
+int iniciarReductorAreaFlujo(ReductorArea* reductor, int anchoOrigen, int altoOrigen, int anchoDestino,
+                             int altoDestino, int canales, AlCerrarFilaArea alFila, void* contexto);
+
+// Empujar la siguiente fila origen (anchoOrigen * canales muestras).
+// Devuelve 0 si sobran filas o si alFila pidió abortar.
+int empujarFilaArea(ReductorArea* reductor, const unsigned char* fila);
+
+// Liberar tablas y acumuladores del reductor (el destino queda intacto).
+void liberarReductorArea(ReductorArea* reductor);
+
+// Modo efectivo de un escalado: en SCALE_AUTO, área si ambos ejes se reducen
+// y alguno queda por debajo de 0.5; bilineal en otro caso.
+ScaleMode resolverModoEscalado(int ancho, int alto, int newWidth, int newHeight, ScaleMode mode);
+
+// Función principal que llama a los hilos.
+// Equivale a scaleImageWithMode(info, newWidth, newHeight, SCALE_AUTO).
 void scaleImageConcurrently(ImagenInfo* info, int newWidth, int newHeight);
 
+// Escalado con modo explícito, repartido en NUM_HILOS_GLOBAL hilos.
+// SCALE_BILINEAR es un remuestreo separable: pasada horizontal a filas
+// temporales y pasada vertical que combina dos filas. SCALE_AREA promedia la huella completa de cada
+// píxel destino con acumulación entera; las reducciones exactas 2x/4x/8x usan
+// una ruta especializada con sumas de pares SIMD. SCALE_NEAREST copia el
+// píxel origen con tablas de columnas, duplica filas repetidas con memcpy y
+// replica con SIMD (SSE2/SSSE3) en ampliaciones horizontales enteras.
+// Con LUZ_LINEAL_GLOBAL activo, bilineal y área promedian en luz lineal. Las
+// imágenes de 16 bits usan los mismos caminos con valores intermedios de 16
+// bits (los de luz lineal) y conservan su profundidad.
+void scaleImageWithMode(ImagenInfo* info, int newWidth, int newHeight, ScaleMode mode);
+
 #endif
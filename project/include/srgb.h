@@ -0,0 +1,63 @@
+#ifndef SRGB_H
+#define SRGB_H
+
+// QUÉ: Interpolación en luz lineal (gamma correcta) para rotación y escalado.
+// CÓMO: Si vale 1, los promedios se calculan sobre valores lineales de 16 bits
+// obtenidos con tablas en lugar de sobre los bytes sRGB. Se cambia desde el menú.
+// POR QUÉ: Promediar bytes sRGB oscurece los detalles de alto contraste al
+// reducir; con tablas la corrección cuesta poco más que el modo normal.
+extern int LUZ_LINEAL_GLOBAL;
+
+// QUÉ: Tablas de conversión sRGB <-> lineal.
+// CÓMO: SRGB_A_LINEAL[b] es el valor lineal de un byte sRGB en 0..65535;
+// LINEAL_A_SRGB[v >> 4] devuelve el byte sRGB de un valor lineal de 16 bits
+// (4096 entradas, evaluadas en el centro de cada intervalo).
+// POR QUÉ: pow() por muestra sería decenas de veces más lento.
+extern unsigned short SRGB_A_LINEAL[256];
+extern unsigned char LINEAL_A_SRGB[4096];
+
+// QUÉ: Construir las tablas (idempotente y seguro entre hilos).
+// Llamar antes de usar las tablas; el coste solo se paga la primera vez.
+void inicializarTablasSRGB(void);
+
+// QUÉ: Convertir un valor lineal de 16 bits a byte sRGB.
+static inline unsigned char linealASRGB(unsigned int lineal) {
+    return LINEAL_A_SRGB[lineal >> 4];
+}
+
+// QUÉ: Tablas por canal para imágenes con alfa.
+// CÓMO: El alfa ya es lineal: ALFA_A_LINEAL[b] = b * 257 lo lleva a la misma
+// escala de 16 bits y linealACanal lo devuelve con redondeo, sin curva sRGB.
+// POR QUÉ: Pasar el alfa por la curva cambiaría la cobertura de los bordes.
+extern unsigned short ALFA_A_LINEAL[256];
+
+static inline const unsigned short* tablaALineal(int canales, int c) {
+    return ((canales == 2 || canales == 4) && c == canales - 1) ? ALFA_A_LINEAL : SRGB_A_LINEAL;
+}
+
+static inline unsigned char linealACanal(unsigned int lineal, int esAlfa) {
+    return esAlfa ? (unsigned char)((lineal * 255u + 32767u) / 65535u) : LINEAL_A_SRGB[lineal >> 4];
+}
+
+// QUÉ: Tablas para imágenes de 16 bits por muestra.
+// CÓMO: SRGB16_A_LINEAL[v] es el valor lineal de una muestra sRGB de 16 bits
+// y LINEAL16_A_SRGB[l] la muestra sRGB de un valor lineal (65536 entradas
+// cada una, 256 KB en total). El alfa de 16 bits ya es lineal y no pasa por
+// ellas. Se construyen aparte, solo si se procesa una imagen de 16 bits.
+// POR QUÉ: Con 4096 entradas la vuelta a sRGB solo tiene 12 bits, menos que
+// la precisión de la imagen.
+extern unsigned short SRGB16_A_LINEAL[65536];
+extern unsigned short LINEAL16_A_SRGB[65536];
+
+// QUÉ: Construir las tablas de 16 bits (idempotente y seguro entre hilos).
+void inicializarTablasSRGB16(void);
+
+static inline unsigned int muestra16ALineal(unsigned int muestra, int esAlfa) {
+    return esAlfa ? muestra : SRGB16_A_LINEAL[muestra];
+}
+
+static inline unsigned short linealACanal16(unsigned int lineal, int esAlfa) {
+    return esAlfa ? (unsigned short)lineal : LINEAL16_A_SRGB[lineal];
+}
+
+#endif // SRGB_H
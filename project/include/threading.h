@@ -2,6 +2,7 @@
 #define THREADING_H
 
 #include <sys/time.h>
+#include <pthread.h>
 
 // QUÉ: Límites para número de hilos.
 // CÓMO: Constantes que definen rango válido.
@@ -19,4 +20,55 @@ extern int NUM_HILOS_GLOBAL;
 // POR QUÉ: clock() suma tiempo de todos los hilos, no muestra paralelización real.
 double obtenerTiempoReal(struct timeval inicio, struct timeval fin);
 
+// QUÉ: Grupo de tareas para esperar solo un subconjunto de trabajos del pool.
+// CÓMO: Contador de tareas pendientes protegido por mutex y variable de condición.
+// POR QUÉ: Permite, por ejemplo, esperar a que termine la reducción de un nivel
+// mientras siguen codificándose teselas del nivel anterior en el mismo pool.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t listo;
+    int pendientes;
+} GrupoTareas;
+
+// QUÉ: Tarea encolada en el pool (función, argumento y grupo opcional).
+typedef struct {
+    void (*funcion)(void*);
+    void* arg;
+    GrupoTareas* grupo;
+} TareaPool;
+
+// QUÉ: Pool de hilos trabajadores con cola acotada.
+// CÓMO: numHilos hilos esperan tareas en una cola circular de capacidad fija;
+// enviarTarea bloquea si la cola está llena.
+// POR QUÉ: Reutiliza hilos entre muchas tareas pequeñas (teselas, bloques) y la
+// cola acotada limita la memoria de trabajos en vuelo.
+typedef struct {
+    pthread_t hilos[MAX_HILOS];
+    int numHilos;
+    TareaPool* cola;
+    int capacidad;
+    int cabeza;
+    int cantidad;
+    int cerrando;
+    pthread_mutex_t mutex;
+    pthread_cond_t hayTarea;
+    pthread_cond_t hayEspacio;
+} PoolHilos;
+
+// QUÉ: Crear un pool con numHilos trabajadores (se limita a [MIN_HILOS, MAX_HILOS]).
+// Devuelve 1 si tuvo éxito, 0 si falla la memoria o la creación de hilos.
+int crearPool(PoolHilos* pool, int numHilos, int capacidadCola);
+
+// QUÉ: Encolar una tarea; si grupo no es NULL se cuenta en ese grupo.
+// CÓMO: Bloquea mientras la cola esté llena. Devuelve 0 si el pool está cerrando.
+int enviarTarea(PoolHilos* pool, void (*funcion)(void*), void* arg, GrupoTareas* grupo);
+
+// QUÉ: Terminar el pool: procesa lo pendiente, une los hilos y libera la cola.
+void destruirPool(PoolHilos* pool);
+
+// QUÉ: Inicializar, esperar y destruir grupos de tareas.
+void iniciarGrupo(GrupoTareas* grupo);
+void esperarGrupo(GrupoTareas* grupo);
+void destruirGrupo(GrupoTareas* grupo);
+
 #endif // THREADING_H
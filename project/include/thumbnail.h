@@ -0,0 +1,18 @@
+#ifndef THUMBNAIL_H
+#define THUMBNAIL_H
+
+#include "image.h"
+
+// QUÉ: Generar una miniatura de un PNG sin cargar la imagen completa.
+// CÓMO: Decodifica el archivo por filas (png_decoder) y empuja cada fila a un
+// reductor de área en flujo; la miniatura conserva la proporción y su lado
+// mayor mide ladoMaximo (nunca se amplía). Si el archivo no admite lectura por
+// filas (no es PNG, es entrelazado o tiene tRNS) se carga con cargarImagen y
+// se reduce con SCALE_AREA.
+// POR QUÉ: La memoria máxima es unas pocas filas origen más la miniatura, sin
+// importar la resolución del archivo, y la función no usa estado global ni
+// hilos propios: se pueden lanzar muchas miniaturas en paralelo.
+// Devuelve 1 si miniatura quedó creada (el llamador la libera), 0 si hubo error.
+int generarMiniatura(const char* ruta, int ladoMaximo, ImagenInfo* miniatura);
+
+#endif // THUMBNAIL_H
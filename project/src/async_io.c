@@ -0,0 +1,708 @@
+#include "async_io.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// QUÉ: io_uring solo existe en Linux (5.1+); en otro sistema, o con
+// cabeceras del kernel antiguas, se compila únicamente el modo con hilos.
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define HAY_IO_URING 1
+#endif
+
+#define HILOS_ES 2              // Hilos del modo sin io_uring
+#define ENTRADAS_ANILLO 64      // Entradas de envío (el kernel da el doble de completación)
+#define TROZO_MAXIMO_ES ((size_t)1 << 30) // Bytes por petición (len es de 32 bits)
+
+enum { OP_ES_LEER, OP_ES_ESCRIBIR, OP_ES_DESPERTAR };
+
+// QUÉ: Una lectura o escritura en curso.
+// CÓMO: Si el kernel completa solo una parte, se vuelve a enviar el resto
+// (hechos marca lo ya transferido, que es también el desplazamiento).
+typedef struct OperacionES {
+    int tipo;
+    int fd;
+    unsigned char* datos;
+    size_t tam;
+    size_t hechos;
+    int indice;                     // Lectura: archivo
+    int ranura;                     // Lectura: búfer registrado o -1
+    char* ruta;                     // Escritura: para borrar el archivo si falla
+    AlTerminarEscritura alTerminar;
+    void* contexto;
+    struct iovec iov;               // io_uring: trozo que se está transfiriendo
+    struct OperacionES* siguiente;  // Hilos: cola de escrituras
+} OperacionES;
+
+enum { ARCHIVO_PENDIENTE, ARCHIVO_LEYENDO, ARCHIVO_LISTO, ARCHIVO_ERROR, ARCHIVO_POR_RUTA };
+
+// QUÉ: Estado de la lectura anticipada de un archivo.
+typedef struct {
+    int estado;
+    int devuelto;           // devolverArchivoLeido ya se llamó
+    int enVentana;          // Ocupa sitio (y quizá una ranura) en la ventana
+    unsigned char* datos;
+    size_t tam;
+    int ranura;
+} ArchivoES;
+
+#ifdef HAY_IO_URING
+// QUÉ: Anillos de io_uring mapeados en memoria.
+// CÓMO: El proceso escribe entradas (SQE) en el anillo de envío y avanza su
+// cola; el kernel escribe resultados (CQE) en el de completación y avanza la
+// suya. Las colas compartidas se leen y escriben con barreras de
+// adquisición/liberación.
+typedef struct {
+    int fd;
+    unsigned* sqCola;
+    unsigned sqMascara;
+    unsigned* sqArreglo;
+    struct io_uring_sqe* sqes;
+    unsigned* cqCabeza;
+    unsigned* cqCola;
+    unsigned cqMascara;
+    struct io_uring_cqe* cqes;
+    unsigned entradasCq;
+    void* mapaSq;
+    size_t tamSq;
+    void* mapaCq;               // Igual que mapaSq con IORING_FEAT_SINGLE_MMAP
+    size_t tamCq;
+    size_t tamSqes;
+} AnilloES;
+#endif
+
+struct ESAsincrona {
+    const char* const* rutas;
+    int numArchivos;
+    ArchivoES* archivos;
+    int ventana;                // Archivos leídos por adelantado como máximo
+    int enVentana;
+    size_t bytesVentana;
+    int siguienteLectura;       // Próximo archivo a leer
+    unsigned char* ranuras;     // ventana búferes de TAM_RANURA_ES
+    int* ranurasLibres;
+    int numLibres;
+    int usaUring;
+    int registradas;            // Las ranuras están registradas en el anillo
+    int pendientes;             // Operaciones en curso (lecturas y escrituras)
+    int capacidad;              // Máximo de operaciones en curso
+    int cerrando;
+    pthread_mutex_t mutex;      // Protege todo lo anterior y la cola
+    pthread_cond_t cambio;
+    OperacionES* primeraEscritura;
+    OperacionES* ultimaEscritura;
+    pthread_t hilos[HILOS_ES];
+    int numHilos;
+#ifdef HAY_IO_URING
+    AnilloES anillo;
+    pthread_mutex_t mutexEnvio; // Un solo escritor en el anillo de envío
+    OperacionES despertar;      // NOP que hace salir al hilo de completación
+#endif
+};
+
+// QUÉ: Liberar el búfer de un archivo y su sitio en la ventana (con el mutex).
+static void liberarArchivo(ESAsincrona* es, ArchivoES* a) {
+    if (!a->enVentana) {
+        return;
+    }
+    if (a->ranura >= 0) {
+        es->ranurasLibres[es->numLibres++] = a->ranura;
+    } else {
+        free(a->datos);
+    }
+    es->enVentana--;
+    es->bytesVentana -= a->tam;
+    a->datos = NULL;
+    a->ranura = -1;
+    a->enVentana = 0;
+}
+
+// QUÉ: Elegir el próximo archivo a leer si la ventana lo permite (con el mutex).
+// CÓMO: Salta los que ya se devolvieron sin leer; la ventana limita archivos
+// y bytes (siempre admite uno) y capacidad limita las operaciones en curso.
+// Devuelve el índice reservado o -1.
+static int reservarLectura(ESAsincrona* es) {
+    while (es->siguienteLectura < es->numArchivos && es->archivos[es->siguienteLectura].devuelto) {
+        es->siguienteLectura++;
+    }
+    if (es->cerrando || es->siguienteLectura >= es->numArchivos || es->enVentana >= es->ventana ||
+        (es->enVentana > 0 && es->bytesVentana >= LIMITE_VENTANA_ES) || es->pendientes >= es->capacidad) {
+        return -1;
+    }
+    int indice = es->siguienteLectura++;
+    ArchivoES* a = &es->archivos[indice];
+    a->estado = ARCHIVO_LEYENDO;
+    a->enVentana = 1;
+    es->enVentana++;
+    es->pendientes++;
+    return indice;
+}
+
+// QUÉ: Dar por terminada la lectura de un archivo con el estado final.
+static void terminarLectura(ESAsincrona* es, int indice, int estado) {
+    pthread_mutex_lock(&es->mutex);
+    ArchivoES* a = &es->archivos[indice];
+    a->estado = estado;
+    if (estado != ARCHIVO_LISTO || a->devuelto) {
+        liberarArchivo(es, a);
+    }
+    es->pendientes--;
+    pthread_cond_broadcast(&es->cambio);
+    pthread_mutex_unlock(&es->mutex);
+}
+
+// QUÉ: Cerrar, informar y avisar del final de una operación.
+// CÓMO: error es un código errno (0 = bien). Una escritura fallida borra el
+// archivo que llegó a crear.
+static void terminarOperacion(ESAsincrona* es, OperacionES* op, int error) {
+    int abierto = op->fd >= 0;
+    if (abierto && close(op->fd) != 0 && !error && op->tipo == OP_ES_ESCRIBIR) {
+        error = errno;
+    }
+    if (op->tipo == OP_ES_LEER) {
+        if (error) {
+            fprintf(stderr, "Error al leer archivo: %s (%s)\n", es->rutas[op->indice], strerror(error));
+        }
+        terminarLectura(es, op->indice, error ? ARCHIVO_ERROR : ARCHIVO_LISTO);
+    } else {
+        if (error) {
+            fprintf(stderr, "Error al escribir archivo: %s (%s)\n", op->ruta, strerror(error));
+            if (abierto) unlink(op->ruta);
+        }
+        op->alTerminar(op->contexto, !error);
+        free(op->datos);
+        free(op->ruta);
+        pthread_mutex_lock(&es->mutex);
+        es->pendientes--;
+        pthread_cond_broadcast(&es->cambio);
+        pthread_mutex_unlock(&es->mutex);
+    }
+    free(op);
+}
+
+// QUÉ: Abrir un archivo reservado y preparar su búfer.
+// CÓMO: Los archivos que caben en TAM_RANURA_ES usan una ranura (registrada
+// con io_uring); los demás, un búfer propio. La ruta "-", lo que no es un
+// archivo regular, los vacíos y los que no caben en un int (límite de stb)
+// quedan para leerse por la ruta.
+// Devuelve la operación lista para leer o NULL si la lectura ya terminó.
+static OperacionES* abrirLectura(ESAsincrona* es, int indice) {
+    const char* ruta = es->rutas[indice];
+    if (strcmp(ruta, "-") == 0) {
+        terminarLectura(es, indice, ARCHIVO_POR_RUTA);
+        return NULL;
+    }
+    int fd = open(ruta, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error al abrir archivo: %s (%s)\n", ruta, strerror(errno));
+        if (fd >= 0) close(fd);
+        terminarLectura(es, indice, ARCHIVO_ERROR);
+        return NULL;
+    }
+    if (!S_ISREG(st.st_mode) || st.st_size <= 0 || st.st_size > 0x7FFFFFFF) {
+        close(fd);
+        terminarLectura(es, indice, ARCHIVO_POR_RUTA);
+        return NULL;
+    }
+    OperacionES* op = (OperacionES*)calloc(1, sizeof(OperacionES));
+    if (!op) {
+        fprintf(stderr, "Error de memoria al leer: %s\n", ruta);
+        close(fd);
+        terminarLectura(es, indice, ARCHIVO_ERROR);
+        return NULL;
+    }
+    op->tipo = OP_ES_LEER;
+    op->fd = fd;
+    op->tam = (size_t)st.st_size;
+    op->indice = indice;
+    op->ranura = -1;
+
+    pthread_mutex_lock(&es->mutex);
+    if (op->tam <= TAM_RANURA_ES && es->numLibres > 0) {
+        op->ranura = es->ranurasLibres[--es->numLibres];
+        op->datos = es->ranuras + (size_t)op->ranura * TAM_RANURA_ES;
+    }
+    pthread_mutex_unlock(&es->mutex);
+    if (op->ranura < 0) {
+        op->datos = (unsigned char*)malloc(op->tam);
+    }
+
+    pthread_mutex_lock(&es->mutex);
+    ArchivoES* a = &es->archivos[indice];
+    a->datos = op->datos;
+    a->ranura = op->ranura;
+    a->tam = op->datos ? op->tam : 0;
+    es->bytesVentana += a->tam;
+    pthread_mutex_unlock(&es->mutex);
+    if (!op->datos) {
+        terminarOperacion(es, op, ENOMEM);
+        return NULL;
+    }
+    return op;
+}
+
+// QUÉ: Hacer una operación con read()/write() bloqueantes (modo con hilos).
+static void ejecutarBloqueante(OperacionES* op, int* error) {
+    if (op->tipo == OP_ES_ESCRIBIR) {
+        op->fd = open(op->ruta, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (op->fd < 0) {
+            *error = errno;
+            return;
+        }
+    }
+    while (op->hechos < op->tam) {
+        ssize_t n = (op->tipo == OP_ES_LEER)
+                        ? pread(op->fd, op->datos + op->hechos, op->tam - op->hechos, (off_t)op->hechos)
+                        : pwrite(op->fd, op->datos + op->hechos, op->tam - op->hechos, (off_t)op->hechos);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // 0 en una lectura: el archivo se acortó mientras se leía
+            *error = (n < 0) ? errno : EIO;
+            return;
+        }
+        op->hechos += (size_t)n;
+    }
+}
+
+// QUÉ: Hilo del modo sin io_uring.
+// CÓMO: Las escrituras tienen prioridad (liberan memoria del lote); si no
+// hay ninguna, lee el siguiente archivo de la ventana.
+static void* hiloES(void* arg) {
+    ESAsincrona* es = (ESAsincrona*)arg;
+    pthread_mutex_lock(&es->mutex);
+    while (1) {
+        OperacionES* op = es->primeraEscritura;
+        if (op) {
+            es->primeraEscritura = op->siguiente;
+            if (!op->siguiente) es->ultimaEscritura = NULL;
+        } else {
+            int indice = reservarLectura(es);
+            if (indice < 0) {
+                if (es->cerrando) break;
+                pthread_cond_wait(&es->cambio, &es->mutex);
+                continue;
+            }
+            pthread_mutex_unlock(&es->mutex);
+            op = abrirLectura(es, indice);
+            pthread_mutex_lock(&es->mutex);
+            if (!op) continue;
+        }
+        pthread_mutex_unlock(&es->mutex);
+        int error = 0;
+        ejecutarBloqueante(op, &error);
+        terminarOperacion(es, op, error);
+        pthread_mutex_lock(&es->mutex);
+    }
+    pthread_mutex_unlock(&es->mutex);
+    return NULL;
+}
+
+#ifdef HAY_IO_URING
+static void cerrarAnillo(AnilloES* a) {
+    if (a->sqes) munmap(a->sqes, a->tamSqes);
+    if (a->mapaCq && a->mapaCq != a->mapaSq) munmap(a->mapaCq, a->tamCq);
+    if (a->mapaSq) munmap(a->mapaSq, a->tamSq);
+    if (a->fd >= 0) close(a->fd);
+    a->fd = -1;
+}
+
+// QUÉ: Crear el anillo con io_uring_setup y mapear sus tres zonas.
+// Devuelve 1 si tuvo éxito, 0 si io_uring no está disponible.
+static int iniciarAnillo(AnilloES* a, unsigned entradas) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(a, 0, sizeof(*a));
+    a->fd = (int)syscall(__NR_io_uring_setup, entradas, &p);
+    if (a->fd < 0) {
+        return 0;
+    }
+    a->tamSq = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    a->tamCq = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int unico = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (unico && a->tamCq > a->tamSq) a->tamSq = a->tamCq;
+    a->tamSqes = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    void* sq = mmap(NULL, a->tamSq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, a->fd, IORING_OFF_SQ_RING);
+    a->mapaSq = (sq == MAP_FAILED) ? NULL : sq;
+    void* cq = unico ? sq : mmap(NULL, a->tamCq, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, a->fd,
+                                 IORING_OFF_CQ_RING);
+    a->mapaCq = (cq == MAP_FAILED) ? NULL : cq;
+    void* sqes = mmap(NULL, a->tamSqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, a->fd, IORING_OFF_SQES);
+    a->sqes = (sqes == MAP_FAILED) ? NULL : (struct io_uring_sqe*)sqes;
+    if (!a->mapaSq || !a->mapaCq || !a->sqes) {
+        cerrarAnillo(a);
+        return 0;
+    }
+
+    unsigned char* s = (unsigned char*)a->mapaSq;
+    unsigned char* c = (unsigned char*)a->mapaCq;
+    a->sqCola = (unsigned*)(s + p.sq_off.tail);
+    a->sqMascara = *(unsigned*)(s + p.sq_off.ring_mask);
+    a->sqArreglo = (unsigned*)(s + p.sq_off.array);
+    a->cqCabeza = (unsigned*)(c + p.cq_off.head);
+    a->cqCola = (unsigned*)(c + p.cq_off.tail);
+    a->cqMascara = *(unsigned*)(c + p.cq_off.ring_mask);
+    a->cqes = (struct io_uring_cqe*)(c + p.cq_off.cqes);
+    a->entradasCq = p.cq_entries;
+    return 1;
+}
+
+// QUÉ: Enviar al kernel el siguiente trozo de una operación.
+// CÓMO: Una SQE por llamada, enviada en el acto con io_uring_enter, así el
+// anillo de envío nunca acumula entradas. Las lecturas en una ranura
+// registrada usan READ_FIXED (el kernel no tiene que fijar las páginas en
+// cada petición); el resto, READV/WRITEV con un solo iovec.
+// Devuelve 0 si se envió o el código errno del fallo.
+static int enviarOperacion(ESAsincrona* es, OperacionES* op) {
+    AnilloES* a = &es->anillo;
+    size_t resto = op->tam - op->hechos;
+    if (resto > TROZO_MAXIMO_ES) resto = TROZO_MAXIMO_ES;
+
+    pthread_mutex_lock(&es->mutexEnvio);
+    unsigned cola = *a->sqCola;
+    unsigned pos = cola & a->sqMascara;
+    struct io_uring_sqe* sqe = &a->sqes[pos];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = op->fd;
+    sqe->off = op->hechos;
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    if (op->tipo == OP_ES_DESPERTAR) {
+        sqe->opcode = IORING_OP_NOP;
+    } else if (op->tipo == OP_ES_LEER && op->ranura >= 0 && es->registradas) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)(op->datos + op->hechos);
+        sqe->len = (unsigned)resto;
+        sqe->buf_index = (unsigned short)op->ranura;
+    } else {
+        op->iov.iov_base = op->datos + op->hechos;
+        op->iov.iov_len = resto;
+        sqe->opcode = (op->tipo == OP_ES_LEER) ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->addr = (uint64_t)(uintptr_t)&op->iov;
+        sqe->len = 1;
+    }
+    a->sqArreglo[pos] = pos;
+    __atomic_store_n(a->sqCola, cola + 1, __ATOMIC_RELEASE);
+    long r;
+    do {
+        r = syscall(__NR_io_uring_enter, a->fd, 1, 0, 0, NULL, 0);
+    } while (r < 0 && (errno == EINTR || errno == EAGAIN));
+    int error = (r == 1) ? 0 : (r < 0 ? errno : EIO);
+    if (error) {
+        // El kernel no consumió la entrada: retirarla
+        __atomic_store_n(a->sqCola, cola, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&es->mutexEnvio);
+    return error;
+}
+
+// QUÉ: Procesar una completación: reenviar el resto o terminar.
+static void completarOperacion(ESAsincrona* es, OperacionES* op, int resultado) {
+    int error = 0;
+    if (resultado < 0) {
+        error = -resultado;
+    } else if (resultado == 0 && op->hechos < op->tam) {
+        error = EIO; // El archivo se acortó mientras se leía
+    } else {
+        op->hechos += (size_t)resultado;
+        if (op->hechos < op->tam) {
+            error = enviarOperacion(es, op);
+            if (!error) return;
+        }
+    }
+    terminarOperacion(es, op, error);
+}
+
+// QUÉ: Hilo que recoge las completaciones del anillo.
+// CÓMO: Duerme en io_uring_enter hasta que hay al menos una; termina al
+// recibir el NOP de destruirESAsincrona, que se envía cuando ya no queda
+// ninguna operación en curso.
+static void* hiloCompletarES(void* arg) {
+    ESAsincrona* es = (ESAsincrona*)arg;
+    AnilloES* a = &es->anillo;
+    while (1) {
+        unsigned cabeza = *a->cqCabeza;
+        if (cabeza == __atomic_load_n(a->cqCola, __ATOMIC_ACQUIRE)) {
+            long r = syscall(__NR_io_uring_enter, a->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (r < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                fprintf(stderr, "Error en io_uring_enter: %s\n", strerror(errno));
+                return NULL;
+            }
+            continue;
+        }
+        struct io_uring_cqe* cqe = &a->cqes[cabeza & a->cqMascara];
+        OperacionES* op = (OperacionES*)(uintptr_t)cqe->user_data;
+        int resultado = cqe->res;
+        __atomic_store_n(a->cqCabeza, cabeza + 1, __ATOMIC_RELEASE);
+        if (op->tipo == OP_ES_DESPERTAR) {
+            return NULL;
+        }
+        completarOperacion(es, op, resultado);
+    }
+}
+
+// QUÉ: Abrir y enviar la lectura de un archivo reservado.
+static void iniciarLecturaUring(ESAsincrona* es, int indice) {
+    OperacionES* op = abrirLectura(es, indice);
+    if (op) {
+        int error = enviarOperacion(es, op);
+        if (error) terminarOperacion(es, op, error);
+    }
+}
+
+// QUÉ: Registrar las ranuras de lectura como búferes fijos del anillo.
+// CÓMO: Fija sus páginas una sola vez; falla con RLIMIT_MEMLOCK bajo en
+// kernels anteriores a 5.12, y entonces se leen sin registrar.
+static int registrarRanuras(ESAsincrona* es) {
+    struct iovec* v = (struct iovec*)malloc((size_t)es->ventana * sizeof(struct iovec));
+    if (!v) {
+        return 0;
+    }
+    for (int i = 0; i < es->ventana; i++) {
+        v[i].iov_base = es->ranuras + (size_t)i * TAM_RANURA_ES;
+        v[i].iov_len = TAM_RANURA_ES;
+    }
+    long r = syscall(__NR_io_uring_register, es->anillo.fd, IORING_REGISTER_BUFFERS, v, es->ventana);
+    free(v);
+    return r == 0;
+}
+#endif
+
+// QUÉ: Leer por adelantado todo lo que permita la ventana (modo io_uring).
+static void rellenarVentana(ESAsincrona* es) {
+#ifdef HAY_IO_URING
+    while (1) {
+        pthread_mutex_lock(&es->mutex);
+        int indice = reservarLectura(es);
+        pthread_mutex_unlock(&es->mutex);
+        if (indice < 0) break;
+        iniciarLecturaUring(es, indice);
+    }
+#else
+    (void)es;
+#endif
+}
+
+// QUÉ: Crear la capa de E/S de un lote.
+// CÓMO: Ver async_io.h.
+// POR QUÉ: Ver async_io.h.
+ESAsincrona* crearESAsincrona(const char* const* rutas, int numArchivos, int ventana, ModoES modo) {
+    if (modo == ES_SINCRONA || numArchivos <= 0) {
+        return NULL;
+    }
+    if (ventana > numArchivos) ventana = numArchivos;
+    if (ventana < 1) ventana = 1;
+    ESAsincrona* es = (ESAsincrona*)calloc(1, sizeof(ESAsincrona));
+    void* ranuras = NULL;
+    if (!es || posix_memalign(&ranuras, 4096, (size_t)ventana * TAM_RANURA_ES) != 0) {
+        fprintf(stderr, "Error de memoria al preparar la E/S del lote\n");
+        free(es);
+        return NULL;
+    }
+    es->ranuras = (unsigned char*)ranuras;
+    es->archivos = (ArchivoES*)calloc((size_t)numArchivos, sizeof(ArchivoES));
+    es->ranurasLibres = (int*)malloc((size_t)ventana * sizeof(int));
+    if (!es->archivos || !es->ranurasLibres) {
+        fprintf(stderr, "Error de memoria al preparar la E/S del lote\n");
+        free(es->archivos);
+        free(es->ranurasLibres);
+        free(es->ranuras);
+        free(es);
+        return NULL;
+    }
+    es->rutas = rutas;
+    es->numArchivos = numArchivos;
+    es->ventana = ventana;
+    for (int i = 0; i < numArchivos; i++) {
+        es->archivos[i].ranura = -1;
+    }
+    for (int i = 0; i < ventana; i++) {
+        es->ranurasLibres[es->numLibres++] = ventana - 1 - i;
+    }
+    es->capacidad = 2 * ENTRADAS_ANILLO;
+    pthread_mutex_init(&es->mutex, NULL);
+    pthread_cond_init(&es->cambio, NULL);
+
+#ifdef HAY_IO_URING
+    if (modo == ES_AUTOMATICA && iniciarAnillo(&es->anillo, ENTRADAS_ANILLO)) {
+        es->capacidad = (int)es->anillo.entradasCq;
+        es->registradas = registrarRanuras(es);
+        es->despertar.tipo = OP_ES_DESPERTAR;
+        es->despertar.fd = -1;
+        pthread_mutex_init(&es->mutexEnvio, NULL);
+        if (pthread_create(&es->hilos[0], NULL, hiloCompletarES, es) == 0) {
+            es->usaUring = 1;
+            es->numHilos = 1;
+        } else {
+            pthread_mutex_destroy(&es->mutexEnvio);
+            cerrarAnillo(&es->anillo);
+            es->registradas = 0;
+        }
+    }
+#endif
+    if (es->usaUring) {
+        rellenarVentana(es);
+        return es;
+    }
+    for (int i = 0; i < HILOS_ES; i++) {
+        if (pthread_create(&es->hilos[es->numHilos], NULL, hiloES, es) == 0) {
+            es->numHilos++;
+        }
+    }
+    if (es->numHilos == 0) {
+        fprintf(stderr, "Error al crear los hilos de E/S del lote\n");
+        destruirESAsincrona(es);
+        return NULL;
+    }
+    return es;
+}
+
+const char* nombreMotorES(const ESAsincrona* es) {
+    if (!es->usaUring) return "hilos";
+    return es->registradas ? "io_uring" : "io_uring sin búferes registrados";
+}
+
+// QUÉ: Esperar a que un archivo esté leído.
+// CÓMO: Con io_uring, si el archivo aún no se pidió, el propio llamador envía
+// las lecturas que permita la ventana; solo duerme cuando no puede reservar
+// nada (todo cambio que lo permita avisa con el mismo mutex).
+int tomarArchivoLeido(ESAsincrona* es, int indice, const unsigned char** datos, size_t* tam) {
+    pthread_mutex_lock(&es->mutex);
+    ArchivoES* a = &es->archivos[indice];
+    while (a->estado == ARCHIVO_PENDIENTE || a->estado == ARCHIVO_LEYENDO) {
+        if (es->usaUring && a->estado == ARCHIVO_PENDIENTE) {
+            int reservado = reservarLectura(es);
+            if (reservado >= 0) {
+                pthread_mutex_unlock(&es->mutex);
+#ifdef HAY_IO_URING
+                iniciarLecturaUring(es, reservado);
+#endif
+                pthread_mutex_lock(&es->mutex);
+                continue;
+            }
+        }
+        pthread_cond_wait(&es->cambio, &es->mutex);
+    }
+    int resultado = (a->estado == ARCHIVO_LISTO) ? 1 : (a->estado == ARCHIVO_ERROR) ? 0 : -1;
+    *datos = a->datos;
+    *tam = a->tam;
+    pthread_mutex_unlock(&es->mutex);
+    return resultado;
+}
+
+void devolverArchivoLeido(ESAsincrona* es, int indice) {
+    pthread_mutex_lock(&es->mutex);
+    ArchivoES* a = &es->archivos[indice];
+    a->devuelto = 1;
+    if (a->estado != ARCHIVO_PENDIENTE && a->estado != ARCHIVO_LEYENDO) {
+        liberarArchivo(es, a);
+    }
+    pthread_cond_broadcast(&es->cambio);
+    pthread_mutex_unlock(&es->mutex);
+    if (es->usaUring) {
+        rellenarVentana(es);
+    }
+}
+
+// QUÉ: Escribir un archivo en segundo plano.
+// CÓMO: Con io_uring el archivo se abre aquí (open es rápido y así el error
+// sale con la ruta) y se envía un WRITEV; con hilos la escritura entera va a
+// la cola. Espera si ya hay capacidad operaciones en curso.
+int escribirArchivoAsincrono(ESAsincrona* es, const char* ruta, unsigned char* datos, size_t tam,
+                             AlTerminarEscritura alTerminar, void* contexto) {
+    OperacionES* op = (OperacionES*)calloc(1, sizeof(OperacionES));
+    char* copia = strdup(ruta);
+    if (!op || !copia) {
+        fprintf(stderr, "Error de memoria al escribir: %s\n", ruta);
+        free(op);
+        free(copia);
+        free(datos);
+        return 0;
+    }
+    op->tipo = OP_ES_ESCRIBIR;
+    op->fd = -1;
+    op->datos = datos;
+    op->tam = tam;
+    op->ruta = copia;
+    op->alTerminar = alTerminar;
+    op->contexto = contexto;
+
+    pthread_mutex_lock(&es->mutex);
+    while (es->pendientes >= es->capacidad) {
+        pthread_cond_wait(&es->cambio, &es->mutex);
+    }
+    es->pendientes++;
+    if (!es->usaUring) {
+        if (es->ultimaEscritura) es->ultimaEscritura->siguiente = op;
+        else es->primeraEscritura = op;
+        es->ultimaEscritura = op;
+        pthread_cond_broadcast(&es->cambio);
+        pthread_mutex_unlock(&es->mutex);
+        return 1;
+    }
+    pthread_mutex_unlock(&es->mutex);
+#ifdef HAY_IO_URING
+    op->fd = open(ruta, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    int error = (op->fd < 0) ? errno : 0;
+    if (!error && tam > 0) {
+        error = enviarOperacion(es, op);
+    }
+    if (error || tam == 0) {
+        terminarOperacion(es, op, error);
+    }
+#endif
+    return 1;
+}
+
+// QUÉ: Esperar las operaciones en curso, parar los hilos y liberar todo.
+void destruirESAsincrona(ESAsincrona* es) {
+    if (!es) {
+        return;
+    }
+    pthread_mutex_lock(&es->mutex);
+    es->cerrando = 1;
+    pthread_cond_broadcast(&es->cambio);
+    while (es->pendientes > 0) {
+        pthread_cond_wait(&es->cambio, &es->mutex);
+    }
+    pthread_mutex_unlock(&es->mutex);
+
+#ifdef HAY_IO_URING
+    if (es->usaUring) {
+        if (enviarOperacion(es, &es->despertar) == 0) {
+            pthread_join(es->hilos[0], NULL);
+            cerrarAnillo(&es->anillo);
+        } else {
+            // Sin el NOP el hilo no despierta: se abandona junto con la capa
+            fprintf(stderr, "Error al cerrar io_uring: %s\n", strerror(errno));
+            pthread_detach(es->hilos[0]);
+            return;
+        }
+        pthread_mutex_destroy(&es->mutexEnvio);
+        es->numHilos = 0;
+    }
+#endif
+    for (int i = 0; i < es->numHilos; i++) {
+        pthread_join(es->hilos[i], NULL);
+    }
+    for (int i = 0; i < es->numArchivos; i++) {
+        liberarArchivo(es, &es->archivos[i]);
+    }
+    pthread_mutex_destroy(&es->mutex);
+    pthread_cond_destroy(&es->cambio);
+    free(es->archivos);
+    free(es->ranurasLibres);
+    free(es->ranuras);
+    free(es);
+}
@@ -0,0 +1,465 @@
+#include "batch.h"
+#include "image_io.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+// QUÉ: Archivos leídos por adelantado como máximo (cada uno puede ocupar una
+// ranura de TAM_RANURA_ES).
+#define VENTANA_MAXIMA_LOTE 32
+
+typedef struct EstadoLote EstadoLote;
+
+// QUÉ: Imagen que avanza por la tubería.
+typedef struct {
+    int indice;             // Posición en opciones->entradas
+    ImagenInfo imagen;
+    size_t bytes;           // Memoria contabilizada en el presupuesto
+    EstadoLote* estado;     // Para el aviso de la escritura asíncrona
+} ElementoLote;
+
+// QUÉ: Cola acotada de elementos entre dos etapas.
+// CÓMO: Cola circular con mutex y dos condiciones; se cierra sola cuando el
+// último productor de la etapa anterior avisa que terminó.
+// POR QUÉ: La capacidad acotada frena a la etapa rápida en vez de acumular
+// imágenes decodificadas sin límite.
+typedef struct {
+    ElementoLote** elementos;
+    int capacidad;
+    int cabeza;
+    int cantidad;
+    int productoresActivos;
+    pthread_mutex_t mutex;
+    pthread_cond_t hayElemento;
+    pthread_cond_t hayEspacio;
+} ColaLote;
+
+// QUÉ: Estado compartido por todos los hilos del lote.
+struct EstadoLote {
+    const OpcionesLote* opciones;
+    ESAsincrona* es;                // NULL = E/S síncrona
+    ColaLote colaProcesar;
+    ColaLote colaCodificar;
+    pthread_mutex_t mutex;          // Protege todo lo que sigue
+    pthread_cond_t hayMemoria;
+    int siguiente;                  // Próximo archivo a decodificar
+    size_t memoria;                 // Bytes de imágenes en vuelo
+    int imagenes;                   // Imágenes en vuelo
+    ResumenLote* resumen;
+};
+
+// QUÉ: Argumento de cada hilo: estado y etapa.
+typedef struct {
+    EstadoLote* estado;
+    int etapa;
+} HiloLote;
+
+static int iniciarCola(ColaLote* cola, int capacidad, int productores) {
+    cola->elementos = (ElementoLote**)malloc((size_t)capacidad * sizeof(ElementoLote*));
+    if (!cola->elementos) {
+        return 0;
+    }
+    cola->capacidad = capacidad;
+    cola->cabeza = 0;
+    cola->cantidad = 0;
+    cola->productoresActivos = productores;
+    pthread_mutex_init(&cola->mutex, NULL);
+    pthread_cond_init(&cola->hayElemento, NULL);
+    pthread_cond_init(&cola->hayEspacio, NULL);
+    return 1;
+}
+
+static void destruirCola(ColaLote* cola) {
+    free(cola->elementos);
+    pthread_mutex_destroy(&cola->mutex);
+    pthread_cond_destroy(&cola->hayElemento);
+    pthread_cond_destroy(&cola->hayEspacio);
+}
+
+// QUÉ: Encolar un elemento; bloquea mientras la cola esté llena.
+static void ponerEnCola(ColaLote* cola, ElementoLote* elemento) {
+    pthread_mutex_lock(&cola->mutex);
+    while (cola->cantidad == cola->capacidad) {
+        pthread_cond_wait(&cola->hayEspacio, &cola->mutex);
+    }
+    cola->elementos[(cola->cabeza + cola->cantidad) % cola->capacidad] = elemento;
+    cola->cantidad++;
+    pthread_cond_signal(&cola->hayElemento);
+    pthread_mutex_unlock(&cola->mutex);
+}
+
+// QUÉ: Tomar un elemento; devuelve NULL cuando la cola está vacía y cerrada.
+static ElementoLote* tomarDeCola(ColaLote* cola) {
+    pthread_mutex_lock(&cola->mutex);
+    while (cola->cantidad == 0 && cola->productoresActivos > 0) {
+        pthread_cond_wait(&cola->hayElemento, &cola->mutex);
+    }
+    ElementoLote* elemento = NULL;
+    if (cola->cantidad > 0) {
+        elemento = cola->elementos[cola->cabeza];
+        cola->cabeza = (cola->cabeza + 1) % cola->capacidad;
+        cola->cantidad--;
+        pthread_cond_signal(&cola->hayEspacio);
+    }
+    pthread_mutex_unlock(&cola->mutex);
+    return elemento;
+}
+
+// QUÉ: Avisar que un productor terminó; el último despierta a los consumidores.
+static void terminarProductor(ColaLote* cola) {
+    pthread_mutex_lock(&cola->mutex);
+    if (--cola->productoresActivos == 0) {
+        pthread_cond_broadcast(&cola->hayElemento);
+    }
+    pthread_mutex_unlock(&cola->mutex);
+}
+
+// QUÉ: Memoria real de una imagen de crearImagen (datos y las dos tablas de punteros).
+static size_t memoriaImagen(const ImagenInfo* imagen) {
+    size_t pixeles = (size_t)imagen->ancho * imagen->alto;
+    return pixeles * bytesPixel(imagen) + pixeles * sizeof(unsigned char*) +
+           (size_t)imagen->alto * sizeof(unsigned char**);
+}
+
+// QUÉ: Cambiar la memoria contabilizada de un elemento (alta, cambio o baja).
+static void contabilizarMemoria(EstadoLote* estado, ElementoLote* elemento, size_t nuevos, int deltaImagenes) {
+    pthread_mutex_lock(&estado->mutex);
+    estado->memoria = estado->memoria - elemento->bytes + nuevos;
+    estado->imagenes += deltaImagenes;
+    elemento->bytes = nuevos;
+    if (estado->memoria > estado->resumen->picoMemoria) estado->resumen->picoMemoria = estado->memoria;
+    if (estado->imagenes > estado->resumen->picoImagenes) estado->resumen->picoImagenes = estado->imagenes;
+    pthread_cond_broadcast(&estado->hayMemoria);
+    pthread_mutex_unlock(&estado->mutex);
+}
+
+// QUÉ: Registrar el tiempo de trabajo de una etapa y, si aplica, del archivo.
+static void registrarTiempo(EstadoLote* estado, int etapa, int indice, struct timeval inicio) {
+    struct timeval fin;
+    gettimeofday(&fin, NULL);
+    double segundos = obtenerTiempoReal(inicio, fin);
+    pthread_mutex_lock(&estado->mutex);
+    estado->resumen->ocupado[etapa] += segundos;
+    pthread_mutex_unlock(&estado->mutex);
+    if (estado->opciones->tiempos) {
+        estado->opciones->tiempos[indice].segundos[etapa] = segundos;
+    }
+}
+
+// QUÉ: Dar por terminado un archivo (guardado o fallido) y liberar su memoria.
+static void finalizarElemento(EstadoLote* estado, ElementoLote* elemento, int ok) {
+    liberarImagen(&elemento->imagen);
+    contabilizarMemoria(estado, elemento, 0, -1);
+    pthread_mutex_lock(&estado->mutex);
+    if (ok) estado->resumen->correctos++;
+    else estado->resumen->fallidos++;
+    pthread_mutex_unlock(&estado->mutex);
+    if (estado->opciones->tiempos) {
+        estado->opciones->tiempos[elemento->indice].ok = ok;
+    }
+    free(elemento);
+}
+
+// QUÉ: Intentar procesar el archivo entero con opciones->procesarArchivo.
+// CÓMO: El tiempo ocupa al hilo decodificador, pero en la tabla por archivo
+// se anota como proceso (decodificar, procesar y codificar van entrelazados).
+// Devuelve 1 si el archivo quedó terminado (bien o mal), 0 si no aplica.
+static int procesarArchivoCompleto(EstadoLote* estado, int indice) {
+    const OpcionesLote* opciones = estado->opciones;
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+    int resultado = opciones->procesarArchivo(opciones->entradas[indice], opciones->salidas[indice],
+                                              opciones->contexto);
+    if (resultado < 0) {
+        return 0;
+    }
+    gettimeofday(&fin, NULL);
+    double segundos = obtenerTiempoReal(inicio, fin);
+    pthread_mutex_lock(&estado->mutex);
+    estado->resumen->ocupado[ETAPA_DECODIFICAR] += segundos;
+    if (resultado) estado->resumen->correctos++;
+    else estado->resumen->fallidos++;
+    pthread_mutex_unlock(&estado->mutex);
+    if (opciones->tiempos) {
+        opciones->tiempos[indice].segundos[ETAPA_PROCESAR] = segundos;
+        opciones->tiempos[indice].ok = resultado;
+    }
+    return 1;
+}
+
+// QUÉ: Decodificar un archivo desde el búfer de la lectura anticipada.
+// CÓMO: El búfer se devuelve nada más decodificar, antes de que la imagen
+// espere en la cola, para que la ventana siga avanzando. Los archivos que la
+// capa de E/S no lee por adelantado (la ruta "-", los que no son regulares)
+// se cargan por la ruta.
+static int cargarArchivoLeido(EstadoLote* estado, int indice, ImagenInfo* imagen) {
+    const OpcionesLote* opciones = estado->opciones;
+    const char* ruta = opciones->entradas[indice];
+    const unsigned char* datos;
+    size_t tam;
+    int leido = tomarArchivoLeido(estado->es, indice, &datos, &tam);
+    int ok = 0;
+    if (leido > 0) {
+        ok = cargarImagenMemoria(datos, tam, ruta, imagen, opciones->canalesEntrada);
+    } else if (leido < 0) {
+        ok = cargarImagenCanales(ruta, imagen, opciones->canalesEntrada);
+    }
+    devolverArchivoLeido(estado->es, indice);
+    return ok;
+}
+
+// QUÉ: Hilo de decodificación.
+// CÓMO: Reparte los archivos con un contador compartido; antes de cada uno
+// espera a que haya presupuesto de memoria (siempre se admite una imagen si no
+// hay ninguna en vuelo, para no bloquearse con imágenes más grandes que el presupuesto).
+static void decodificarLote(EstadoLote* estado) {
+    const OpcionesLote* opciones = estado->opciones;
+    while (1) {
+        pthread_mutex_lock(&estado->mutex);
+        while (opciones->presupuestoMemoria > 0 && estado->imagenes > 0 &&
+               estado->memoria >= opciones->presupuestoMemoria) {
+            pthread_cond_wait(&estado->hayMemoria, &estado->mutex);
+        }
+        int indice = estado->siguiente < opciones->numArchivos ? estado->siguiente++ : -1;
+        pthread_mutex_unlock(&estado->mutex);
+        if (indice < 0) {
+            break;
+        }
+
+        if (opciones->procesarArchivo && procesarArchivoCompleto(estado, indice)) {
+            // El flujo lee el archivo por su ruta; la lectura anticipada solo
+            // dejó los bytes en la caché de páginas
+            if (estado->es) devolverArchivoLeido(estado->es, indice);
+            continue;
+        }
+
+        ElementoLote* elemento = (ElementoLote*)calloc(1, sizeof(ElementoLote));
+        if (!elemento) {
+            fprintf(stderr, "Error de memoria en el lote\n");
+            if (estado->es) devolverArchivoLeido(estado->es, indice);
+            pthread_mutex_lock(&estado->mutex);
+            estado->resumen->fallidos++;
+            pthread_mutex_unlock(&estado->mutex);
+            continue;
+        }
+        elemento->indice = indice;
+        elemento->estado = estado;
+        struct timeval inicio;
+        gettimeofday(&inicio, NULL);
+        int ok = estado->es ? cargarArchivoLeido(estado, indice, &elemento->imagen)
+                            : cargarImagenCanales(opciones->entradas[indice], &elemento->imagen,
+                                                  opciones->canalesEntrada);
+        registrarTiempo(estado, ETAPA_DECODIFICAR, indice, inicio);
+        contabilizarMemoria(estado, elemento, ok ? memoriaImagen(&elemento->imagen) : 0, 1);
+        if (!ok) {
+            finalizarElemento(estado, elemento, 0);
+            continue;
+        }
+        ponerEnCola(&estado->colaProcesar, elemento);
+    }
+    terminarProductor(&estado->colaProcesar);
+}
+
+// QUÉ: Hilo de procesado: aplica la operación y pasa la imagen a codificar.
+static void procesarLote(EstadoLote* estado) {
+    const OpcionesLote* opciones = estado->opciones;
+    ElementoLote* elemento;
+    while ((elemento = tomarDeCola(&estado->colaProcesar)) != NULL) {
+        int ok = 1;
+        if (opciones->procesar) {
+            struct timeval inicio;
+            gettimeofday(&inicio, NULL);
+            ok = opciones->procesar(&elemento->imagen, opciones->contexto);
+            registrarTiempo(estado, ETAPA_PROCESAR, elemento->indice, inicio);
+        }
+        if (!ok || !elemento->imagen.pixeles) {
+            fprintf(stderr, "Error al procesar: %s\n", opciones->entradas[elemento->indice]);
+            finalizarElemento(estado, elemento, 0);
+            continue;
+        }
+        // La operación puede haber cambiado el tamaño (escalado, rotación)
+        contabilizarMemoria(estado, elemento, memoriaImagen(&elemento->imagen), 0);
+        ponerEnCola(&estado->colaCodificar, elemento);
+    }
+    terminarProductor(&estado->colaCodificar);
+}
+
+// QUÉ: Aviso de la capa de E/S: la salida de un elemento quedó escrita (o no).
+static void alTerminarEscrituraLote(void* contexto, int ok) {
+    ElementoLote* elemento = (ElementoLote*)contexto;
+    finalizarElemento(elemento->estado, elemento, ok);
+}
+
+// QUÉ: Codificar en memoria y dejar la escritura a la capa de E/S.
+// CÓMO: Los píxeles se liberan en cuanto hay archivo codificado; hasta que se
+// escribe, el presupuesto cuenta los bytes del archivo.
+// Devuelve 1 si el elemento quedó en manos de la E/S o terminado, 0 si el
+// formato no se codifica en memoria.
+static int codificarEnSegundoPlano(EstadoLote* estado, ElementoLote* elemento, struct timeval inicio) {
+    const char* ruta = estado->opciones->salidas[elemento->indice];
+    unsigned char* datos = NULL;
+    size_t tam = 0;
+    int resultado = codificarImagenMemoria(&elemento->imagen, ruta, &datos, &tam);
+    if (resultado < 0) {
+        return 0;
+    }
+    registrarTiempo(estado, ETAPA_CODIFICAR, elemento->indice, inicio);
+    if (!resultado) {
+        finalizarElemento(estado, elemento, 0);
+        return 1;
+    }
+    liberarImagen(&elemento->imagen);
+    contabilizarMemoria(estado, elemento, tam, 0);
+    if (!escribirArchivoAsincrono(estado->es, ruta, datos, tam, alTerminarEscrituraLote, elemento)) {
+        finalizarElemento(estado, elemento, 0);
+    }
+    return 1;
+}
+
+// QUÉ: Hilo de codificación: guarda con el formato de la ruta de salida.
+static void codificarLote(EstadoLote* estado) {
+    const OpcionesLote* opciones = estado->opciones;
+    ElementoLote* elemento;
+    while ((elemento = tomarDeCola(&estado->colaCodificar)) != NULL) {
+        struct timeval inicio;
+        gettimeofday(&inicio, NULL);
+        if (estado->es && codificarEnSegundoPlano(estado, elemento, inicio)) {
+            continue;
+        }
+        int ok = guardarImagen(&elemento->imagen, opciones->salidas[elemento->indice]);
+        registrarTiempo(estado, ETAPA_CODIFICAR, elemento->indice, inicio);
+        finalizarElemento(estado, elemento, ok);
+    }
+}
+
+static void* hiloLote(void* arg) {
+    HiloLote* hilo = (HiloLote*)arg;
+    switch (hilo->etapa) {
+        case ETAPA_DECODIFICAR: decodificarLote(hilo->estado); break;
+        case ETAPA_PROCESAR: procesarLote(hilo->estado); break;
+        default: codificarLote(hilo->estado); break;
+    }
+    return NULL;
+}
+
+// QUÉ: Ejecutar el lote completo.
+// CÓMO: Ver batch.h.
+// POR QUÉ: Ver batch.h.
+int ejecutarLote(const OpcionesLote* opciones, ResumenLote* resumen) {
+    memset(resumen, 0, sizeof(*resumen));
+    if (opciones->numArchivos <= 0) {
+        return 1;
+    }
+    int total = 0;
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        resumen->hilos[e] = opciones->hilos[e] < 1 ? 1 : opciones->hilos[e];
+        total += resumen->hilos[e];
+    }
+    int capacidad = opciones->capacidadCola < 1 ? 1 : opciones->capacidadCola;
+
+    EstadoLote estado;
+    memset(&estado, 0, sizeof(estado));
+    estado.opciones = opciones;
+    estado.resumen = resumen;
+    pthread_t* hilos = (pthread_t*)malloc((size_t)total * sizeof(pthread_t));
+    HiloLote* argumentos = (HiloLote*)malloc((size_t)total * sizeof(HiloLote));
+    if (!hilos || !argumentos ||
+        !iniciarCola(&estado.colaProcesar, capacidad, resumen->hilos[ETAPA_DECODIFICAR])) {
+        fprintf(stderr, "Error de memoria al preparar el lote\n");
+        free(hilos);
+        free(argumentos);
+        return 0;
+    }
+    if (!iniciarCola(&estado.colaCodificar, capacidad, resumen->hilos[ETAPA_PROCESAR])) {
+        fprintf(stderr, "Error de memoria al preparar el lote\n");
+        destruirCola(&estado.colaProcesar);
+        free(hilos);
+        free(argumentos);
+        return 0;
+    }
+    pthread_mutex_init(&estado.mutex, NULL);
+    pthread_cond_init(&estado.hayMemoria, NULL);
+
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+
+    // QUÉ: Capa de E/S asíncrona (opcional).
+    // CÓMO: La ventana de lectura anticipada cubre dos archivos por hilo
+    // decodificador más dos de margen, con un máximo de VENTANA_MAXIMA_LOTE.
+    // Si no se puede crear, el lote sigue con E/S síncrona.
+    if (opciones->modoES != ES_SINCRONA) {
+        int ventana = 2 * resumen->hilos[ETAPA_DECODIFICAR] + 2;
+        if (ventana > VENTANA_MAXIMA_LOTE) ventana = VENTANA_MAXIMA_LOTE;
+        estado.es = crearESAsincrona(opciones->entradas, opciones->numArchivos, ventana, opciones->modoES);
+        if (estado.es) resumen->motorES = nombreMotorES(estado.es);
+    }
+
+    // QUÉ: Lanzar los hilos de las tres etapas, de la última a la primera.
+    // CÓMO: Si una etapa se queda sin ningún hilo, las anteriores no se lanzan
+    // y sus productores se dan por terminados, así las colas se cierran y los
+    // hilos ya lanzados salen en vez de esperar para siempre.
+    static const int orden[NUM_ETAPAS] = {ETAPA_CODIFICAR, ETAPA_PROCESAR, ETAPA_DECODIFICAR};
+    int lanzados = 0;
+    int ok = 1;
+    for (int k = 0; k < NUM_ETAPAS; k++) {
+        int e = orden[k];
+        int activos = 0;
+        for (int i = 0; i < resumen->hilos[e] && ok; i++) {
+            argumentos[lanzados].estado = &estado;
+            argumentos[lanzados].etapa = e;
+            if (pthread_create(&hilos[lanzados], NULL, hiloLote, &argumentos[lanzados]) == 0) {
+                lanzados++;
+                activos++;
+            }
+        }
+        // Productores que no llegaron a arrancar
+        for (int i = activos; i < resumen->hilos[e]; i++) {
+            if (e == ETAPA_DECODIFICAR) terminarProductor(&estado.colaProcesar);
+            if (e == ETAPA_PROCESAR) terminarProductor(&estado.colaCodificar);
+        }
+        if (activos == 0 && ok) {
+            fprintf(stderr, "Error al crear los hilos del lote\n");
+            ok = 0;
+        }
+        resumen->hilos[e] = activos;
+    }
+    for (int i = 0; i < lanzados; i++) {
+        pthread_join(hilos[i], NULL);
+    }
+    // Las últimas escrituras terminan aquí; sus avisos cierran los recuentos
+    destruirESAsincrona(estado.es);
+
+    gettimeofday(&fin, NULL);
+    resumen->segundosTotales = obtenerTiempoReal(inicio, fin);
+
+    pthread_mutex_destroy(&estado.mutex);
+    pthread_cond_destroy(&estado.hayMemoria);
+    destruirCola(&estado.colaProcesar);
+    destruirCola(&estado.colaCodificar);
+    free(hilos);
+    free(argumentos);
+    return ok && resumen->fallidos == 0 && resumen->correctos == opciones->numArchivos;
+}
+
+// QUÉ: Imprimir el resumen del lote.
+void imprimirResumenLote(const ResumenLote* resumen) {
+    static const char* nombres[NUM_ETAPAS] = {"Decodificar", "Procesar", "Codificar"};
+    printf("\n--- Resumen del lote ---\n");
+    printf("Archivos: %d correctos, %d fallidos en %.3f s", resumen->correctos, resumen->fallidos,
+           resumen->segundosTotales);
+    if (resumen->segundosTotales > 0) {
+        printf(" (%.2f archivos/s)", resumen->correctos / resumen->segundosTotales);
+    }
+    printf("\n");
+    for (int e = 0; e < NUM_ETAPAS; e++) {
+        double capacidad = resumen->segundosTotales * resumen->hilos[e];
+        printf("  %-12s %2d hilos  ocupado %8.3f s  utilización %5.1f%%\n", nombres[e],
+               resumen->hilos[e], resumen->ocupado[e],
+               capacidad > 0 ? 100.0 * resumen->ocupado[e] / capacidad : 0.0);
+    }
+    printf("Memoria pico en vuelo: %.1f MB (%d imágenes)\n",
+           resumen->picoMemoria / (1024.0 * 1024.0), resumen->picoImagenes);
+    printf("E/S de archivos: %s\n", resumen->motorES ? resumen->motorES : "síncrona");
+}
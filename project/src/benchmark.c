@@ -159,11 +159,11 @@ void mostrarInformacion(const ImagenInfo* info) {
         printf("  ✓ Imagen cargada:\n");
         printf("    - Dimensiones: %d x %d píxeles\n", info->ancho, info->alto);
         printf("    - Formato: %s (%d canal%s)\n",
-               info->canales == 1 ? "Escala de grises" : "RGB",
+               nombreFormatoImagen(info),
                info->canales,
                info->canales == 1 ? "" : "es");
         printf("    - Tamaño total: %.2f MB\n",
-               (info->ancho * info->alto * info->canales) / (1024.0 * 1024.0));
+               ((double)info->ancho * info->alto * bytesPixel(info)) / (1024.0 * 1024.0));
         printf("    - Píxeles totales: %d\n", info->ancho * info->alto);
     }
 
@@ -16,9 +16,39 @@ typedef struct {
     int fin;
     int ancho;
     int canales;
+    int bytesMuestra;
     int delta;
 } BrilloArgs;
 
+// QUÉ: Sumar delta a los canales de color de una fila, con saturación.
+// CÓMO: El alfa (último canal de 2 o 4) no es luz: se deja intacto. Una copia
+// por tipo de muestra (bytes constante); con 16 bits delta se escala por 257
+// para que el mismo delta aclare lo mismo en ambas profundidades.
+__attribute__((always_inline))
+static inline void ajustarBrilloMuestras(unsigned char* fila, int ancho, int canales, int delta, const int bytes) {
+    int canalesColor = canales - (tieneAlfa(canales) ? 1 : 0);
+    int maximo = (bytes == 2) ? 65535 : 255;
+    if (bytes == 2) {
+        delta *= 257;
+    }
+    for (int x = 0; x < ancho; x++) {
+        for (int c = 0; c < canalesColor; c++) {
+            size_t i = (size_t)x * canales + c;
+            int nuevoValor = (int)leerMuestra(fila, i, bytes) + delta;
+            escribirMuestra(fila, i, (unsigned int)(nuevoValor < 0 ? 0 : (nuevoValor > maximo ? maximo : nuevoValor)),
+                            bytes);
+        }
+    }
+}
+
+void ajustarBrilloFila(unsigned char* fila, int ancho, int canales, int delta, int bytesMuestra) {
+    if (bytesMuestra == 2) {
+        ajustarBrilloMuestras(fila, ancho, canales, delta, 2);
+    } else {
+        ajustarBrilloMuestras(fila, ancho, canales, delta, 1);
+    }
+}
+
 // QUÉ: Ajustar brillo en un rango de filas (para hilos) con monitoreo.
 // CÓMO: Suma delta a cada canal, registra inicio/fin y progreso.
 // POR QUÉ: Permite visualizar el trabajo de cada hilo.
@@ -31,14 +61,8 @@ static void* ajustarBrilloHilo(void* args) {
 
     int pixeles_procesados = 0;
     for (int y = bArgs->inicio; y < bArgs->fin; y++) {
-        for (int x = 0; x < bArgs->ancho; x++) {
-            for (int c = 0; c < bArgs->canales; c++) {
-                int nuevoValor = bArgs->pixeles[y][x][c] + bArgs->delta;
-                bArgs->pixeles[y][x][c] = (unsigned char)(nuevoValor < 0 ? 0 :
-                                                          (nuevoValor > 255 ? 255 : nuevoValor));
-            }
-            pixeles_procesados++;
-        }
+        ajustarBrilloFila(bArgs->pixeles[y][0], bArgs->ancho, bArgs->canales, bArgs->delta, bArgs->bytesMuestra);
+        pixeles_procesados += bArgs->ancho;
     }
 
     // Registrar fin
@@ -61,9 +85,9 @@ static void* ajustarBrilloHilo(void* args) {
 // QUÉ: Ajustar brillo de la imagen usando múltiples hilos con monitoreo.
 // CÓMO: Divide las filas entre hilos, registra tiempos y muestra estadísticas.
 // POR QUÉ: Demuestra paralelización con evidencia visual clara.
-void ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
+int ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
     if (!imagenCargada(info)) {
-        return;
+        return 0;
     }
 
     if (delta < -255 || delta > 255) {
@@ -82,8 +106,7 @@ void ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
     printf("╚══════════════════════════════════════════════════════╝\n");
     printf("Configuración:\n");
     printf("  • Hilos activos: %d\n", numHilos);
-    printf("  • Imagen: %dx%d (%s)\n", info->ancho, info->alto,
-           info->canales == 1 ? "grayscale" : "RGB");
+    printf("  • Imagen: %dx%d (%s)\n", info->ancho, info->alto, nombreFormatoImagen(info));
     printf("  • Total píxeles: %d\n", info->ancho * info->alto);
     printf("  • Delta brillo: %+d\n", delta);
     printf("\n");
@@ -97,7 +120,7 @@ void ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
         fprintf(stderr, "Error de memoria al asignar hilos\n");
         if (hilos) free(hilos);
         if (args) free(args);
-        return;
+        return 0;
     }
 
     int filasPorHilo = (int)ceil((double)info->alto / numHilos);
@@ -111,6 +134,7 @@ void ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
         args[i].fin = ((i + 1) * filasPorHilo < info->alto) ? (i + 1) * filasPorHilo : info->alto;
         args[i].ancho = info->ancho;
         args[i].canales = info->canales;
+        args[i].bytesMuestra = bytesMuestra(info);
         args[i].delta = delta;
         printf("Lanzando hilos...\n");
         if (pthread_create(&hilos[i], NULL, ajustarBrilloHilo, &args[i]) != 0) {
@@ -118,10 +142,10 @@ void ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
             for (int j = 0; j < i; j++) {
                 pthread_join(hilos[j], NULL);
             }
-            printf("\nTodos los hilos completados.\n");
+            // Las filas de los hilos ya unidos quedan cambiadas
             free(hilos);
             free(args);
-            return;
+            return 0;
         }
         printf("  [Hilo #%d] Lanzado: procesará filas %d-%d\n",
                i, args[i].inicio, args[i].fin - 1);
@@ -155,4 +179,32 @@ void ajustarBrilloConcurrente(ImagenInfo* info, int delta) {
 
     free(hilos);
     free(args);
+    return 1;
+}
+
+// QUÉ: Ajustar el brillo solo dentro de un rectángulo (ver filters.h).
+// CÓMO: Recorta el rectángulo a la imagen y aplica ajustarBrilloFila al tramo
+// de cada fila; un solo hilo, porque la región suele ser pequeña.
+int ajustarBrilloRegion(ImagenInfo* info, int x, int y, int ancho, int alto, int delta) {
+    if (!imagenCargada(info)) {
+        return 0;
+    }
+    int x1 = x + ancho < info->ancho ? x + ancho : info->ancho;
+    int y1 = y + alto < info->alto ? y + alto : info->alto;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (ancho <= 0 || alto <= 0 || x >= x1 || y >= y1) {
+        fprintf(stderr, "La región no tiene píxeles dentro de la imagen (%dx%d)\n", info->ancho, info->alto);
+        return 0;
+    }
+
+    struct timeval tiempo_inicio, tiempo_fin;
+    gettimeofday(&tiempo_inicio, NULL);
+    for (int fila = y; fila < y1; fila++) {
+        ajustarBrilloFila(info->pixeles[fila][x], x1 - x, info->canales, delta, bytesMuestra(info));
+    }
+    gettimeofday(&tiempo_fin, NULL);
+    printf("✓ Brillo %+d en la región %dx%d desde (%d, %d) en %.4f seg\n", delta, x1 - x, y1 - y, x, y,
+           obtenerTiempoReal(tiempo_inicio, tiempo_fin));
+    return 1;
 }
@@ -0,0 +1,511 @@
+#include "cache.h"
+#include "pnm.h"
+#include "srgb.h"
+#include "threading.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// --- XXH64 ---
+
+#define PRIMO64_1 0x9E3779B185EBCA87ULL
+#define PRIMO64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIMO64_3 0x165667B19E3779F9ULL
+#define PRIMO64_4 0x85EBCA77C2B2AE63ULL
+#define PRIMO64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotarIzq64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+// CÓMO: memcpy evita lecturas desalineadas; el compilador lo convierte en
+// una carga (las claves en disco suponen un host little-endian).
+static inline uint64_t leer64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t leer32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t rondaXXH(uint64_t acumulador, uint64_t entrada) {
+    acumulador += entrada * PRIMO64_2;
+    acumulador = rotarIzq64(acumulador, 31);
+    return acumulador * PRIMO64_1;
+}
+
+static inline uint64_t mezclarRonda(uint64_t acumulador, uint64_t valor) {
+    acumulador ^= rondaXXH(0, valor);
+    return acumulador * PRIMO64_1 + PRIMO64_4;
+}
+
+// QUÉ: Hash XXH64 (ver cache.h).
+// CÓMO: Cuatro acumuladores independientes sobre franjas de 32 bytes (el
+// procesador los avanza en paralelo), fusión, cola de 8/4/1 bytes y
+// avalancha final.
+uint64_t hashBytes(const void* datos, size_t largo, uint64_t semilla) {
+    const unsigned char* p = (const unsigned char*)datos;
+    const unsigned char* fin = p + largo;
+    uint64_t h;
+
+    if (largo >= 32) {
+        const unsigned char* limite = fin - 32;
+        uint64_t v1 = semilla + PRIMO64_1 + PRIMO64_2;
+        uint64_t v2 = semilla + PRIMO64_2;
+        uint64_t v3 = semilla;
+        uint64_t v4 = semilla - PRIMO64_1;
+        do {
+            v1 = rondaXXH(v1, leer64(p));
+            v2 = rondaXXH(v2, leer64(p + 8));
+            v3 = rondaXXH(v3, leer64(p + 16));
+            v4 = rondaXXH(v4, leer64(p + 24));
+            p += 32;
+        } while (p <= limite);
+        h = rotarIzq64(v1, 1) + rotarIzq64(v2, 7) + rotarIzq64(v3, 12) + rotarIzq64(v4, 18);
+        h = mezclarRonda(h, v1);
+        h = mezclarRonda(h, v2);
+        h = mezclarRonda(h, v3);
+        h = mezclarRonda(h, v4);
+    } else {
+        h = semilla + PRIMO64_5;
+    }
+    h += (uint64_t)largo;
+
+    for (; p + 8 <= fin; p += 8) {
+        h ^= rondaXXH(0, leer64(p));
+        h = rotarIzq64(h, 27) * PRIMO64_1 + PRIMO64_4;
+    }
+    if (p + 4 <= fin) {
+        h ^= (uint64_t)leer32(p) * PRIMO64_1;
+        h = rotarIzq64(h, 23) * PRIMO64_2 + PRIMO64_3;
+        p += 4;
+    }
+    for (; p < fin; p++) {
+        h ^= (*p) * PRIMO64_5;
+        h = rotarIzq64(h, 11) * PRIMO64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIMO64_2;
+    h ^= h >> 29;
+    h *= PRIMO64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+// --- Hash de imágenes ---
+
+// QUÉ: Trabajo compartido por las tareas del hash en paralelo.
+typedef struct {
+    const unsigned char* datos;
+    size_t total;
+    int numBloques;
+    uint64_t* hashes;
+    int siguiente;          // Próximo bloque libre (contador atómico)
+} TrabajoHash;
+
+static void hashBloquesTarea(void* arg) {
+    TrabajoHash* trabajo = (TrabajoHash*)arg;
+    while (1) {
+        int bloque = __atomic_fetch_add(&trabajo->siguiente, 1, __ATOMIC_RELAXED);
+        if (bloque >= trabajo->numBloques) {
+            return;
+        }
+        size_t inicio = (size_t)bloque * BLOQUE_HASH_CACHE;
+        size_t largo = trabajo->total - inicio < BLOQUE_HASH_CACHE ? trabajo->total - inicio : BLOQUE_HASH_CACHE;
+        trabajo->hashes[bloque] = hashBytes(trabajo->datos + inicio, largo, 0);
+    }
+}
+
+// QUÉ: Hash de una imagen (ver cache.h).
+uint64_t hashImagen(const ImagenInfo* imagen) {
+    int32_t cabecera[5] = {imagen->ancho, imagen->alto, imagen->canales, imagen->profundidad, imagen->relleno};
+    uint64_t semilla = hashBytes(cabecera, sizeof(cabecera), 0);
+    if (!imagenCargada(imagen)) {
+        return semilla;
+    }
+    TrabajoHash trabajo;
+    trabajo.datos = imagen->pixeles[0][0];
+    trabajo.total = (size_t)imagen->ancho * imagen->alto * bytesPixel(imagen);
+    trabajo.numBloques = (int)((trabajo.total + BLOQUE_HASH_CACHE - 1) / BLOQUE_HASH_CACHE);
+    trabajo.siguiente = 0;
+    trabajo.hashes = (uint64_t*)malloc((size_t)trabajo.numBloques * sizeof(uint64_t));
+    if (!trabajo.hashes) {
+        // Sin memoria para la lista: un solo bloque da una clave distinta pero
+        // igual de válida (solo cambia qué se reutiliza, nunca el resultado)
+        return hashBytes(trabajo.datos, trabajo.total, ~semilla);
+    }
+
+    int numHilos = NUM_HILOS_GLOBAL < trabajo.numBloques ? NUM_HILOS_GLOBAL : trabajo.numBloques;
+    PoolHilos pool;
+    if (numHilos > 1 && crearPool(&pool, numHilos, numHilos)) {
+        GrupoTareas grupo;
+        iniciarGrupo(&grupo);
+        for (int i = 0; i < numHilos; i++) {
+            if (!enviarTarea(&pool, hashBloquesTarea, &trabajo, &grupo)) {
+                break;
+            }
+        }
+        esperarGrupo(&grupo);
+        destruirGrupo(&grupo);
+        destruirPool(&pool);
+    }
+    // Sin pool (o si algún envío falló) este hilo termina los bloques que queden
+    hashBloquesTarea(&trabajo);
+
+    uint64_t h = hashBytes(trabajo.hashes, (size_t)trabajo.numBloques * sizeof(uint64_t), semilla);
+    free(trabajo.hashes);
+    return h;
+}
+
+// QUÉ: Hash de la cadena de operaciones (ver cache.h).
+// CÓMO: Campo a campo, para no hashear el relleno de la estructura.
+uint64_t hashCadena(const CadenaOperaciones* cadena) {
+    int32_t cabecera[2] = {cadena->numOps, LUZ_LINEAL_GLOBAL ? 1 : 0};
+    uint64_t h = hashBytes(cabecera, sizeof(cabecera), 0);
+    for (int i = 0; i < cadena->numOps; i++) {
+        const Operacion* op = &cadena->ops[i];
+        int32_t campos[5] = {(int32_t)op->tipo, op->entero[0], op->entero[1], op->entero[2], 0};
+        memcpy(&campos[4], &op->real, sizeof(float));
+        h = hashBytes(campos, sizeof(campos), h);
+    }
+    return h;
+}
+
+// --- Nivel de memoria (LRU) ---
+
+#define CUBETAS_CACHE 1024
+
+// QUÉ: Resultado guardado en memoria.
+// CÓMO: Está a la vez en una cubeta de la tabla hash y en la lista LRU
+// (cabeza = usado más recientemente).
+typedef struct EntradaCache {
+    ClaveCache clave;
+    ImagenInfo imagen;
+    size_t bytes;
+    struct EntradaCache* anterior;
+    struct EntradaCache* siguiente;
+    struct EntradaCache* siguienteCubeta;
+} EntradaCache;
+
+// QUÉ: Clave que un hilo está calculando (ver buscarEnCache).
+typedef struct EnCalculo {
+    ClaveCache clave;
+    struct EnCalculo* siguiente;
+} EnCalculo;
+
+// QUÉ: Estado del módulo, protegido por 'mutex'. 'calculada' se señala
+// cada vez que una clave sale de la lista enCalculo.
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t calculada = PTHREAD_COND_INITIALIZER;
+static EnCalculo* enCalculo = NULL;
+static EntradaCache* cubetas[CUBETAS_CACHE];
+static EntradaCache* cabeza = NULL;
+static EntradaCache* cola = NULL;
+static size_t capacidad = 0;
+static size_t ocupados = 0;
+static int numEntradas = 0;
+static char directorio[1024] = "";
+static long consultas = 0, aciertosMemoria = 0, aciertosDisco = 0, expulsadas = 0, esperas = 0;
+static int temporales = 0;
+
+static size_t bytesImagen(const ImagenInfo* imagen) {
+    return (size_t)imagen->ancho * imagen->alto * bytesPixel(imagen);
+}
+
+// QUÉ: Copia independiente de una imagen. Devuelve 1 si tuvo éxito.
+static int copiarImagen(const ImagenInfo* origen, ImagenInfo* destino) {
+    if (!crearImagenComo(destino, origen, origen->ancho, origen->alto)) {
+        return 0;
+    }
+    memcpy(destino->pixeles[0][0], origen->pixeles[0][0], bytesImagen(origen));
+    return 1;
+}
+
+static int clavesIguales(const ClaveCache* a, const ClaveCache* b) {
+    return a->pixeles == b->pixeles && a->operacion == b->operacion;
+}
+
+static inline int cubetaDe(const ClaveCache* clave) {
+    return (int)((clave->pixeles ^ clave->operacion) % CUBETAS_CACHE);
+}
+
+static EntradaCache* buscarEntrada(const ClaveCache* clave) {
+    for (EntradaCache* e = cubetas[cubetaDe(clave)]; e; e = e->siguienteCubeta) {
+        if (clavesIguales(&e->clave, clave)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void quitarDeLista(EntradaCache* e) {
+    if (e->anterior) e->anterior->siguiente = e->siguiente; else cabeza = e->siguiente;
+    if (e->siguiente) e->siguiente->anterior = e->anterior; else cola = e->anterior;
+    e->anterior = e->siguiente = NULL;
+}
+
+static void ponerEnCabeza(EntradaCache* e) {
+    e->siguiente = cabeza;
+    e->anterior = NULL;
+    if (cabeza) cabeza->anterior = e; else cola = e;
+    cabeza = e;
+}
+
+// QUÉ: Sacar una entrada de la tabla y de la lista y liberarla.
+static void eliminarEntrada(EntradaCache* e) {
+    EntradaCache** enlace = &cubetas[cubetaDe(&e->clave)];
+    while (*enlace != e) {
+        enlace = &(*enlace)->siguienteCubeta;
+    }
+    *enlace = e->siguienteCubeta;
+    quitarDeLista(e);
+    ocupados -= e->bytes;
+    numEntradas--;
+    liberarImagen(&e->imagen);
+    free(e);
+}
+
+// QUÉ: Añadir a memoria una imagen ya copiada, expulsando por LRU.
+// CÓMO: Se llama con el mutex tomado; si la clave ya estaba (dos hilos
+// calcularon lo mismo a la vez) se descarta la copia nueva.
+static void insertarEnMemoria(const ClaveCache* clave, ImagenInfo* imagen) {
+    size_t bytes = bytesImagen(imagen);
+    if (bytes > capacidad || buscarEntrada(clave)) {
+        liberarImagen(imagen);
+        return;
+    }
+    EntradaCache* e = (EntradaCache*)calloc(1, sizeof(EntradaCache));
+    if (!e) {
+        liberarImagen(imagen);
+        return;
+    }
+    while (ocupados + bytes > capacidad && cola) {
+        eliminarEntrada(cola);
+        expulsadas++;
+    }
+    e->clave = *clave;
+    e->imagen = *imagen;
+    e->bytes = bytes;
+    int cubeta = cubetaDe(clave);
+    e->siguienteCubeta = cubetas[cubeta];
+    cubetas[cubeta] = e;
+    ponerEnCabeza(e);
+    ocupados += bytes;
+    numEntradas++;
+}
+
+static EnCalculo** buscarEnCalculo(const ClaveCache* clave) {
+    EnCalculo** enlace = &enCalculo;
+    while (*enlace && !clavesIguales(&(*enlace)->clave, clave)) {
+        enlace = &(*enlace)->siguiente;
+    }
+    return enlace;
+}
+
+// QUÉ: Sacar una clave de la lista en cálculo y despertar a los que esperan.
+// CÓMO: Se llama con el mutex tomado.
+static void terminarCalculo(const ClaveCache* clave) {
+    EnCalculo** enlace = buscarEnCalculo(clave);
+    if (*enlace) {
+        EnCalculo* libre = *enlace;
+        *enlace = libre->siguiente;
+        free(libre);
+        pthread_cond_broadcast(&calculada);
+    }
+}
+
+// --- Nivel de disco ---
+
+static void rutaEnDisco(const ClaveCache* clave, char* ruta, size_t tam) {
+    snprintf(ruta, tam, "%s/%016llx-%016llx.pnm", directorio, (unsigned long long)clave->pixeles,
+             (unsigned long long)clave->operacion);
+}
+
+// QUÉ: Configurar la caché (ver cache.h).
+int configurarCache(size_t capacidadBytes, const char* dir) {
+    liberarCache();
+    pthread_mutex_lock(&mutex);
+    capacidad = capacidadBytes;
+    directorio[0] = 0;
+    consultas = aciertosMemoria = aciertosDisco = expulsadas = esperas = 0;
+    pthread_mutex_unlock(&mutex);
+    if (!dir) {
+        return 1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "ERROR: No se pudo crear el directorio de caché %s: %s\n", dir, strerror(errno));
+        return 0;
+    }
+    if (access(dir, W_OK | X_OK) != 0) {
+        fprintf(stderr, "ERROR: El directorio de caché %s no es escribible\n", dir);
+        return 0;
+    }
+    if (strlen(dir) >= sizeof(directorio) - 40) {
+        fprintf(stderr, "ERROR: Ruta de caché demasiado larga: %s\n", dir);
+        return 0;
+    }
+    snprintf(directorio, sizeof(directorio), "%s", dir);
+    return 1;
+}
+
+int cacheActiva(void) {
+    return capacidad > 0 || directorio[0] != 0;
+}
+
+// QUÉ: Buscar un resultado (ver cache.h).
+// CÓMO: La copia de un acierto en memoria se hace con el mutex tomado (la
+// entrada podría expulsarse si no). Si otro hilo está calculando la clave se
+// espera y se vuelve a mirar; si no, la clave pasa a estar en cálculo antes
+// de leer el disco (fuera del mutex), así solo un hilo la lee o la calcula.
+int buscarEnCache(const ClaveCache* clave, ImagenInfo* resultado) {
+    pthread_mutex_lock(&mutex);
+    consultas++;
+    int esperado = 0;
+    while (1) {
+        EntradaCache* e = capacidad > 0 ? buscarEntrada(clave) : NULL;
+        if (e) {
+            quitarDeLista(e);
+            ponerEnCabeza(e);
+            int ok = copiarImagen(&e->imagen, resultado);
+            if (ok) {
+                aciertosMemoria++;
+            }
+            pthread_mutex_unlock(&mutex);
+            return ok;
+        }
+        if (!*buscarEnCalculo(clave)) {
+            break;
+        }
+        if (!esperado) {
+            esperas++;
+            esperado = 1;
+        }
+        pthread_cond_wait(&calculada, &mutex);
+    }
+    EnCalculo* nuevo = (EnCalculo*)malloc(sizeof(EnCalculo));
+    if (nuevo) {
+        nuevo->clave = *clave;
+        nuevo->siguiente = enCalculo;
+        enCalculo = nuevo;
+    }
+    int conDisco = directorio[0] != 0;
+    pthread_mutex_unlock(&mutex);
+
+    if (!conDisco) {
+        return 0;
+    }
+    char ruta[1100];
+    rutaEnDisco(clave, ruta, sizeof(ruta));
+    if (access(ruta, R_OK) != 0 || !cargarPNMSinAviso(ruta, resultado)) {
+        return 0;
+    }
+    ImagenInfo copia = {0, 0, 0, 0, 0, NULL};
+    int subir = capacidad > 0 && copiarImagen(resultado, &copia);
+    pthread_mutex_lock(&mutex);
+    aciertosDisco++;
+    if (subir) {
+        insertarEnMemoria(clave, &copia);
+    }
+    terminarCalculo(clave);
+    pthread_mutex_unlock(&mutex);
+    return 1;
+}
+
+// QUÉ: Escribir un resultado en el nivel de disco, si está activo.
+static void guardarEnDisco(const ClaveCache* clave, const ImagenInfo* resultado) {
+    if (directorio[0] == 0) {
+        return;
+    }
+    char ruta[1100], temporal[1100];
+    rutaEnDisco(clave, ruta, sizeof(ruta));
+    if (access(ruta, F_OK) == 0) {
+        return;
+    }
+    snprintf(temporal, sizeof(temporal), "%s/.tmp-%ld-%d.pnm", directorio, (long)getpid(),
+             __atomic_fetch_add(&temporales, 1, __ATOMIC_RELAXED));
+    int fd = open(temporal, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Aviso: no se pudo escribir en la caché %s: %s\n", temporal, strerror(errno));
+        return;
+    }
+    int ok = escribirPNM(resultado, fd);
+    ok = (close(fd) == 0) && ok;
+    if (!ok || rename(temporal, ruta) != 0) {
+        unlink(temporal);
+    }
+}
+
+// QUÉ: Guardar un resultado (ver cache.h).
+// CÓMO: El disco se escribe antes de despertar a los que esperan: si el
+// resultado no cabe en memoria, lo encuentran allí.
+void guardarEnCache(const ClaveCache* clave, const ImagenInfo* resultado) {
+    if (!imagenCargada(resultado)) {
+        abandonarClaveCache(clave);
+        return;
+    }
+    guardarEnDisco(clave, resultado);
+    ImagenInfo copia = {0, 0, 0, 0, 0, NULL};
+    int enMemoria = capacidad > 0 && bytesImagen(resultado) <= capacidad && copiarImagen(resultado, &copia);
+    pthread_mutex_lock(&mutex);
+    if (enMemoria) {
+        insertarEnMemoria(clave, &copia);
+    }
+    terminarCalculo(clave);
+    pthread_mutex_unlock(&mutex);
+}
+
+void abandonarClaveCache(const ClaveCache* clave) {
+    pthread_mutex_lock(&mutex);
+    terminarCalculo(clave);
+    pthread_mutex_unlock(&mutex);
+}
+
+// QUÉ: Estadísticas de la caché (ver cache.h).
+void imprimirEstadisticasCache(void) {
+    pthread_mutex_lock(&mutex);
+    long aciertos = aciertosMemoria + aciertosDisco;
+    printf("Caché de resultados: %ld consultas, %ld aciertos (%.1f%%): %ld en memoria, %ld en disco; %ld fallos\n",
+           consultas, aciertos, consultas ? 100.0 * aciertos / consultas : 0.0, aciertosMemoria, aciertosDisco,
+           consultas - aciertos);
+    if (esperas > 0) {
+        printf("  %ld consultas esperaron a que otro hilo terminara el mismo cálculo\n", esperas);
+    }
+    if (capacidad > 0) {
+        printf("  memoria: %d resultados, %.1f de %.1f MB, %ld expulsados (LRU)\n", numEntradas,
+               ocupados / (1024.0 * 1024.0), capacidad / (1024.0 * 1024.0), expulsadas);
+    }
+    if (directorio[0]) {
+        printf("  disco: %s\n", directorio);
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// QUÉ: Línea de estado para el menú (ver cache.h).
+void imprimirEstadoCache(void) {
+    pthread_mutex_lock(&mutex);
+    if (consultas > 0) {
+        long aciertos = aciertosMemoria + aciertosDisco;
+        printf("  ⚡ Caché: %ld de %ld aciertos (%.0f%%), %d resultados, %.1f MB\n", aciertos, consultas,
+               100.0 * aciertos / consultas, numEntradas, ocupados / (1024.0 * 1024.0));
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// QUÉ: Liberar el nivel de memoria.
+void liberarCache(void) {
+    pthread_mutex_lock(&mutex);
+    while (cabeza) {
+        eliminarEntrada(cabeza);
+    }
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,605 @@
+#include "cli.h"
+#include "batch.h"
+#include "cache.h"
+#include "flujo.h"
+#include "grafo.h"
+#include "image_io.h"
+#include "operaciones.h"
+#include "paleta.h"
+#include "png_decoder.h"
+#include "png_encoder.h"
+#include "pnm.h"
+#include "threading.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <glob.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// QUÉ: Patrón de salida por defecto (mismo directorio que usa el menú).
+#define PATRON_DEFECTO "results/{name}.png"
+#define PRESUPUESTO_DEFECTO_MB 1024
+
+// QUÉ: Lista dinámica de rutas.
+typedef struct {
+    char** rutas;
+    int num;
+    int capacidad;
+} ListaRutas;
+
+static int agregarRuta(ListaRutas* lista, const char* ruta) {
+    if (lista->num == lista->capacidad) {
+        int nueva = lista->capacidad ? 2 * lista->capacidad : 64;
+        char** rutas = (char**)realloc(lista->rutas, (size_t)nueva * sizeof(char*));
+        if (!rutas) return 0;
+        lista->rutas = rutas;
+        lista->capacidad = nueva;
+    }
+    lista->rutas[lista->num] = strdup(ruta);
+    if (!lista->rutas[lista->num]) return 0;
+    lista->num++;
+    return 1;
+}
+
+static void liberarLista(ListaRutas* lista) {
+    for (int i = 0; i < lista->num; i++) {
+        free(lista->rutas[i]);
+    }
+    free(lista->rutas);
+    lista->rutas = NULL;
+    lista->num = 0;
+    lista->capacidad = 0;
+}
+
+static int compararRutas(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+// QUÉ: ¿Tiene el nombre una extensión de imagen que sabemos leer?
+static int esExtensionImagen(const char* nombre) {
+    static const char* extensiones[] = {".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif",
+                                        ".qoi", ".qoip", ".pgm", ".ppm", ".pnm", ".pam"};
+    const char* punto = strrchr(nombre, '.');
+    if (!punto) return 0;
+    for (size_t i = 0; i < sizeof(extensiones) / sizeof(extensiones[0]); i++) {
+        if (strcasecmp(punto, extensiones[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+// QUÉ: Añadir a la lista los archivos que designa una entrada.
+// CÓMO: Patrón glob (contiene * ? o [), directorio (sus imágenes, sin
+// recursión, en orden alfabético) o archivo suelto; "-" es la entrada
+// estándar (PNM).
+// Devuelve 1 si tuvo éxito, 0 si la entrada no existe o no coincide con nada.
+static int expandirEntrada(const char* entrada, ListaRutas* lista) {
+    if (strcmp(entrada, "-") == 0) {
+        return agregarRuta(lista, entrada);
+    }
+    if (strpbrk(entrada, "*?[")) {
+        glob_t g;
+        int r = glob(entrada, 0, NULL, &g);
+        if (r != 0) {
+            fprintf(stderr, "ERROR: Ningún archivo coincide con '%s'\n", entrada);
+            if (r != GLOB_NOMATCH) globfree(&g);
+            return 0;
+        }
+        int ok = 1;
+        for (size_t i = 0; i < g.gl_pathc && ok; i++) {
+            struct stat st;
+            if (stat(g.gl_pathv[i], &st) == 0 && S_ISREG(st.st_mode)) {
+                ok = agregarRuta(lista, g.gl_pathv[i]);
+            }
+        }
+        globfree(&g);
+        return ok;
+    }
+
+    struct stat st;
+    if (stat(entrada, &st) != 0) {
+        fprintf(stderr, "ERROR: No existe: %s\n", entrada);
+        return 0;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        return agregarRuta(lista, entrada);
+    }
+
+    DIR* dir = opendir(entrada);
+    if (!dir) {
+        fprintf(stderr, "ERROR: No se puede abrir el directorio: %s\n", entrada);
+        return 0;
+    }
+    int primero = lista->num;
+    size_t largo = strlen(entrada);
+    const char* separador = (largo > 0 && entrada[largo - 1] == '/') ? "" : "/";
+    struct dirent* d;
+    int ok = 1;
+    while ((d = readdir(dir)) != NULL && ok) {
+        if (d->d_name[0] == '.' || !esExtensionImagen(d->d_name)) continue;
+        char* ruta = (char*)malloc(largo + strlen(d->d_name) + 2);
+        if (!ruta) {
+            ok = 0;
+            break;
+        }
+        sprintf(ruta, "%s%s%s", entrada, separador, d->d_name);
+        if (stat(ruta, &st) == 0 && S_ISREG(st.st_mode)) {
+            ok = agregarRuta(lista, ruta);
+        }
+        free(ruta);
+    }
+    closedir(dir);
+    qsort(lista->rutas + primero, (size_t)(lista->num - primero), sizeof(char*), compararRutas);
+    return ok;
+}
+
+// QUÉ: Construir la ruta de salida de una entrada a partir del patrón.
+// CÓMO: {name} = nombre sin extensión, {ext} = extensión original sin punto,
+// {dir} = directorio de la entrada, {index} = posición en el lote (desde 1).
+// Devuelve 1 si tuvo éxito, 0 si el resultado no cabe.
+static int expandirPatron(const char* patron, const char* entrada, int indice, char* salida, size_t tam) {
+    const char* barra = strrchr(entrada, '/');
+    const char* base = barra ? barra + 1 : entrada;
+    const char* punto = strrchr(base, '.');
+    int largoNombre = punto ? (int)(punto - base) : (int)strlen(base);
+    char directorio[1024];
+    if (barra) {
+        snprintf(directorio, sizeof(directorio), "%.*s", (int)(barra - entrada), entrada);
+    } else {
+        strcpy(directorio, ".");
+    }
+
+    size_t usado = 0;
+    for (const char* p = patron; *p; ) {
+        int n;
+        if (strncmp(p, "{name}", 6) == 0) {
+            n = snprintf(salida + usado, tam - usado, "%.*s", largoNombre, base);
+            p += 6;
+        } else if (strncmp(p, "{ext}", 5) == 0) {
+            n = snprintf(salida + usado, tam - usado, "%s", punto ? punto + 1 : "");
+            p += 5;
+        } else if (strncmp(p, "{dir}", 5) == 0) {
+            n = snprintf(salida + usado, tam - usado, "%s", directorio);
+            p += 5;
+        } else if (strncmp(p, "{index}", 7) == 0) {
+            n = snprintf(salida + usado, tam - usado, "%d", indice + 1);
+            p += 7;
+        } else {
+            n = snprintf(salida + usado, tam - usado, "%c", *p);
+            p++;
+        }
+        if (n < 0 || (size_t)n >= tam - usado) return 0;
+        usado += (size_t)n;
+    }
+    return 1;
+}
+
+// QUÉ: Crear los directorios padre de una ruta (como mkdir -p).
+static int crearDirectorios(const char* ruta) {
+    char copia[4096];
+    if (snprintf(copia, sizeof(copia), "%s", ruta) >= (int)sizeof(copia)) return 0;
+    for (char* p = copia + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = 0;
+        if (mkdir(copia, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "ERROR: No se puede crear el directorio %s\n", copia);
+            return 0;
+        }
+        *p = '/';
+    }
+    return 1;
+}
+
+// QUÉ: Lo que necesitan los callbacks del lote: la cadena y, si se fusiona,
+// su plan (compartido por todos los archivos, es de solo lectura).
+// hashOperaciones es la parte de la clave de caché común a todo el lote.
+typedef struct {
+    const CadenaOperaciones* cadena;
+    const PlanGrafo* plan;
+    int usarCache;
+    uint64_t hashOperaciones;
+} ContextoOperaciones;
+
+// QUÉ: Adaptar la cadena de operaciones a la firma de batch.h.
+// CÓMO: Con la caché activa (cache.h), un acierto sustituye la imagen por
+// el resultado guardado; un fallo calcula y guarda una copia del resultado.
+static int procesarConCadena(ImagenInfo* imagen, void* contexto) {
+    const ContextoOperaciones* ctx = (const ContextoOperaciones*)contexto;
+    ClaveCache clave;
+    if (ctx->usarCache) {
+        ImagenInfo resultado = {0, 0, 0, 0, 0, NULL};
+        clave.pixeles = hashImagen(imagen);
+        clave.operacion = ctx->hashOperaciones;
+        if (buscarEnCache(&clave, &resultado)) {
+            liberarImagen(imagen);
+            *imagen = resultado;
+            return 1;
+        }
+    }
+    int ok = ctx->plan ? ejecutarPlan(imagen, ctx->plan) : aplicarCadena(imagen, ctx->cadena);
+    if (ctx->usarCache) {
+        if (ok) {
+            guardarEnCache(&clave, imagen);
+        } else {
+            abandonarClaveCache(&clave);
+        }
+    }
+    return ok;
+}
+
+// QUÉ: Adaptar la ejecución en flujo a la firma de batch.h.
+// La entrada estándar no se decodifica por filas: va por la ruta normal.
+static int procesarEnFlujo(const char* entrada, const char* salida, void* contexto) {
+    if (strcmp(entrada, "-") == 0) {
+        return FLUJO_NO_APLICA;
+    }
+    const ContextoOperaciones* ctx = (const ContextoOperaciones*)contexto;
+    return ejecutarCadenaEnFlujo(entrada, salida, ctx->cadena, PERFIL_PNG_GLOBAL);
+}
+
+static void mostrarAyuda(const char* programa) {
+    printf("Uso: %s [opciones] -i ENTRADA [-i ENTRADA ...] [ENTRADA ...]\n\n", programa);
+    printf("  -i, --input RUTA      Archivo, directorio o patrón glob (entre comillas); - es la\n");
+    printf("                        entrada estándar (PNM)\n");
+    printf("  -p, --ops CADENA      Operaciones separadas por '|', por ejemplo\n");
+    printf("                        'blur:5,1.5|sobel|scale:800x600'\n");
+    printf("                        blur[:tam[,sigma]]  sobel  gray  brightness:D  rotate:G\n");
+    printf("                        scale:AxB[,modo] | scale:P%%[,modo]  (modo: auto, bilinear, area, nearest)\n");
+    printf("  -o, --output PATRÓN   Ruta de salida con {name} {ext} {dir} {index}; la extensión\n");
+    printf("                        elige el formato (.png .qoi .qoip .pgm .ppm .pam). Por defecto %s\n", PATRON_DEFECTO);
+    printf("                        - escribe una sola imagen en la salida estándar (PNM)\n");
+    printf("  -t, --threads N       Hilos totales (por defecto, los núcleos disponibles)\n");
+    printf("  -j, --jobs N          Archivos en paralelo (por defecto, automático)\n");
+    printf("  -m, --memory MB       Presupuesto de imágenes en vuelo (por defecto %d MB)\n", PRESUPUESTO_DEFECTO_MB);
+    printf("  -z, --png-profile P   store | fast | default | max\n");
+    printf("  -q, --palette M       PNG indexado: exact (sin pérdida si caben, por defecto) | off |\n");
+    printf("                        N (2-256: reducir RGB a N colores si no caben)\n");
+    printf("  -s, --stream          PNG a PNG por franjas de filas, sin cargar imágenes completas\n");
+    printf("                        (blur, sobel, gray, brightness y reducciones por área; el\n");
+    printf("                        resto de archivos y operaciones usa la ruta normal)\n");
+    printf("  -I, --io MODO         E/S de archivos: auto (io_uring o, si no está disponible,\n");
+    printf("                        hilos; por defecto) | threads | sync\n");
+    printf("  -d, --png-decoder D   Decodificador de PNG: fast (propio, por defecto) | stb\n");
+    printf("  -x, --explain         Mostrar el plan fusionado de las operaciones (pasadas por\n");
+    printf("                        teselas, tablas, halo)\n");
+    printf("  -F, --no-fuse         Aplicar cada operación con una pasada propia, sin fusionar\n");
+    printf("  -T, --tile AxH|auto   Teselas de las pasadas de vecindario fusionadas (blur, sobel\n");
+    printf("                        seguidos): auto (según la caché L2, por defecto) o AxH píxeles\n");
+    printf("  -c, --cache MB        Caché en memoria de resultados por contenido: una entrada con\n");
+    printf("                        los mismos píxeles y operaciones no se recalcula (0 = no, por defecto)\n");
+    printf("  -C, --cache-dir DIR   Nivel de la caché en disco (PNM crudo), persistente entre ejecuciones\n");
+    printf("  -v, --verbose         Mostrar los mensajes de cada filtro\n");
+    printf("  -h, --help            Esta ayuda\n");
+}
+
+// QUÉ: Ejecutar el modo por lotes.
+// CÓMO: Ver cli.h. Reparto automático: con T hilos y N archivos se procesan
+// J = min(N, T) archivos a la vez y cada filtro usa T / J hilos. Paralelizar
+// entre archivos escala mejor (la decodificación de cada archivo es
+// secuencial), así que solo se reparte dentro de la imagen lo que sobra.
+// POR QUÉ: Ver cli.h.
+int ejecutarCLI(int argc, char* argv[]) {
+    static const struct option opcionesLargas[] = {
+        {"input", required_argument, NULL, 'i'},
+        {"ops", required_argument, NULL, 'p'},
+        {"output", required_argument, NULL, 'o'},
+        {"threads", required_argument, NULL, 't'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"memory", required_argument, NULL, 'm'},
+        {"png-profile", required_argument, NULL, 'z'},
+        {"palette", required_argument, NULL, 'q'},
+        {"stream", no_argument, NULL, 's'},
+        {"io", required_argument, NULL, 'I'},
+        {"png-decoder", required_argument, NULL, 'd'},
+        {"explain", no_argument, NULL, 'x'},
+        {"no-fuse", no_argument, NULL, 'F'},
+        {"tile", required_argument, NULL, 'T'},
+        {"cache", required_argument, NULL, 'c'},
+        {"cache-dir", required_argument, NULL, 'C'},
+        {"verbose", no_argument, NULL, 'v'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    static const char* perfiles[] = {"store", "fast", "default", "max"};
+    static const char* modosES[] = {"sync", "auto", "threads"}; // Por valor de ModoES
+
+    ListaRutas entradas = {NULL, 0, 0};
+    const char* textoOps = NULL;
+    const char* patron = PATRON_DEFECTO;
+    int hilosTotales = 0, trabajos = 0, memoriaMB = PRESUPUESTO_DEFECTO_MB, verboso = 0, enFlujo = 0;
+    int explicar = 0, fusionar = 1, cacheMB = 0;
+    const char* dirCache = NULL;
+    PerfilPNG perfil = PERFIL_PNG_GLOBAL;
+    ModoES modoES = ES_AUTOMATICA;
+    int ok = 1;
+
+    optind = 1;
+    int c;
+    while (ok && (c = getopt_long(argc, argv, "i:p:o:t:j:m:z:q:sI:d:xFT:c:C:vh", opcionesLargas, NULL)) != -1) {
+        switch (c) {
+            case 'i': ok = expandirEntrada(optarg, &entradas); break;
+            case 'p': textoOps = optarg; break;
+            case 'o': patron = optarg; break;
+            case 't': hilosTotales = atoi(optarg); ok = hilosTotales >= 1; break;
+            case 'j': trabajos = atoi(optarg); ok = trabajos >= 1; break;
+            case 'm': memoriaMB = atoi(optarg); ok = memoriaMB >= 0; break;
+            case 'z': {
+                ok = 0;
+                for (int k = 0; k < 4; k++) {
+                    if (strcmp(optarg, perfiles[k]) == 0) {
+                        perfil = (PerfilPNG)k;
+                        ok = 1;
+                    }
+                }
+                if (!ok) fprintf(stderr, "ERROR: Perfil PNG desconocido: %s\n", optarg);
+                break;
+            }
+            case 'q': {
+                int colores = atoi(optarg);
+                if (strcmp(optarg, "exact") == 0 || strcmp(optarg, "off") == 0) {
+                    MODO_PALETA_GLOBAL = optarg[0] == 'e' ? PALETA_EXACTA : PALETA_NO;
+                    COLORES_PALETA_GLOBAL = 256;
+                } else if (colores >= 2 && colores <= 256) {
+                    MODO_PALETA_GLOBAL = PALETA_CUANTIZAR;
+                    COLORES_PALETA_GLOBAL = colores;
+                } else {
+                    fprintf(stderr, "ERROR: Paleta desconocida: %s\n", optarg);
+                    ok = 0;
+                }
+                break;
+            }
+            case 's': enFlujo = 1; break;
+            case 'I': {
+                ok = 0;
+                for (int k = 0; k < 3; k++) {
+                    if (strcmp(optarg, modosES[k]) == 0) {
+                        modoES = (ModoES)k;
+                        ok = 1;
+                    }
+                }
+                if (!ok) fprintf(stderr, "ERROR: Modo de E/S desconocido: %s\n", optarg);
+                break;
+            }
+            case 'd':
+                ok = (strcmp(optarg, "fast") == 0 || strcmp(optarg, "stb") == 0);
+                if (ok) {
+                    DECODIFICADOR_PNG_PROPIO = (strcmp(optarg, "fast") == 0);
+                } else {
+                    fprintf(stderr, "ERROR: Decodificador PNG desconocido: %s\n", optarg);
+                }
+                break;
+            case 'x': explicar = 1; break;
+            case 'F': fusionar = 0; break;
+            case 'T': {
+                int ancho = 0, alto = 0;
+                char resto;
+                if (strcmp(optarg, "auto") == 0) {
+                    ANCHO_TESELA_GRAFO_GLOBAL = ALTO_TESELA_GRAFO_GLOBAL = 0;
+                } else if (sscanf(optarg, "%dx%d%c", &ancho, &alto, &resto) == 2 && ancho >= 1 && alto >= 1) {
+                    ANCHO_TESELA_GRAFO_GLOBAL = ancho;
+                    ALTO_TESELA_GRAFO_GLOBAL = alto;
+                } else {
+                    fprintf(stderr, "ERROR: Tesela desconocida: %s (AxH o auto)\n", optarg);
+                    ok = 0;
+                }
+                break;
+            }
+            case 'c': cacheMB = atoi(optarg); ok = cacheMB >= 0; break;
+            case 'C': dirCache = optarg; break;
+            case 'v': verboso = 1; break;
+            case 'h':
+                mostrarAyuda(argv[0]);
+                liberarLista(&entradas);
+                return 0;
+            default: ok = 0; break;
+        }
+    }
+    for (int i = optind; i < argc && ok; i++) {
+        ok = expandirEntrada(argv[i], &entradas);
+    }
+    if (ok && entradas.num == 0) {
+        fprintf(stderr, "ERROR: No se indicaron imágenes de entrada (-i)\n");
+        ok = 0;
+    }
+
+    CadenaOperaciones cadena = {NULL, 0};
+    PlanGrafo plan;
+    memset(&plan, 0, sizeof(plan));
+    if (ok && textoOps && !interpretarCadena(textoOps, &cadena)) {
+        ok = 0;
+    }
+    if (ok && cadena.numOps > 0 && !planificarCadena(&cadena, &plan)) {
+        ok = 0;
+    }
+    if (ok && (cacheMB > 0 || dirCache) && !configurarCache((size_t)cacheMB * 1024 * 1024, dirCache)) {
+        ok = 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "Use %s --help para ver las opciones.\n", argv[0]);
+        liberarLista(&entradas);
+        liberarCadena(&cadena);
+        liberarPlan(&plan);
+        liberarCache();
+        return 2;
+    }
+
+    // QUÉ: Construir las rutas de salida y comprobar que no se repiten.
+    // CÓMO: Un patrón que termina en '/' o es un directorio existente recibe
+    // "{name}.png" al final. "-" es la salida estándar (PNM) y solo admite
+    // una entrada.
+    int salidaEstandar = (strcmp(patron, "-") == 0);
+    if (salidaEstandar && entradas.num > 1) {
+        fprintf(stderr, "ERROR: -o - escribe una sola imagen y hay %d entradas\n", entradas.num);
+        ok = 0;
+    }
+    char patronCompleto[1024];
+    struct stat st;
+    size_t largoPatron = strlen(patron);
+    if ((largoPatron > 0 && patron[largoPatron - 1] == '/') ||
+        (!strchr(patron, '{') && stat(patron, &st) == 0 && S_ISDIR(st.st_mode))) {
+        snprintf(patronCompleto, sizeof(patronCompleto), "%s%s{name}.png", patron,
+                 patron[largoPatron - 1] == '/' ? "" : "/");
+    } else {
+        snprintf(patronCompleto, sizeof(patronCompleto), "%s", patron);
+    }
+    ListaRutas salidas = {NULL, 0, 0};
+    char ruta[4096];
+    for (int i = 0; i < entradas.num && ok; i++) {
+        if (salidaEstandar) {
+            ok = agregarRuta(&salidas, patron);
+            continue;
+        }
+        ok = expandirPatron(patronCompleto, entradas.rutas[i], i, ruta, sizeof(ruta)) &&
+             agregarRuta(&salidas, ruta) && crearDirectorios(ruta);
+    }
+    if (ok) {
+        char** ordenadas = (char**)malloc((size_t)salidas.num * sizeof(char*));
+        if (ordenadas) {
+            memcpy(ordenadas, salidas.rutas, (size_t)salidas.num * sizeof(char*));
+            qsort(ordenadas, (size_t)salidas.num, sizeof(char*), compararRutas);
+            for (int i = 1; i < salidas.num && ok; i++) {
+                if (strcmp(ordenadas[i - 1], ordenadas[i]) == 0) {
+                    fprintf(stderr, "ERROR: Varias entradas escriben en %s; use {dir}, {ext} o {index} en -o\n",
+                            ordenadas[i]);
+                    ok = 0;
+                }
+            }
+            free(ordenadas);
+        }
+    }
+    if (!ok) {
+        liberarLista(&entradas);
+        liberarLista(&salidas);
+        liberarCadena(&cadena);
+        liberarPlan(&plan);
+        liberarCache();
+        return 2;
+    }
+
+    // QUÉ: Repartir los hilos entre archivos e imagen.
+    if (hilosTotales == 0) {
+        long nucleos = sysconf(_SC_NPROCESSORS_ONLN);
+        hilosTotales = nucleos > 0 ? (int)nucleos : 1;
+    }
+    if (trabajos == 0) {
+        trabajos = hilosTotales < entradas.num ? hilosTotales : entradas.num;
+    }
+    if (trabajos > entradas.num) trabajos = entradas.num;
+    int hilosImagen = hilosTotales / trabajos;
+    if (hilosImagen < MIN_HILOS) hilosImagen = MIN_HILOS;
+    if (hilosImagen > MAX_HILOS) hilosImagen = MAX_HILOS;
+    NUM_HILOS_GLOBAL = hilosImagen;
+    PERFIL_PNG_GLOBAL = perfil;
+    MODO_INTERACTIVO = 0;
+
+    // QUÉ: Con -o -, stdout queda reservado para la imagen.
+    // CÓMO: guardarPNM escribe "-" en una copia de la salida estándar original
+    // y stdout pasa a ser stderr hasta el final, así que la información del
+    // lote y los mensajes de -v salen por stderr.
+    int stdoutImagen = -1;
+    if (salidaEstandar) {
+        fflush(stdout);
+        stdoutImagen = dup(STDOUT_FILENO);
+        if (stdoutImagen < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            perror("dup");
+            if (stdoutImagen >= 0) close(stdoutImagen);
+            liberarLista(&entradas);
+            liberarLista(&salidas);
+            liberarCadena(&cadena);
+            liberarPlan(&plan);
+            liberarCache();
+            return 2;
+        }
+        DESCRIPTOR_SALIDA_PNM = stdoutImagen;
+    }
+
+    char descripcion[512] = "(solo conversión)";
+    if (cadena.numOps > 0) describirCadena(&cadena, descripcion, sizeof(descripcion));
+    enFlujo = enFlujo && cadenaAdmiteFlujo(&cadena);
+    printf("%d archivos | operaciones: %s%s%s\n", entradas.num, descripcion,
+           canalesNecesarios(&cadena) == 1 ? " | decodificación directa a grises" : "",
+           enFlujo ? " | en flujo" : "");
+    printf("%d archivos en paralelo x %d hilos por imagen | PNG %s | presupuesto %d MB%s\n",
+           trabajos, hilosImagen, nombrePerfilPNG(perfil), memoriaMB,
+           (cadena.numOps > 0 && !fusionar) ? " | sin fusionar" : "");
+    if (explicar && cadena.numOps > 0) {
+        explicarPlan(&plan);
+    }
+    fflush(stdout);
+
+    // La caché no se consulta en flujo: esos archivos nunca están enteros en memoria
+    int usarCache = cadena.numOps > 0 && cacheActiva() && !enFlujo;
+    ContextoOperaciones contexto = {&cadena, fusionar ? &plan : NULL, usarCache, usarCache ? hashCadena(&cadena) : 0};
+
+    OpcionesLote opciones;
+    memset(&opciones, 0, sizeof(opciones));
+    opciones.entradas = (const char* const*)entradas.rutas;
+    opciones.salidas = (const char* const*)salidas.rutas;
+    opciones.numArchivos = entradas.num;
+    opciones.procesar = cadena.numOps > 0 ? procesarConCadena : NULL;
+    opciones.contexto = &contexto;
+    opciones.hilos[ETAPA_DECODIFICAR] = trabajos;
+    opciones.hilos[ETAPA_PROCESAR] = trabajos;
+    opciones.hilos[ETAPA_CODIFICAR] = trabajos;
+    opciones.capacidadCola = trabajos;
+    opciones.presupuestoMemoria = (size_t)memoriaMB * 1024 * 1024;
+    opciones.tiempos = (TiemposArchivo*)calloc((size_t)entradas.num, sizeof(TiemposArchivo));
+    opciones.canalesEntrada = canalesNecesarios(&cadena);
+    opciones.procesarArchivo = enFlujo ? procesarEnFlujo : NULL;
+    opciones.modoES = modoES;
+
+    // QUÉ: Sin -v, los mensajes de los filtros (stdout) se descartan durante el
+    // lote; los errores siguen saliendo por stderr.
+    int stdoutGuardado = -1;
+    if (!verboso) {
+        int nulo = open("/dev/null", O_WRONLY);
+        stdoutGuardado = dup(STDOUT_FILENO);
+        if (nulo >= 0 && stdoutGuardado >= 0) {
+            dup2(nulo, STDOUT_FILENO);
+        }
+        if (nulo >= 0) close(nulo);
+    }
+    ResumenLote resumen;
+    int todoBien = ejecutarLote(&opciones, &resumen);
+    if (stdoutGuardado >= 0) {
+        fflush(stdout);
+        dup2(stdoutGuardado, STDOUT_FILENO);
+        close(stdoutGuardado);
+    }
+
+    // QUÉ: Tabla por archivo (segundos por etapa) y resumen agregado.
+    if (opciones.tiempos) {
+        printf("\n%-32s %9s %9s %9s %9s  %s\n", "Archivo", "Decod.", "Proceso", "Codif.", "Total", "Estado");
+        for (int i = 0; i < entradas.num; i++) {
+            const TiemposArchivo* t = &opciones.tiempos[i];
+            const char* barra = strrchr(entradas.rutas[i], '/');
+            double total = t->segundos[0] + t->segundos[1] + t->segundos[2];
+            printf("%-32.32s %8.3fs %8.3fs %8.3fs %8.3fs  %s\n", barra ? barra + 1 : entradas.rutas[i],
+                   t->segundos[0], t->segundos[1], t->segundos[2], total, t->ok ? salidas.rutas[i] : "ERROR");
+        }
+    }
+    imprimirResumenLote(&resumen);
+    if (usarCache) {
+        imprimirEstadisticasCache();
+    }
+    if (cacheActiva()) {
+        liberarCache(); // También con --stream o sin operaciones
+    }
+    if (stdoutImagen >= 0) {
+        fflush(stdout);
+        dup2(stdoutImagen, STDOUT_FILENO);
+        close(stdoutImagen);
+        DESCRIPTOR_SALIDA_PNM = STDOUT_FILENO;
+    }
+
+    free(opciones.tiempos);
+    liberarLista(&entradas);
+    liberarLista(&salidas);
+    liberarCadena(&cadena);
+    liberarPlan(&plan);
+    return todoBien ? 0 : 1;
+}
@@ -113,46 +113,96 @@ typedef struct {
     int ancho;
     int alto;
     int canales;
+    int bytesMuestra;
 } ConvolucionArgs;
 
+// QUÉ: Núcleo de la convolución de una fila para un número fijo de canales.
+// CÓMO: Se llama siempre con una constante (1 a 4) y se fuerza la expansión
+// en línea, así hay una copia por formato de píxel con el bucle de canales
+// desenrollado y las sumas en registros. filas[ky] son las tamKernel filas
+// vecinas ya recortadas al borde, de modo que la misma función sirve para la
+// imagen completa y para el anillo de filas del modo en flujo. El orden de
+// las sumas es el mismo que el de la versión genérica: resultados idénticos.
+// El tamaño de la muestra (bytes: 1 u 2) también es constante, así que 8 y
+// 16 bits tienen copias distintas; con 16 bits se satura a 65535.
+// POR QUÉ: Con el número de canales en una variable el compilador no puede
+// desenrollar ni vectorizar; RGBA (4 bytes por píxel) es el caso que más gana.
+__attribute__((always_inline))
+static inline void convolucionarFila(const unsigned char* const* filas, float** kernel, int tamKernel,
+                                     int ancho, unsigned char* destino, const int canales, const int bytes) {
+    const int maximo = (bytes == 2) ? 65535 : 255;
+    int radio = tamKernel / 2;
+    for (int x = 0; x < ancho; x++) {
+        float suma[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+        for (int ky = 0; ky < tamKernel; ky++) {
+            const unsigned char* fila = filas[ky];
+            const float* pesos = kernel[ky];
+
+            for (int kx = 0; kx < tamKernel; kx++) {
+                int ix = x + kx - radio;
+                if (ix < 0) ix = 0;
+                if (ix >= ancho) ix = ancho - 1;
+                for (int c = 0; c < canales; c++) {
+                    suma[c] += leerMuestra(fila, (size_t)ix * canales + c, bytes) * pesos[kx];
+                }
+            }
+        }
+
+        for (int c = 0; c < canales; c++) {
+            int valor = (int)(suma[c] + 0.5f);
+            if (valor < 0) valor = 0;
+            if (valor > maximo) valor = maximo;
+            escribirMuestra(destino, (size_t)x * canales + c, (unsigned int)valor, bytes);
+        }
+    }
+}
+
+// QUÉ: Elegir la copia especializada según los canales y el tipo de muestra.
+static void convolucionarFilaCanales(const unsigned char* const* filas, float** kernel, int tamKernel,
+                                     int ancho, int canales, int bytesMuestra, unsigned char* destino) {
+    if (bytesMuestra == 2) {
+        switch (canales) {
+            case 1: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 1, 2); break;
+            case 2: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 2, 2); break;
+            case 3: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 3, 2); break;
+            default: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 4, 2); break;
+        }
+        return;
+    }
+    switch (canales) {
+        case 1: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 1, 1); break;
+        case 2: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 2, 1); break;
+        case 3: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 3, 1); break;
+        default: convolucionarFila(filas, kernel, tamKernel, ancho, destino, 4, 1); break;
+    }
+}
+
 // QUÉ: Aplicar convolución en un rango de filas (para hilos).
-// CÓMO: Para cada píxel en el rango, multiplica vecinos por kernel y suma.
+// CÓMO: Para cada fila del rango reúne sus filas vecinas y la convoluciona
+// con el núcleo especializado según los canales de la imagen.
 // POR QUÉ: Permite paralelizar la operación dividiendo filas entre hilos.
 static void* aplicarConvolucionHilo(void* args) {
     ConvolucionArgs* cArgs = (ConvolucionArgs*)args;
-    int radio = cArgs->tamKernel / 2;
 
     // AÑADIR ESTO AL INICIO:
     struct timeval tiempo_inicio;
     gettimeofday(&tiempo_inicio, NULL);
     int pixeles_procesados = 0;
 
+    // Filas vecinas de cada fila destino, recortadas al borde (tamKernel <= 15)
+    const unsigned char* filas[15];
+    int radio = cArgs->tamKernel / 2;
     for (int y = cArgs->inicio; y < cArgs->fin; y++) {
-        for (int x = 0; x < cArgs->ancho; x++) {
-            for (int c = 0; c < cArgs->canales; c++) {
-                float suma = 0.0f;
-
-                for (int ky = 0; ky < cArgs->tamKernel; ky++) {
-                    for (int kx = 0; kx < cArgs->tamKernel; kx++) {
-                        int iy = y + ky - radio;
-                        int ix = x + kx - radio;
-
-                        if (iy < 0) iy = 0;
-                        if (iy >= cArgs->alto) iy = cArgs->alto - 1;
-                        if (ix < 0) ix = 0;
-                        if (ix >= cArgs->ancho) ix = cArgs->ancho - 1;
-
-                        suma += cArgs->pixelesOrigen[iy][ix][c] * cArgs->kernel[ky][kx];
-                    }
-                }
-
-                int valor = (int)(suma + 0.5f);
-                if (valor < 0) valor = 0;
-                if (valor > 255) valor = 255;
-                cArgs->pixelesDestino[y][x][c] = (unsigned char)valor;
-            }
-            pixeles_procesados++;
+        for (int ky = 0; ky < cArgs->tamKernel; ky++) {
+            int iy = y + ky - radio;
+            if (iy < 0) iy = 0;
+            if (iy >= cArgs->alto) iy = cArgs->alto - 1;
+            filas[ky] = cArgs->pixelesOrigen[iy][0];
         }
+        convolucionarFilaCanales(filas, cArgs->kernel, cArgs->tamKernel, cArgs->ancho, cArgs->canales,
+                                 cArgs->bytesMuestra, cArgs->pixelesDestino[y][0]);
+        pixeles_procesados += cArgs->ancho;
     }
 
     // AÑADIR ESTO AL FINAL (antes del return):
@@ -194,53 +244,13 @@ int aplicarConvolucionGaussiana(ImagenInfo* info, int tamKernel, float sigma) {
     // QUÉ: Crear matriz de destino para resultado.
     // CÓMO: Asigna nueva matriz 3D con mismas dimensiones que original.
     // POR QUÉ: No podemos modificar la imagen original mientras la leemos.
-    unsigned char*** pixelesNuevos = (unsigned char***)malloc(info->alto * sizeof(unsigned char**));
-    if (!pixelesNuevos) {
+    ImagenInfo destino;
+    if (!crearImagenComo(&destino, info, info->ancho, info->alto)) {
         fprintf(stderr, "Error de memoria al asignar imagen destino\n");
         liberarKernel(kernel, tamKernel);
         return 0;
     }
-
-    int memoriaOk = 1;
-    for (int y = 0; y < info->alto && memoriaOk; y++) {
-        pixelesNuevos[y] = (unsigned char**)malloc(info->ancho * sizeof(unsigned char*));
-        if (!pixelesNuevos[y]) {
-            memoriaOk = 0;
-            fprintf(stderr, "Error de memoria al asignar columnas destino\n");
-            // Liberar lo ya asignado
-            for (int yy = 0; yy < y; yy++) {
-                for (int x = 0; x < info->ancho; x++) {
-                    free(pixelesNuevos[yy][x]);
-                }
-                free(pixelesNuevos[yy]);
-            }
-            free(pixelesNuevos);
-            liberarKernel(kernel, tamKernel);
-            return 0;
-        }
-
-        for (int x = 0; x < info->ancho && memoriaOk; x++) {
-            pixelesNuevos[y][x] = (unsigned char*)malloc(info->canales * sizeof(unsigned char));
-            if (!pixelesNuevos[y][x]) {
-                memoriaOk = 0;
-                fprintf(stderr, "Error de memoria al asignar canales destino\n");
-                // Liberar lo ya asignado
-                for (int xx = 0; xx < x; xx++) {
-                    free(pixelesNuevos[y][xx]);
-                }
-                for (int yy = 0; yy < y; yy++) {
-                    for (int xx = 0; xx < info->ancho; xx++) {
-                        free(pixelesNuevos[yy][xx]);
-                    }
-                    free(pixelesNuevos[yy]);
-                }
-                free(pixelesNuevos[y]);
-                free(pixelesNuevos);
-                liberarKernel(kernel, tamKernel);
-                return 0;
-            }
-        }
-    }
+    unsigned char*** pixelesNuevos = destino.pixeles;
 
     // QUÉ: Configurar y lanzar hilos para convolución.
     // CÓMO: Divide filas entre hilos, pasa argumentos y sincroniza.
@@ -275,6 +285,7 @@ int aplicarConvolucionGaussiana(ImagenInfo* info, int tamKernel, float sigma) {
         args[i].ancho = info->ancho;
         args[i].alto = info->alto;
         args[i].canales = info->canales;
+        args[i].bytesMuestra = bytesMuestra(info);
         printf("Lanzando hilos...\n");
         if (pthread_create(&hilos[i], NULL, aplicarConvolucionHilo, &args[i]) != 0) {
             fprintf(stderr, "Error al crear hilo %d\n", i);
@@ -284,13 +295,7 @@ int aplicarConvolucionGaussiana(ImagenInfo* info, int tamKernel, float sigma) {
             }
             printf("\nTodos los hilos completados.\n");
             // Liberar memoria
-            for (int y = 0; y < info->alto; y++) {
-                for (int x = 0; x < info->ancho; x++) {
-                    free(pixelesNuevos[y][x]);
-                }
-                free(pixelesNuevos[y]);
-            }
-            free(pixelesNuevos);
+            liberarImagen(&destino);
             liberarKernel(kernel, tamKernel);
             return 0;
         }
@@ -305,14 +310,8 @@ int aplicarConvolucionGaussiana(ImagenInfo* info, int tamKernel, float sigma) {
     // QUÉ: Reemplazar imagen original con resultado.
     // CÓMO: Libera matriz antigua y asigna la nueva.
     // POR QUÉ: Actualiza la imagen en memoria con el resultado del filtro.
-    for (int y = 0; y < info->alto; y++) {
-        for (int x = 0; x < info->ancho; x++) {
-            free(info->pixeles[y][x]);
-        }
-        free(info->pixeles[y]);
-    }
-    free(info->pixeles);
-    info->pixeles = pixelesNuevos;
+    liberarImagen(info);
+    *info = destino;
     liberarKernel(kernel, tamKernel);
 
     gettimeofday(&tiempo_fin, NULL);
@@ -334,3 +333,31 @@ int aplicarConvolucionGaussiana(ImagenInfo* info, int tamKernel, float sigma) {
 
     return 1;
 }
+
+// QUÉ: Kernel para el modo en flujo (misma validación y mismos pesos).
+int crearKernelGaussiano(KernelGaussiano* kernel, int tamKernel, float sigma) {
+    kernel->pesos = NULL;
+    kernel->tam = 0;
+    if (!validarParametrosConvolucion(tamKernel, sigma)) {
+        return 0;
+    }
+    float suma;
+    kernel->pesos = generarKernelGaussiano(tamKernel, sigma, &suma);
+    if (!kernel->pesos) {
+        return 0;
+    }
+    kernel->tam = tamKernel;
+    return 1;
+}
+
+void liberarKernelGaussiano(KernelGaussiano* kernel) {
+    liberarKernel(kernel->pesos, kernel->tam);
+    kernel->pesos = NULL;
+    kernel->tam = 0;
+}
+
+// QUÉ: Convolucionar una fila a partir de sus filas vecinas.
+void convolucionarFilaGaussiana(const KernelGaussiano* kernel, const unsigned char* const* filas,
+                                int ancho, int canales, unsigned char* destino) {
+    convolucionarFilaCanales(filas, kernel->pesos, kernel->tam, ancho, canales, 1, destino);
+}
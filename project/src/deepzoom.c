@@ -0,0 +1,337 @@
+#include "deepzoom.h"
+#include "image.h"
+#include "pyramid.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "../stb/stb_image_write.h"
+
+// QUÉ: Contexto compartido de la exportación (solo lectura para los hilos).
+typedef struct {
+    const char* rutaBase;
+    const OpcionesTeselas* opciones;
+    int nivelXYZ0;          // Nivel DeepZoom que corresponde a z = 0 (formato XYZ)
+} ContextoTeselas;
+
+// QUÉ: Trabajo de codificación de todas las teselas de un nivel.
+// CÓMO: Se envían NUM_HILOS_GLOBAL tareas con el mismo argumento; cada una toma
+// el siguiente índice de tesela con un incremento atómico hasta agotarlas.
+// POR QUÉ: Pocas entradas en la cola (no bloquea al hilo principal) y reparto
+// dinámico aunque unas teselas compriman más lento que otras.
+typedef struct {
+    const ContextoTeselas* contexto;
+    ImagenInfo nivel;       // Copia de la estructura (los píxeles no se copian)
+    int numeroNivel;
+    int columnas;
+    int filas;
+    int siguiente;          // Próxima tesela a codificar (atómico)
+    int errores;            // Teselas fallidas (atómico)
+} TrabajoNivel;
+
+// QUÉ: Franjas de reducción por hilo del pool.
+// POR QUÉ: Más franjas que hilos reparten mejor la reducción cuando parte de
+// los hilos sigue codificando las últimas teselas del nivel anterior.
+#define FRANJAS_POR_HILO 2
+
+// QUÉ: Franja de filas [yIni, yFin) de la reducción 2x de un nivel.
+// CÓMO: Copias de las estructuras (los píxeles no se copian), como en
+// TrabajoNivel: el hilo principal pasa al nivel siguiente mientras corren.
+typedef struct {
+    ImagenInfo origen;
+    ImagenInfo destino;
+    int yIni;
+    int yFin;
+} FranjaReduccion;
+
+// QUÉ: Crear un directorio si no existe.
+static int crearDirectorio(const char* ruta) {
+    if (mkdir(ruta, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error al crear directorio %s\n", ruta);
+        return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Calcular el rango [inicio, fin) de la tesela i en un eje con solapamiento.
+static void rangoTesela(int i, int tam, int solapamiento, int limite, int* inicio, int* fin) {
+    *inicio = i * tam - (i > 0 ? solapamiento : 0);
+    *fin = (i + 1) * tam + solapamiento;
+    if (*fin > limite) *fin = limite;
+}
+
+// QUÉ: Tarea del pool: codificar teselas de un nivel hasta que no queden.
+// CÓMO: Cada tesela es una subregión de filas contiguas; stbi_write_png la lee
+// en su lugar usando el stride del nivel, sin copiarla.
+static void codificarTeselasTarea(void* arg) {
+    TrabajoNivel* trabajo = (TrabajoNivel*)arg;
+    const ContextoTeselas* ctx = trabajo->contexto;
+    const OpcionesTeselas* op = ctx->opciones;
+    int solapamiento = (op->formato == TESELAS_DEEPZOOM) ? op->solapamiento : 0;
+    int total = trabajo->columnas * trabajo->filas;
+    int stride = trabajo->nivel.ancho * trabajo->nivel.canales;
+
+    while (1) {
+        int indice = __atomic_fetch_add(&trabajo->siguiente, 1, __ATOMIC_RELAXED);
+        if (indice >= total) {
+            break;
+        }
+        int col = indice % trabajo->columnas;
+        int fila = indice / trabajo->columnas;
+        int x0, x1, y0, y1;
+        rangoTesela(col, op->tamTesela, solapamiento, trabajo->nivel.ancho, &x0, &x1);
+        rangoTesela(fila, op->tamTesela, solapamiento, trabajo->nivel.alto, &y0, &y1);
+
+        char ruta[1024];
+        if (op->formato == TESELAS_DEEPZOOM) {
+            snprintf(ruta, sizeof(ruta), "%s_files/%d/%d_%d.png",
+                     ctx->rutaBase, trabajo->numeroNivel, col, fila);
+        } else {
+            snprintf(ruta, sizeof(ruta), "%s/%d/%d/%d.png",
+                     ctx->rutaBase, trabajo->numeroNivel - ctx->nivelXYZ0, col, fila);
+        }
+
+        const unsigned char* origen = trabajo->nivel.pixeles[y0][x0];
+        if (!stbi_write_png(ruta, x1 - x0, y1 - y0, trabajo->nivel.canales, origen, stride)) {
+            fprintf(stderr, "Error al guardar tesela %s\n", ruta);
+            __atomic_fetch_add(&trabajo->errores, 1, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// QUÉ: Preparar directorios y enviar al pool la codificación de un nivel.
+// CÓMO: Crea las carpetas del nivel (y de cada columna en XYZ) en el hilo
+// principal y luego encola NUM_HILOS_GLOBAL tareas sobre el mismo trabajo.
+static int enviarNivel(PoolHilos* pool, GrupoTareas* grupo, TrabajoNivel* trabajo,
+                       const ContextoTeselas* ctx, const ImagenInfo* nivel, int numeroNivel) {
+    const OpcionesTeselas* op = ctx->opciones;
+    char ruta[1024];
+
+    trabajo->contexto = ctx;
+    trabajo->nivel = *nivel;
+    trabajo->numeroNivel = numeroNivel;
+    trabajo->columnas = (nivel->ancho + op->tamTesela - 1) / op->tamTesela;
+    trabajo->filas = (nivel->alto + op->tamTesela - 1) / op->tamTesela;
+    trabajo->siguiente = 0;
+    trabajo->errores = 0;
+
+    if (op->formato == TESELAS_DEEPZOOM) {
+        snprintf(ruta, sizeof(ruta), "%s_files/%d", ctx->rutaBase, numeroNivel);
+        if (!crearDirectorio(ruta)) return 0;
+    } else {
+        snprintf(ruta, sizeof(ruta), "%s/%d", ctx->rutaBase, numeroNivel - ctx->nivelXYZ0);
+        if (!crearDirectorio(ruta)) return 0;
+        for (int col = 0; col < trabajo->columnas; col++) {
+            snprintf(ruta, sizeof(ruta), "%s/%d/%d", ctx->rutaBase, numeroNivel - ctx->nivelXYZ0, col);
+            if (!crearDirectorio(ruta)) return 0;
+        }
+    }
+
+    for (int i = 0; i < pool->numHilos; i++) {
+        if (!enviarTarea(pool, codificarTeselasTarea, trabajo, grupo)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Tarea del pool: reducir una franja del nivel siguiente.
+static void reducirFranjaTarea(void* arg) {
+    FranjaReduccion* franja = (FranjaReduccion*)arg;
+    reducirNivelCaja(&franja->origen, &franja->destino, franja->yIni, franja->yFin);
+}
+
+// QUÉ: Enviar al pool la reducción 2x (caja) de origen a destino, por franjas.
+// CÓMO: Reparte las filas de destino en hasta FRANJAS_POR_HILO * numHilos
+// franjas, todas en el mismo grupo. franjas no se puede reutilizar hasta
+// esperar el grupo.
+static int enviarReduccion(PoolHilos* pool, GrupoTareas* grupo, FranjaReduccion* franjas,
+                           const ImagenInfo* origen, const ImagenInfo* destino) {
+    int numFranjas = FRANJAS_POR_HILO * pool->numHilos;
+    if (numFranjas > destino->alto) {
+        numFranjas = destino->alto;
+    }
+    for (int i = 0; i < numFranjas; i++) {
+        franjas[i].origen = *origen;
+        franjas[i].destino = *destino;
+        franjas[i].yIni = (int)((long)destino->alto * i / numFranjas);
+        franjas[i].yFin = (int)((long)destino->alto * (i + 1) / numFranjas);
+        if (!enviarTarea(pool, reducirFranjaTarea, &franjas[i], grupo)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Escribir el descriptor .dzi del formato DeepZoom.
+static int escribirDescriptorDZI(const char* rutaBase, const ImagenInfo* info, const OpcionesTeselas* op) {
+    char ruta[1024];
+    snprintf(ruta, sizeof(ruta), "%s.dzi", rutaBase);
+    FILE* f = fopen(ruta, "w");
+    if (!f) {
+        fprintf(stderr, "Error al crear %s\n", ruta);
+        return 0;
+    }
+    fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(f, "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"png\" "
+               "Overlap=\"%d\" TileSize=\"%d\">\n", op->solapamiento, op->tamTesela);
+    fprintf(f, "  <Size Width=\"%d\" Height=\"%d\"/>\n", info->ancho, info->alto);
+    fprintf(f, "</Image>\n");
+    fclose(f);
+    return 1;
+}
+
+// QUÉ: Exportar una imagen de 8 bits como pirámide de teselas.
+static int exportarTeselas8(const ImagenInfo* info, const char* rutaBase, const OpcionesTeselas* opciones) {
+    if (opciones->tamTesela < 16 || opciones->solapamiento < 0 ||
+        opciones->solapamiento >= opciones->tamTesela / 2) {
+        fprintf(stderr, "ERROR: Tamaño de tesela (%d) o solapamiento (%d) inválidos\n",
+                opciones->tamTesela, opciones->solapamiento);
+        return 0;
+    }
+
+    struct timeval tiempo_inicio, tiempo_fin;
+    gettimeofday(&tiempo_inicio, NULL);
+
+    // QUÉ: Número de niveles: el máximo es ceil(log2(max(ancho, alto))).
+    int nivelMaximo = 0;
+    int ancho = info->ancho, alto = info->alto;
+    while (ancho > 1 || alto > 1) {
+        ancho = (ancho + 1) / 2;
+        alto = (alto + 1) / 2;
+        nivelMaximo++;
+    }
+
+    // En XYZ, z = 0 es el primer nivel que cabe entero en una tesela
+    ContextoTeselas ctx = {rutaBase, opciones, 0};
+    ancho = info->ancho;
+    alto = info->alto;
+    int nivelMinimo = 0;
+    if (opciones->formato == TESELAS_XYZ) {
+        int n = nivelMaximo;
+        while (ancho > opciones->tamTesela || alto > opciones->tamTesela) {
+            ancho = (ancho + 1) / 2;
+            alto = (alto + 1) / 2;
+            n--;
+        }
+        ctx.nivelXYZ0 = n;
+        nivelMinimo = n;
+        if (!crearDirectorio(rutaBase)) return 0;
+    } else {
+        char ruta[1024];
+        snprintf(ruta, sizeof(ruta), "%s_files", rutaBase);
+        if (!crearDirectorio(ruta) || !escribirDescriptorDZI(rutaBase, info, opciones)) {
+            return 0;
+        }
+    }
+
+    int numHilos = NUM_HILOS_GLOBAL;
+    PoolHilos pool;
+    if (!crearPool(&pool, numHilos, 4 * numHilos)) {
+        return 0;
+    }
+    GrupoTareas grupos[2];
+    GrupoTareas reduccion;
+    iniciarGrupo(&grupos[0]);
+    iniciarGrupo(&grupos[1]);
+    iniciarGrupo(&reduccion);
+    TrabajoNivel trabajos[2];
+    FranjaReduccion franjas[FRANJAS_POR_HILO * MAX_HILOS];
+    memset(trabajos, 0, sizeof(trabajos));
+
+    printf("Exportando teselas %dx%d (%s) de %s: niveles %d-%d, %d hilos\n",
+           opciones->tamTesela, opciones->tamTesela,
+           opciones->formato == TESELAS_DEEPZOOM ? "DeepZoom" : "XYZ",
+           rutaBase, nivelMinimo, nivelMaximo, pool.numHilos);
+
+    // QUÉ: Recorrer niveles de mayor a menor resolución.
+    // CÓMO: actual es el nivel cuyas teselas se están codificando y siguiente
+    // el que se reduce de él. La reducción de un nivel se encola antes que
+    // sus teselas, así que los hilos la toman primero; la del nivel
+    // siguiente se encola en cuanto termina la anterior y la toman los hilos
+    // que acaban las teselas del nivel en curso. Antes de liberar un nivel
+    // se espera a su grupo de teselas.
+    ImagenInfo actual = *info;   // Vista del original (no se libera)
+    ImagenInfo siguiente = {0, 0, 0, 0, 0, NULL};
+    int actualPropio = 0;
+    int ok = 1;
+    long totalTeselas = 0;
+    int nivel = nivelMaximo;
+
+    if (nivel > nivelMinimo) {
+        ok = crearImagenComo(&siguiente, &actual, (actual.ancho + 1) / 2, (actual.alto + 1) / 2) &&
+             enviarReduccion(&pool, &reduccion, franjas, &actual, &siguiente);
+    }
+    if (ok) {
+        ok = enviarNivel(&pool, &grupos[nivel % 2], &trabajos[nivel % 2], &ctx, &actual, nivel);
+        totalTeselas += (long)trabajos[nivel % 2].columnas * trabajos[nivel % 2].filas;
+    }
+
+    while (ok && nivel > nivelMinimo) {
+        // El siguiente nivel está completo cuando terminan sus franjas
+        esperarGrupo(&reduccion);
+        ImagenInfo despues = {0, 0, 0, 0, 0, NULL};
+        if (nivel - 1 > nivelMinimo) {
+            ok = crearImagenComo(&despues, &siguiente, (siguiente.ancho + 1) / 2, (siguiente.alto + 1) / 2) &&
+                 enviarReduccion(&pool, &reduccion, franjas, &siguiente, &despues);
+        }
+
+        int g = (nivel - 1) % 2;
+        if (ok) {
+            ok = enviarNivel(&pool, &grupos[g], &trabajos[g], &ctx, &siguiente, nivel - 1);
+            totalTeselas += (long)trabajos[g].columnas * trabajos[g].filas;
+        }
+
+        // Esperar las teselas del nivel actual antes de liberarlo
+        esperarGrupo(&grupos[nivel % 2]);
+        if (trabajos[nivel % 2].errores > 0) ok = 0;
+        if (actualPropio) {
+            liberarImagen(&actual);
+        }
+        actual = siguiente;
+        actualPropio = 1;
+        siguiente = despues;
+        nivel--;
+    }
+
+    esperarGrupo(&reduccion);
+    esperarGrupo(&grupos[0]);
+    esperarGrupo(&grupos[1]);
+    if (trabajos[nivel % 2].errores > 0) ok = 0;
+    if (actualPropio) {
+        liberarImagen(&actual);
+    }
+    liberarImagen(&siguiente);
+    destruirPool(&pool);
+    destruirGrupo(&grupos[0]);
+    destruirGrupo(&grupos[1]);
+    destruirGrupo(&reduccion);
+
+    gettimeofday(&tiempo_fin, NULL);
+    if (ok) {
+        printf("Teselas exportadas: %ld archivos en %.4f seg\n",
+               totalTeselas, obtenerTiempoReal(tiempo_inicio, tiempo_fin));
+    } else {
+        fprintf(stderr, "Error: la exportación de teselas no se completó\n");
+    }
+    return ok;
+}
+
+// QUÉ: Exportar la imagen como pirámide de teselas PNG directamente desde memoria.
+// CÓMO: Ver deepzoom.h. Las teselas son PNG de 8 bits sin relleno: una imagen
+// de 16 bits o RGBX pasa antes por imagenParaGuardar (las demás se usan sin
+// copia), así la pirámide se construye ya con los canales que se escriben.
+// POR QUÉ: Ver deepzoom.h.
+int exportarTeselas(const ImagenInfo* info, const char* rutaBase, const OpcionesTeselas* opciones) {
+    ImagenInfo ocho = {0, 0, 0, 0, 0, NULL};
+    if (!imagenCargada(info) || !imagenParaGuardar(info, &ocho, 0)) {
+        return 0;
+    }
+    int ok = exportarTeselas8(&ocho, rutaBase, opciones);
+    liberarImagen(&ocho);
+    return ok;
+}
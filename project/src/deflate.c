@@ -0,0 +1,759 @@
+#include "deflate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// QUÉ: Constantes de deflate y del buscador de coincidencias.
+// CÓMO: Ventana de 32 KB, coincidencias de 3 a 258 bytes, tabla hash de 2^15
+// cabezas y bloques de hasta 32768 símbolos.
+#define VENTANA 32768
+#define MASCARA_VENTANA (VENTANA - 1)
+#define MIN_COINCIDENCIA 3
+#define MAX_COINCIDENCIA 258
+#define BITS_HASH 15
+#define TAM_HASH (1 << BITS_HASH)
+#define MAX_SIMBOLOS_BLOQUE 32768
+#define MAX_BITS_CODIGO 15
+#define MAX_BITS_LONGITUDES 7
+
+// QUÉ: Asegurar espacio para 'extra' bytes más en el búfer.
+int reservarBuffer(BufferBytes* buffer, size_t extra) {
+    if (buffer->tam + extra <= buffer->capacidad) {
+        return 1;
+    }
+    size_t nueva = buffer->capacidad ? buffer->capacidad : 4096;
+    while (nueva < buffer->tam + extra) {
+        nueva *= 2;
+    }
+    unsigned char* datos = (unsigned char*)realloc(buffer->datos, nueva);
+    if (!datos) {
+        return 0;
+    }
+    buffer->datos = datos;
+    buffer->capacidad = nueva;
+    return 1;
+}
+
+// QUÉ: Liberar el búfer y dejarlo vacío.
+void liberarBuffer(BufferBytes* buffer) {
+    free(buffer->datos);
+    buffer->datos = NULL;
+    buffer->tam = 0;
+    buffer->capacidad = 0;
+}
+
+// ============================================================================
+// SUMAS DE VERIFICACIÓN
+// ============================================================================
+
+#define BASE_ADLER 65521u
+
+// QUÉ: Continuar una suma Adler-32.
+// CÓMO: Acumula en bloques de 5552 bytes, el máximo que no desborda 32 bits
+// antes de aplicar el módulo (igual que zlib).
+unsigned long adler32Actualizar(unsigned long adler, const unsigned char* datos, size_t n) {
+    unsigned int a = adler & 0xFFFF;
+    unsigned int b = (adler >> 16) & 0xFFFF;
+    while (n > 0) {
+        size_t bloque = n < 5552 ? n : 5552;
+        n -= bloque;
+        while (bloque--) {
+            a += *datos++;
+            b += a;
+        }
+        a %= BASE_ADLER;
+        b %= BASE_ADLER;
+    }
+    return ((unsigned long)b << 16) | a;
+}
+
+// QUÉ: Adler-32 de A+B a partir de las sumas de A y B.
+// CÓMO: a = a1 + a2 - 1 y b = b1 + b2 + len2 * (a1 - 1), todo módulo 65521.
+unsigned long combinarAdler32(unsigned long adler1, unsigned long adler2, size_t longitud2) {
+    unsigned long resto = (unsigned long)(longitud2 % BASE_ADLER);
+    unsigned long a1 = adler1 & 0xFFFF, b1 = (adler1 >> 16) & 0xFFFF;
+    unsigned long a2 = adler2 & 0xFFFF, b2 = (adler2 >> 16) & 0xFFFF;
+    unsigned long a = (a1 + a2 + BASE_ADLER - 1) % BASE_ADLER;
+    unsigned long b = (b1 + b2 + (resto * ((a1 + BASE_ADLER - 1) % BASE_ADLER))) % BASE_ADLER;
+    return (b << 16) | a;
+}
+
+// QUÉ: Tabla de CRC-32 (polinomio 0xEDB88320) construida una sola vez.
+static unsigned long tablaCRC[256];
+static int tablaCRCLista = 0;
+
+static void construirTablaCRC(void) {
+    if (__atomic_load_n(&tablaCRCLista, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    // Construcción idempotente: varios hilos pueden hacerla a la vez sin daño
+    for (unsigned long n = 0; n < 256; n++) {
+        unsigned long c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320UL ^ (c >> 1) : c >> 1;
+        }
+        tablaCRC[n] = c;
+    }
+    __atomic_store_n(&tablaCRCLista, 1, __ATOMIC_RELEASE);
+}
+
+// QUÉ: Continuar un CRC-32 (empezar con 0).
+unsigned long crc32Actualizar(unsigned long crc, const unsigned char* datos, size_t n) {
+    construirTablaCRC();
+    crc = crc ^ 0xFFFFFFFFUL;
+    for (size_t i = 0; i < n; i++) {
+        crc = tablaCRC[(crc ^ datos[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFUL;
+}
+
+// ============================================================================
+// ESCRITURA DE BITS
+// ============================================================================
+
+// QUÉ: Escritor de bits LSB primero sobre un BufferBytes.
+typedef struct {
+    BufferBytes* salida;
+    unsigned long long acumulado;
+    int numBits;
+    int error;
+} EscritorBits;
+
+static void escribirBits(EscritorBits* e, unsigned int valor, int n) {
+    e->acumulado |= (unsigned long long)valor << e->numBits;
+    e->numBits += n;
+    if (e->numBits >= 32) {
+        if (!reservarBuffer(e->salida, 4)) {
+            e->error = 1;
+            e->numBits = 0;
+            e->acumulado = 0;
+            return;
+        }
+        unsigned char* p = e->salida->datos + e->salida->tam;
+        p[0] = (unsigned char)e->acumulado;
+        p[1] = (unsigned char)(e->acumulado >> 8);
+        p[2] = (unsigned char)(e->acumulado >> 16);
+        p[3] = (unsigned char)(e->acumulado >> 24);
+        e->salida->tam += 4;
+        e->acumulado >>= 32;
+        e->numBits -= 32;
+    }
+}
+
+// QUÉ: Completar el byte en curso con ceros y volcar los bits pendientes.
+static void alinearByte(EscritorBits* e) {
+    int bytes = (e->numBits + 7) / 8;
+    if (!reservarBuffer(e->salida, (size_t)bytes)) {
+        e->error = 1;
+        return;
+    }
+    for (int i = 0; i < bytes; i++) {
+        e->salida->datos[e->salida->tam++] = (unsigned char)(e->acumulado >> (8 * i));
+    }
+    e->acumulado = 0;
+    e->numBits = 0;
+}
+
+// ============================================================================
+// CÓDIGOS DE HUFFMAN
+// ============================================================================
+
+// QUÉ: Tablas de longitudes y distancias (RFC 1951, sección 3.2.5).
+static const unsigned short baseLongitud[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char extraLongitud[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short baseDistancia[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577};
+static const unsigned char extraDistancia[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const unsigned char ordenLongitudes[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// QUÉ: Código de longitud (0..28) de una coincidencia de 3..258 bytes.
+// CÓMO: Tabla indexada por longitud - 3, construida una sola vez.
+static unsigned char tablaCodigoLongitud[256];
+// QUÉ: Código de distancia: tabla para distancias 1..512 y, por encima,
+// tabla indexada por (distancia - 1) >> 7 (los códigos altos cubren múltiplos de 128).
+static unsigned char tablaDistanciaBaja[512];
+static unsigned char tablaDistanciaAlta[256];
+static int tablasCodigosListas = 0;
+
+static void construirTablasCodigos(void) {
+    if (__atomic_load_n(&tablasCodigosListas, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    // Construcción idempotente: varios hilos pueden hacerla a la vez sin daño
+    for (int l = 3, c = 0; l <= MAX_COINCIDENCIA; l++) {
+        while (c < 28 && baseLongitud[c + 1] <= l) c++;
+        tablaCodigoLongitud[l - 3] = (unsigned char)c;
+    }
+    for (int d = 1, c = 0; d <= 512; d++) {
+        while (c < 29 && baseDistancia[c + 1] <= d) c++;
+        tablaDistanciaBaja[d - 1] = (unsigned char)c;
+    }
+    for (int i = 0, c = 0; i < 256; i++) {
+        int d = i * 128 + 1;
+        while (c < 29 && baseDistancia[c + 1] <= d) c++;
+        tablaDistanciaAlta[i] = (unsigned char)c;
+    }
+    __atomic_store_n(&tablasCodigosListas, 1, __ATOMIC_RELEASE);
+}
+
+static inline int codigoLongitud(int longitud) {
+    return tablaCodigoLongitud[longitud - 3];
+}
+
+static inline int codigoDistancia(int distancia) {
+    return distancia <= 512 ? tablaDistanciaBaja[distancia - 1] : tablaDistanciaAlta[(distancia - 1) >> 7];
+}
+
+// QUÉ: Símbolo con su frecuencia, para ordenar al construir el código.
+typedef struct {
+    unsigned int frecuencia;
+    unsigned short simbolo;
+} SimboloFrecuencia;
+
+static int compararFrecuencia(const void* a, const void* b) {
+    const SimboloFrecuencia* x = (const SimboloFrecuencia*)a;
+    const SimboloFrecuencia* y = (const SimboloFrecuencia*)b;
+    if (x->frecuencia != y->frecuencia) return x->frecuencia < y->frecuencia ? -1 : 1;
+    return (int)x->simbolo - (int)y->simbolo;
+}
+
+// QUÉ: Calcular longitudes de código de Huffman limitadas a maxBits.
+// CÓMO: Ordena los símbolos usados por frecuencia, obtiene las profundidades
+// óptimas con el algoritmo en sitio de Moffat-Katajainen y, si alguna supera
+// maxBits, redistribuye las cuentas por longitud hasta cumplir la desigualdad
+// de Kraft (como hace miniz). Las longitudes se reparten de más corta a más
+// larga entre los símbolos de mayor a menor frecuencia. Con un solo símbolo
+// se añade otro para que el código sea completo.
+static void construirLongitudes(const unsigned int* frecuencias, int n, int maxBits, unsigned char* longitudes) {
+    SimboloFrecuencia lista[288];
+    int usados = 0;
+    memset(longitudes, 0, (size_t)n);
+    for (int s = 0; s < n; s++) {
+        if (frecuencias[s]) {
+            lista[usados].frecuencia = frecuencias[s];
+            lista[usados].simbolo = (unsigned short)s;
+            usados++;
+        }
+    }
+    if (usados == 0) {
+        return;
+    }
+    if (usados == 1) {
+        longitudes[lista[0].simbolo] = 1;
+        longitudes[lista[0].simbolo == 0 ? 1 : 0] = 1;
+        return;
+    }
+    qsort(lista, (size_t)usados, sizeof(SimboloFrecuencia), compararFrecuencia);
+
+    // Moffat-Katajainen: A[] contiene frecuencias ordenadas y termina con profundidades
+    unsigned int A[288];
+    for (int i = 0; i < usados; i++) A[i] = lista[i].frecuencia;
+    int raiz = 0, hoja = 2, siguiente;
+    A[0] += A[1];
+    for (siguiente = 1; siguiente < usados - 1; siguiente++) {
+        if (hoja >= usados || A[raiz] < A[hoja]) {
+            A[siguiente] = A[raiz];
+            A[raiz++] = (unsigned int)siguiente;
+        } else {
+            A[siguiente] = A[hoja++];
+        }
+        if (hoja >= usados || (raiz < siguiente && A[raiz] < A[hoja])) {
+            A[siguiente] += A[raiz];
+            A[raiz++] = (unsigned int)siguiente;
+        } else {
+            A[siguiente] += A[hoja++];
+        }
+    }
+    A[usados - 2] = 0;
+    for (siguiente = usados - 3; siguiente >= 0; siguiente--) {
+        A[siguiente] = A[A[siguiente]] + 1;
+    }
+    int disponibles = 1, ocupados = 0, profundidad = 0;
+    raiz = usados - 2;
+    siguiente = usados - 1;
+    while (disponibles > 0) {
+        while (raiz >= 0 && (int)A[raiz] == profundidad) {
+            ocupados++;
+            raiz--;
+        }
+        while (disponibles > ocupados) {
+            A[siguiente--] = (unsigned int)profundidad;
+            disponibles--;
+        }
+        disponibles = 2 * ocupados;
+        profundidad++;
+        ocupados = 0;
+    }
+
+    // Cuentas por longitud, limitadas a maxBits y ajustadas a Kraft
+    int cuentas[33] = {0};
+    for (int i = 0; i < usados; i++) {
+        int l = (int)A[i];
+        cuentas[l > 32 ? 32 : l]++;
+    }
+    for (int i = maxBits + 1; i <= 32; i++) {
+        cuentas[maxBits] += cuentas[i];
+        cuentas[i] = 0;
+    }
+    unsigned long total = 0;
+    for (int i = maxBits; i > 0; i--) {
+        total += (unsigned long)cuentas[i] << (maxBits - i);
+    }
+    while (total != (1UL << maxBits)) {
+        cuentas[maxBits]--;
+        for (int i = maxBits - 1; i > 0; i--) {
+            if (cuentas[i]) {
+                cuentas[i]--;
+                cuentas[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    int j = usados;
+    for (int l = 1; l <= maxBits; l++) {
+        for (int c = cuentas[l]; c > 0; c--) {
+            longitudes[lista[--j].simbolo] = (unsigned char)l;
+        }
+    }
+}
+
+// QUÉ: Asignar códigos canónicos (ya invertidos para escribir LSB primero).
+static void asignarCodigos(const unsigned char* longitudes, int n, unsigned short* codigos) {
+    int cuentas[MAX_BITS_CODIGO + 1] = {0};
+    int siguiente[MAX_BITS_CODIGO + 1];
+    for (int s = 0; s < n; s++) cuentas[longitudes[s]]++;
+    cuentas[0] = 0;
+    int codigo = 0;
+    for (int l = 1; l <= MAX_BITS_CODIGO; l++) {
+        codigo = (codigo + cuentas[l - 1]) << 1;
+        siguiente[l] = codigo;
+    }
+    for (int s = 0; s < n; s++) {
+        int l = longitudes[s];
+        if (l == 0) {
+            codigos[s] = 0;
+            continue;
+        }
+        unsigned int c = (unsigned int)siguiente[l]++;
+        unsigned int invertido = 0;
+        for (int i = 0; i < l; i++) {
+            invertido = (invertido << 1) | ((c >> i) & 1);
+        }
+        codigos[s] = (unsigned short)invertido;
+    }
+}
+
+// ============================================================================
+// COMPRESOR
+// ============================================================================
+
+// QUÉ: Estado de un trozo en compresión (uno por llamada, nada compartido).
+typedef struct {
+    const unsigned char* base;
+    size_t inicio;
+    size_t fin;
+    const ParametrosDeflate* parametros;
+
+    int* cabeza;                       // TAM_HASH: última posición por hash
+    int* anterior;                     // VENTANA: cadena de posiciones previas
+    size_t origen;                     // Posición de base correspondiente a 0 en cabeza/anterior
+
+    unsigned short* simbolos;          // Literal/longitud (0..285) o longitud real si es coincidencia
+    unsigned short* distancias;        // 0 = literal
+    int numSimbolos;
+    size_t inicioBloque;               // Primer byte de base cubierto por el bloque en curso
+
+    EscritorBits escritor;
+} Compresor;
+
+static inline unsigned int hash3(const unsigned char* p) {
+    unsigned int v = (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16);
+    return (v * 2654435761u) >> (32 - BITS_HASH);
+}
+
+// QUÉ: Insertar la posición pos en la cadena de su hash y devolver la cabeza previa.
+static inline int insertarPosicion(Compresor* c, size_t pos) {
+    unsigned int h = hash3(c->base + pos);
+    int relativa = (int)(pos - c->origen);
+    int previa = c->cabeza[h];
+    c->anterior[relativa & MASCARA_VENTANA] = previa;
+    c->cabeza[h] = relativa;
+    return previa;
+}
+
+// QUÉ: Buscar la coincidencia más larga para pos recorriendo la cadena.
+static int buscarCoincidencia(const Compresor* c, size_t pos, int candidato, int* distancia) {
+    const unsigned char* actual = c->base + pos;
+    size_t disponibles = c->fin - pos;
+    int maxLongitud = disponibles < MAX_COINCIDENCIA ? (int)disponibles : MAX_COINCIDENCIA;
+    int mejor = MIN_COINCIDENCIA - 1;
+    int relativa = (int)(pos - c->origen);
+    int limite = relativa - VENTANA + 1;
+    int cadena = c->parametros->maxCadena;
+
+    if (maxLongitud < MIN_COINCIDENCIA) {
+        return 0;
+    }
+    while (candidato >= 0 && candidato >= limite && cadena-- > 0) {
+        const unsigned char* previo = c->base + c->origen + candidato;
+        if (previo[mejor] == actual[mejor] && previo[0] == actual[0] && previo[1] == actual[1]) {
+            int l = 2;
+            while (l < maxLongitud && previo[l] == actual[l]) l++;
+            if (l > mejor) {
+                mejor = l;
+                *distancia = relativa - candidato;
+                if (l >= c->parametros->longitudBuena || l == maxLongitud) {
+                    break;
+                }
+            }
+        }
+        candidato = c->anterior[candidato & MASCARA_VENTANA];
+    }
+    return mejor >= MIN_COINCIDENCIA ? mejor : 0;
+}
+
+// QUÉ: Escribir un bloque almacenado con base[desde, hasta).
+static void escribirAlmacenado(EscritorBits* e, const unsigned char* base, size_t desde, size_t hasta, int final) {
+    do {
+        size_t n = hasta - desde;
+        if (n > 65535) n = 65535;
+        int ultimo = final && (desde + n == hasta);
+        escribirBits(e, ultimo ? 1 : 0, 1);
+        escribirBits(e, 0, 2);
+        alinearByte(e);
+        if (e->error || !reservarBuffer(e->salida, 4 + n)) {
+            e->error = 1;
+            return;
+        }
+        unsigned char* p = e->salida->datos + e->salida->tam;
+        p[0] = (unsigned char)n;
+        p[1] = (unsigned char)(n >> 8);
+        p[2] = (unsigned char)~n;
+        p[3] = (unsigned char)(~n >> 8);
+        memcpy(p + 4, base + desde, n);
+        e->salida->tam += 4 + n;
+        desde += n;
+    } while (desde < hasta);
+}
+
+// QUÉ: Escribir los símbolos del bloque con los códigos dados.
+static void escribirSimbolos(Compresor* c, const unsigned short* codLit, const unsigned char* lenLit,
+                             const unsigned short* codDist, const unsigned char* lenDist) {
+    EscritorBits* e = &c->escritor;
+    for (int i = 0; i < c->numSimbolos; i++) {
+        int distancia = c->distancias[i];
+        if (distancia == 0) {
+            int s = c->simbolos[i];
+            escribirBits(e, codLit[s], lenLit[s]);
+        } else {
+            int longitud = c->simbolos[i];
+            int cl = codigoLongitud(longitud);
+            escribirBits(e, codLit[257 + cl], lenLit[257 + cl]);
+            escribirBits(e, (unsigned int)(longitud - baseLongitud[cl]), extraLongitud[cl]);
+            int cd = codigoDistancia(distancia);
+            escribirBits(e, codDist[cd], lenDist[cd]);
+            escribirBits(e, (unsigned int)(distancia - baseDistancia[cd]), extraDistancia[cd]);
+        }
+    }
+    escribirBits(e, codLit[256], lenLit[256]);
+}
+
+// QUÉ: Cerrar el bloque en curso eligiendo la codificación más corta.
+// CÓMO: Calcula frecuencias, construye los códigos dinámicos y estima en bits
+// el tamaño con Huffman dinámico, Huffman fijo y sin compresión.
+static void emitirBloque(Compresor* c, size_t hasta, int final) {
+    unsigned int frecLit[286] = {0};
+    unsigned int frecDist[30] = {0};
+    unsigned long long bitsExtra = 0;
+
+    for (int i = 0; i < c->numSimbolos; i++) {
+        if (c->distancias[i] == 0) {
+            frecLit[c->simbolos[i]]++;
+        } else {
+            int cl = codigoLongitud(c->simbolos[i]);
+            int cd = codigoDistancia(c->distancias[i]);
+            frecLit[257 + cl]++;
+            frecDist[cd]++;
+            bitsExtra += extraLongitud[cl] + extraDistancia[cd];
+        }
+    }
+    frecLit[256] = 1;
+
+    // Códigos dinámicos
+    unsigned char lenLit[288], lenDist[32];
+    unsigned short codLit[288], codDist[32];
+    construirLongitudes(frecLit, 286, MAX_BITS_CODIGO, lenLit);
+    construirLongitudes(frecDist, 30, MAX_BITS_CODIGO, lenDist);
+    int hayDistancias = 0;
+    for (int s = 0; s < 30; s++) hayDistancias |= lenDist[s];
+    if (!hayDistancias) {
+        lenDist[0] = lenDist[1] = 1; // Árbol de distancias completo aunque no se use
+    }
+    int hlit = 286, hdist = 30;
+    while (hlit > 257 && lenLit[hlit - 1] == 0) hlit--;
+    while (hdist > 1 && lenDist[hdist - 1] == 0) hdist--;
+
+    // Longitudes combinadas codificadas con 16/17/18 (repeticiones)
+    unsigned char todas[286 + 30];
+    memcpy(todas, lenLit, (size_t)hlit);
+    memcpy(todas + hlit, lenDist, (size_t)hdist);
+    int total = hlit + hdist;
+    unsigned char rle[286 + 30];
+    unsigned char rleExtra[286 + 30];
+    int numRle = 0;
+    unsigned int frecLongitudes[19] = {0};
+    for (int i = 0; i < total;) {
+        int l = todas[i];
+        int repeticion = 1;
+        while (i + repeticion < total && todas[i + repeticion] == l) repeticion++;
+        i += repeticion;
+        if (l == 0) {
+            while (repeticion >= 11) {
+                int n = repeticion > 138 ? 138 : repeticion;
+                rle[numRle] = 18;
+                rleExtra[numRle++] = (unsigned char)(n - 11);
+                repeticion -= n;
+            }
+            if (repeticion >= 3) {
+                rle[numRle] = 17;
+                rleExtra[numRle++] = (unsigned char)(repeticion - 3);
+                repeticion = 0;
+            }
+        } else {
+            rle[numRle] = (unsigned char)l;
+            rleExtra[numRle++] = 0;
+            repeticion--;
+            while (repeticion >= 3) {
+                int n = repeticion > 6 ? 6 : repeticion;
+                rle[numRle] = 16;
+                rleExtra[numRle++] = (unsigned char)(n - 3);
+                repeticion -= n;
+            }
+        }
+        while (repeticion-- > 0) {
+            rle[numRle] = (unsigned char)l;
+            rleExtra[numRle++] = 0;
+        }
+    }
+    for (int i = 0; i < numRle; i++) frecLongitudes[rle[i]]++;
+    unsigned char lenLongitudes[19];
+    unsigned short codLongitudes[19];
+    construirLongitudes(frecLongitudes, 19, MAX_BITS_LONGITUDES, lenLongitudes);
+    int hclen = 19;
+    while (hclen > 4 && lenLongitudes[ordenLongitudes[hclen - 1]] == 0) hclen--;
+
+    // Estimación de tamaños en bits
+    unsigned long long bitsDinamico = 3 + 5 + 5 + 4 + 3ULL * hclen;
+    for (int i = 0; i < numRle; i++) {
+        bitsDinamico += lenLongitudes[rle[i]];
+        bitsDinamico += (rle[i] == 16) ? 2 : (rle[i] == 17) ? 3 : (rle[i] == 18) ? 7 : 0;
+    }
+    unsigned long long bitsFijo = 3 + bitsExtra;
+    for (int s = 0; s < 286; s++) {
+        bitsDinamico += (unsigned long long)frecLit[s] * lenLit[s];
+        bitsFijo += (unsigned long long)frecLit[s] * (s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8);
+    }
+    for (int s = 0; s < 30; s++) {
+        bitsDinamico += (unsigned long long)frecDist[s] * lenDist[s];
+        bitsFijo += (unsigned long long)frecDist[s] * 5;
+    }
+    bitsDinamico += bitsExtra;
+    size_t bytesCrudos = hasta - c->inicioBloque;
+    unsigned long long bitsAlmacenado = (bytesCrudos / 65535 + 1) * 40ULL + bytesCrudos * 8ULL + 7;
+
+    EscritorBits* e = &c->escritor;
+    if (bytesCrudos > 0 && bitsAlmacenado <= bitsDinamico && bitsAlmacenado <= bitsFijo) {
+        escribirAlmacenado(e, c->base, c->inicioBloque, hasta, final);
+    } else if (bitsFijo <= bitsDinamico) {
+        unsigned char lenFijoLit[288], lenFijoDist[32];
+        unsigned short codFijoLit[288], codFijoDist[32];
+        for (int s = 0; s < 288; s++) lenFijoLit[s] = (unsigned char)(s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8);
+        for (int s = 0; s < 32; s++) lenFijoDist[s] = 5;
+        asignarCodigos(lenFijoLit, 288, codFijoLit);
+        asignarCodigos(lenFijoDist, 32, codFijoDist);
+        escribirBits(e, final ? 1 : 0, 1);
+        escribirBits(e, 1, 2);
+        escribirSimbolos(c, codFijoLit, lenFijoLit, codFijoDist, lenFijoDist);
+    } else {
+        asignarCodigos(lenLit, 286, codLit);
+        asignarCodigos(lenDist, 30, codDist);
+        asignarCodigos(lenLongitudes, 19, codLongitudes);
+        escribirBits(e, final ? 1 : 0, 1);
+        escribirBits(e, 2, 2);
+        escribirBits(e, (unsigned int)(hlit - 257), 5);
+        escribirBits(e, (unsigned int)(hdist - 1), 5);
+        escribirBits(e, (unsigned int)(hclen - 4), 4);
+        for (int i = 0; i < hclen; i++) {
+            escribirBits(e, lenLongitudes[ordenLongitudes[i]], 3);
+        }
+        for (int i = 0; i < numRle; i++) {
+            escribirBits(e, codLongitudes[rle[i]], lenLongitudes[rle[i]]);
+            if (rle[i] == 16) escribirBits(e, rleExtra[i], 2);
+            else if (rle[i] == 17) escribirBits(e, rleExtra[i], 3);
+            else if (rle[i] == 18) escribirBits(e, rleExtra[i], 7);
+        }
+        escribirSimbolos(c, codLit, lenLit, codDist, lenDist);
+    }
+
+    c->numSimbolos = 0;
+    c->inicioBloque = hasta;
+}
+
+static inline void agregarLiteral(Compresor* c, size_t pos) {
+    c->simbolos[c->numSimbolos] = c->base[pos];
+    c->distancias[c->numSimbolos++] = 0;
+    if (c->numSimbolos == MAX_SIMBOLOS_BLOQUE) {
+        emitirBloque(c, pos + 1, 0);
+    }
+}
+
+static inline void agregarCoincidencia(Compresor* c, size_t pos, int longitud, int distancia) {
+    c->simbolos[c->numSimbolos] = (unsigned short)longitud;
+    c->distancias[c->numSimbolos++] = (unsigned short)distancia;
+    if (c->numSimbolos == MAX_SIMBOLOS_BLOQUE) {
+        emitirBloque(c, pos + longitud, 0);
+    }
+}
+
+// QUÉ: Comprimir base[inicio, fin) como bloques deflate.
+// CÓMO: Ver deflate.h. El LZ77 usa cadenas de hash de 3 bytes; las posiciones
+// del diccionario (hasta 32 KB antes de inicio) se insertan primero.
+// POR QUÉ: Ver deflate.h.
+int comprimirDeflate(const unsigned char* base, size_t inicio, size_t fin, int final,
+                     const ParametrosDeflate* parametros, BufferBytes* salida) {
+    if (parametros->almacenar) {
+        // Solo bloques almacenados: ya quedan alineados a byte, así que el
+        // trozo siguiente puede concatenarse sin vaciado de sincronización.
+        EscritorBits e;
+        memset(&e, 0, sizeof(e));
+        e.salida = salida;
+        escribirAlmacenado(&e, base, inicio, fin, final);
+        if (e.error) {
+            fprintf(stderr, "Error de memoria al escribir flujo deflate\n");
+            return 0;
+        }
+        return 1;
+    }
+
+    Compresor c;
+    memset(&c, 0, sizeof(c));
+    construirTablasCodigos();
+    c.base = base;
+    c.inicio = inicio;
+    c.fin = fin;
+    c.parametros = parametros;
+    c.origen = inicio > VENTANA ? inicio - VENTANA : 0;
+    c.inicioBloque = inicio;
+    c.escritor.salida = salida;
+
+    c.cabeza = (int*)malloc(TAM_HASH * sizeof(int));
+    c.anterior = (int*)malloc(VENTANA * sizeof(int));
+    c.simbolos = (unsigned short*)malloc(MAX_SIMBOLOS_BLOQUE * sizeof(unsigned short));
+    c.distancias = (unsigned short*)malloc(MAX_SIMBOLOS_BLOQUE * sizeof(unsigned short));
+    if (!c.cabeza || !c.anterior || !c.simbolos || !c.distancias) {
+        fprintf(stderr, "Error de memoria en compresor deflate\n");
+        free(c.cabeza);
+        free(c.anterior);
+        free(c.simbolos);
+        free(c.distancias);
+        return 0;
+    }
+    memset(c.cabeza, 0xFF, TAM_HASH * sizeof(int)); // -1 = cadena vacía
+
+    if (parametros->maxCadena <= 0) {
+        // Sin búsqueda de coincidencias: solo literales (Huffman o almacenado)
+        for (size_t pos = inicio; pos < fin; pos++) {
+            agregarLiteral(&c, pos);
+        }
+    } else {
+        // Diccionario: los últimos 32 KB del trozo anterior
+        for (size_t pos = c.origen; pos < inicio && pos + 2 < fin; pos++) {
+            insertarPosicion(&c, pos);
+        }
+
+        size_t pos = inicio;
+        int pendiente = 0;        // La coincidencia de pos ya está calculada
+        int longitud = 0, distancia = 0;
+        while (pos < fin) {
+            if (!pendiente) {
+                longitud = 0;
+                if (pos + 2 < fin) {
+                    int candidato = insertarPosicion(&c, pos);
+                    longitud = buscarCoincidencia(&c, pos, candidato, &distancia);
+                }
+            }
+            pendiente = 0;
+
+            if (longitud == 0) {
+                agregarLiteral(&c, pos);
+                pos++;
+                continue;
+            }
+
+            // Evaluación perezosa: si la posición siguiente da una coincidencia
+            // más larga, se emite un literal y se usa esa.
+            if (parametros->perezoso && longitud < parametros->longitudBuena && pos + 3 < fin) {
+                int distancia2 = 0;
+                int candidato = insertarPosicion(&c, pos + 1);
+                int longitud2 = buscarCoincidencia(&c, pos + 1, candidato, &distancia2);
+                if (longitud2 > longitud) {
+                    agregarLiteral(&c, pos);
+                    pos++;
+                    longitud = longitud2;
+                    distancia = distancia2;
+                    pendiente = 1;
+                    continue;
+                }
+                agregarCoincidencia(&c, pos, longitud, distancia);
+                for (size_t p = pos + 2; p < pos + longitud && p + 2 < fin; p++) {
+                    insertarPosicion(&c, p);
+                }
+            } else {
+                agregarCoincidencia(&c, pos, longitud, distancia);
+                for (size_t p = pos + 1; p < pos + longitud && p + 2 < fin; p++) {
+                    insertarPosicion(&c, p);
+                }
+            }
+            pos += longitud;
+        }
+    }
+
+    if (c.numSimbolos > 0 || final) {
+        emitirBloque(&c, fin, final);
+    }
+    if (!final) {
+        // Vaciado de sincronización: bloque almacenado vacío, salida alineada a byte
+        escribirBits(&c.escritor, 0, 3);
+        alinearByte(&c.escritor);
+        if (!c.escritor.error && reservarBuffer(salida, 4)) {
+            unsigned char marca[4] = {0x00, 0x00, 0xFF, 0xFF};
+            memcpy(salida->datos + salida->tam, marca, 4);
+            salida->tam += 4;
+        } else {
+            c.escritor.error = 1;
+        }
+    } else {
+        alinearByte(&c.escritor);
+    }
+
+    free(c.cabeza);
+    free(c.anterior);
+    free(c.simbolos);
+    free(c.distancias);
+    if (c.escritor.error) {
+        fprintf(stderr, "Error de memoria al escribir flujo deflate\n");
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,392 @@
+#include "flujo.h"
+#include "filters.h"
+#include "png_decoder.h"
+#include "scaling.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+struct EjecucionFlujo;
+
+// QUÉ: Una etapa de la cadena en flujo.
+// CÓMO: Recibe filas de entrada en orden y entrega filas de salida en orden a
+// la etapa siguiente. Las de vecindario guardan las filas recibidas en un
+// anillo (en Sobel, ya reducidas a luma) y calculan franjas en 'salida'.
+typedef struct {
+    TipoOperacion tipo;
+    int ancho, alto, canales;                       // Filas de entrada
+    int anchoSalida, altoSalida, canalesSalida;     // Filas de salida
+    size_t bytesAnillo;                             // Bytes de cada fila del anillo
+    size_t bytesSalida;
+    int radio;                                      // Filas de halo (0 en etapas puntuales)
+    int filasAnillo;
+    unsigned char* anillo;
+    unsigned char* salida;                          // Franja de salida (o una fila)
+    int recibidas;
+    int emitidas;
+    int delta;
+    KernelGaussiano kernel;
+    ReductorArea reductor;
+    int reductorListo;
+    struct EjecucionFlujo* ejecucion;
+    int indice;
+} EtapaFlujo;
+
+// QUÉ: Estado de una ejecución (un archivo).
+typedef struct EjecucionFlujo {
+    const CadenaOperaciones* cadena;
+    const char* rutaSalida;
+    PerfilPNG perfil;
+    EtapaFlujo* etapas;
+    int numEtapas;
+    CodificadorPNG codificador;
+    int codificadorAbierto;
+    PoolHilos pool;
+    int hayPool;
+    int noAplica;
+    size_t bytesBuferes;
+} EjecucionFlujo;
+
+// QUÉ: Trabajo de una parte de la franja de una etapa de vecindario.
+typedef struct {
+    EtapaFlujo* etapa;
+    int desde;
+    int hasta;
+} TareaFranjaFlujo;
+
+static int empujarFila(EjecucionFlujo* ejecucion, int indice, const unsigned char* fila);
+
+// QUÉ: ¿Es un scale que el reductor de área en flujo puede hacer?
+static int escalaEnFlujo(const Operacion* op, int ancho, int alto, int* nuevoAncho, int* nuevoAlto) {
+    dimensionesEscala(op, ancho, alto, nuevoAncho, nuevoAlto);
+    ScaleMode modo = resolverModoEscalado(ancho, alto, *nuevoAncho, *nuevoAlto, (ScaleMode)op->entero[2]);
+    return modo == SCALE_AREA && *nuevoAncho <= ancho && *nuevoAlto <= alto;
+}
+
+// QUÉ: ¿Puede la cadena ejecutarse en flujo?
+int cadenaAdmiteFlujo(const CadenaOperaciones* cadena) {
+    for (int i = 0; i < cadena->numOps; i++) {
+        const Operacion* op = &cadena->ops[i];
+        if (op->tipo == OP_ROTAR) return 0;
+        if (op->tipo == OP_ESCALAR && op->entero[2] != SCALE_AUTO && op->entero[2] != SCALE_AREA) return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Fila del anillo que guarda la fila de entrada y (recortada al borde).
+static inline const unsigned char* filaAnillo(const EtapaFlujo* etapa, int y) {
+    if (y < 0) y = 0;
+    if (y >= etapa->alto) y = etapa->alto - 1;
+    return etapa->anillo + (size_t)(y % etapa->filasAnillo) * etapa->bytesAnillo;
+}
+
+// QUÉ: Calcular las filas [desde, hasta) de la franja de una etapa de vecindario.
+static void calcularFranja(EtapaFlujo* etapa, int desde, int hasta) {
+    const unsigned char* filas[15];
+    for (int y = desde; y < hasta; y++) {
+        unsigned char* destino = etapa->salida + (size_t)(y - etapa->emitidas) * etapa->bytesSalida;
+        if (etapa->tipo == OP_BLUR) {
+            for (int k = 0; k < etapa->kernel.tam; k++) {
+                filas[k] = filaAnillo(etapa, y + k - etapa->radio);
+            }
+            convolucionarFilaGaussiana(&etapa->kernel, filas, etapa->ancho, etapa->canales, destino);
+        } else {
+            for (int k = 0; k < 3; k++) {
+                filas[k] = filaAnillo(etapa, y + k - 1);
+            }
+            sobelFila(filas, etapa->ancho, destino);
+        }
+    }
+}
+
+static void calcularFranjaTarea(void* arg) {
+    TareaFranjaFlujo* tarea = (TareaFranjaFlujo*)arg;
+    calcularFranja(tarea->etapa, tarea->desde, tarea->hasta);
+}
+
+// QUÉ: Calcular y entregar las filas de salida que ya tienen todo su halo.
+// CÓMO: Mientras haya una franja completa lista (o al final, lo que quede),
+// se reparte entre los hilos del pool y luego se entregan sus filas en orden.
+static int avanzarVecindario(EtapaFlujo* etapa) {
+    EjecucionFlujo* ejecucion = etapa->ejecucion;
+    int final = etapa->recibidas == etapa->alto;
+    int listas = final ? etapa->alto : etapa->recibidas - etapa->radio;
+    while (listas - etapa->emitidas >= FILAS_FRANJA_FLUJO || (final && etapa->emitidas < listas)) {
+        int n = listas - etapa->emitidas;
+        if (n > FILAS_FRANJA_FLUJO) n = FILAS_FRANJA_FLUJO;
+        int partes = ejecucion->hayPool ? NUM_HILOS_GLOBAL : 1;
+        if (partes > n) partes = n;
+        if (partes > 1) {
+            TareaFranjaFlujo tareas[MAX_HILOS];
+            GrupoTareas grupo;
+            iniciarGrupo(&grupo);
+            int filasPorParte = (n + partes - 1) / partes;
+            int enviadas = 1;
+            for (int i = 0; i < partes; i++) {
+                tareas[i].etapa = etapa;
+                tareas[i].desde = etapa->emitidas + i * filasPorParte;
+                tareas[i].hasta = etapa->emitidas + ((i + 1) * filasPorParte < n ? (i + 1) * filasPorParte : n);
+                if (tareas[i].desde >= tareas[i].hasta) continue;
+                if (!enviarTarea(&ejecucion->pool, calcularFranjaTarea, &tareas[i], &grupo)) {
+                    enviadas = 0;
+                    break;
+                }
+            }
+            esperarGrupo(&grupo);
+            destruirGrupo(&grupo);
+            if (!enviadas) return 0;
+        } else {
+            calcularFranja(etapa, etapa->emitidas, etapa->emitidas + n);
+        }
+        for (int i = 0; i < n; i++) {
+            if (!empujarFila(ejecucion, etapa->indice + 1, etapa->salida + (size_t)i * etapa->bytesSalida)) {
+                return 0;
+            }
+        }
+        etapa->emitidas += n;
+    }
+    return 1;
+}
+
+// QUÉ: Callback del reductor de área: pasar la fila a la etapa siguiente.
+static int alCerrarFilaEscala(void* contexto, const unsigned char* fila) {
+    EtapaFlujo* etapa = (EtapaFlujo*)contexto;
+    return empujarFila(etapa->ejecucion, etapa->indice + 1, fila);
+}
+
+// QUÉ: Entregar una fila a la etapa 'indice' (o al codificador tras la última).
+static int empujarFila(EjecucionFlujo* ejecucion, int indice, const unsigned char* fila) {
+    if (indice == ejecucion->numEtapas) {
+        return escribirFilaPNG(&ejecucion->codificador, fila);
+    }
+    EtapaFlujo* etapa = &ejecucion->etapas[indice];
+    if (etapa->recibidas >= etapa->alto) {
+        return 0;
+    }
+    switch (etapa->tipo) {
+        case OP_BRILLO:
+            memcpy(etapa->salida, fila, etapa->bytesSalida);
+            ajustarBrilloFila(etapa->salida, etapa->ancho, etapa->canales, etapa->delta, 1);
+            etapa->recibidas++;
+            return empujarFila(ejecucion, indice + 1, etapa->salida);
+        case OP_GRISES:
+            if (etapa->canales == 4) {
+                filaAGrisesConAlfa(fila, etapa->salida, etapa->ancho);
+            } else {
+                filaAGrises(fila, etapa->canales, etapa->salida, etapa->ancho);
+            }
+            etapa->recibidas++;
+            return empujarFila(ejecucion, indice + 1, etapa->salida);
+        case OP_ESCALAR:
+            etapa->recibidas++;
+            return empujarFilaArea(&etapa->reductor, fila);
+        case OP_SOBEL: {
+            // El anillo guarda la luma; el alfa no interviene
+            unsigned char* destino = etapa->anillo + (size_t)(etapa->recibidas % etapa->filasAnillo) * etapa->bytesAnillo;
+            if (etapa->canales >= 3) {
+                filaAGrises(fila, etapa->canales, destino, etapa->ancho);
+            } else {
+                for (int x = 0; x < etapa->ancho; x++) {
+                    destino[x] = fila[x * etapa->canales];
+                }
+            }
+            etapa->recibidas++;
+            return avanzarVecindario(etapa);
+        }
+        case OP_BLUR:
+            memcpy(etapa->anillo + (size_t)(etapa->recibidas % etapa->filasAnillo) * etapa->bytesAnillo, fila,
+                   etapa->bytesAnillo);
+            etapa->recibidas++;
+            return avanzarVecindario(etapa);
+        case OP_ROTAR:
+            break;
+    }
+    return 0;
+}
+
+// QUÉ: Añadir una etapa con la entrada de la anterior y preparar sus búferes.
+// Devuelve 1 si tuvo éxito, 0 si falta memoria o el kernel no es válido.
+static int agregarEtapa(EjecucionFlujo* ejecucion, const Operacion* op, int* ancho, int* alto, int* canales) {
+    EtapaFlujo* etapa = &ejecucion->etapas[ejecucion->numEtapas];
+    memset(etapa, 0, sizeof(*etapa));
+    etapa->tipo = op->tipo;
+    etapa->ancho = etapa->anchoSalida = *ancho;
+    etapa->alto = etapa->altoSalida = *alto;
+    etapa->canales = etapa->canalesSalida = *canales;
+    etapa->ejecucion = ejecucion;
+    etapa->indice = ejecucion->numEtapas;
+    ejecucion->numEtapas++;
+
+    int filasSalida = 1;
+    switch (op->tipo) {
+        case OP_BRILLO:
+            etapa->delta = op->entero[0];
+            break;
+        case OP_GRISES:
+            etapa->canalesSalida = (*canales == 4) ? 2 : 1;
+            break;
+        case OP_BLUR:
+            if (!crearKernelGaussiano(&etapa->kernel, op->entero[0], op->real)) {
+                return 0;
+            }
+            etapa->radio = op->entero[0] / 2;
+            etapa->bytesAnillo = (size_t)*ancho * *canales;
+            filasSalida = FILAS_FRANJA_FLUJO;
+            break;
+        case OP_SOBEL:
+            etapa->radio = 1;
+            etapa->canalesSalida = 1;
+            etapa->bytesAnillo = (size_t)*ancho;
+            filasSalida = FILAS_FRANJA_FLUJO;
+            break;
+        case OP_ESCALAR:
+            escalaEnFlujo(op, *ancho, *alto, &etapa->anchoSalida, &etapa->altoSalida);
+            filasSalida = 0; // El reductor tiene su propia fila de salida
+            if (!iniciarReductorAreaFlujo(&etapa->reductor, *ancho, *alto, etapa->anchoSalida,
+                                          etapa->altoSalida, *canales, alCerrarFilaEscala, etapa)) {
+                return 0;
+            }
+            etapa->reductorListo = 1;
+            // Fila horizontal, dos acumuladores y la fila de salida
+            ejecucion->bytesBuferes += (size_t)etapa->anchoSalida * *canales * (3 * sizeof(unsigned int) + 1);
+            break;
+        case OP_ROTAR:
+            return 0;
+    }
+    etapa->bytesSalida = (size_t)etapa->anchoSalida * etapa->canalesSalida;
+    if (etapa->radio > 0) {
+        etapa->filasAnillo = FILAS_FRANJA_FLUJO + 2 * etapa->radio;
+        etapa->anillo = (unsigned char*)malloc((size_t)etapa->filasAnillo * etapa->bytesAnillo);
+        if (!etapa->anillo) return 0;
+        ejecucion->bytesBuferes += (size_t)etapa->filasAnillo * etapa->bytesAnillo;
+    }
+    if (filasSalida > 0) {
+        etapa->salida = (unsigned char*)malloc((size_t)filasSalida * etapa->bytesSalida);
+        if (!etapa->salida) return 0;
+        ejecucion->bytesBuferes += (size_t)filasSalida * etapa->bytesSalida;
+    }
+    *ancho = etapa->anchoSalida;
+    *alto = etapa->altoSalida;
+    *canales = etapa->canalesSalida;
+    return 1;
+}
+
+// QUÉ: Callback de cabecera: comprobar la cadena con las dimensiones reales,
+// crear las etapas y abrir el codificador.
+// CÓMO: Si algún scale no es una reducción por área, o el PNG es de 16 bits
+// (las etapas del flujo son de 8), se marca noAplica y se aborta antes de
+// crear el archivo de salida.
+static int alRecibirCabeceraFlujo(void* contexto, CabeceraPNG* cabecera) {
+    EjecucionFlujo* ejecucion = (EjecucionFlujo*)contexto;
+    const CadenaOperaciones* cadena = ejecucion->cadena;
+
+    if (cabecera->profundidad == 16) {
+        ejecucion->noAplica = 1;
+        return 0;
+    }
+
+    int ancho = cabecera->ancho, alto = cabecera->alto;
+    for (int i = 0; i < cadena->numOps; i++) {
+        const Operacion* op = &cadena->ops[i];
+        if (op->tipo == OP_ESCALAR) {
+            int nuevoAncho, nuevoAlto;
+            if (!escalaEnFlujo(op, ancho, alto, &nuevoAncho, &nuevoAlto)) {
+                ejecucion->noAplica = 1;
+                return 0;
+            }
+            ancho = nuevoAncho;
+            alto = nuevoAlto;
+        }
+    }
+
+    // Una etapa por operación más la reducción inicial a grises
+    ejecucion->etapas = (EtapaFlujo*)calloc((size_t)cadena->numOps + 1, sizeof(EtapaFlujo));
+    if (!ejecucion->etapas) {
+        fprintf(stderr, "Error de memoria al preparar el flujo\n");
+        return 0;
+    }
+    ancho = cabecera->ancho;
+    alto = cabecera->alto;
+    int canales = cabecera->canalesSalida;
+    Operacion grises;
+    memset(&grises, 0, sizeof(grises));
+    grises.tipo = OP_GRISES;
+    if (canalesNecesarios(cadena) == 1 && canales >= 3 && !agregarEtapa(ejecucion, &grises, &ancho, &alto, &canales)) {
+        return 0;
+    }
+    for (int i = 0; i < cadena->numOps; i++) {
+        // gray sobre grises no hace nada (como convertirAGrayscale)
+        if (cadena->ops[i].tipo == OP_GRISES && canales <= 2) continue;
+        if (!agregarEtapa(ejecucion, &cadena->ops[i], &ancho, &alto, &canales)) {
+            fprintf(stderr, "Error al preparar la etapa %d del flujo\n", i + 1);
+            return 0;
+        }
+    }
+
+    if (!iniciarCodificadorPNG(&ejecucion->codificador, ejecucion->rutaSalida, ancho, alto, canales,
+                               ejecucion->perfil)) {
+        return 0;
+    }
+    ejecucion->codificadorAbierto = 1;
+    printf("Flujo: %dx%d (%s) -> %dx%d (%s), %d etapas, %.1f KB de búferes\n", cabecera->ancho,
+           cabecera->alto, nombreFormato(cabecera->canalesSalida), ancho, alto, nombreFormato(canales),
+           ejecucion->numEtapas, ejecucion->bytesBuferes / 1024.0);
+    return 1;
+}
+
+// QUÉ: Callback de fila del decodificador.
+static int alRecibirFilaFlujo(void* contexto, const unsigned char* fila, int y) {
+    (void)y; // Las filas llegan en orden
+    return empujarFila((EjecucionFlujo*)contexto, 0, fila);
+}
+
+// QUÉ: Decodificar, procesar y codificar un PNG por filas.
+// CÓMO: Ver flujo.h.
+// POR QUÉ: Ver flujo.h.
+int ejecutarCadenaEnFlujo(const char* rutaEntrada, const char* rutaSalida, const CadenaOperaciones* cadena,
+                          PerfilPNG perfil) {
+    const char* punto = strrchr(rutaSalida, '.');
+    if (!punto || strcasecmp(punto, ".png") != 0 || !cadenaAdmiteFlujo(cadena)) {
+        return FLUJO_NO_APLICA;
+    }
+
+    EjecucionFlujo ejecucion;
+    memset(&ejecucion, 0, sizeof(ejecucion));
+    ejecucion.cadena = cadena;
+    ejecucion.rutaSalida = rutaSalida;
+    ejecucion.perfil = perfil;
+    if (NUM_HILOS_GLOBAL > 1) {
+        ejecucion.hayPool = crearPool(&ejecucion.pool, NUM_HILOS_GLOBAL, 2 * NUM_HILOS_GLOBAL);
+    }
+
+    int resultado = decodificarPNGPorFilas(rutaEntrada, alRecibirCabeceraFlujo, alRecibirFilaFlujo, &ejecucion);
+    if (ejecucion.hayPool) {
+        destruirPool(&ejecucion.pool);
+    }
+
+    int ok = (resultado == PNG_OK);
+    for (int i = 0; i < ejecucion.numEtapas; i++) {
+        EtapaFlujo* etapa = &ejecucion.etapas[i];
+        // Todas las filas deben haber salido de cada etapa
+        if (etapa->radio > 0 && etapa->emitidas != etapa->alto) ok = 0;
+        if (etapa->reductorListo) liberarReductorArea(&etapa->reductor);
+        liberarKernelGaussiano(&etapa->kernel);
+        free(etapa->anillo);
+        free(etapa->salida);
+    }
+    free(ejecucion.etapas);
+    if (ejecucion.codificadorAbierto) {
+        ok = terminarCodificadorPNG(&ejecucion.codificador) && ok;
+    }
+
+    if (resultado == PNG_NO_SOPORTADO || ejecucion.noAplica) {
+        return FLUJO_NO_APLICA;
+    }
+    if (!ok) {
+        fprintf(stderr, "Error al procesar en flujo: %s\n", rutaEntrada);
+        return FLUJO_ERROR;
+    }
+    return FLUJO_OK;
+}
@@ -0,0 +1,840 @@
+#include "grafo.h"
+#include "guardado.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static const char* NOMBRES_ETAPA[3] = {"puntual", "vecindario", "barrera"};
+
+// QUÉ: ¿Es una operación puntual (cada píxel depende solo de sí mismo)?
+static int esPuntual(const Operacion* op) {
+    return op->tipo == OP_BRILLO || op->tipo == OP_GRISES;
+}
+
+// --- Programas puntuales ---
+
+// QUÉ: Componer "sumar delta con saturación" detrás de una tabla.
+// CÓMO: Si la tabla aún no se usa, parte de la identidad; si el resultado
+// vuelve a ser la identidad (brightness:0, o +10 y -10 sin saturar), la tabla
+// deja de usarse.
+static void componerBrillo(unsigned char* tabla, int* usaTabla, int delta) {
+    int identidad = 1;
+    for (int v = 0; v < 256; v++) {
+        int valor = (*usaTabla ? tabla[v] : v) + delta;
+        tabla[v] = (unsigned char)(valor < 0 ? 0 : (valor > 255 ? 255 : valor));
+        if (tabla[v] != v) identidad = 0;
+    }
+    *usaTabla = !identidad;
+}
+
+// QUÉ: Añadir una operación puntual al final de un programa.
+// CÓMO: El brillo va a la tabla de antes mientras no haya reducción y a la de
+// después en cuanto la hay. De dos reducciones queda la más fuerte: tras gray
+// la imagen tiene 1 o 2 canales y el primero es la luma, así que luma después
+// de gray da lo mismo que luma directamente, con la tabla de después sobre
+// ese canal en ambos casos.
+static void agregarAPrograma(ProgramaPuntual* programa, TipoOperacion tipo, int delta) {
+    if (tipo == OP_BRILLO) {
+        if (programa->reduccion == REDUCIR_NADA) {
+            componerBrillo(programa->tablaAntes, &programa->usaTablaAntes, delta);
+        } else {
+            componerBrillo(programa->tablaDespues, &programa->usaTablaDespues, delta);
+        }
+    } else {
+        ReduccionPuntual reduccion = (tipo == OP_GRISES) ? REDUCIR_GRISES : REDUCIR_LUMA;
+        if (reduccion > programa->reduccion) {
+            programa->reduccion = reduccion;
+        }
+    }
+}
+
+// QUÉ: Canales que deja el programa a partir de una entrada de 'canales'.
+// CÓMO: relleno es el de la imagen de entrada del plan; solo cuenta con 4
+// canales (antes de cualquier reducción), y entonces gray da 1 canal.
+static int canalesTrasPrograma(const ProgramaPuntual* programa, int canales, int relleno) {
+    switch (programa->reduccion) {
+        case REDUCIR_GRISES:
+            return canales == 4 ? (relleno ? 1 : 2) : (canales == 3 ? 1 : canales);
+        case REDUCIR_LUMA:
+            return 1;
+        case REDUCIR_NADA:
+            break;
+    }
+    return canales;
+}
+
+// QUÉ: ¿Cambia algo el programa sobre una entrada de 'canales'?
+static int programaActivo(const ProgramaPuntual* programa, int canales, int relleno) {
+    return programa->usaTablaAntes || programa->usaTablaDespues ||
+           canalesTrasPrograma(programa, canales, relleno) != canales;
+}
+
+// QUÉ: Aplicar una tabla a los canales de color de una fila (el alfa o el
+// relleno se copian).
+// CÓMO: origen y destino pueden ser la misma fila.
+static void aplicarTablaFila(const unsigned char* tabla, const unsigned char* origen, unsigned char* destino,
+                             int ancho, int canales) {
+    if (!tieneAlfa(canales)) {
+        size_t bytes = (size_t)ancho * canales;
+        for (size_t i = 0; i < bytes; i++) {
+            destino[i] = tabla[origen[i]];
+        }
+        return;
+    }
+    int canalesColor = canales - 1;
+    for (int x = 0; x < ancho; x++, origen += canales, destino += canales) {
+        for (int c = 0; c < canalesColor; c++) {
+            destino[c] = tabla[origen[c]];
+        }
+        destino[canalesColor] = origen[canalesColor];
+    }
+}
+
+// QUÉ: Reducir una fila a 'canalesSalida' (1 o 2) con las mismas funciones
+// que convertirAGrayscale y convertirALuma.
+static void reducirFila(const unsigned char* origen, int canales, unsigned char* destino, int canalesSalida,
+                        int ancho) {
+    if (canalesSalida == 2) {
+        filaAGrisesConAlfa(origen, destino, ancho);
+    } else if (canales >= 3) {
+        filaAGrises(origen, canales, destino, ancho);
+    } else {
+        for (int x = 0; x < ancho; x++) {
+            destino[x] = origen[x * canales];
+        }
+    }
+}
+
+// QUÉ: Ejecutar un programa puntual sobre una fila.
+// CÓMO: Sin reducción efectiva, origen y destino pueden ser la misma fila; con
+// ella, 'temporal' (ancho * 4 bytes) guarda la fila tras la primera tabla.
+// Todo ocurre sobre una sola fila, que sigue en caché entre los pasos.
+static void aplicarPrograma(const ProgramaPuntual* programa, const unsigned char* origen, int canales,
+                            int relleno, unsigned char* destino, int ancho, unsigned char* temporal) {
+    int canalesSalida = canalesTrasPrograma(programa, canales, relleno);
+    const unsigned char* fuente = origen;
+    if (canalesSalida == canales) {
+        if (programa->usaTablaAntes) {
+            aplicarTablaFila(programa->tablaAntes, fuente, destino, ancho, canales);
+            fuente = destino;
+        }
+        if (programa->usaTablaDespues) {
+            aplicarTablaFila(programa->tablaDespues, fuente, destino, ancho, canales);
+            fuente = destino;
+        }
+        if (fuente != destino) {
+            memcpy(destino, fuente, (size_t)ancho * canales);
+        }
+        return;
+    }
+    if (programa->usaTablaAntes) {
+        aplicarTablaFila(programa->tablaAntes, fuente, temporal, ancho, canales);
+        fuente = temporal;
+    }
+    reducirFila(fuente, canales, destino, canalesSalida, ancho);
+    if (programa->usaTablaDespues) {
+        aplicarTablaFila(programa->tablaDespues, destino, destino, ancho, canalesSalida);
+    }
+}
+
+// --- Planificación ---
+
+// QUÉ: Añadir una etapa vacía al plan.
+static EtapaGrafo* nuevaEtapa(PlanGrafo* plan, TipoEtapaGrafo tipo, int primeraOp) {
+    EtapaGrafo* etapa = &plan->etapas[plan->numEtapas++];
+    memset(etapa, 0, sizeof(*etapa));
+    etapa->tipo = tipo;
+    etapa->primeraOp = primeraOp;
+    return etapa;
+}
+
+// QUÉ: Construir el plan fusionado (ver grafo.h).
+// CÓMO: 'abierta' es la última etapa de vecindario a la que aún se le pueden
+// añadir operaciones puntuales en su salida; 'pendiente' acumula las que
+// llegan antes del primer vecindario o tras una barrera.
+int planificarCadena(const CadenaOperaciones* cadena, PlanGrafo* plan) {
+    memset(plan, 0, sizeof(*plan));
+    // Como mucho una etapa por operación más la puntual del final
+    plan->ops = (Operacion*)malloc(((size_t)cadena->numOps + 1) * sizeof(Operacion));
+    plan->etapas = (EtapaGrafo*)calloc((size_t)cadena->numOps + 1, sizeof(EtapaGrafo));
+    if (!plan->ops || !plan->etapas) {
+        fprintf(stderr, "Error de memoria al planificar las operaciones\n");
+        liberarPlan(plan);
+        return 0;
+    }
+    if (cadena->numOps > 0) {
+        memcpy(plan->ops, cadena->ops, (size_t)cadena->numOps * sizeof(Operacion));
+    }
+    plan->numOps = cadena->numOps;
+
+    EtapaGrafo* abierta = NULL;
+    ProgramaPuntual pendiente;
+    memset(&pendiente, 0, sizeof(pendiente));
+    int inicioPendiente = 0;
+
+    for (int i = 0; i < cadena->numOps; i++) {
+        const Operacion* op = &cadena->ops[i];
+        if (esPuntual(op)) {
+            ProgramaPuntual* destino = abierta ? &abierta->salida : &pendiente;
+            if (!abierta && pendiente.numOps == 0) inicioPendiente = i;
+            agregarAPrograma(destino, op->tipo, op->entero[0]);
+            destino->numOps++;
+            if (abierta) abierta->numOps++;
+            continue;
+        }
+
+        if (op->tipo == OP_BLUR || op->tipo == OP_SOBEL) {
+            EtapaGrafo* etapa = nuevaEtapa(plan, ETAPA_VECINDARIO, pendiente.numOps ? inicioPendiente : i);
+            etapa->entrada = pendiente;
+            etapa->numOps = pendiente.numOps + 1;
+            etapa->nucleo = *op;
+            memset(&pendiente, 0, sizeof(pendiente));
+            if (op->tipo == OP_BLUR) {
+                if (!crearKernelGaussiano(&etapa->kernel, op->entero[0], op->real)) {
+                    fprintf(stderr, "ERROR: blur inválido (operación %d)\n", i + 1);
+                    liberarPlan(plan);
+                    return 0;
+                }
+                etapa->radio = op->entero[0] / 2;
+            } else {
+                // Sobel calcula sobre la luma, que no es una operación de la cadena
+                agregarAPrograma(&etapa->entrada, OP_SOBEL, 0);
+                etapa->radio = 1;
+            }
+            abierta = etapa;
+            continue;
+        }
+
+        // rotate y scale: cerrar lo que hubiera y ejecutarlos solos
+        if (pendiente.numOps > 0) {
+            EtapaGrafo* etapa = nuevaEtapa(plan, ETAPA_PUNTUAL, inicioPendiente);
+            etapa->entrada = pendiente;
+            etapa->numOps = pendiente.numOps;
+            memset(&pendiente, 0, sizeof(pendiente));
+        }
+        EtapaGrafo* etapa = nuevaEtapa(plan, ETAPA_BARRERA, i);
+        etapa->nucleo = *op;
+        etapa->numOps = 1;
+        abierta = NULL;
+    }
+    if (pendiente.numOps > 0) {
+        EtapaGrafo* etapa = nuevaEtapa(plan, ETAPA_PUNTUAL, inicioPendiente);
+        etapa->entrada = pendiente;
+        etapa->numOps = pendiente.numOps;
+    }
+    return 1;
+}
+
+// --- Ejecución por teselas ---
+
+int ANCHO_TESELA_GRAFO_GLOBAL = 0;
+int ALTO_TESELA_GRAFO_GLOBAL = 0;
+
+// QUÉ: Etapas de vecindario como mucho por grupo; una cadena más larga se
+// parte en varios grupos (cada uno con su pasada).
+#define MAX_ETAPAS_GRUPO 8
+
+// QUÉ: Fin (exclusivo) del grupo de etapas de vecindario seguidas que empieza en 'inicio'.
+static int finDeGrupo(const PlanGrafo* plan, int inicio) {
+    int fin = inicio + 1;
+    while (plan->etapas[inicio].tipo == ETAPA_VECINDARIO && fin < plan->numEtapas &&
+           plan->etapas[fin].tipo == ETAPA_VECINDARIO && fin - inicio < MAX_ETAPAS_GRUPO) {
+        fin++;
+    }
+    return fin;
+}
+
+// QUÉ: Tamaño de la caché L2 en bytes.
+// CÓMO: sysconf y, si no lo sabe (contenedores), sysfs; si tampoco, 512 KB.
+// Se calcula una vez; varios lotes pueden llamarla a la vez.
+static size_t tamCacheL2(void) {
+    static size_t tam = 0;
+    size_t conocido = __atomic_load_n(&tam, __ATOMIC_RELAXED);
+    if (conocido) {
+        return conocido;
+    }
+    long valor = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    conocido = valor > 0 ? (size_t)valor : 0;
+    if (!conocido) {
+        FILE* f = fopen("/sys/devices/system/cpu/cpu0/cache/index2/size", "r");
+        unsigned long kb;
+        if (f) {
+            if (fscanf(f, "%luK", &kb) == 1) conocido = (size_t)kb * 1024;
+            fclose(f);
+        }
+    }
+    if (!conocido) {
+        conocido = 512 * 1024;
+    }
+    __atomic_store_n(&tam, conocido, __ATOMIC_RELAXED);
+    return conocido;
+}
+
+// QUÉ: Forma de un grupo de etapas: canales y halo de cada una.
+// CÓMO: halo[k] son las filas (y columnas) por lado que la salida de la
+// etapa k debe cubrir más allá de la tesela para que las etapas siguientes
+// puedan calcularla: la suma de sus radios. halo[-1] (haloTotal) es lo que
+// se lee de la imagen de entrada.
+typedef struct {
+    int numEtapas;
+    int relleno;                            // La entrada es RGBX
+    int canalesNucleo[MAX_ETAPAS_GRUPO];    // Tras el programa de entrada
+    int canalesSalida[MAX_ETAPAS_GRUPO];    // Tras el programa de salida
+    int halo[MAX_ETAPAS_GRUPO];
+    int haloTotal;
+} FormaGrupo;
+
+static void calcularForma(const EtapaGrafo* etapas, int numEtapas, int canales, int relleno,
+                          FormaGrupo* forma) {
+    forma->numEtapas = numEtapas;
+    forma->relleno = relleno;
+    for (int k = 0; k < numEtapas; k++) {
+        forma->canalesNucleo[k] = canalesTrasPrograma(&etapas[k].entrada, canales, relleno);
+        forma->canalesSalida[k] = canalesTrasPrograma(&etapas[k].salida, forma->canalesNucleo[k], relleno);
+        canales = forma->canalesSalida[k];
+    }
+    int suma = 0;
+    for (int k = numEtapas - 1; k >= 0; k--) {
+        forma->halo[k] = suma;
+        suma += etapas[k].radio;
+    }
+    forma->haloTotal = suma;
+}
+
+static int minimo(int a, int b) {
+    return a < b ? a : b;
+}
+
+// QUÉ: Bytes de los búferes de un hilo para teselas de tw x th.
+// CÓMO: Por etapa, las filas de entrada que necesita (tesela + 2 halos) por
+// el ancho de la ventana; más las tres filas de trabajo.
+static size_t bytesBuferesGrupo(const FormaGrupo* forma, int ancho, int alto, int tw, int th) {
+    int anchoVentana = minimo(ancho, tw + 2 * forma->haloTotal);
+    size_t bytes = (size_t)3 * anchoVentana * 4;
+    for (int k = 0; k < forma->numEtapas; k++) {
+        int haloEntrada = k == 0 ? forma->haloTotal : forma->halo[k - 1];
+        bytes += (size_t)minimo(alto, th + 2 * haloEntrada) * anchoVentana * forma->canalesNucleo[k];
+    }
+    return bytes;
+}
+
+// QUÉ: Elegir la tesela (ver grafo.h).
+// CÓMO: repetido = píxeles que calculan las etapas por píxel de salida (1.0
+// sin halo); es lo que cuesta la recomputación de los bordes.
+void elegirTeselaGrafo(const EtapaGrafo* etapas, int numEtapas, int ancho, int alto, int canales, int relleno,
+                       int hilos, int* anchoTesela, int* altoTesela) {
+    if (ANCHO_TESELA_GRAFO_GLOBAL > 0 && ALTO_TESELA_GRAFO_GLOBAL > 0) {
+        *anchoTesela = minimo(ANCHO_TESELA_GRAFO_GLOBAL, ancho);
+        *altoTesela = minimo(ALTO_TESELA_GRAFO_GLOBAL, alto);
+        return;
+    }
+    static const int anchos[] = {0, 1024, 512, 256, 128, 64}; // 0 = la imagen entera
+    static const int altos[] = {8, 16, 32, 64, 128, 256};
+    FormaGrupo forma;
+    calcularForma(etapas, numEtapas, canales, relleno, &forma);
+    size_t presupuesto = tamCacheL2() / 2;
+
+    double mejorRepetido = 0.0;
+    size_t menorMemoria = 0;
+    int mejorClase = -1; // 2 = cabe y reparte bien, 1 = cabe, 0 = no cabe
+    *anchoTesela = ancho;
+    *altoTesela = minimo(FILAS_TESELA_GRAFO, alto);
+    for (size_t i = 0; i < sizeof(anchos) / sizeof(anchos[0]); i++) {
+        int tw = anchos[i] == 0 ? ancho : anchos[i];
+        if (i > 0 && tw >= ancho) continue;
+        for (size_t j = 0; j < sizeof(altos) / sizeof(altos[0]); j++) {
+            int th = minimo(altos[j], alto);
+            if (j > 0 && altos[j - 1] >= alto) break;
+            size_t memoria = bytesBuferesGrupo(&forma, ancho, alto, tw, th);
+            long teselas = (long)((ancho + tw - 1) / tw) * ((alto + th - 1) / th);
+            int clase = memoria > presupuesto ? 0 : (teselas >= 4L * hilos ? 2 : 1);
+            double calculado = 0.0;
+            int anchoVentana = minimo(ancho, tw + 2 * forma.haloTotal);
+            for (int k = 0; k < numEtapas; k++) {
+                calculado += (double)minimo(alto, th + 2 * forma.halo[k]) * anchoVentana;
+            }
+            double repetido = calculado / ((double)tw * th * numEtapas);
+            int mejor = clase > mejorClase ||
+                        (clase == mejorClase && (clase > 0 ? repetido < mejorRepetido : memoria < menorMemoria));
+            if (mejor) {
+                mejorClase = clase;
+                mejorRepetido = repetido;
+                menorMemoria = memoria;
+                *anchoTesela = tw;
+                *altoTesela = th;
+            }
+        }
+    }
+}
+
+// QUÉ: Trabajo de una etapa puntual, compartido por las tareas del pool.
+typedef struct {
+    const EtapaGrafo* etapa;
+    const ImagenInfo* origen;
+    ImagenInfo* destino;            // Puede ser el origen (sin cambio de canales)
+    int numFranjas;
+    int siguiente;
+    int errores;
+} TrabajoPuntual;
+
+// QUÉ: Tarea del pool: aplicar el programa a franjas de filas hasta que no queden.
+static void procesarFranjasTarea(void* arg) {
+    TrabajoPuntual* trabajo = (TrabajoPuntual*)arg;
+    const ImagenInfo* origen = trabajo->origen;
+    int ancho = origen->ancho, alto = origen->alto;
+    unsigned char* temporal = (unsigned char*)malloc((size_t)ancho * 4);
+    if (!temporal) {
+        fprintf(stderr, "Error de memoria en los búferes de las teselas\n");
+        __atomic_fetch_add(&trabajo->errores, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    while (1) {
+        int indice = __atomic_fetch_add(&trabajo->siguiente, 1, __ATOMIC_RELAXED);
+        if (indice >= trabajo->numFranjas) {
+            break;
+        }
+        int y0 = indice * FILAS_TESELA_GRAFO;
+        int y1 = minimo(y0 + FILAS_TESELA_GRAFO, alto);
+        for (int y = y0; y < y1; y++) {
+            aplicarPrograma(&trabajo->etapa->entrada, origen->pixeles[y][0], origen->canales, origen->relleno,
+                            trabajo->destino->pixeles[y][0], ancho, temporal);
+        }
+    }
+    free(temporal);
+}
+
+// QUÉ: Trabajo de un grupo de etapas de vecindario, compartido por las
+// tareas del pool.
+typedef struct {
+    const EtapaGrafo* etapas;
+    FormaGrupo forma;
+    const ImagenInfo* origen;
+    ImagenInfo* destino;
+    int anchoTesela, altoTesela;
+    int teselasPorFila;
+    int numTeselas;
+    int siguiente;
+    int errores;
+} TrabajoGrupo;
+
+// QUÉ: Búferes de una tarea, reservados una vez para la tesela más grande.
+// CÓMO: entrada[k] guarda las filas de entrada de la etapa k (ya con su
+// programa de entrada) en la ventana de la tesela; entrada[0] solo existe
+// si el programa de entrada de la primera etapa hace algo (si no, se lee de
+// la imagen).
+typedef struct {
+    unsigned char* entrada[MAX_ETAPAS_GRUPO];
+    unsigned char* filaNucleo;
+    unsigned char* filaIntermedia;
+    unsigned char* temporal;
+} BuferesGrupo;
+
+// QUÉ: Calcular una tesela de salida con todas las etapas del grupo.
+// CÓMO: La ventana de columnas es la tesela ampliada con el halo total
+// (recortada a la imagen) y todas las etapas la calculan entera: los
+// núcleos replican el borde de la fila que reciben, así que las columnas
+// junto a un borde de ventana interior salen mal, pero el error avanza como
+// mucho un radio por etapa y nunca llega a la tesela. En vertical cada etapa
+// calcula solo las filas que necesitan las siguientes (tesela + halo[k]),
+// replicando los bordes de la imagen igual que el filtro completo.
+static void calcularTeselaGrupo(const TrabajoGrupo* trabajo, int indice, BuferesGrupo* b) {
+    const FormaGrupo* forma = &trabajo->forma;
+    const ImagenInfo* origen = trabajo->origen;
+    int ancho = origen->ancho, alto = origen->alto;
+    int x0 = (indice % trabajo->teselasPorFila) * trabajo->anchoTesela;
+    int y0 = (indice / trabajo->teselasPorFila) * trabajo->altoTesela;
+    int x1 = minimo(x0 + trabajo->anchoTesela, ancho);
+    int y1 = minimo(y0 + trabajo->altoTesela, alto);
+    int vx0 = x0 - forma->haloTotal < 0 ? 0 : x0 - forma->haloTotal;
+    int vx1 = minimo(x1 + forma->haloTotal, ancho);
+    int anchoVentana = vx1 - vx0;
+
+    // Filas de entrada de la etapa actual: [primera, primera + numFilas)
+    int primera = y0 - forma->haloTotal < 0 ? 0 : y0 - forma->haloTotal;
+    int fin = minimo(y1 + forma->haloTotal, alto);
+    const EtapaGrafo* etapa0 = &trabajo->etapas[0];
+    int relleno = forma->relleno;
+    int leerImagen = !programaActivo(&etapa0->entrada, origen->canales, relleno);
+    if (!leerImagen) {
+        size_t bytesFila = (size_t)anchoVentana * forma->canalesNucleo[0];
+        for (int y = primera; y < fin; y++) {
+            aplicarPrograma(&etapa0->entrada, origen->pixeles[y][vx0], origen->canales, relleno,
+                            b->entrada[0] + (size_t)(y - primera) * bytesFila, anchoVentana, b->temporal);
+        }
+    }
+
+    const unsigned char* filas[15];
+    for (int k = 0; k < forma->numEtapas; k++) {
+        const EtapaGrafo* etapa = &trabajo->etapas[k];
+        int canales = forma->canalesNucleo[k];
+        size_t bytesFila = (size_t)anchoVentana * canales;
+        int ultima = (k == forma->numEtapas - 1);
+        int salidaActiva = programaActivo(&etapa->salida, canales, relleno);
+        int siguienteActiva = !ultima &&
+                              programaActivo(&trabajo->etapas[k + 1].entrada, forma->canalesSalida[k], relleno);
+        size_t bytesFilaSiguiente = ultima ? 0 : (size_t)anchoVentana * forma->canalesNucleo[k + 1];
+        int s0 = y0 - forma->halo[k] < 0 ? 0 : y0 - forma->halo[k];
+        int s1 = minimo(y1 + forma->halo[k], alto);
+
+        for (int y = s0; y < s1; y++) {
+            int tam = 2 * etapa->radio + 1;
+            for (int j = 0; j < tam; j++) {
+                int iy = y + j - etapa->radio;
+                if (iy < 0) iy = 0;
+                if (iy >= alto) iy = alto - 1;
+                filas[j] = (k == 0 && leerImagen) ? origen->pixeles[iy][vx0]
+                                                  : b->entrada[k] + (size_t)(iy - primera) * bytesFila;
+            }
+            // El núcleo escribe directamente en su destino si no hay nada más que hacer con la fila
+            unsigned char* destinoFila;
+            unsigned char* salidaNucleo = b->filaNucleo;
+            if (ultima) {
+                destinoFila = trabajo->destino->pixeles[y][x0];
+                if (!salidaActiva && vx0 == x0 && vx1 == x1) salidaNucleo = destinoFila;
+            } else {
+                destinoFila = b->entrada[k + 1] + (size_t)(y - s0) * bytesFilaSiguiente;
+                if (!salidaActiva && !siguienteActiva) salidaNucleo = destinoFila;
+            }
+            if (etapa->nucleo.tipo == OP_BLUR) {
+                convolucionarFilaGaussiana(&etapa->kernel, filas, anchoVentana, canales, salidaNucleo);
+            } else {
+                sobelFila(filas, anchoVentana, salidaNucleo);
+            }
+            if (salidaNucleo == destinoFila) {
+                continue;
+            }
+            if (ultima) {
+                aplicarPrograma(&etapa->salida, b->filaNucleo + (size_t)(x0 - vx0) * canales, canales, relleno,
+                                destinoFila, x1 - x0, b->temporal);
+            } else if (!siguienteActiva) {
+                aplicarPrograma(&etapa->salida, b->filaNucleo, canales, relleno, destinoFila, anchoVentana,
+                                b->temporal);
+            } else {
+                const unsigned char* fuente = b->filaNucleo;
+                if (salidaActiva) {
+                    aplicarPrograma(&etapa->salida, b->filaNucleo, canales, relleno, b->filaIntermedia,
+                                    anchoVentana, b->temporal);
+                    fuente = b->filaIntermedia;
+                }
+                aplicarPrograma(&trabajo->etapas[k + 1].entrada, fuente, forma->canalesSalida[k], relleno,
+                                destinoFila, anchoVentana, b->temporal);
+            }
+        }
+        primera = s0;
+    }
+}
+
+// QUÉ: Tarea del pool: calcular teselas del grupo hasta que no queden.
+// CÓMO: Los búferes se reservan una vez por tarea (ver bytesBuferesGrupo).
+static void procesarGrupoTarea(void* arg) {
+    TrabajoGrupo* trabajo = (TrabajoGrupo*)arg;
+    const FormaGrupo* forma = &trabajo->forma;
+    int ancho = trabajo->origen->ancho, alto = trabajo->origen->alto;
+    int anchoVentana = minimo(ancho, trabajo->anchoTesela + 2 * forma->haloTotal);
+
+    BuferesGrupo b;
+    memset(&b, 0, sizeof(b));
+    b.filaNucleo = (unsigned char*)malloc((size_t)anchoVentana * 4);
+    b.filaIntermedia = (unsigned char*)malloc((size_t)anchoVentana * 4);
+    b.temporal = (unsigned char*)malloc((size_t)anchoVentana * 4);
+    int memoriaOk = b.filaNucleo && b.filaIntermedia && b.temporal;
+    for (int k = 0; k < forma->numEtapas && memoriaOk; k++) {
+        if (k == 0 && !programaActivo(&trabajo->etapas[0].entrada, trabajo->origen->canales, forma->relleno)) {
+            continue;
+        }
+        int haloEntrada = k == 0 ? forma->haloTotal : forma->halo[k - 1];
+        b.entrada[k] = (unsigned char*)malloc((size_t)minimo(alto, trabajo->altoTesela + 2 * haloEntrada) *
+                                              anchoVentana * forma->canalesNucleo[k]);
+        memoriaOk = b.entrada[k] != NULL;
+    }
+    if (!memoriaOk) {
+        fprintf(stderr, "Error de memoria en los búferes de las teselas\n");
+        __atomic_fetch_add(&trabajo->errores, 1, __ATOMIC_RELAXED);
+    }
+
+    while (memoriaOk) {
+        int indice = __atomic_fetch_add(&trabajo->siguiente, 1, __ATOMIC_RELAXED);
+        if (indice >= trabajo->numTeselas) {
+            break;
+        }
+        calcularTeselaGrupo(trabajo, indice, &b);
+    }
+    for (int k = 0; k < forma->numEtapas; k++) {
+        free(b.entrada[k]);
+    }
+    free(b.filaNucleo);
+    free(b.filaIntermedia);
+    free(b.temporal);
+}
+
+// QUÉ: Repartir un trabajo entre las tareas del pool (o hacerlo en este
+// hilo si no hay pool o solo hay una parte).
+static void repartirTrabajo(void (*tarea)(void*), void* trabajo, int* errores, int partes, PoolHilos* pool) {
+    if (partes > 1 && pool) {
+        GrupoTareas grupo;
+        iniciarGrupo(&grupo);
+        for (int i = 0; i < partes; i++) {
+            if (!enviarTarea(pool, tarea, trabajo, &grupo)) {
+                __atomic_fetch_add(errores, 1, __ATOMIC_RELAXED);
+                break;
+            }
+        }
+        esperarGrupo(&grupo);
+        destruirGrupo(&grupo);
+    } else {
+        tarea(trabajo);
+    }
+}
+
+// QUÉ: Ejecutar una etapa puntual sobre la imagen.
+// CÓMO: Si no cambian los canales y nadie más comparte el bloque escribe en
+// la propia imagen; si no, en una imagen nueva que la sustituye (así el plan
+// nunca escribe en una imagen compartida, ver compartirImagen).
+static int ejecutarEtapaPuntual(ImagenInfo* imagen, const EtapaGrafo* etapa, PoolHilos* pool) {
+    if (!programaActivo(&etapa->entrada, imagen->canales, imagen->relleno)) {
+        return 1; // p. ej. gray sobre una imagen que ya es gris
+    }
+    int canalesSalida = canalesTrasPrograma(&etapa->entrada, imagen->canales, imagen->relleno);
+    ImagenInfo nueva = {0, 0, 0, 0, 0, NULL};
+    int enSuSitio = (canalesSalida == imagen->canales && referenciasImagen(imagen) == 1);
+    if (!enSuSitio && !crearImagenFormato(&nueva, imagen->ancho, imagen->alto, canalesSalida, 8,
+                                          canalesSalida == 4 && imagen->relleno)) {
+        fprintf(stderr, "Error de memoria al asignar la imagen de la etapa\n");
+        return 0;
+    }
+
+    TrabajoPuntual trabajo;
+    trabajo.etapa = etapa;
+    trabajo.origen = imagen;
+    trabajo.destino = enSuSitio ? imagen : &nueva;
+    trabajo.numFranjas = (imagen->alto + FILAS_TESELA_GRAFO - 1) / FILAS_TESELA_GRAFO;
+    trabajo.siguiente = 0;
+    trabajo.errores = 0;
+    repartirTrabajo(procesarFranjasTarea, &trabajo, &trabajo.errores,
+                    minimo(pool ? pool->numHilos : 1, trabajo.numFranjas), pool);
+
+    if (trabajo.errores > 0) {
+        if (!enSuSitio) liberarImagen(&nueva);
+        return 0;
+    }
+    if (!enSuSitio) {
+        liberarImagen(imagen);
+        *imagen = nueva;
+    }
+    return 1;
+}
+
+// QUÉ: Ejecutar un grupo de etapas de vecindario en una pasada por teselas.
+// CÓMO: Elige la tesela (elegirTeselaGrafo), reparte las teselas entre las
+// tareas del pool y sustituye la imagen por la salida de la última etapa.
+// 'descripcion' recibe la tesela elegida para el informe de la pasada.
+static int ejecutarGrupoPorTeselas(ImagenInfo* imagen, const EtapaGrafo* etapas, int numEtapas, PoolHilos* pool,
+                                   char* descripcion, size_t tam) {
+    TrabajoGrupo trabajo;
+    trabajo.etapas = etapas;
+    calcularForma(etapas, numEtapas, imagen->canales, imagen->relleno, &trabajo.forma);
+    int hilos = pool ? pool->numHilos : 1;
+    elegirTeselaGrafo(etapas, numEtapas, imagen->ancho, imagen->alto, imagen->canales, imagen->relleno, hilos,
+                      &trabajo.anchoTesela, &trabajo.altoTesela);
+    trabajo.teselasPorFila = (imagen->ancho + trabajo.anchoTesela - 1) / trabajo.anchoTesela;
+    trabajo.numTeselas = trabajo.teselasPorFila * ((imagen->alto + trabajo.altoTesela - 1) / trabajo.altoTesela);
+    trabajo.siguiente = 0;
+    trabajo.errores = 0;
+    int partes = minimo(hilos, trabajo.numTeselas);
+    snprintf(descripcion, tam, ", teselas %dx%d con halo %d, %d hilo(s)", trabajo.anchoTesela,
+             trabajo.altoTesela, trabajo.forma.haloTotal, partes);
+
+    ImagenInfo nueva = {0, 0, 0, 0, 0, NULL};
+    int canalesSalida = trabajo.forma.canalesSalida[numEtapas - 1];
+    if (!crearImagenFormato(&nueva, imagen->ancho, imagen->alto, canalesSalida, 8,
+                            canalesSalida == 4 && imagen->relleno)) {
+        fprintf(stderr, "Error de memoria al asignar la imagen de la etapa\n");
+        return 0;
+    }
+    trabajo.origen = imagen;
+    trabajo.destino = &nueva;
+    repartirTrabajo(procesarGrupoTarea, &trabajo, &trabajo.errores, partes, pool);
+
+    if (trabajo.errores > 0) {
+        liberarImagen(&nueva);
+        return 0;
+    }
+    liberarImagen(imagen);
+    *imagen = nueva;
+    return 1;
+}
+
+// QUÉ: Ejecutar las operaciones de una pasada una a una, sin fusionarlas.
+// CÓMO: Llama a aplicarOperacion con cada operación que cubren las etapas;
+// antes de una que escribe en su sitio pide una copia privada si la imagen
+// está compartida, igual que ejecutarEtapaPuntual.
+// POR QUÉ: Las tablas de brillo (256 entradas) y los búferes de las teselas
+// son de 8 bits; una imagen de 16 bits pasa por los filtros de imagen
+// completa, que sí conservan su profundidad.
+static int ejecutarSinFusion(ImagenInfo* imagen, const PlanGrafo* plan, const EtapaGrafo* etapas, int numEtapas) {
+    int primera = etapas[0].primeraOp;
+    int ultima = etapas[numEtapas - 1].primeraOp + etapas[numEtapas - 1].numOps;
+    for (int i = primera; i < ultima; i++) {
+        const Operacion* op = &plan->ops[i];
+        if (operacionEnSuSitio(op, imagen->canales) && !prepararModificacion(imagen)) {
+            return 0;
+        }
+        if (!aplicarOperacion(imagen, op)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Ejecutar el plan sobre la imagen (ver grafo.h).
+int ejecutarPlan(ImagenInfo* imagen, const PlanGrafo* plan) {
+    if (!imagenCargada(imagen)) {
+        return 0;
+    }
+    int hayTeselas = 0, numPasadas = 0;
+    for (int i = 0; i < plan->numEtapas; i = finDeGrupo(plan, i)) {
+        if (plan->etapas[i].tipo != ETAPA_BARRERA) hayTeselas = 1;
+        numPasadas++;
+    }
+    PoolHilos pool;
+    int hayPool = 0;
+    if (hayTeselas && NUM_HILOS_GLOBAL > 1) {
+        hayPool = crearPool(&pool, NUM_HILOS_GLOBAL, NUM_HILOS_GLOBAL);
+    }
+
+    int ok = 1, pasada = 0;
+    for (int i = 0; i < plan->numEtapas && ok; i = finDeGrupo(plan, i)) {
+        const EtapaGrafo* etapa = &plan->etapas[i];
+        int numEtapas = finDeGrupo(plan, i) - i;
+        int numOps = 0;
+        for (int k = 0; k < numEtapas; k++) numOps += etapa[k].numOps;
+        char detalle[128] = "";
+        struct timeval inicio, fin;
+        gettimeofday(&inicio, NULL);
+        if (etapa->tipo == ETAPA_BARRERA) {
+            ok = aplicarOperacion(imagen, &etapa->nucleo);
+        } else if (bytesMuestra(imagen) == 2) {
+            snprintf(detalle, sizeof(detalle), ", sin fusionar: 16 bits");
+            ok = ejecutarSinFusion(imagen, plan, etapa, numEtapas);
+        } else if (etapa->tipo == ETAPA_PUNTUAL) {
+            ok = ejecutarEtapaPuntual(imagen, etapa, hayPool ? &pool : NULL);
+        } else {
+            ok = ejecutarGrupoPorTeselas(imagen, etapa, numEtapas, hayPool ? &pool : NULL, detalle, sizeof(detalle));
+        }
+        gettimeofday(&fin, NULL);
+        printf("  Pasada %d/%d (%s, %d operaciones%s): %.4f seg, %dx%d %s\n", ++pasada, numPasadas,
+               NOMBRES_ETAPA[etapa->tipo], numOps, detalle, obtenerTiempoReal(inicio, fin), imagen->ancho,
+               imagen->alto, nombreFormatoImagen(imagen));
+    }
+    if (hayPool) {
+        destruirPool(&pool);
+    }
+    return ok;
+}
+
+// --- Explicación ---
+
+// QUÉ: Describir la forma compilada de un programa ("tabla -> grises -> tabla").
+static void describirPrograma(const ProgramaPuntual* programa, char* salida, size_t tam) {
+    static const char* reducciones[3] = {"", "grises", "luma"};
+    salida[0] = 0;
+    size_t usado = 0;
+    const char* partes[3] = {programa->usaTablaAntes ? "tabla de 256" : NULL,
+                             programa->reduccion ? reducciones[programa->reduccion] : NULL,
+                             programa->usaTablaDespues ? "tabla de 256" : NULL};
+    for (int i = 0; i < 3 && usado < tam; i++) {
+        if (!partes[i]) continue;
+        int n = snprintf(salida + usado, tam - usado, "%s%s", usado ? " -> " : "", partes[i]);
+        if (n < 0) break;
+        usado += (size_t)n;
+    }
+    if (usado == 0) {
+        snprintf(salida, tam, "sin efecto");
+    }
+}
+
+// QUÉ: Imprimir el plan (ver grafo.h).
+// CÓMO: Una pasada por grupo; dentro de un grupo de vecindario, cada etapa
+// con su halo (lo que calcula de más por lado para las siguientes).
+void explicarPlan(const PlanGrafo* plan) {
+    int pasadasSinFusion = 0, numPasadas = 0;
+    for (int i = 0; i < plan->numOps; i++) {
+        // Sobel sobre color hace además una pasada de luma
+        pasadasSinFusion += (plan->ops[i].tipo == OP_SOBEL) ? 2 : 1;
+    }
+    for (int i = 0; i < plan->numEtapas; i = finDeGrupo(plan, i)) {
+        numPasadas++;
+    }
+    printf("Plan fusionado: %d operaciones en %d pasadas (sin fusionar: hasta %d)\n", plan->numOps, numPasadas,
+           pasadasSinFusion);
+    int pasada = 0;
+    for (int i = 0; i < plan->numEtapas; i = finDeGrupo(plan, i)) {
+        const EtapaGrafo* etapa = &plan->etapas[i];
+        int numEtapas = finDeGrupo(plan, i) - i;
+        char texto[512];
+        CadenaOperaciones tramo = {plan->ops + etapa->primeraOp, 0};
+        for (int k = 0; k < numEtapas; k++) tramo.numOps += etapa[k].numOps;
+        describirCadena(&tramo, texto, sizeof(texto));
+        printf("  Pasada %d (%s): %s\n", ++pasada, NOMBRES_ETAPA[etapa->tipo], texto);
+        if (etapa->tipo == ETAPA_PUNTUAL) {
+            describirPrograma(&etapa->entrada, texto, sizeof(texto));
+            printf("      por fila:  %s\n", texto);
+            continue;
+        }
+        if (etapa->tipo == ETAPA_BARRERA) {
+            printf("      imagen completa (mueve píxeles entre filas lejanas)\n");
+            continue;
+        }
+        int haloTotal = 0;
+        for (int k = 0; k < numEtapas; k++) haloTotal += etapa[k].radio;
+        if (ANCHO_TESELA_GRAFO_GLOBAL > 0 && ALTO_TESELA_GRAFO_GLOBAL > 0) {
+            printf("      teselas:   %dx%d, halo de %d píxel(es) por lado\n", ANCHO_TESELA_GRAFO_GLOBAL,
+                   ALTO_TESELA_GRAFO_GLOBAL, haloTotal);
+        } else {
+            printf("      teselas:   automáticas (L2 de %zu KB), halo de %d píxel(es) por lado\n",
+                   tamCacheL2() / 1024, haloTotal);
+        }
+        int haloRestante = haloTotal;
+        for (int k = 0; k < numEtapas; k++) {
+            const EtapaGrafo* actual = &etapa[k];
+            haloRestante -= actual->radio;
+            if (numEtapas > 1) {
+                printf("      etapa %d%s\n", k + 1,
+                       haloRestante > 0 ? "" : " (escribe la tesela)");
+            }
+            if (actual->entrada.usaTablaAntes || actual->entrada.usaTablaDespues || actual->entrada.reduccion) {
+                describirPrograma(&actual->entrada, texto, sizeof(texto));
+                printf("      entrada:   %s\n", texto);
+            }
+            if (actual->nucleo.tipo == OP_BLUR) {
+                printf("      núcleo:    blur %dx%d, sigma %g", actual->kernel.tam, actual->kernel.tam,
+                       actual->nucleo.real);
+            } else {
+                printf("      núcleo:    sobel 3x3");
+            }
+            if (haloRestante > 0) {
+                printf(" (recalcula %d píxel(es) de halo por lado)", haloRestante);
+            }
+            printf("\n");
+            if (actual->salida.numOps > 0) {
+                describirPrograma(&actual->salida, texto, sizeof(texto));
+                printf("      salida:    %s\n", texto);
+            }
+        }
+    }
+}
+
+// QUÉ: Liberar el plan.
+void liberarPlan(PlanGrafo* plan) {
+    if (plan->etapas) {
+        for (int i = 0; i < plan->numEtapas; i++) {
+            liberarKernelGaussiano(&plan->etapas[i].kernel);
+        }
+    }
+    free(plan->etapas);
+    free(plan->ops);
+    memset(plan, 0, sizeof(*plan));
+}
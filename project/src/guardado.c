@@ -0,0 +1,161 @@
+#include "guardado.h"
+#include "image_io.h"
+#include "png_encoder.h"
+#include "threading.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// QUÉ: Trabajos que pueden esperar en la cola antes de que guardar bloquee.
+#define CAPACIDAD_GUARDADOS 8
+
+// QUÉ: Un guardado encolado.
+// CÓMO: imagen comparte el bloque de la del menú (compartirImagen); la
+// referencia se suelta al terminar de escribir.
+typedef struct {
+    ImagenInfo imagen;
+    char* ruta;
+    PerfilPNG perfil;
+} TrabajoGuardado;
+
+// QUÉ: Estado del módulo, protegido por mutex.
+// CÓMO: El hilo de guardado solo toca los campos de estado.
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static PoolHilos pool;
+static int poolCreado = 0;
+static int pendientes = 0;
+static int terminados = 0;
+static char rutaEnCurso[512];
+static char ultimaRuta[512];
+static int ultimoOk = 0;
+static double ultimosSegundos = 0.0;
+
+// QUÉ: Tarea del hilo de guardado: codificar, escribir y anotar el resultado.
+static void tareaGuardar(void* arg) {
+    TrabajoGuardado* trabajo = (TrabajoGuardado*)arg;
+    pthread_mutex_lock(&mutex);
+    snprintf(rutaEnCurso, sizeof(rutaEnCurso), "%s", trabajo->ruta);
+    pthread_mutex_unlock(&mutex);
+
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+    int ok = guardarImagenConPerfil(&trabajo->imagen, trabajo->ruta, trabajo->perfil);
+    gettimeofday(&fin, NULL);
+
+    pthread_mutex_lock(&mutex);
+    pendientes--;
+    terminados++;
+    rutaEnCurso[0] = 0;
+    snprintf(ultimaRuta, sizeof(ultimaRuta), "%s", trabajo->ruta);
+    ultimoOk = ok;
+    ultimosSegundos = obtenerTiempoReal(inicio, fin);
+    pthread_mutex_unlock(&mutex);
+
+    liberarImagen(&trabajo->imagen); // Si el menú ya no la usa, se libera aquí
+    free(trabajo->ruta);
+    free(trabajo);
+}
+
+// QUÉ: Encolar el guardado de la imagen actual (ver guardado.h).
+// CÓMO: El trabajo comparte el bloque de la imagen del menú (una referencia
+// más por guardado).
+// POR QUÉ: Guardar no copia píxeles: la copia solo se hace si el menú
+// modifica la imagen antes de que terminen los guardados.
+int guardarEnSegundoPlano(const ImagenInfo* imagen, const char* ruta) {
+    if (!imagenCargada(imagen)) {
+        fprintf(stderr, "No hay imagen para guardar.\n");
+        return 0;
+    }
+    if (!poolCreado) {
+        if (!crearPool(&pool, 1, CAPACIDAD_GUARDADOS)) {
+            fprintf(stderr, "Error: no se pudo crear el hilo de guardado\n");
+            return 0;
+        }
+        poolCreado = 1;
+    }
+    TrabajoGuardado* trabajo = (TrabajoGuardado*)malloc(sizeof(TrabajoGuardado));
+    char* copiaRuta = strdup(ruta);
+    if (!trabajo || !copiaRuta) {
+        fprintf(stderr, "Error: sin memoria para el guardado\n");
+        free(trabajo);
+        free(copiaRuta);
+        return 0;
+    }
+
+    pthread_mutex_lock(&mutex);
+    pendientes++;
+    pthread_mutex_unlock(&mutex);
+
+    PerfilPNG perfil = PERFIL_PNG_GLOBAL;
+    compartirImagen(imagen, &trabajo->imagen);
+    trabajo->ruta = copiaRuta;
+    trabajo->perfil = perfil;
+    // Puede esperar si la cola está llena; el pool no se cierra fuera de
+    // esperarGuardados, que también corre en este hilo. Desde aquí el trabajo
+    // es del hilo de guardado.
+    enviarTarea(&pool, tareaGuardar, trabajo, NULL);
+    printf("Guardando en segundo plano: %s (perfil PNG %s)\n", ruta, nombrePerfilPNG(perfil));
+    return 1;
+}
+
+// QUÉ: Copia en escritura de la imagen del menú (ver guardado.h).
+// CÓMO: Mientras el bloque está compartido nadie escribe en él, así que se
+// copia sin bloquear a los guardados; después el menú suelta su referencia.
+// Si entretanto los demás soltaron las suyas, la copia sobraba, pero es
+// correcta.
+int prepararModificacion(ImagenInfo* imagen) {
+    if (referenciasImagen(imagen) <= 1) {
+        return 1;
+    }
+    ImagenInfo copia = {0, 0, 0, 0, 0, NULL};
+    if (!crearImagenComo(&copia, imagen, imagen->ancho, imagen->alto)) {
+        fprintf(stderr, "Error: sin memoria para copiar la imagen mientras se guarda\n");
+        return 0;
+    }
+    memcpy(copia.pixeles[0][0], imagen->pixeles[0][0],
+           (size_t)imagen->ancho * imagen->alto * bytesPixel(imagen));
+    liberarImagen(imagen);
+    *imagen = copia;
+    return 1;
+}
+
+// QUÉ: Soltar la imagen del menú (ver guardado.h).
+void soltarImagen(ImagenInfo* imagen) {
+    liberarImagen(imagen);
+}
+
+// QUÉ: Esperar los guardados pendientes (ver guardado.h).
+// CÓMO: destruirPool procesa las tareas en cola antes de unir el hilo.
+void esperarGuardados(void) {
+    if (!poolCreado) {
+        return;
+    }
+    pthread_mutex_lock(&mutex);
+    int enCola = pendientes;
+    pthread_mutex_unlock(&mutex);
+    if (enCola > 0) {
+        printf("Esperando %d guardado(s) en segundo plano...\n", enCola);
+        fflush(stdout);
+    }
+    destruirPool(&pool);
+    poolCreado = 0;
+}
+
+// QUÉ: Línea de estado para el menú (ver guardado.h).
+void imprimirEstadoGuardados(void) {
+    pthread_mutex_lock(&mutex);
+    if (pendientes > 0) {
+        printf("  ⏳ Guardando en segundo plano: %d pendiente(s)%s%s\n", pendientes,
+               rutaEnCurso[0] ? ", en curso " : "", rutaEnCurso);
+    }
+    if (terminados > 0) {
+        if (ultimoOk) {
+            printf("  ✓ Último guardado: %s (%.2f s)\n", ultimaRuta, ultimosSegundos);
+        } else {
+            printf("  ❌ Falló el último guardado: %s\n", ultimaRuta);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+}
@@ -0,0 +1,595 @@
+#include "historial.h"
+#include "guardado.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// QUÉ: Imagen completa adoptada por el historial.
+// CÓMO: imagen es una referencia más al bloque de la imagen del menú
+// (compartirImagen); teselas cuenta las teselas que lo miran y, al llegar a
+// cero, se suelta la referencia. Los bloques vivos forman una lista.
+typedef struct BloqueHistorial {
+    ImagenInfo imagen;
+    int teselas;
+    struct BloqueHistorial* siguiente;
+} BloqueHistorial;
+
+// QUÉ: Tesela inmutable con contador de referencias.
+// CÓMO: O bien mira su trozo de un bloque adoptado (bloque != NULL, filas
+// separadas por paso bytes), o bien guarda sus filas seguidas en datos
+// propios. Las del borde derecho e inferior son más pequeñas. referencias
+// cuenta las versiones que la usan.
+typedef struct {
+    int referencias;
+    int ancho;
+    int alto;
+    size_t paso;
+    unsigned char* datos;
+    BloqueHistorial* bloque;
+} TeselaHistorial;
+
+// QUÉ: Una versión: dimensiones, formato de píxel, rejilla de teselas y qué
+// la produjo.
+typedef struct {
+    int ancho, alto, canales, profundidad, relleno;
+    int columnas, filas;
+    TeselaHistorial** teselas;     // columnas * filas, por filas
+    int nuevas;                    // Teselas creadas al registrarla
+    int adoptada;                  // 1 si las nuevas miran la imagen sin copiarla
+    char descripcion[96];
+} Version;
+
+// QUÉ: Estado del módulo. versiones[actual] es igual a la imagen del menú;
+// las posteriores son las que se pueden rehacer.
+static Version* versiones[MAX_VERSIONES_HISTORIAL];
+static int numVersiones = 0;
+static int actual = -1;
+static BloqueHistorial* bloques = NULL;
+
+// QUÉ: Bytes de los píxeles de una tesela.
+static size_t bytesTesela(const TeselaHistorial* tesela, int bytesPorPixel) {
+    return (size_t)tesela->ancho * tesela->alto * bytesPorPixel;
+}
+
+// QUÉ: Bytes por píxel de una versión.
+static int bytesPixelVersion(const Version* version) {
+    return version->canales * (version->profundidad == 16 ? 2 : 1);
+}
+
+// QUÉ: ¿La versión tiene las dimensiones y el formato de píxel de la imagen?
+static int mismaForma(const Version* version, const ImagenInfo* imagen) {
+    return version->ancho == imagen->ancho && version->alto == imagen->alto &&
+           version->canales == imagen->canales && version->profundidad == imagen->profundidad &&
+           version->relleno == imagen->relleno;
+}
+
+// QUÉ: Bloque adoptado con la misma matriz que la imagen, o NULL.
+static BloqueHistorial* buscarBloque(const ImagenInfo* imagen) {
+    for (BloqueHistorial* b = bloques; b; b = b->siguiente) {
+        if (b->imagen.pixeles == imagen->pixeles) {
+            return b;
+        }
+    }
+    return NULL;
+}
+
+// QUÉ: Adoptar la imagen (una referencia a su bloque, sin copiar píxeles).
+// CÓMO: Si ya estaba adoptada se reutiliza su bloque.
+static BloqueHistorial* adoptarImagen(const ImagenInfo* imagen) {
+    BloqueHistorial* bloque = buscarBloque(imagen);
+    if (bloque) {
+        return bloque;
+    }
+    bloque = (BloqueHistorial*)malloc(sizeof(BloqueHistorial));
+    if (!bloque) {
+        return NULL;
+    }
+    compartirImagen(imagen, &bloque->imagen);
+    bloque->teselas = 0;
+    bloque->siguiente = bloques;
+    bloques = bloque;
+    return bloque;
+}
+
+static void soltarBloque(BloqueHistorial* bloque) {
+    if (--bloque->teselas > 0) {
+        return;
+    }
+    BloqueHistorial** enlace = &bloques;
+    while (*enlace != bloque) {
+        enlace = &(*enlace)->siguiente;
+    }
+    *enlace = bloque->siguiente;
+    liberarImagen(&bloque->imagen);
+    free(bloque);
+}
+
+// QUÉ: Crear la tesela (tx, ty) de una imagen de ancho x alto.
+// CÓMO: Con bloque, una vista de su trozo (sin copiar); sin él, una copia de
+// la imagen.
+static TeselaHistorial* crearTesela(const ImagenInfo* imagen, BloqueHistorial* bloque, int tx, int ty) {
+    int x0 = tx * TAM_TESELA_HISTORIAL, y0 = ty * TAM_TESELA_HISTORIAL;
+    TeselaHistorial* tesela = (TeselaHistorial*)malloc(sizeof(TeselaHistorial));
+    if (!tesela) {
+        return NULL;
+    }
+    tesela->referencias = 1;
+    tesela->ancho = imagen->ancho - x0 < TAM_TESELA_HISTORIAL ? imagen->ancho - x0 : TAM_TESELA_HISTORIAL;
+    tesela->alto = imagen->alto - y0 < TAM_TESELA_HISTORIAL ? imagen->alto - y0 : TAM_TESELA_HISTORIAL;
+    tesela->bloque = bloque;
+    if (bloque) {
+        tesela->paso = (size_t)imagen->ancho * bytesPixel(imagen);
+        tesela->datos = bloque->imagen.pixeles[y0][x0];
+        bloque->teselas++;
+        return tesela;
+    }
+    tesela->paso = (size_t)tesela->ancho * bytesPixel(imagen);
+    tesela->datos = (unsigned char*)malloc(tesela->paso * tesela->alto);
+    if (!tesela->datos) {
+        free(tesela);
+        return NULL;
+    }
+    for (int y = 0; y < tesela->alto; y++) {
+        memcpy(tesela->datos + y * tesela->paso, imagen->pixeles[y0 + y][x0], tesela->paso);
+    }
+    return tesela;
+}
+
+// QUÉ: Copiar una tesela guardada en su sitio de la imagen.
+static void restaurarTesela(ImagenInfo* imagen, const TeselaHistorial* tesela, int tx, int ty) {
+    int x0 = tx * TAM_TESELA_HISTORIAL, y0 = ty * TAM_TESELA_HISTORIAL;
+    size_t bytesFila = (size_t)tesela->ancho * bytesPixel(imagen);
+    for (int y = 0; y < tesela->alto; y++) {
+        memcpy(imagen->pixeles[y0 + y][x0], tesela->datos + y * tesela->paso, bytesFila);
+    }
+}
+
+// QUÉ: Pasar una vista a datos propios antes de que se escriba en su bloque.
+// CÓMO: Todas las versiones que la usan ven el cambio (es el mismo objeto).
+// Devuelve 1 si tuvo éxito, 0 si falta memoria (la tesela queda como estaba).
+static int independizarTesela(TeselaHistorial* tesela, int bytesPorPixel) {
+    size_t bytesFila = (size_t)tesela->ancho * bytesPorPixel;
+    unsigned char* datos = (unsigned char*)malloc(bytesFila * tesela->alto);
+    if (!datos) {
+        return 0;
+    }
+    for (int y = 0; y < tesela->alto; y++) {
+        memcpy(datos + y * bytesFila, tesela->datos + y * tesela->paso, bytesFila);
+    }
+    BloqueHistorial* bloque = tesela->bloque;
+    tesela->datos = datos;
+    tesela->paso = bytesFila;
+    tesela->bloque = NULL;
+    soltarBloque(bloque);
+    return 1;
+}
+
+// QUÉ: Independizar las vistas del bloque de la imagen en las teselas
+// [tx0, tx1) x [ty0, ty1), en todas las versiones.
+// CÓMO: Las vistas de un bloque solo están en versiones de sus dimensiones y
+// siempre en su posición, así que basta mirar esas celdas.
+static int independizarRegion(const ImagenInfo* imagen, int tx0, int tx1, int ty0, int ty1) {
+    for (int v = 0; v < numVersiones; v++) {
+        Version* version = versiones[v];
+        if (!mismaForma(version, imagen)) {
+            continue;
+        }
+        for (int ty = ty0; ty < ty1; ty++) {
+            for (int tx = tx0; tx < tx1; tx++) {
+                TeselaHistorial* tesela = version->teselas[ty * version->columnas + tx];
+                if (tesela->bloque && tesela->bloque->imagen.pixeles == imagen->pixeles &&
+                    !independizarTesela(tesela, bytesPixelVersion(version))) {
+                    return 0;
+                }
+            }
+        }
+    }
+    return 1;
+}
+
+static void soltarTesela(TeselaHistorial* tesela) {
+    if (!tesela || --tesela->referencias > 0) {
+        return;
+    }
+    if (tesela->bloque) {
+        soltarBloque(tesela->bloque);
+    } else {
+        free(tesela->datos);
+    }
+    free(tesela);
+}
+
+static void liberarVersion(Version* version) {
+    if (!version) {
+        return;
+    }
+    if (version->teselas) {
+        for (int i = 0; i < version->columnas * version->filas; i++) {
+            soltarTesela(version->teselas[i]);
+        }
+    }
+    free(version->teselas);
+    free(version);
+}
+
+// QUÉ: Crear una versión a partir de la imagen.
+// CÓMO: Si 'anterior' tiene las mismas dimensiones y formato, las teselas
+// fuera de la región (x, y, ancho, alto) se comparten con ella. Si la región
+// es la imagen entera (o no hay anterior compatible) se adopta la imagen y
+// sus teselas son vistas de su bloque; si es una parte, las teselas tocadas
+// se copian.
+// POR QUÉ: Tras un filtro de imagen completa la imagen es nueva y nadie más
+// la tiene: adoptarla cuesta O(teselas) punteros en lugar de otra copia.
+// Una región pequeña se sigue copiando para no compartir toda la imagen
+// (escribir en ella obligaría a copiarla entera después).
+static Version* crearVersion(const ImagenInfo* imagen, const char* descripcion, const Version* anterior,
+                             int x, int y, int ancho, int alto) {
+    Version* version = (Version*)calloc(1, sizeof(Version));
+    if (!version) {
+        return NULL;
+    }
+    version->ancho = imagen->ancho;
+    version->alto = imagen->alto;
+    version->canales = imagen->canales;
+    version->profundidad = imagen->profundidad;
+    version->relleno = imagen->relleno;
+    version->columnas = (imagen->ancho + TAM_TESELA_HISTORIAL - 1) / TAM_TESELA_HISTORIAL;
+    version->filas = (imagen->alto + TAM_TESELA_HISTORIAL - 1) / TAM_TESELA_HISTORIAL;
+    snprintf(version->descripcion, sizeof(version->descripcion), "%s", descripcion);
+    version->teselas = (TeselaHistorial**)calloc((size_t)version->columnas * version->filas,
+                                                 sizeof(TeselaHistorial*));
+    if (!version->teselas) {
+        free(version);
+        return NULL;
+    }
+
+    int compatible = anterior && mismaForma(anterior, imagen);
+    // Rango de teselas que toca la región (vacío si la región no tiene píxeles)
+    int tx0 = 0, tx1 = version->columnas, ty0 = 0, ty1 = version->filas;
+    if (compatible) {
+        int x1 = x + ancho < imagen->ancho ? x + ancho : imagen->ancho;
+        int y1 = y + alto < imagen->alto ? y + alto : imagen->alto;
+        if (x < 0) x = 0;
+        if (y < 0) y = 0;
+        if (x >= x1 || y >= y1) {
+            tx0 = tx1 = ty0 = ty1 = 0;
+        } else {
+            tx0 = x / TAM_TESELA_HISTORIAL;
+            tx1 = (x1 - 1) / TAM_TESELA_HISTORIAL + 1;
+            ty0 = y / TAM_TESELA_HISTORIAL;
+            ty1 = (y1 - 1) / TAM_TESELA_HISTORIAL + 1;
+        }
+    }
+    BloqueHistorial* bloque = NULL;
+    if (tx0 == 0 && ty0 == 0 && tx1 == version->columnas && ty1 == version->filas) {
+        bloque = adoptarImagen(imagen);
+        if (!bloque) {
+            free(version->teselas);
+            free(version);
+            return NULL;
+        }
+        bloque->teselas++; // Que no se suelte mientras se crean las vistas
+        version->adoptada = 1;
+    }
+
+    int ok = 1;
+    for (int ty = 0; ty < version->filas && ok; ty++) {
+        for (int tx = 0; tx < version->columnas && ok; tx++) {
+            int i = ty * version->columnas + tx;
+            int tocada = tx >= tx0 && tx < tx1 && ty >= ty0 && ty < ty1;
+            if (compatible && !tocada) {
+                version->teselas[i] = anterior->teselas[i];
+                version->teselas[i]->referencias++;
+                continue;
+            }
+            version->teselas[i] = crearTesela(imagen, bloque, tx, ty);
+            ok = version->teselas[i] != NULL;
+            version->nuevas += ok;
+        }
+    }
+    if (bloque) {
+        soltarBloque(bloque);
+    }
+    if (!ok) {
+        liberarVersion(version);
+        return NULL;
+    }
+    return version;
+}
+
+// QUÉ: Olvidar la versión más antigua; sus teselas siguen vivas si otra las usa.
+static void olvidarMasAntigua(void) {
+    liberarVersion(versiones[0]);
+    memmove(versiones, versiones + 1, (size_t)(numVersiones - 1) * sizeof(Version*));
+    versiones[--numVersiones] = NULL;
+    actual--;
+}
+
+// QUÉ: Empezar un historial nuevo (ver historial.h).
+int iniciarHistorial(const ImagenInfo* imagen, const char* descripcion) {
+    liberarHistorial();
+    if (!imagenCargada(imagen)) {
+        return 0;
+    }
+    versiones[0] = crearVersion(imagen, descripcion, NULL, 0, 0, 0, 0);
+    if (!versiones[0]) {
+        fprintf(stderr, "Aviso: sin memoria para el historial; deshacer no estará disponible\n");
+        return 0;
+    }
+    numVersiones = 1;
+    actual = 0;
+    return 1;
+}
+
+// QUÉ: Registrar la imagen como versión nueva (ver historial.h).
+int registrarVersion(const ImagenInfo* imagen, const char* descripcion, int x, int y, int ancho, int alto) {
+    if (!imagenCargada(imagen)) {
+        return 0;
+    }
+    if (actual < 0) {
+        return iniciarHistorial(imagen, descripcion);
+    }
+    // Una edición nueva descarta lo que se podía rehacer
+    for (int i = actual + 1; i < numVersiones; i++) {
+        liberarVersion(versiones[i]);
+        versiones[i] = NULL;
+    }
+    numVersiones = actual + 1;
+
+    Version* version = crearVersion(imagen, descripcion, versiones[actual], x, y, ancho, alto);
+    if (!version) {
+        fprintf(stderr, "Aviso: sin memoria para el historial; se vacía y deshacer no estará disponible\n");
+        liberarHistorial();
+        return 0;
+    }
+    if (numVersiones == MAX_VERSIONES_HISTORIAL) {
+        olvidarMasAntigua();
+    }
+    versiones[numVersiones++] = version;
+    actual = numVersiones - 1;
+
+    // Presupuesto en bytes: la versión actual se conserva siempre
+    size_t unicos, compartidos, limite = (size_t)MEMORIA_MAXIMA_HISTORIAL_MB * 1024 * 1024;
+    int olvidadas = 0;
+    memoriaHistorial(&unicos, &compartidos);
+    while (unicos > limite && numVersiones > 1) {
+        olvidarMasAntigua();
+        olvidadas++;
+        memoriaHistorial(&unicos, &compartidos);
+    }
+    if (olvidadas > 0) {
+        printf("Historial: se olvidan las %d versión(es) más antigua(s) para no pasar de %d MB\n", olvidadas,
+               MEMORIA_MAXIMA_HISTORIAL_MB);
+    }
+    return 1;
+}
+
+int registrarVersionCompleta(const ImagenInfo* imagen, const char* descripcion) {
+    return registrarVersion(imagen, descripcion, 0, 0, imagen->ancho, imagen->alto);
+}
+
+// QUÉ: Preparar una región de la imagen del menú para escribir en ella (ver historial.h).
+// CÓMO: Si la comparten guardados pendientes, copia privada de la imagen
+// (prepararModificacion). Si solo la comparte el historial, se copian las
+// teselas del historial que miran la región y la imagen se sigue
+// escribiendo en su sitio: fuera de la región las vistas siguen valiendo.
+int prepararEdicion(ImagenInfo* imagen, int x, int y, int ancho, int alto) {
+    if (!imagenCargada(imagen)) {
+        return 0;
+    }
+    BloqueHistorial* bloque = buscarBloque(imagen);
+    if (referenciasImagen(imagen) > 1 + (bloque != NULL)) {
+        return prepararModificacion(imagen);
+    }
+    if (!bloque) {
+        return 1;
+    }
+    int x1 = x + ancho < imagen->ancho ? x + ancho : imagen->ancho;
+    int y1 = y + alto < imagen->alto ? y + alto : imagen->alto;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x >= x1 || y >= y1) {
+        return 1;
+    }
+    if (!independizarRegion(imagen, x / TAM_TESELA_HISTORIAL, (x1 - 1) / TAM_TESELA_HISTORIAL + 1,
+                            y / TAM_TESELA_HISTORIAL, (y1 - 1) / TAM_TESELA_HISTORIAL + 1)) {
+        // Sin memoria para las teselas: se intenta con la copia entera
+        return prepararModificacion(imagen);
+    }
+    return 1;
+}
+
+// QUÉ: Llevar la imagen a la versión 'objetivo'.
+// CÓMO: 'origen' es la versión con la que coincide la imagen, o NULL si no
+// se sabe (una edición que falló a medias). Tres casos, del más barato al
+// más caro:
+//   - el destino es entero una imagen adoptada: la imagen pasa a compartir
+//     ese bloque (no se copia nada, *reutilizada = 1);
+//   - mismas dimensiones y la imagen solo la comparte el historial: se
+//     copian en su sitio las teselas distintas (punteros distintos; sin
+//     origen, todas las que no miran ya la imagen), tras independizar las
+//     vistas de esas teselas;
+//   - si no, se reconstruye una imagen nueva con todas las teselas.
+// Devuelve las teselas copiadas, o -1 si falta memoria (la imagen no cambia).
+static int llevarAVersion(ImagenInfo* imagen, const Version* origen, const Version* objetivo, int* reutilizada) {
+    int total = objetivo->columnas * objetivo->filas;
+    *reutilizada = 0;
+
+    BloqueHistorial* bloque = objetivo->teselas[0]->bloque;
+    for (int i = 1; i < total && bloque; i++) {
+        if (objetivo->teselas[i]->bloque != bloque) bloque = NULL;
+    }
+    if (bloque) {
+        if (bloque->imagen.pixeles != imagen->pixeles) {
+            soltarImagen(imagen);
+            compartirImagen(&bloque->imagen, imagen);
+        }
+        *reutilizada = 1;
+        return 0;
+    }
+
+    int copiadas = 0;
+    BloqueHistorial* propio = imagenCargada(imagen) ? buscarBloque(imagen) : NULL;
+    int enSuSitio = imagenCargada(imagen) && referenciasImagen(imagen) <= 1 + (propio != NULL) &&
+                    mismaForma(objetivo, imagen) &&
+                    (!origen || mismaForma(origen, imagen));
+    if (enSuSitio) {
+        for (int ty = 0; ty < objetivo->filas && enSuSitio; ty++) {
+            for (int tx = 0; tx < objetivo->columnas && enSuSitio; tx++) {
+                int i = ty * objetivo->columnas + tx;
+                const TeselaHistorial* tesela = objetivo->teselas[i];
+                if ((origen && origen->teselas[i] == tesela) ||
+                    (tesela->bloque && tesela->bloque->imagen.pixeles == imagen->pixeles)) {
+                    continue; // La imagen ya tiene esos píxeles
+                }
+                // Sin memoria para independizar: las teselas ya copiadas
+                // son del destino, así que reconstruir desde él es correcto
+                enSuSitio = independizarRegion(imagen, tx, tx + 1, ty, ty + 1);
+                if (enSuSitio) {
+                    restaurarTesela(imagen, tesela, tx, ty);
+                    copiadas++;
+                }
+            }
+        }
+    }
+    if (!enSuSitio) {
+        ImagenInfo nueva = {0, 0, 0, 0, 0, NULL};
+        if (!crearImagenFormato(&nueva, objetivo->ancho, objetivo->alto, objetivo->canales,
+                                objetivo->profundidad, objetivo->relleno)) {
+            fprintf(stderr, "Error de memoria al restaurar la versión\n");
+            return -1;
+        }
+        for (int ty = 0; ty < objetivo->filas; ty++) {
+            for (int tx = 0; tx < objetivo->columnas; tx++) {
+                restaurarTesela(&nueva, objetivo->teselas[ty * objetivo->columnas + tx], tx, ty);
+            }
+        }
+        copiadas = total;
+        soltarImagen(imagen);
+        *imagen = nueva;
+    }
+    return copiadas;
+}
+
+// QUÉ: Llevar la imagen de la versión actual a la versión 'destino'.
+static int irAVersion(ImagenInfo* imagen, int destino) {
+    const Version* objetivo = versiones[destino];
+    int total = objetivo->columnas * objetivo->filas;
+    int reutilizada;
+    int copiadas = llevarAVersion(imagen, versiones[actual], objetivo, &reutilizada);
+    if (copiadas < 0) {
+        return 0;
+    }
+    if (reutilizada) {
+        printf("✓ Versión %d: %s (0 de %d teselas copiadas: se reutiliza la imagen guardada)\n", destino,
+               objetivo->descripcion, total);
+    } else {
+        printf("✓ Versión %d: %s (%d de %d teselas copiadas)\n", destino, objetivo->descripcion, copiadas, total);
+    }
+    actual = destino;
+    return 1;
+}
+
+// QUÉ: Devolver la imagen a la versión actual tras una edición fallida (ver
+// historial.h).
+// CÓMO: Como deshacer, pero sin suponer que la imagen coincide con alguna
+// versión: prepararEdicion ya independizó las teselas de la región escrita,
+// así que basta copiar las que no miran la propia imagen.
+int restaurarVersionActual(ImagenInfo* imagen) {
+    if (actual < 0) {
+        return 0;
+    }
+    int reutilizada;
+    int copiadas = llevarAVersion(imagen, NULL, versiones[actual], &reutilizada);
+    if (copiadas < 0) {
+        return 0;
+    }
+    printf("Se restauró la versión %d (%d teselas copiadas%s).\n", actual, copiadas,
+           reutilizada ? ": se reutiliza la imagen guardada" : "");
+    return 1;
+}
+
+// QUÉ: Deshacer y rehacer (ver historial.h).
+int deshacer(ImagenInfo* imagen) {
+    if (actual <= 0) {
+        printf("No hay nada que deshacer.\n");
+        return 0;
+    }
+    return irAVersion(imagen, actual - 1);
+}
+
+int rehacer(ImagenInfo* imagen) {
+    if (actual < 0 || actual + 1 >= numVersiones) {
+        printf("No hay nada que rehacer.\n");
+        return 0;
+    }
+    return irAVersion(imagen, actual + 1);
+}
+
+// QUÉ: Memoria del historial (ver historial.h).
+// CÓMO: Cada tesela propia aparece en 'referencias' versiones; sumar en cada
+// aparición bytes / referencias la cuenta una sola vez. Los bloques
+// adoptados cuentan enteros una vez (siguen vivos mientras los mire alguna
+// tesela). compartidos es lo que ocuparía de más una copia por versión.
+void memoriaHistorial(size_t* unicos, size_t* compartidos) {
+    double totalUnicos = 0.0, totalVersiones = 0.0;
+    for (int v = 0; v < numVersiones; v++) {
+        const Version* version = versiones[v];
+        totalVersiones += (double)version->ancho * version->alto * bytesPixelVersion(version);
+        for (int i = 0; i < version->columnas * version->filas; i++) {
+            const TeselaHistorial* tesela = version->teselas[i];
+            if (!tesela->bloque) {
+                totalUnicos += (double)bytesTesela(tesela, bytesPixelVersion(version)) / tesela->referencias;
+            }
+        }
+    }
+    for (const BloqueHistorial* b = bloques; b; b = b->siguiente) {
+        totalUnicos += (double)b->imagen.ancho * b->imagen.alto * bytesPixel(&b->imagen);
+    }
+    *unicos = (size_t)(totalUnicos + 0.5);
+    *compartidos = totalVersiones > totalUnicos ? (size_t)(totalVersiones - totalUnicos + 0.5) : 0;
+}
+
+// QUÉ: Imprimir las versiones y la memoria (ver historial.h).
+void imprimirHistorial(void) {
+    if (numVersiones == 0) {
+        printf("El historial está vacío (carga una imagen).\n");
+        return;
+    }
+    printf("\nHistorial: %d versión(es), teselas de %dx%d (máximo %d versiones y %d MB)\n", numVersiones,
+           TAM_TESELA_HISTORIAL, TAM_TESELA_HISTORIAL, MAX_VERSIONES_HISTORIAL, MEMORIA_MAXIMA_HISTORIAL_MB);
+    for (int v = 0; v < numVersiones; v++) {
+        const Version* version = versiones[v];
+        int total = version->columnas * version->filas;
+        ImagenInfo formato = {0, 0, version->canales, version->profundidad, version->relleno, NULL};
+        printf(" %s %2d. %-40.40s %5dx%-5d %-11s %5d %s, %5d compartidas\n", v == actual ? "→" : " ", v,
+               version->descripcion, version->ancho, version->alto, nombreFormatoImagen(&formato),
+               version->nuevas, version->adoptada ? "adoptadas" : "copiadas ", total - version->nuevas);
+    }
+    size_t unicos, compartidos;
+    memoriaHistorial(&unicos, &compartidos);
+    printf("Memoria: %.2f MB únicos, %.2f MB compartidos (sin compartir serían %.2f MB)\n",
+           unicos / (1024.0 * 1024.0), compartidos / (1024.0 * 1024.0),
+           (unicos + compartidos) / (1024.0 * 1024.0));
+}
+
+// QUÉ: Línea de estado para el menú (ver historial.h).
+void imprimirEstadoHistorial(void) {
+    if (numVersiones == 0) {
+        return;
+    }
+    size_t unicos, compartidos;
+    memoriaHistorial(&unicos, &compartidos);
+    printf("  ↶ Versión %d de %d | historial: %.1f MB únicos, %.1f MB compartidos\n", actual,
+           numVersiones - 1, unicos / (1024.0 * 1024.0), compartidos / (1024.0 * 1024.0));
+}
+
+// QUÉ: Liberar todas las versiones.
+void liberarHistorial(void) {
+    for (int i = 0; i < numVersiones; i++) {
+        liberarVersion(versiones[i]);
+        versiones[i] = NULL;
+    }
+    numVersiones = 0;
+    actual = -1;
+}
@@ -1,25 +1,129 @@
 #include "image.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+// QUÉ: Enlazar los arreglos de punteros de la matriz 3D sobre un bloque de datos.
+// CÓMO: filas[y] apunta a su tramo de punteros y cada puntero a su píxel dentro
+// del bloque (fila y en datos + y*ancho*bytesPixel).
+// POR QUÉ: Lo comparten crearImagen y las vistas que viven dentro de reservas
+// más grandes (por ejemplo, los niveles de una pirámide).
+void enlazarMatriz(unsigned char*** filas, unsigned char** punteros, unsigned char* datos,
+                   int ancho, int alto, int bytesPixel) {
+    for (int y = 0; y < alto; y++) {
+        filas[y] = punteros + (size_t)y * ancho;
+        unsigned char* fila = datos + (size_t)y * ancho * bytesPixel;
+        for (int x = 0; x < ancho; x++) {
+            filas[y][x] = fila + (size_t)x * bytesPixel;
+        }
+    }
+}
+
+// QUÉ: Cabecera que precede al arreglo de filas de cada imagen de crearImagen.
+// CÓMO: Cuenta las ImagenInfo que comparten el bloque (compartirImagen). Es
+// una unión con un puntero para que las filas que siguen queden alineadas.
+typedef union {
+    int referencias;
+    void* alineacion;
+} CabeceraImagen;
+
+static CabeceraImagen* cabeceraDe(const ImagenInfo* info) {
+    return (CabeceraImagen*)info->pixeles - 1;
+}
+
+// QUÉ: Reservar una imagen nueva con memoria contigua.
+// CÓMO: Hace tres reservas: arreglo de filas (tras la cabecera con las
+// referencias), arreglo de punteros a píxel y un único bloque de datos
+// (alto*ancho*canales*bytes por muestra); luego enlaza pixeles[y][x] al
+// bloque para que el acceso [y][x][c] siga funcionando igual.
+// POR QUÉ: Una reserva por píxel fragmenta la memoria y obliga a recorrer la
+// imagen píxel a píxel; con filas contiguas se puede usar memcpy y SIMD.
+int crearImagenFormato(ImagenInfo* info, int ancho, int alto, int canales, int profundidad, int relleno) {
+    info->ancho = 0;
+    info->alto = 0;
+    info->canales = 0;
+    info->profundidad = 0;
+    info->relleno = 0;
+    info->pixeles = NULL;
+    if (ancho <= 0 || alto <= 0 || canales <= 0) {
+        fprintf(stderr, "Error: dimensiones inválidas (%dx%d, %d canales)\n", ancho, alto, canales);
+        return 0;
+    }
+    if ((profundidad != 8 && profundidad != 16) || (relleno && canales != 4)) {
+        fprintf(stderr, "Error: formato de píxel inválido (%d canales, %d bits%s)\n", canales, profundidad,
+                relleno ? ", relleno" : "");
+        return 0;
+    }
+
+    int bytesPorPixel = canales * (profundidad / 8);
+    size_t totalPixeles = (size_t)ancho * alto;
+    CabeceraImagen* cabecera = (CabeceraImagen*)malloc(sizeof(CabeceraImagen) + alto * sizeof(unsigned char**));
+    unsigned char** punteros = (unsigned char**)malloc(totalPixeles * sizeof(unsigned char*));
+    unsigned char* datos = (unsigned char*)malloc(totalPixeles * bytesPorPixel);
+    if (!cabecera || !punteros || !datos) {
+        fprintf(stderr, "Error de memoria al reservar imagen %dx%d\n", ancho, alto);
+        free(cabecera);
+        free(punteros);
+        free(datos);
+        return 0;
+    }
+    cabecera->referencias = 1;
+    unsigned char*** filas = (unsigned char***)(cabecera + 1);
+
+    enlazarMatriz(filas, punteros, datos, ancho, alto, bytesPorPixel);
+
+    info->ancho = ancho;
+    info->alto = alto;
+    info->canales = canales;
+    info->profundidad = profundidad;
+    info->relleno = relleno;
+    info->pixeles = filas;
+    return 1;
+}
+
+int crearImagen(ImagenInfo* info, int ancho, int alto, int canales) {
+    return crearImagenFormato(info, ancho, alto, canales, 8, 0);
+}
+
+int crearImagenComo(ImagenInfo* info, const ImagenInfo* modelo, int ancho, int alto) {
+    return crearImagenFormato(info, ancho, alto, modelo->canales, modelo->profundidad == 16 ? 16 : 8,
+                              modelo->relleno);
+}
 
 // QUÉ: Liberar memoria asignada para la imagen.
-// CÓMO: Libera cada fila y canal de la matriz 3D, luego el arreglo de filas y
-// reinicia la estructura.
+// CÓMO: Resta una referencia; si era la última libera el bloque de datos, el
+// arreglo de punteros a píxel y el de filas (las tres reservas de
+// crearImagen). Luego reinicia la estructura.
 // POR QUÉ: Evita fugas de memoria, esencial en C para manejar recursos manualmente.
 void liberarImagen(ImagenInfo* info) {
     if (info->pixeles) {
-        for (int y = 0; y < info->alto; y++) {
-            for (int x = 0; x < info->ancho; x++) {
-                free(info->pixeles[y][x]); // Liberar canales por píxel
+        CabeceraImagen* cabecera = cabeceraDe(info);
+        if (__atomic_sub_fetch(&cabecera->referencias, 1, __ATOMIC_ACQ_REL) == 0) {
+            if (info->alto > 0 && info->ancho > 0) {
+                free(info->pixeles[0][0]); // Bloque de datos
+                free(info->pixeles[0]);    // Punteros a píxel
             }
-            free(info->pixeles[y]); // Liberar fila
+            free(cabecera); // Cabecera y arreglo de filas
         }
-        free(info->pixeles); // Liberar arreglo de filas
         info->pixeles = NULL;
     }
     info->ancho = 0;
     info->alto = 0;
     info->canales = 0;
+    info->profundidad = 0;
+    info->relleno = 0;
+}
+
+// QUÉ: Compartir el bloque de la imagen (ver image.h).
+void compartirImagen(const ImagenInfo* origen, ImagenInfo* copia) {
+    *copia = *origen;
+    if (origen->pixeles) {
+        __atomic_add_fetch(&cabeceraDe(origen)->referencias, 1, __ATOMIC_RELAXED);
+    }
+}
+
+int referenciasImagen(const ImagenInfo* info) {
+    return info->pixeles ? __atomic_load_n(&cabeceraDe(info)->referencias, __ATOMIC_ACQUIRE) : 0;
 }
 
 // QUÉ: Verificar si hay una imagen cargada en memoria.
@@ -33,84 +137,235 @@ int imagenCargada(const ImagenInfo* info) {
     return 1;
 }
 
-// QUÉ: Convertir imagen RGB a escala de grises.
-// CÓMO: Usa ponderación perceptual (0.299R + 0.587G + 0.114B).
-// POR QUÉ: Sobel requiere imagen de un solo canal para calcular gradientes.
-int convertirAGrayscale(ImagenInfo* info) {
-    if (!imagenCargada(info)) {
-        return 0;
+// QUÉ: Convertir una fila RGB (o RGBA) a escala de grises.
+// CÓMO: Ponderación ITU-R BT.601: Gray = 0.299*R + 0.587*G + 0.114*B, con
+// redondeo; canales es la distancia entre píxeles del origen (3 o 4). Se
+// expande en línea con bytes constante: una copia por tipo de muestra.
+// POR QUÉ: Refleja la sensibilidad perceptual del ojo humano. Es la única
+// fórmula del programa: los cargadores la usan al decodificar directamente a
+// grises y el resultado coincide con convertir después.
+__attribute__((always_inline))
+static inline void convertirFilaAGrises(const unsigned char* origen, int canales, unsigned char* destino,
+                                        int ancho, const int bytes) {
+    for (int x = 0; x < ancho; x++) {
+        size_t i = (size_t)x * canales;
+        float gray = 0.299f * (float)leerMuestra(origen, i, bytes) +
+                     0.587f * (float)leerMuestra(origen, i + 1, bytes) +
+                     0.114f * (float)leerMuestra(origen, i + 2, bytes);
+        escribirMuestra(destino, x, (unsigned int)(gray + 0.5f), bytes); // Redondeo
     }
-    if (info->canales == 1) {
-        printf("La imagen ya está en escala de grises.\n");
-        return 1; // Ya es grayscale
+}
+
+// QUÉ: Grises + alfa desde RGBA (2 muestras por píxel, el alfa se copia).
+__attribute__((always_inline))
+static inline void convertirFilaAGrisesConAlfa(const unsigned char* origen, unsigned char* destino, int ancho,
+                                               const int bytes) {
+    for (int x = 0; x < ancho; x++, origen += 4 * bytes, destino += 2 * bytes) {
+        convertirFilaAGrises(origen, 4, destino, 1, bytes);
+        escribirMuestra(destino, 1, leerMuestra(origen, 3, bytes), bytes);
     }
-    if (info->canales != 3) {
-        fprintf(stderr, "Error: formato de imagen no soportado (canales=%d).\n", info->canales);
-        return 0;
+}
+
+void filaAGrises(const unsigned char* origen, int canales, unsigned char* destino, int ancho) {
+    convertirFilaAGrises(origen, canales, destino, ancho, 1);
+}
+
+void filaAGrisesConAlfa(const unsigned char* origen, unsigned char* destino, int ancho) {
+    convertirFilaAGrisesConAlfa(origen, destino, ancho, 1);
+}
+
+void filaAGrisesMuestras(const unsigned char* origen, int canales, unsigned char* destino, int ancho,
+                         int bytesMuestra) {
+    if (bytesMuestra == 2) {
+        convertirFilaAGrises(origen, canales, destino, ancho, 2);
+    } else {
+        convertirFilaAGrises(origen, canales, destino, ancho, 1);
     }
+}
 
-    // QUÉ: Crear nueva matriz para grayscale (1 canal).
-    unsigned char*** pixelesGray = (unsigned char***)malloc(info->alto * sizeof(unsigned char**));
-    if (!pixelesGray) {
-        fprintf(stderr, "Error de memoria al asignar grayscale\n");
-        return 0;
+void filaAGrisesConAlfaMuestras(const unsigned char* origen, unsigned char* destino, int ancho,
+                                int bytesMuestra) {
+    if (bytesMuestra == 2) {
+        convertirFilaAGrisesConAlfa(origen, destino, ancho, 2);
+    } else {
+        convertirFilaAGrisesConAlfa(origen, destino, ancho, 1);
+    }
+}
+
+// QUÉ: RGB <-> RGBX (ver image.h).
+__attribute__((always_inline))
+static inline void ensancharRGBX(const unsigned char* origen, unsigned char* destino, size_t ancho,
+                                 const int bytes) {
+    unsigned int maximo = bytes == 2 ? 65535u : 255u;
+    for (size_t x = ancho; x-- > 0;) {
+        unsigned int r = leerMuestra(origen, 3 * x, bytes);
+        unsigned int g = leerMuestra(origen, 3 * x + 1, bytes);
+        unsigned int b = leerMuestra(origen, 3 * x + 2, bytes);
+        escribirMuestra(destino, 4 * x + 3, maximo, bytes);
+        escribirMuestra(destino, 4 * x + 2, b, bytes);
+        escribirMuestra(destino, 4 * x + 1, g, bytes);
+        escribirMuestra(destino, 4 * x, r, bytes);
+    }
+}
+
+void ensancharFilaRGBX(const unsigned char* origen, unsigned char* destino, size_t ancho, int bytesMuestra) {
+    if (bytesMuestra == 2) {
+        ensancharRGBX(origen, destino, ancho, 2);
+    } else {
+        ensancharRGBX(origen, destino, ancho, 1);
     }
+}
+
+void compactarFilaRGBX(const unsigned char* origen, unsigned char* destino, size_t ancho, int bytesMuestra) {
+    size_t bytesColor = 3 * (size_t)bytesMuestra;
+    for (size_t x = 0; x < ancho; x++) {
+        memmove(destino + x * bytesColor, origen + x * 4 * bytesMuestra, bytesColor);
+    }
+}
 
-    int memoriaOk = 1;
-    for (int y = 0; y < info->alto && memoriaOk; y++) {
-        pixelesGray[y] = (unsigned char**)malloc(info->ancho * sizeof(unsigned char*));
-        if (!pixelesGray[y]) {
-            memoriaOk = 0;
-            for (int yy = 0; yy < y; yy++) {
-                for (int x = 0; x < info->ancho; x++) {
-                    free(pixelesGray[yy][x]);
-                }
-                free(pixelesGray[yy]);
+// QUÉ: Copiar una imagen RGBX a 'destino' (RGB) fila a fila.
+// CÓMO: Si el destino es de 8 bits y el origen de 16, se redondea a la vez.
+static void copiarSinRelleno(const ImagenInfo* origen, ImagenInfo* destino) {
+    int bytesOrigen = bytesMuestra(origen);
+    size_t ancho = (size_t)origen->ancho;
+    for (int y = 0; y < origen->alto; y++) {
+        const unsigned char* fila = origen->pixeles[y][0];
+        unsigned char* salida = destino->pixeles[y][0];
+        if (bytesMuestra(destino) == bytesOrigen) {
+            compactarFilaRGBX(fila, salida, ancho, bytesOrigen);
+            continue;
+        }
+        const unsigned short* muestras = (const unsigned short*)fila;
+        for (size_t x = 0; x < ancho; x++) {
+            for (int c = 0; c < 3; c++) {
+                *salida++ = (unsigned char)((muestras[4 * x + c] * 255u + 32767u) / 65535u);
             }
-            free(pixelesGray);
-            return 0;
         }
+    }
+}
 
-        for (int x = 0; x < info->ancho && memoriaOk; x++) {
-            pixelesGray[y][x] = (unsigned char*)malloc(1 * sizeof(unsigned char));
-            if (!pixelesGray[y][x]) {
-                memoriaOk = 0;
-                for (int xx = 0; xx < x; xx++) {
-                    free(pixelesGray[y][xx]);
-                }
-                for (int yy = 0; yy < y; yy++) {
-                    for (int xx = 0; xx < info->ancho; xx++) {
-                        free(pixelesGray[yy][xx]);
-                    }
-                    free(pixelesGray[yy]);
-                }
-                free(pixelesGray[y]);
-                free(pixelesGray);
-                return 0;
-            }
+// QUÉ: Versión de 8 bits de la imagen (ver image.h).
+int imagenEn8Bits(const ImagenInfo* origen, ImagenInfo* destino) {
+    if (origen->profundidad != 16) {
+        compartirImagen(origen, destino);
+        return 1;
+    }
+    if (!crearImagenFormato(destino, origen->ancho, origen->alto, origen->canales, 8, origen->relleno)) {
+        return 0;
+    }
+    size_t muestras = (size_t)origen->ancho * origen->canales;
+    for (int y = 0; y < origen->alto; y++) {
+        const unsigned short* fila = (const unsigned short*)origen->pixeles[y][0];
+        unsigned char* salida = destino->pixeles[y][0];
+        for (size_t i = 0; i < muestras; i++) {
+            salida[i] = (unsigned char)((fila[i] * 255u + 32767u) / 65535u);
+        }
+    }
+    return 1;
+}
 
-            // QUÉ: Calcular valor grayscale usando ponderación ITU-R BT.601.
-            // CÓMO: Gray = 0.299*R + 0.587*G + 0.114*B
-            // POR QUÉ: Refleja la sensibilidad perceptual del ojo humano.
-            float r = (float)info->pixeles[y][x][0];
-            float g = (float)info->pixeles[y][x][1];
-            float b = (float)info->pixeles[y][x][2];
-            float gray = 0.299f * r + 0.587f * g + 0.114f * b;
-            pixelesGray[y][x][0] = (unsigned char)(gray + 0.5f); // Redondeo
+// QUÉ: Versión sin relleno y de la profundidad admitida (ver image.h).
+int imagenParaGuardar(const ImagenInfo* origen, ImagenInfo* destino, int admite16) {
+    if (!origen->relleno) {
+        if (!admite16) {
+            return imagenEn8Bits(origen, destino);
         }
+        compartirImagen(origen, destino);
+        return 1;
     }
+    int profundidad = (admite16 && origen->profundidad == 16) ? 16 : 8;
+    if (!crearImagenFormato(destino, origen->ancho, origen->alto, 3, profundidad, 0)) {
+        return 0;
+    }
+    copiarSinRelleno(origen, destino);
+    return 1;
+}
 
-    // QUÉ: Reemplazar imagen original con grayscale.
+// QUÉ: Canal alfa y nombre del formato.
+int tieneAlfa(int canales) {
+    return canales == 2 || canales == 4;
+}
+
+int imagenConAlfa(const ImagenInfo* info) {
+    return tieneAlfa(info->canales) && !info->relleno;
+}
+
+const char* nombreFormato(int canales) {
+    static const char* nombres[5] = {"?", "grises", "grises+alfa", "RGB", "RGBA"};
+    return (canales >= 1 && canales <= 4) ? nombres[canales] : nombres[0];
+}
+
+const char* nombreFormatoImagen(const ImagenInfo* info) {
+    static const char* nombres16[5] = {"?", "grises, 16 bits", "grises+alfa, 16 bits", "RGB, 16 bits",
+                                       "RGBA, 16 bits"};
+    int canales = (info->canales >= 1 && info->canales <= 4) ? info->canales : 0;
+    if (info->relleno) {
+        return info->profundidad == 16 ? "RGBX, 16 bits" : "RGBX";
+    }
+    return info->profundidad == 16 ? nombres16[canales] : nombreFormato(canales);
+}
+
+// QUÉ: Sustituir la imagen por su versión en grises (con o sin alfa).
+// CÓMO: Una pasada por fila con filaAGrises o filaAGrisesConAlfa; de grises
+// + alfa a luma solo se copia el primer canal.
+static int reducirAGrises(ImagenInfo* info, int conservarAlfa) {
+    int alfa = conservarAlfa && imagenConAlfa(info);
+    ImagenInfo gris;
+    if (!crearImagenFormato(&gris, info->ancho, info->alto, alfa ? 2 : 1, bytesMuestra(info) * 8, 0)) {
+        fprintf(stderr, "Error de memoria al asignar grayscale\n");
+        return 0;
+    }
+    int canales = info->canales;
+    int bytes = bytesMuestra(info);
     for (int y = 0; y < info->alto; y++) {
-        for (int x = 0; x < info->ancho; x++) {
-            free(info->pixeles[y][x]);
+        const unsigned char* origen = info->pixeles[y][0];
+        unsigned char* destino = gris.pixeles[y][0];
+        if (alfa) {
+            filaAGrisesConAlfaMuestras(origen, destino, info->ancho, bytes);
+        } else if (canales >= 3) {
+            filaAGrisesMuestras(origen, canales, destino, info->ancho, bytes);
+        } else {
+            for (int x = 0; x < info->ancho; x++) {
+                memcpy(destino + (size_t)x * bytes, origen + (size_t)x * canales * bytes, bytes);
+            }
         }
-        free(info->pixeles[y]);
     }
-    free(info->pixeles);
-    info->pixeles = pixelesGray;
-    info->canales = 1;
 
+    // QUÉ: Reemplazar imagen original con grayscale.
+    liberarImagen(info);
+    *info = gris;
+    return 1;
+}
+
+// QUÉ: Convertir imagen RGB a escala de grises.
+// CÓMO: Usa ponderación perceptual (0.299R + 0.587G + 0.114B).
+// POR QUÉ: Sobel requiere imagen de un solo canal para calcular gradientes.
+int convertirAGrayscale(ImagenInfo* info) {
+    if (!imagenCargada(info)) {
+        return 0;
+    }
+    if (info->canales <= 2) {
+        printf("La imagen ya está en escala de grises.\n");
+        return 1; // Ya es grayscale
+    }
+    if (info->canales > 4) {
+        fprintf(stderr, "Error: formato de imagen no soportado (canales=%d).\n", info->canales);
+        return 0;
+    }
+    if (!reducirAGrises(info, 1)) {
+        return 0;
+    }
     printf("Imagen convertida a escala de grises.\n");
     return 1;
 }
+
+// QUÉ: Reducir a un solo canal de luma.
+int convertirALuma(ImagenInfo* info) {
+    if (!imagenCargada(info)) {
+        return 0;
+    }
+    if (info->canales == 1) {
+        return 1;
+    }
+    return reducirAGrises(info, 0);
+}
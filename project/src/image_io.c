@@ -1,7 +1,13 @@
 #include "image_io.h"
 #include "image.h"
+#include "png_encoder.h"
+#include "png_decoder.h"
+#include "qoi.h"
+#include "pnm.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // QUÉ: Incluir bibliotecas stb para cargar y guardar imágenes PNG.
 // CÓMO: stb_image.h lee PNG/JPG a memoria; stb_image_write.h escribe PNG.
@@ -11,84 +17,253 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "../stb/stb_image_write.h"
 
-// QUÉ: Cargar una imagen PNG desde un archivo.
-// CÓMO: Usa stbi_load para leer el archivo, detecta canales (1 o 3), y convierte
-// los datos a una matriz 3D (alto x ancho x canales).
+// QUÉ: 1 si se puede preguntar al usuario (menú); 0 en modo por lotes.
+int MODO_INTERACTIVO = 1;
+
+// QUÉ: Cargar una imagen (PNG, QOI, PNM u otro formato de stb_image).
+// CÓMO: cargarImagenCanales sin forzar canales: conserva los del archivo
+// (1 a 4, con alfa si lo tiene; RGB pasa a RGBX) y convierte los datos a
+// una matriz 3D (alto x ancho x canales).
 // POR QUÉ: La matriz 3D es intuitiva para principiantes y permite procesar
 // píxeles y canales individualmente.
 int cargarImagen(const char* ruta, ImagenInfo* info) {
-    int canales;
-    // QUÉ: Cargar imagen con formato original (0 canales = usar formato nativo).
-    // CÓMO: stbi_load lee el archivo y llena ancho, alto y canales.
-    // POR QUÉ: Respetar el formato original asegura que grises o RGB se mantengan.
-    unsigned char* datos = stbi_load(ruta, &info->ancho, &info->alto, &canales, 0);
-    if (!datos) {
-        fprintf(stderr, "Error al cargar imagen: %s\n", ruta);
-        return 0;
-    }
+    return cargarImagenCanales(ruta, info, 0);
+}
 
+// QUÉ: Aceptar o no las dimensiones de una imagen antes de crear la matriz.
+// CÓMO: Rechaza dimensiones no positivas y en las muy grandes avisa y, en el
+// menú, pide confirmación.
+// Devuelve 1 si se continúa, 0 si no.
+static int aceptarDimensiones(int ancho, int alto) {
     // QUÉ: Validar dimensiones de la imagen.
     // CÓMO: Verifica que ancho y alto sean positivos y razonables.
     // POR QUÉ: Evita problemas con imágenes corruptas o inválidas.
-    if (info->ancho <= 0 || info->alto <= 0) {
-        fprintf(stderr, "ERROR: Dimensiones inválidas (%dx%d)\n", info->ancho, info->alto);
-        stbi_image_free(datos);
+    if (ancho <= 0 || alto <= 0) {
+        fprintf(stderr, "ERROR: Dimensiones inválidas (%dx%d)\n", ancho, alto);
         return 0;
     }
-    if (info->ancho > 10000 || info->alto > 10000) {
-        fprintf(stderr, "ADVERTENCIA: Imagen muy grande (%dx%d)\n", info->ancho, info->alto);
-        fprintf(stderr, "El procesamiento puede ser lento. ¿Continuar? (s/n): ");
-        char respuesta;
-        scanf(" %c", &respuesta);
-        while (getchar() != '\n');
-        if (respuesta != 's' && respuesta != 'S') {
-            stbi_image_free(datos);
-            return 0;
+    if (ancho > 10000 || alto > 10000) {
+        fprintf(stderr, "ADVERTENCIA: Imagen muy grande (%dx%d)\n", ancho, alto);
+        if (!MODO_INTERACTIVO) {
+            // Sin terminal no se pregunta: se avisa y se continúa
+            fprintf(stderr, "El procesamiento puede ser lento.\n");
+        } else {
+            fprintf(stderr, "El procesamiento puede ser lento. ¿Continuar? (s/n): ");
+            char respuesta;
+            scanf(" %c", &respuesta);
+            while (getchar() != '\n');
+            if (respuesta != 's' && respuesta != 'S') {
+                return 0;
+            }
         }
     }
+    return 1;
+}
+
+// QUÉ: Canales de la matriz para un decodificador que entrega "canales".
+// CÓMO: Grises pedidos y origen en color (RGB o RGBA): luma al copiar, con
+// alfa. Si no, RGB se ensancha a RGBX (4 canales con relleno).
+static int canalesDeMatriz(int canales, int canalesDeseados) {
+    if (canalesDeseados == 1 && canales >= 3) {
+        return (canales == 4) ? 2 : 1;
+    }
+    return (canales == 3) ? 4 : canales;
+}
+
+// QUÉ: Crear la matriz para las filas de un decodificador.
+static int crearMatrizDecodificada(ImagenInfo* info, int ancho, int alto, int canales, int canalesImagen,
+                                   int bytes) {
+    return crearImagenFormato(info, ancho, alto, canalesImagen, 8 * bytes, canales == 3 && canalesImagen == 4);
+}
+
+// QUÉ: Copiar una fila del decodificador a la matriz, reduciendo a luma o
+// ensanchando a RGBX si hace falta.
+// CÓMO: bytes es el tamaño de cada muestra (1 u 2) en la fila y en la matriz.
+static void copiarFilaDecodificada(const unsigned char* origen, int canales, unsigned char* fila,
+                                   int canalesImagen, int ancho, int bytes) {
+    if (canales == canalesImagen) {
+        // Copiar la fila completa: el formato coincide
+        memcpy(fila, origen, (size_t)ancho * canales * bytes);
+    } else if (canalesImagen == 4) {
+        ensancharFilaRGBX(origen, fila, (size_t)ancho, bytes);
+    } else if (canalesImagen == 2) {
+        filaAGrisesConAlfaMuestras(origen, fila, ancho, bytes);
+    } else {
+        filaAGrisesMuestras(origen, canales, fila, ancho, bytes);
+    }
+}
+
+// QUÉ: Pasar el búfer decodificado por stb a la matriz y liberarlo.
+// CÓMO: Valida las dimensiones, pide confirmación en imágenes muy grandes y
+// reduce a luma durante la copia si canalesDeseados = 1.
+static int copiarDesdeSTB(unsigned char* datos, int canales, int bits16, const char* ruta, ImagenInfo* info,
+                          int canalesDeseados) {
+    if (!datos) {
+        fprintf(stderr, "Error al cargar imagen: %s\n", ruta);
+        return 0;
+    }
+    if (!aceptarDimensiones(info->ancho, info->alto)) {
+        stbi_image_free(datos);
+        return 0;
+    }
 
-    info->canales = (canales == 1 || canales == 3) ? canales : 1; // Forzar 1 o 3
+    int canalesImagen = canalesDeMatriz(canales, canalesDeseados);
 
     // QUÉ: Asignar memoria para matriz 3D.
-    // CÓMO: Asignar alto filas, luego ancho columnas por fila, luego canales por píxel.
-    // POR QUÉ: Estructura clara y flexible para grises (1 canal) o RGB (3 canales).
-    info->pixeles = (unsigned char***)malloc(info->alto * sizeof(unsigned char**));
-    if (!info->pixeles) {
-        fprintf(stderr, "Error de memoria al asignar filas\n");
+    // CÓMO: crearImagen reserva un bloque contiguo y enlaza [alto][ancho][canales].
+    // POR QUÉ: Estructura clara y flexible para grises, RGB y sus variantes con alfa.
+    int ancho = info->ancho;
+    int alto = info->alto;
+    int bytes = bits16 ? 2 : 1;
+    if (!crearMatrizDecodificada(info, ancho, alto, canales, canalesImagen, bytes)) {
         stbi_image_free(datos);
         return 0;
     }
-    for (int y = 0; y < info->alto; y++) {
-        info->pixeles[y] = (unsigned char**)malloc(info->ancho * sizeof(unsigned char*));
-        if (!info->pixeles[y]) {
-            fprintf(stderr, "Error de memoria al asignar columnas\n");
-            liberarImagen(info);
-            stbi_image_free(datos);
-            return 0;
-        }
-        for (int x = 0; x < info->ancho; x++) {
-            info->pixeles[y][x] = (unsigned char*)malloc(info->canales * sizeof(unsigned char));
-            if (!info->pixeles[y][x]) {
-                fprintf(stderr, "Error de memoria al asignar canales\n");
-                liberarImagen(info);
-                stbi_image_free(datos);
-                return 0;
-            }
-            // Copiar píxeles a matriz 3D
-            for (int c = 0; c < info->canales; c++) {
-                info->pixeles[y][x][c] = datos[(y * info->ancho + x) * info->canales + c];
-            }
-        }
+    for (int y = 0; y < alto; y++) {
+        copiarFilaDecodificada(datos + (size_t)y * ancho * canales * bytes, canales, info->pixeles[y][0],
+                               canalesImagen, ancho, bytes);
     }
 
     stbi_image_free(datos); // Liberar buffer de stb
     printf("Imagen cargada: %dx%d, %d canales (%s)\n", info->ancho, info->alto,
-           info->canales, info->canales == 1 ? "grises" : "RGB");
+           info->canales, nombreFormatoImagen(info));
     return 1;
 }
 
+// QUÉ: Estado de una carga completa con el decodificador PNG propio.
+typedef struct {
+    ImagenInfo* info;
+    int canalesDeseados;
+    int canales;     // Canales de las filas que entrega el decodificador
+    int bytes;       // Bytes por muestra de esas filas (1 u 2)
+    int creada;      // La matriz ya existe (liberarla si algo falla)
+} CargaPNG;
+
+// CÓMO: Los PNG de 16 bits se piden con muestras de 16 bits (bytesMuestra = 2).
+static int alCabeceraCarga(void* contexto, CabeceraPNG* cab) {
+    CargaPNG* carga = (CargaPNG*)contexto;
+    if (!aceptarDimensiones(cab->ancho, cab->alto)) {
+        return 0;
+    }
+    if (cab->profundidad == 16) {
+        cab->bytesMuestra = 2;
+    }
+    carga->canales = cab->canalesSalida;
+    carga->bytes = cab->bytesMuestra;
+    int canalesImagen = canalesDeMatriz(cab->canalesSalida, carga->canalesDeseados);
+    if (!crearMatrizDecodificada(carga->info, cab->ancho, cab->alto, cab->canalesSalida, canalesImagen,
+                                 carga->bytes)) {
+        return 0;
+    }
+    carga->creada = 1;
+    return 1;
+}
+
+static int alFilaCarga(void* contexto, const unsigned char* fila, int y) {
+    CargaPNG* carga = (CargaPNG*)contexto;
+    ImagenInfo* info = carga->info;
+    copiarFilaDecodificada(fila, carga->canales, info->pixeles[y][0], info->canales, info->ancho, carga->bytes);
+    return 1;
+}
+
+// QUÉ: Cargar un PNG con el decodificador propio (png_decoder) en vez de stb.
+// CÓMO: Cada fila decodificada se copia a la matriz (con la reducción a luma
+// de copiarDesdeSTB); datos = NULL lee de la ruta. La cabecera se valida antes
+// de reservar la matriz.
+// POR QUÉ: El inflate y el deshacer de filtros de stb son lo más caro de
+// cargar un PNG grande; los píxeles resultantes son los mismos.
+// Devuelve 1 si tuvo éxito, 0 en caso de error o -1 si el archivo no es para
+// este decodificador (no es PNG, Adam7, tRNS) y se debe usar stb.
+static int cargarPNGPropio(const unsigned char* datos, size_t tam, const char* ruta, ImagenInfo* info,
+                           int canalesDeseados) {
+    CargaPNG carga = {info, canalesDeseados, 0, 1, 0};
+    int resultado = datos ? decodificarPNGMemoriaPorFilas(datos, tam, ruta, alCabeceraCarga, alFilaCarga, &carga)
+                          : decodificarPNGPorFilas(ruta, alCabeceraCarga, alFilaCarga, &carga);
+    if (resultado == PNG_OK) {
+        printf("Imagen cargada: %dx%d, %d canales (%s)\n", info->ancho, info->alto, info->canales,
+               nombreFormatoImagen(info));
+        return 1;
+    }
+    if (carga.creada) {
+        liberarImagen(info);
+    }
+    if (resultado == PNG_NO_SOPORTADO) {
+        return -1;
+    }
+    fprintf(stderr, "Error al cargar imagen: %s\n", ruta);
+    return 0;
+}
+
+// QUÉ: Cargar una imagen con el número de canales que necesita el proceso.
+// CÓMO: Ver image_io.h. La reducción a grises se hace en la copia que ya
+// existía desde el búfer del decodificador a la matriz.
+// POR QUÉ: No se usa req_comp de stb porque su fórmula de luma es distinta de
+// la de convertirAGrayscale; así ambos caminos dan los mismos píxeles.
+int cargarImagenCanales(const char* ruta, ImagenInfo* info, int canalesDeseados) {
+    // QUÉ: Detectar QOI por sus bytes mágicos ("qoif" / "qoip").
+    // POR QUÉ: stb no lee QOI; la extensión del archivo no es fiable.
+    if (esArchivoQOI(ruta)) {
+        return cargarQOI(ruta, info, canalesDeseados);
+    }
+    // QUÉ: PGM/PPM binarios ("P5"/"P6") y la entrada estándar ("-").
+    if (strcmp(ruta, "-") == 0 || esArchivoPNM(ruta)) {
+        return cargarPNM(ruta, info, canalesDeseados);
+    }
+    if (DECODIFICADOR_PNG_PROPIO) {
+        int resultado = cargarPNGPropio(NULL, 0, ruta, info, canalesDeseados);
+        if (resultado >= 0) {
+            return resultado;
+        }
+    }
+
+    int canales;
+    // QUÉ: Cargar imagen con formato original (0 canales = usar formato nativo).
+    // CÓMO: stbi_load lee el archivo y llena ancho, alto y canales (1 a 4). Los
+    // PNG de 16 bits se leen con stbi_load_16 y conservan sus 16 bits.
+    // POR QUÉ: Respetar el formato original asegura que grises, RGB, alfa y la
+    // profundidad se mantengan; stbi_load truncaría los 16 bits (v >> 8).
+    unsigned char* datos;
+    int bits16 = stbi_is_16_bit(ruta);
+    if (bits16) {
+        datos = (unsigned char*)stbi_load_16(ruta, &info->ancho, &info->alto, &canales, 0);
+    } else {
+        datos = stbi_load(ruta, &info->ancho, &info->alto, &canales, 0);
+    }
+    return copiarDesdeSTB(datos, canales, bits16, ruta, info, canalesDeseados);
+}
+
+// QUÉ: Cargar una imagen que ya está en memoria.
+// CÓMO: Ver image_io.h.
+int cargarImagenMemoria(const unsigned char* datos, size_t tam, const char* ruta, ImagenInfo* info,
+                        int canalesDeseados) {
+    if (tam >= 4 && (memcmp(datos, "qoif", 4) == 0 || memcmp(datos, "qoip", 4) == 0)) {
+        return cargarQOIMemoria(datos, tam, ruta, info, canalesDeseados);
+    }
+    // PNM lee la trama directamente en la matriz desde el descriptor: se abre
+    // por la ruta (los bytes ya están en la caché de páginas)
+    if ((tam >= 2 && datos[0] == 'P' && datos[1] >= '5' && datos[1] <= '7') || tam > INT_MAX) {
+        return cargarImagenCanales(ruta, info, canalesDeseados);
+    }
+    if (DECODIFICADOR_PNG_PROPIO && tam >= 8 && memcmp(datos, "\x89PNG", 4) == 0) {
+        int resultado = cargarPNGPropio(datos, tam, ruta, info, canalesDeseados);
+        if (resultado >= 0) {
+            return resultado;
+        }
+    }
+    int canales;
+    int largo = (int)tam;
+    unsigned char* pixeles;
+    int bits16 = stbi_is_16_bit_from_memory(datos, largo);
+    if (bits16) {
+        pixeles = (unsigned char*)stbi_load_16_from_memory(datos, largo, &info->ancho, &info->alto, &canales, 0);
+    } else {
+        pixeles = stbi_load_from_memory(datos, largo, &info->ancho, &info->alto, &canales, 0);
+    }
+    return copiarDesdeSTB(pixeles, canales, bits16, ruta, info, canalesDeseados);
+}
+
 // QUÉ: Mostrar la matriz de píxeles (primeras 10 filas).
-// CÓMO: Imprime los valores de los píxeles, agrupando canales por píxel (grises o RGB).
+// CÓMO: Imprime los valores de los píxeles, agrupando canales por píxel.
 // POR QUÉ: Ayuda a visualizar la matriz para entender la estructura de datos.
 void mostrarMatriz(const ImagenInfo* info) {
     if (!info->pixeles) {
@@ -96,13 +271,21 @@ void mostrarMatriz(const ImagenInfo* info) {
         return;
     }
     printf("Matriz de la imagen (primeras 10 filas):\n");
+    // Con 16 bits cada muestra ocupa hasta 5 cifras
+    int bytes = bytesMuestra(info);
+    int cifras = (bytes == 2) ? 5 : 3;
+    int canales = canalesVisibles(info);
     for (int y = 0; y < info->alto && y < 10; y++) {
         for (int x = 0; x < info->ancho; x++) {
             if (info->canales == 1) {
-                printf("%3u ", info->pixeles[y][x][0]); // Escala de grises
+                printf("%*u ", cifras, leerMuestra(info->pixeles[y][x], 0, bytes)); // Escala de grises
             } else {
-                printf("(%3u,%3u,%3u) ", info->pixeles[y][x][0], info->pixeles[y][x][1],
-                       info->pixeles[y][x][2]); // RGB
+                // Grises + alfa, RGB o RGBA (de RGBX no se muestra el relleno)
+                printf("(");
+                for (int c = 0; c < canales; c++) {
+                    printf(c ? ",%*u" : "%*u", cifras, leerMuestra(info->pixeles[y][x], (size_t)c, bytes));
+                }
+                printf(") ");
             }
         }
         printf("\n");
@@ -112,43 +295,137 @@ void mostrarMatriz(const ImagenInfo* info) {
     }
 }
 
-// QUÉ: Guardar la matriz como PNG (grises o RGB).
-// CÓMO: Aplana la matriz 3D a 1D y usa stbi_write_png con el número de canales correcto.
-// POR QUÉ: Respeta el formato original (grises o RGB) para consistencia.
-int guardarPNG(const ImagenInfo* info, const char* rutaSalida) {
+// QUÉ: Informar de la paleta si el codificador indexó la imagen.
+static void imprimirPaletaPNG(const EstadisticasPNG* estadisticas) {
+    if (estadisticas->coloresPaleta > 0) {
+        printf("  Indexada: %d colores, %d bits por píxel (%s)\n", estadisticas->coloresPaleta,
+               estadisticas->bitsPixel, estadisticas->paletaExacta ? "exacta" : "cuantizada");
+    }
+}
+
+// QUÉ: Guardar la matriz como PNG (1 a 4 canales) con un perfil dado.
+// CÓMO: Codifica con escribirPNGParalelo (png_encoder.c) e informa del
+// tiempo, el ratio y la paleta; si falla, recurre a stbi_write_png sobre el
+// bloque contiguo.
+// POR QUÉ: Mantiene el formato de la imagen (grises, grises + alfa, RGB o
+// RGBA) y la compresión deja de ser el cuello de botella de un solo hilo.
+static int guardarPNGConPerfil(const ImagenInfo* info, const char* rutaSalida, PerfilPNG perfil) {
     if (!info->pixeles) {
         fprintf(stderr, "No hay imagen para guardar.\n");
         return 0;
     }
 
-    // QUÉ: Aplanar matriz 3D a 1D para stb.
-    // CÓMO: Copia píxeles en orden [y][x][c] a un arreglo plano.
-    // POR QUÉ: stb_write_png requiere datos contiguos.
-    unsigned char* datos1D = (unsigned char*)malloc(info->ancho * info->alto * info->canales);
-    if (!datos1D) {
-        fprintf(stderr, "Error de memoria al aplanar imagen\n");
-        return 0;
+    // QUÉ: Guardar como PNG.
+    // CÓMO: El codificador paralelo (png_encoder.c) filtra y comprime con
+    // NUM_HILOS_GLOBAL hilos y el perfil indicado; si falla (por
+    // ejemplo, sin memoria para el búfer filtrado) se recurre a
+    // stbi_write_png, que lee del bloque contiguo.
+    // POR QUÉ: Mantiene el formato (1 a 4 canales) y la compresión deja de
+    // ser el cuello de botella de un solo hilo.
+    EstadisticasPNG estadisticas;
+    int resultado = escribirPNGParalelo(info, rutaSalida, perfil, &estadisticas);
+    if (resultado) {
+        // Tiempo y ratio para elegir el perfil adecuado en cada etapa
+        printf("Imagen guardada en: %s (%s)\n", rutaSalida, nombreFormatoImagen(info));
+        printf("  Perfil %s: %.3f s, %zu -> %zu bytes (ratio %.2f:1)\n",
+               nombrePerfilPNG(perfil), estadisticas.segundos,
+               estadisticas.bytesCrudos, estadisticas.bytesArchivo,
+               (double)estadisticas.bytesCrudos / (double)estadisticas.bytesArchivo);
+        imprimirPaletaPNG(&estadisticas);
+        return 1;
     }
-    for (int y = 0; y < info->alto; y++) {
-        for (int x = 0; x < info->ancho; x++) {
-            for (int c = 0; c < info->canales; c++) {
-                datos1D[(y * info->ancho + x) * info->canales + c] = info->pixeles[y][x][c];
-            }
-        }
+    // stb solo escribe 8 bits y sin relleno: una imagen de 16 se redondea antes
+    ImagenInfo ocho = {0, 0, 0, 0, 0, NULL};
+    if (!imagenParaGuardar(info, &ocho, 0)) {
+        return 0;
     }
-
-    // QUÉ: Guardar como PNG.
-    // CÓMO: Usa stbi_write_png con los canales de la imagen original.
-    // POR QUÉ: Mantiene el formato (grises o RGB) de la entrada.
-    int resultado = stbi_write_png(rutaSalida, info->ancho, info->alto, info->canales,
-                                   datos1D, info->ancho * info->canales);
-    free(datos1D);
+    resultado = stbi_write_png(rutaSalida, ocho.ancho, ocho.alto, ocho.canales,
+                               ocho.pixeles[0][0], ocho.ancho * ocho.canales);
+    liberarImagen(&ocho);
     if (resultado) {
-        printf("Imagen guardada en: %s (%s)\n", rutaSalida,
-               info->canales == 1 ? "grises" : "RGB");
+        printf("Imagen guardada en: %s (%s, stb_image_write)\n", rutaSalida,
+               nombreFormato(canalesVisibles(info)));
         return 1;
     } else {
         fprintf(stderr, "Error al guardar PNG: %s\n", rutaSalida);
         return 0;
     }
 }
+
+int guardarPNG(const ImagenInfo* info, const char* rutaSalida) {
+    return guardarPNGConPerfil(info, rutaSalida, PERFIL_PNG_GLOBAL);
+}
+
+// QUÉ: ¿La ruta de salida pide PNM (extensión o "-" para la salida estándar)?
+static int esSalidaPNM(const char* rutaSalida) {
+    const char* extension = strrchr(rutaSalida, '.');
+    return strcmp(rutaSalida, "-") == 0 ||
+           (extension && (strcmp(extension, ".pgm") == 0 || strcmp(extension, ".ppm") == 0 ||
+                          strcmp(extension, ".pnm") == 0 || strcmp(extension, ".pam") == 0));
+}
+
+// QUÉ: Guardar la imagen eligiendo el formato por la extensión de la ruta.
+// CÓMO: ".qoi" -> QOI estándar, ".qoip" -> contenedor QOI de franjas paralelas,
+// ".pgm"/".ppm"/".pnm"/".pam" o "-" (salida estándar) -> PNM (PAM si hay
+// alfa), cualquier otra -> PNG.
+// POR QUÉ: Los archivos intermedios y de caché pueden ir en QOI, mucho más
+// rápido, sin cambiar el flujo del menú.
+int guardarImagen(const ImagenInfo* info, const char* rutaSalida) {
+    return guardarImagenConPerfil(info, rutaSalida, PERFIL_PNG_GLOBAL);
+}
+
+// QUÉ: guardarImagen con un perfil PNG fijo en vez de PERFIL_PNG_GLOBAL.
+int guardarImagenConPerfil(const ImagenInfo* info, const char* rutaSalida, PerfilPNG perfil) {
+    const char* extension = strrchr(rutaSalida, '.');
+    if (esSalidaPNM(rutaSalida)) {
+        return guardarPNM(info, rutaSalida);
+    }
+    if (extension && strcmp(extension, ".qoi") == 0) {
+        return guardarQOI(info, rutaSalida);
+    }
+    if (extension && strcmp(extension, ".qoip") == 0) {
+        return guardarQOIParalelo(info, rutaSalida);
+    }
+    return guardarPNGConPerfil(info, rutaSalida, perfil);
+}
+
+// QUÉ: Codificar la imagen en memoria con el formato de la ruta de salida.
+// CÓMO: Ver image_io.h. Mismos mensajes que guardarPNG, también con el
+// respaldo de stb (stbi_write_png_to_mem).
+int codificarImagenMemoria(const ImagenInfo* info, const char* rutaSalida, unsigned char** datos,
+                           size_t* tam) {
+    const char* extension = strrchr(rutaSalida, '.');
+    if (esSalidaPNM(rutaSalida) ||
+        (extension && (strcmp(extension, ".qoi") == 0 || strcmp(extension, ".qoip") == 0))) {
+        return -1;
+    }
+    if (!info->pixeles) {
+        fprintf(stderr, "No hay imagen para guardar.\n");
+        return 0;
+    }
+    EstadisticasPNG estadisticas;
+    if (codificarPNGParaleloMemoria(info, PERFIL_PNG_GLOBAL, datos, tam, &estadisticas)) {
+        printf("Imagen codificada para: %s (%s)\n", rutaSalida, nombreFormatoImagen(info));
+        printf("  Perfil %s: %.3f s, %zu -> %zu bytes (ratio %.2f:1)\n",
+               nombrePerfilPNG(PERFIL_PNG_GLOBAL), estadisticas.segundos,
+               estadisticas.bytesCrudos, estadisticas.bytesArchivo,
+               (double)estadisticas.bytesCrudos / (double)estadisticas.bytesArchivo);
+        imprimirPaletaPNG(&estadisticas);
+        return 1;
+    }
+    int largo = 0;
+    ImagenInfo ocho = {0, 0, 0, 0, 0, NULL};
+    if (!imagenParaGuardar(info, &ocho, 0)) {
+        return 0;
+    }
+    *datos = stbi_write_png_to_mem(ocho.pixeles[0][0], ocho.ancho * ocho.canales, ocho.ancho, ocho.alto,
+                                   ocho.canales, &largo);
+    liberarImagen(&ocho);
+    if (!*datos) {
+        fprintf(stderr, "Error al codificar PNG: %s\n", rutaSalida);
+        return 0;
+    }
+    *tam = (size_t)largo;
+    printf("Imagen codificada para: %s (%s, stb_image_write)\n", rutaSalida, nombreFormato(info->canales));
+    return 1;
+}
@@ -26,6 +26,7 @@
 #define _GNU_SOURCE
 #include "image_rotation.h"
 #include "threading.h"
+#include "srgb.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
@@ -107,6 +108,88 @@ unsigned char bilinearInterpolate(unsigned char*** pixels, float x, float y,
     return clamp((int)value);
 }
 
+/**
+ * @brief Bilinear interpolation in linear light (gamma-correct)
+ * @details Same sampling as bilinearInterpolate(), but the four neighbours are
+ *          first decoded to 16-bit linear values through SRGB_A_LINEAL and the
+ *          weighted average is encoded back with the 4096-entry LINEAL_A_SRGB
+ *          table, so bright/dark edges keep their perceived brightness.
+ *
+ * @note Requires inicializarTablasSRGB() to have been called
+ */
+static unsigned char bilinearInterpolateLinear(unsigned char*** pixels, float x, float y,
+                                               int width, int height, int channel) {
+    if (x < 0 || x >= width - 1 || y < 0 || y >= height - 1) {
+        int xi = (int)(x < 0 ? 0 : (x >= width ? width - 1 : x));
+        int yi = (int)(y < 0 ? 0 : (y >= height ? height - 1 : y));
+        return pixels[yi][xi][channel];
+    }
+
+    int x0 = (int)floor(x);
+    int y0 = (int)floor(y);
+    float dx = x - x0;
+    float dy = y - y0;
+
+    float p00 = SRGB_A_LINEAL[pixels[y0][x0][channel]];
+    float p10 = SRGB_A_LINEAL[pixels[y0][x0 + 1][channel]];
+    float p01 = SRGB_A_LINEAL[pixels[y0 + 1][x0][channel]];
+    float p11 = SRGB_A_LINEAL[pixels[y0 + 1][x0 + 1][channel]];
+
+    float value = p00 * (1 - dx) * (1 - dy) +
+                  p10 * dx * (1 - dy) +
+                  p01 * (1 - dx) * dy +
+                  p11 * dx * dy;
+
+    int linear = (int)(value + 0.5f);
+    if (linear > 65535) linear = 65535;
+    return linealASRGB((unsigned int)linear);
+}
+
+/**
+ * @brief Bilinear interpolation for 16-bit images
+ * @details Same sampling as bilinearInterpolate(), on native-endian unsigned
+ *          short samples clamped to [0, 65535]. With @p linear set the four
+ *          neighbours are decoded through SRGB16_A_LINEAL and the result is
+ *          encoded back with LINEAL16_A_SRGB, keeping the full 16-bit precision.
+ *
+ * @note With @p linear set, requires inicializarTablasSRGB16() to have been called
+ */
+static unsigned short bilinearInterpolate16(unsigned char*** pixels, float x, float y,
+                                            int width, int height, int channel, int linear) {
+    if (x < 0 || x >= width - 1 || y < 0 || y >= height - 1) {
+        int xi = (int)(x < 0 ? 0 : (x >= width ? width - 1 : x));
+        int yi = (int)(y < 0 ? 0 : (y >= height ? height - 1 : y));
+        return ((const unsigned short*)pixels[yi][xi])[channel];
+    }
+
+    int x0 = (int)floor(x);
+    int y0 = (int)floor(y);
+    float dx = x - x0;
+    float dy = y - y0;
+
+    unsigned int s00 = ((const unsigned short*)pixels[y0][x0])[channel];
+    unsigned int s10 = ((const unsigned short*)pixels[y0][x0 + 1])[channel];
+    unsigned int s01 = ((const unsigned short*)pixels[y0 + 1][x0])[channel];
+    unsigned int s11 = ((const unsigned short*)pixels[y0 + 1][x0 + 1])[channel];
+    float p00 = linear ? SRGB16_A_LINEAL[s00] : s00;
+    float p10 = linear ? SRGB16_A_LINEAL[s10] : s10;
+    float p01 = linear ? SRGB16_A_LINEAL[s01] : s01;
+    float p11 = linear ? SRGB16_A_LINEAL[s11] : s11;
+
+    float value = p00 * (1 - dx) * (1 - dy) +
+                  p10 * dx * (1 - dy) +
+                  p01 * (1 - dx) * dy +
+                  p11 * dx * dy;
+
+    if (!linear) {
+        int sample = (int)value;
+        return (unsigned short)(sample < 0 ? 0 : (sample > 65535 ? 65535 : sample));
+    }
+    int linearValue = (int)(value + 0.5f);
+    if (linearValue > 65535) linearValue = 65535;
+    return LINEAL16_A_SRGB[linearValue];
+}
+
 /**
  * @brief Calculates optimal dimensions for rotated image bounding box
  * @details Computes the minimum bounding rectangle that contains the entire
@@ -197,6 +280,14 @@ void* rotateImageThread(void* args) {
     float destCenterX = rArgs->destWidth / 2.0f;
     float destCenterY = rArgs->destHeight / 2.0f;
 
+    int alphaChannel = imagenConAlfa(rArgs->srcInfo) ? rArgs->channels - 1 : -1;
+    int wideSamples = bytesMuestra(rArgs->srcInfo) == 2;
+    // RGBX padding is not interpolated: it stays at the maximum sample value,
+    // even outside the source where the color channels fall back to black
+    int colorChannels = canalesVisibles(rArgs->srcInfo);
+    int padding = colorChannels < rArgs->channels;
+    int paddingValue = maximoMuestra(rArgs->srcInfo);
+
     // Process assigned rows in destination image
     for (int destY = rArgs->rowStart; destY < rArgs->rowEnd; destY++) {
         for (int destX = 0; destX < rArgs->destWidth; destX++) {
@@ -208,9 +299,26 @@ void* rotateImageThread(void* args) {
             float srcX = dx * cosAngle - dy * sinAngle + srcCenterX;
             float srcY = dx * sinAngle + dy * cosAngle + srcCenterY;
 
-            // Interpolate pixel value from source image
-            for (int c = 0; c < rArgs->channels; c++) {
-                rArgs->destPixels[destY][destX][c] = 
+            // Interpolate pixel value from source image (alpha is already
+            // linear, so it never goes through the sRGB tables)
+            if (wideSamples) {
+                unsigned short* dest = (unsigned short*)rArgs->destPixels[destY][destX];
+                for (int c = 0; c < colorChannels; c++) {
+                    dest[c] = bilinearInterpolate16(rArgs->srcInfo->pixeles, srcX, srcY, rArgs->srcWidth,
+                                                    rArgs->srcHeight, c, rArgs->linearLight && c != alphaChannel);
+                }
+                if (padding) {
+                    dest[colorChannels] = (unsigned short)paddingValue;
+                }
+                continue;
+            }
+            if (padding) {
+                rArgs->destPixels[destY][destX][colorChannels] = (unsigned char)paddingValue;
+            }
+            for (int c = 0; c < colorChannels; c++) {
+                rArgs->destPixels[destY][destX][c] = (rArgs->linearLight && c != alphaChannel) ?
+                    bilinearInterpolateLinear(rArgs->srcInfo->pixeles, srcX, srcY,
+                                              rArgs->srcWidth, rArgs->srcHeight, c) :
                     bilinearInterpolate(rArgs->srcInfo->pixeles, srcX, srcY,
                                        rArgs->srcWidth, rArgs->srcHeight, c);
             }
@@ -261,46 +369,20 @@ int rotateImageConcurrent(ImagenInfo* info, float angle) {
     printf("Rotating image by %.2f degrees (original: %dx%d, new: %dx%d)\n",
            angle, info->ancho, info->alto, newWidth, newHeight);
 
-    // Allocate memory for destination image buffer
-    unsigned char*** newPixels = 
-        (unsigned char***)malloc(newHeight * sizeof(unsigned char**));
-    if (!newPixels) {
+    // Allocate memory for destination image buffer (contiguous rows)
+    ImagenInfo rotated;
+    if (!crearImagenComo(&rotated, info, newWidth, newHeight)) {
         fprintf(stderr, "Error: Memory allocation failed for rotated image\n");
         return 0;
     }
-
-    for (int y = 0; y < newHeight; y++) {
-        newPixels[y] = (unsigned char**)malloc(newWidth * sizeof(unsigned char*));
-        if (!newPixels[y]) {
-            fprintf(stderr, "Error: Memory allocation failed at row %d\n", y);
-            // Clean up partial allocation on failure
-            for (int i = 0; i < y; i++) {
-                for (int x = 0; x < newWidth; x++) {
-                    free(newPixels[i][x]);
-                }
-                free(newPixels[i]);
-            }
-            free(newPixels);
-            return 0;
-        }
-        
-        for (int x = 0; x < newWidth; x++) {
-            newPixels[y][x] = 
-                (unsigned char*)malloc(info->canales * sizeof(unsigned char));
-            if (!newPixels[y][x]) {
-                fprintf(stderr, "Error: Memory allocation failed at pixel (%d,%d)\n", 
-                       x, y);
-                // Clean up partial allocation on failure
-                for (int i = 0; i <= y; i++) {
-                    int maxX = (i == y) ? x : newWidth;
-                    for (int j = 0; j < maxX; j++) {
-                        free(newPixels[i][j]);
-                    }
-                    free(newPixels[i]);
-                }
-                free(newPixels);
-                return 0;
-            }
+    unsigned char*** newPixels = rotated.pixeles;
+
+    // Linear-light interpolation needs the sRGB conversion tables
+    int linearLight = LUZ_LINEAL_GLOBAL;
+    if (linearLight) {
+        inicializarTablasSRGB();
+        if (bytesMuestra(info) == 2) {
+            inicializarTablasSRGB16();
         }
     }
 
@@ -323,6 +405,7 @@ int rotateImageConcurrent(ImagenInfo* info, float angle) {
         threadArgs[i].srcWidth = info->ancho;
         threadArgs[i].srcHeight = info->alto;
         threadArgs[i].channels = info->canales;
+        threadArgs[i].linearLight = linearLight;
 
         if (pthread_create(&threads[i], NULL, rotateImageThread, 
                           &threadArgs[i]) != 0) {
@@ -331,13 +414,7 @@ int rotateImageConcurrent(ImagenInfo* info, float angle) {
             for (int j = 0; j < i; j++) {
                 pthread_join(threads[j], NULL);
             }
-            for (int y = 0; y < newHeight; y++) {
-                for (int x = 0; x < newWidth; x++) {
-                    free(newPixels[y][x]);
-                }
-                free(newPixels[y]);
-            }
-            free(newPixels);
+            liberarImagen(&rotated);
             return 0;
         }
     }
@@ -347,22 +424,14 @@ int rotateImageConcurrent(ImagenInfo* info, float angle) {
         pthread_join(threads[i], NULL);
     }
 
-    // Deallocate original image memory to prevent memory leaks
-    for (int y = 0; y < info->alto; y++) {
-        for (int x = 0; x < info->ancho; x++) {
-            free(info->pixeles[y][x]);
-        }
-        free(info->pixeles[y]);
-    }
-    free(info->pixeles);
-
-    // Update image structure with rotated data
-    info->pixeles = newPixels;
-    info->ancho = newWidth;
-    info->alto = newHeight;
+    // Deallocate original image memory and adopt the rotated buffer
+    liberarImagen(info);
+    *info = rotated;
 
-    printf("Image rotation completed concurrently with %d threads (%s)\n",
-           NUM_THREADS, info->canales == 1 ? "grayscale" : "RGB");
+    static const char* formatNames[5] = {"?", "grayscale", "grayscale+alpha", "RGB", "RGBA"};
+    printf("Image rotation completed concurrently with %d threads (%s%s%s)\n",
+           NUM_THREADS, formatNames[canalesVisibles(info)], bytesMuestra(info) == 2 ? ", 16-bit" : "",
+           linearLight ? ", linear light" : "");
 
     return 1;
 }
\ No newline at end of file
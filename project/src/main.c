@@ -1,6 +1,7 @@
 // Programa de procesamiento de imágenes en C para principiantes en Linux.
 // QUÉ: Procesa imágenes PNG (escala de grises o RGB) usando matrices, con soporte
-// para carga, visualización, guardado y ajuste de brillo concurrente.
+// para carga, visualización, guardado en segundo plano y ajuste de brillo
+// concurrente.
 // CÓMO: Usa stb_image.h para cargar PNG y stb_image_write.h para guardar PNG,
 // con hilos POSIX (pthread) para el procesamiento paralelo del brillo.
 // POR QUÉ: Diseñado para enseñar manejo de matrices, concurrencia y gestión de
@@ -12,10 +13,13 @@
 //
 // Compilar: make
 // Ejecutar: ./img [ruta_imagen.png]
+// Convertir: ./img entrada salida   ("-" = stdin/stdout en formato PNM)
+// Lotes:     ./img -i 'fotos/*.png' -p 'blur:5|sobel' -o 'salida/{name}.png'  (ver --help)
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "image.h"
 #include "image_io.h"
 #include "filters.h"
@@ -23,6 +27,20 @@
 #include "benchmark.h"
 #include "image_rotation.h"
 #include "scaling.h"
+#include "pyramid.h"
+#include "deepzoom.h"
+#include "thumbnail.h"
+#include "srgb.h"
+#include "png_encoder.h"
+#include "pnm.h"
+#include "batch.h"
+#include "cli.h"
+#include "guardado.h"
+#include "paleta.h"
+#include "operaciones.h"
+#include "perezoso.h"
+#include "historial.h"
+#include "cache.h"
 
 // QUÉ: Mostrar el menú interactivo.
 // CÓMO: Imprime opciones y espera entrada del usuario.
@@ -32,9 +50,9 @@ void mostrarMenu() {
     printf("║   Plataforma de Edición de Imágenes - Linux C      ║\n");
     printf("╚══════════════════════════════════════════════════════╝\n");
     printf("  0. Benchmark de paralelización (prueba automática)\n");
-    printf("  1. Cargar imagen PNG\n");
+    printf("  1. Cargar imagen (PNG/QOI/PNM)\n");
     printf("  2. Mostrar matriz de píxeles\n");
-    printf("  3. Guardar como PNG\n");
+    printf("  3. Guardar imagen en segundo plano (.png, .qoi, .qoip, .pgm o .ppm)\n");
     printf("  4. Ajustar brillo (+/- valor) concurrentemente\n");
     printf("  5. Aplicar convolución Gaussiana (blur)\n");
     printf("  6. Aplicar detector de bordes Sobel\n");
@@ -42,18 +60,140 @@ void mostrarMenu() {
     printf("  8. Escalar imagen\n");
     printf("  9. Configurar número de hilos (actual: %d)\n", NUM_HILOS_GLOBAL);
     printf(" 10. Información del sistema\n");
-    printf(" 11. Salir\n");
+    printf(" 11. Generar pirámide de niveles (mipmaps)\n");
+    printf(" 12. Exportar teselas Deep Zoom / XYZ\n");
+    printf(" 13. Generar miniatura desde archivo (memoria constante)\n");
+    printf(" 14. Interpolación en luz lineal (actual: %s)\n", LUZ_LINEAL_GLOBAL ? "activada" : "desactivada");
+    printf(" 15. Perfil de compresión PNG (actual: %s)\n", nombrePerfilPNG(PERFIL_PNG_GLOBAL));
+    printf(" 16. Procesar lote de archivos (tubería decodificar/procesar/codificar)\n");
+    printf(" 17. Paleta PNG (actual: %s, %d colores)\n", nombreModoPaleta(MODO_PALETA_GLOBAL),
+           COLORES_PALETA_GLOBAL);
+    printf(" 18. Evaluación perezosa (actual: %s)\n", MODO_PEREZOSO_GLOBAL ? "activada" : "desactivada");
+    printf(" 19. Ajustar brillo en una región\n");
+    printf(" 20. Deshacer\n");
+    printf(" 21. Rehacer\n");
+    printf(" 22. Ver historial de versiones y memoria\n");
+    printf(" 23. Caché de resultados (actual: %s)\n", cacheActiva() ? "activada" : "desactivada");
+    printf(" 24. Salir\n");
+    imprimirEstadoGuardados();
+    imprimirPendientes();
+    imprimirEstadoHistorial();
+    imprimirEstadoCache();
     printf("─────────────────────────────────────────────────────\n");
     printf("Opción: ");
 }
 
+// QUÉ: Operaciones del lote de la opción 16.
+// CÓMO: Adaptan los filtros a la firma ProcesarImagenFn de batch.h.
+static int loteDesenfocar(ImagenInfo* imagen, void* contexto) {
+    (void)contexto;
+    return aplicarConvolucionGaussiana(imagen, 5, 1.0f);
+}
+
+static int loteSobel(ImagenInfo* imagen, void* contexto) {
+    (void)contexto;
+    return aplicarSobel(imagen);
+}
+
+// QUÉ: Aplicar una operación del menú a la imagen, o posponerla.
+// CÓMO: En modo perezoso solo se añade a la cadena pendiente (perezoso.h).
+// Si no, con la caché activada (opción 23) se busca el resultado (cache.h):
+// en un acierto la imagen se sustituye por el resultado guardado. En un
+// fallo, o sin caché, se aplica con su filtro de imagen completa; si el
+// filtro escribe en su sitio, antes se copia lo que comparten guardados o
+// historial (prepararEdicion). Después se registra en el historial; si el
+// filtro falla, que pudo escribir parte, la imagen vuelve a la versión
+// actual.
+// POR QUÉ: Sin caché no se hashea la entrada ni se copia el resultado: en el
+// menú casi nunca se repite una operación sobre la misma imagen.
+static void aplicarOPosponer(ImagenInfo* imagen, const Operacion* op) {
+    if (!imagenCargada(imagen)) {
+        printf("\n❌ Debes cargar una imagen primero (opción 1).\n");
+        return;
+    }
+    if (MODO_PEREZOSO_GLOBAL) {
+        posponerOperacion(op);
+        return;
+    }
+    CadenaOperaciones una = {(Operacion*)op, 1};
+    char descripcion[96];
+    describirCadena(&una, descripcion, sizeof(descripcion));
+    // Los filtros que crean una imagen nueva leen la del historial sin copiarla
+    int enSuSitio = operacionEnSuSitio(op, imagen->canales);
+    if (!cacheActiva()) {
+        if (enSuSitio && !prepararEdicion(imagen, 0, 0, imagen->ancho, imagen->alto)) {
+            return;
+        }
+        if (!aplicarOperacion(imagen, op)) {
+            // Puede haber escrito parte de la imagen antes de fallar
+            restaurarVersionActual(imagen);
+            return;
+        }
+    } else {
+        ClaveCache clave = {hashImagen(imagen), hashCadena(&una)};
+        ImagenInfo resultado = {0, 0, 0, 0, 0, NULL};
+        if (buscarEnCache(&clave, &resultado)) {
+            soltarImagen(imagen);
+            *imagen = resultado;
+            printf("✓ %s: resultado reutilizado de la caché (%dx%d, %s)\n", descripcion, imagen->ancho,
+                   imagen->alto, nombreFormatoImagen(imagen));
+        } else if (enSuSitio && !prepararEdicion(imagen, 0, 0, imagen->ancho, imagen->alto)) {
+            abandonarClaveCache(&clave);
+            return;
+        } else if (aplicarOperacion(imagen, op)) {
+            guardarEnCache(&clave, imagen);
+        } else {
+            abandonarClaveCache(&clave);
+            restaurarVersionActual(imagen);
+            return;
+        }
+    }
+    registrarVersionCompleta(imagen, descripcion);
+}
+
+// QUÉ: Descripción de la versión inicial del historial.
+static void iniciarHistorialCargada(const ImagenInfo* imagen, const char* origen, const char* ruta) {
+    char descripcion[96];
+    snprintf(descripcion, sizeof(descripcion), "%s %s", origen, ruta);
+    iniciarHistorial(imagen, descripcion);
+}
+
 // QUÉ: Función principal que controla el flujo del programa.
 // CÓMO: Maneja entrada CLI, ejecuta el menú en bucle y llama funciones según opción.
 // POR QUÉ: Centraliza la lógica y asegura limpieza al salir.
 int main(int argc, char* argv[]) {
-    ImagenInfo imagen = {0, 0, 0, NULL}; // Inicializar estructura
+    ImagenInfo imagen = {0, 0, 0, 0, 0, NULL}; // Inicializar estructura
     char ruta[256] = {0}; // Buffer para ruta de archivo
 
+    // QUÉ: Modo por lotes sin menú cuando el primer argumento es una opción.
+    // POR QUÉ: "-" solo sigue siendo la entrada estándar del modo conversión.
+    if (argc > 1 && argv[1][0] == '-' && argv[1][1] != 0) {
+        return ejecutarCLI(argc, argv);
+    }
+
+    // QUÉ: Conversión directa sin menú: ./img entrada salida.
+    // CÓMO: Carga y guarda con el formato de cada ruta; "-" es la entrada o
+    // salida estándar en PNM. Con salida "-", stdout se reserva para la imagen
+    // y los mensajes se redirigen a stderr.
+    // POR QUÉ: Permite usar el programa dentro de una tubería sin archivos temporales.
+    if (argc > 2) {
+        MODO_INTERACTIVO = 0;
+        int salidaEstandar = (strcmp(argv[2], "-") == 0);
+        int fdDatos = STDOUT_FILENO;
+        if (salidaEstandar) {
+            fflush(stdout);
+            fdDatos = dup(STDOUT_FILENO);
+            if (fdDatos < 0 || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+                perror("dup");
+                return EXIT_FAILURE;
+            }
+        }
+        int ok = cargarImagen(argv[1], &imagen) &&
+                 (salidaEstandar ? escribirPNM(&imagen, fdDatos) : guardarImagen(&imagen, argv[2]));
+        liberarImagen(&imagen);
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     // QUÉ: Cargar imagen desde CLI si se pasa.
     // CÓMO: Copia argv[1] y llama cargarImagen.
     // POR QUÉ: Permite ejecución directa con ./img imagen.png.
@@ -62,6 +202,7 @@ int main(int argc, char* argv[]) {
         if (!cargarImagen(ruta, &imagen)) {
             return EXIT_FAILURE;
         }
+        iniciarHistorialCargada(&imagen, "cargar", ruta);
     }
 
     int opcion;
@@ -83,36 +224,50 @@ int main(int argc, char* argv[]) {
                     printf("\n❌ Debes cargar una imagen primero (opción 1).\n");
                     break;
                 }
+                // El benchmark cambia NUM_HILOS_GLOBAL y aplica el blur a la imagen
+                esperarGuardados();
+                if (!materializarImagen(&imagen) || !prepararModificacion(&imagen)) {
+                    break;
+                }
                 ejecutarBenchmark(&imagen);
+                registrarVersionCompleta(&imagen, "benchmark (blur)");
                 break;
             }
             case 1: { // Cargar imagen
-                printf("Ingresa la ruta del archivo PNG: ");
+                printf("Ingresa la ruta del archivo (PNG, QOI o PNM): ");
                 if (fgets(ruta, sizeof(ruta), stdin) == NULL) {
                     printf("Error al leer ruta.\n");
                     continue;
                 }
                 ruta[strcspn(ruta, "\n")] = 0; // Eliminar salto de línea
-                liberarImagen(&imagen); // Liberar imagen previa
+                soltarImagen(&imagen); // Liberar imagen previa (o dejarla a los guardados pendientes)
+                descartarPendientes();
+                liberarHistorial();
                 if (!cargarImagen(ruta, &imagen)) {
                     continue;
                 }
+                iniciarHistorialCargada(&imagen, "cargar", ruta);
                 break;
             }
             case 2: // Mostrar matriz
-                mostrarMatriz(&imagen);
+                if (materializarImagen(&imagen)) {
+                    mostrarMatriz(&imagen);
+                }
                 break;
-            case 3: { // Guardar PNG
+            case 3: { // Guardar imagen (formato según extensión)
                 char nombreArchivo[256];
                 char rutaCompleta[512];
-                printf("Nombre del archivo PNG de salida: ");
+                printf("Nombre del archivo de salida (.png, .qoi, .qoip, .pgm o .ppm): ");
                 if (fgets(nombreArchivo, sizeof(nombreArchivo), stdin) == NULL) {
                     printf("Error al leer ruta.\n");
                     continue;
                 }
                 nombreArchivo[strcspn(nombreArchivo, "\n")] = 0;
                 snprintf(rutaCompleta, sizeof(rutaCompleta), "results/%s", nombreArchivo);
-                guardarPNG(&imagen, rutaCompleta);
+                // Se codifica en segundo plano sobre una instantánea; el menú sigue
+                if (materializarImagen(&imagen)) {
+                    guardarEnSegundoPlano(&imagen, rutaCompleta);
+                }
                 break;
             }
             case 4: { // Ajustar brillo
@@ -124,7 +279,8 @@ int main(int argc, char* argv[]) {
                     continue;
                 }
                 while (getchar() != '\n');
-                ajustarBrilloConcurrente(&imagen, delta);
+                Operacion op = {OP_BRILLO, {delta, 0, 0}, 0.0f};
+                aplicarOPosponer(&imagen, &op);
                 break;
             }
             case 5: { // Convolución Gaussiana
@@ -143,11 +299,13 @@ int main(int argc, char* argv[]) {
                     continue;
                 }
                 while (getchar() != '\n');
-                aplicarConvolucionGaussiana(&imagen, tamKernel, sigma);
+                Operacion op = {OP_BLUR, {tamKernel, 0, 0}, sigma};
+                aplicarOPosponer(&imagen, &op);
                 break;
             }
             case 6: { // Sobel
-                aplicarSobel(&imagen);
+                Operacion op = {OP_SOBEL, {0, 0, 0}, 0.0f};
+                aplicarOPosponer(&imagen, &op);
                 break;
             }
             case 7: { // Rotar imagen
@@ -159,16 +317,37 @@ int main(int argc, char* argv[]) {
                     continue;
                 }
                 while (getchar() != '\n');
-                rotateImageConcurrent(&imagen, angulo);
+                Operacion op = {OP_ROTAR, {0, 0, 0}, (float)angulo};
+                aplicarOPosponer(&imagen, &op);
                 break;
             }
             case 8:{
-                int newWidth, newHeight;
+                int newWidth, newHeight, modo;
                 printf("Nuevo ancho: ");
-                scanf("%d", &newWidth);
+                if (scanf("%d", &newWidth) != 1) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
                 printf("Nuevo alto: ");
-                scanf("%d", &newHeight);
-                scaleImageConcurrently(&imagen, newWidth, newHeight);
+                if (scanf("%d", &newHeight) != 1) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                printf("Modo (0=automático, 1=bilineal, 2=promedio de área, 3=vecino más cercano): ");
+                if (scanf("%d", &modo) != 1 || modo < SCALE_AUTO || modo > SCALE_NEAREST) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                if (newWidth <= 0 || newHeight <= 0) {
+                    fprintf(stderr, "ERROR: Dimensiones inválidas (%dx%d)\n", newWidth, newHeight);
+                    break;
+                }
+                Operacion op = {OP_ESCALAR, {newWidth, newHeight, modo}, 0.0f};
+                aplicarOPosponer(&imagen, &op);
                 break;
             }
             case 9: { // Configurar hilos
@@ -188,17 +367,324 @@ int main(int argc, char* argv[]) {
                     continue;
                 }
 
+                // El codificador de los guardados pendientes lee NUM_HILOS_GLOBAL
+                esperarGuardados();
                 NUM_HILOS_GLOBAL = nuevoNumHilos;
                 printf("✓ Número de hilos configurado a: %d\n", NUM_HILOS_GLOBAL);
                 printf("INFO: Este cambio afectará todas las operaciones futuras.\n");
                 break;
             }
             case 10: { // Información del sistema
+                materializarImagen(&imagen);
                 mostrarInformacion(&imagen);
+                if (cacheActiva()) {
+                    imprimirEstadisticasCache();
+                }
+                break;
+            }
+            case 11: { // Pirámide de niveles
+                if (!imagenCargada(&imagen) || !materializarImagen(&imagen)) {
+                    break;
+                }
+                int filtro;
+                char base[200];
+                printf("Filtro (0=caja, 1=gaussiano): ");
+                if (scanf("%d", &filtro) != 1 || (filtro != PIRAMIDE_CAJA && filtro != PIRAMIDE_GAUSSIANA)) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                printf("Nombre base de los niveles (se guardan en results/): ");
+                if (fgets(base, sizeof(base), stdin) == NULL) {
+                    printf("Error al leer nombre.\n");
+                    continue;
+                }
+                base[strcspn(base, "\n")] = 0;
+
+                Piramide piramide;
+                if (!construirPiramide(&imagen, &piramide, (FiltroPiramide)filtro)) {
+                    break;
+                }
+                for (int l = 0; l < piramide.numNiveles; l++) {
+                    char rutaNivel[512];
+                    snprintf(rutaNivel, sizeof(rutaNivel), "results/%s_nivel%d.png", base, l);
+                    guardarPNG(&piramide.niveles[l], rutaNivel);
+                }
+                liberarPiramide(&piramide);
+                break;
+            }
+            case 12: { // Exportar teselas
+                if (!imagenCargada(&imagen) || !materializarImagen(&imagen)) {
+                    break;
+                }
+                int formato;
+                char base[200];
+                char rutaBase[512];
+                printf("Formato (0=DeepZoom .dzi, 1=XYZ z/x/y): ");
+                if (scanf("%d", &formato) != 1 || (formato != TESELAS_DEEPZOOM && formato != TESELAS_XYZ)) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                printf("Nombre base de la exportación (se guarda en results/): ");
+                if (fgets(base, sizeof(base), stdin) == NULL) {
+                    printf("Error al leer nombre.\n");
+                    continue;
+                }
+                base[strcspn(base, "\n")] = 0;
+                snprintf(rutaBase, sizeof(rutaBase), "results/%s", base);
+
+                OpcionesTeselas opciones;
+                opciones.tamTesela = 256;
+                opciones.solapamiento = (formato == TESELAS_DEEPZOOM) ? 1 : 0;
+                opciones.formato = (FormatoTeselas)formato;
+                exportarTeselas(&imagen, rutaBase, &opciones);
+                break;
+            }
+            case 13: { // Miniatura en flujo
+                char rutaOrigen[256];
+                int lado;
+                printf("Ruta del PNG de origen: ");
+                if (fgets(rutaOrigen, sizeof(rutaOrigen), stdin) == NULL) {
+                    printf("Error al leer ruta.\n");
+                    continue;
+                }
+                rutaOrigen[strcspn(rutaOrigen, "\n")] = 0;
+                printf("Lado máximo de la miniatura (px): ");
+                if (scanf("%d", &lado) != 1 || lado < 1) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+
+                ImagenInfo miniatura = {0, 0, 0, 0, 0, NULL};
+                if (!generarMiniatura(rutaOrigen, lado, &miniatura)) {
+                    break;
+                }
+                // La miniatura pasa a ser la imagen actual (se guarda con la opción 3)
+                soltarImagen(&imagen);
+                descartarPendientes();
+                imagen = miniatura;
+                iniciarHistorialCargada(&imagen, "miniatura de", rutaOrigen);
+                printf("Miniatura generada: %dx%d, %d canales\n", imagen.ancho, imagen.alto, imagen.canales);
+                break;
+            }
+            case 14: { // Alternar luz lineal
+                // Rotar y escalar leen el ajuste al ejecutarse: lo pendiente usa el actual
+                materializarImagen(&imagen);
+                LUZ_LINEAL_GLOBAL = !LUZ_LINEAL_GLOBAL;
+                printf("✓ Interpolación en luz lineal %s (rotación y escalado).\n",
+                       LUZ_LINEAL_GLOBAL ? "activada" : "desactivada");
+                break;
+            }
+            case 15: { // Perfil de compresión PNG
+                int perfil;
+                printf("Perfiles:\n");
+                printf("  0. Almacenar (sin compresión, el más rápido)\n");
+                printf("  1. Rápido (filtro Paeth fijo, LZ77 voraz)\n");
+                printf("  2. Por defecto (filtro por fila, nivel medio)\n");
+                printf("  3. Máximo (búsqueda de filtro por fila, cadenas largas)\n");
+                printf("Seleccione perfil: ");
+                if (scanf("%d", &perfil) != 1 || perfil < PNG_ALMACENAR || perfil > PNG_MAXIMO) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                PERFIL_PNG_GLOBAL = (PerfilPNG)perfil;
+                printf("✓ Perfil PNG: %s\n", nombrePerfilPNG(PERFIL_PNG_GLOBAL));
+                break;
+            }
+            case 16: { // Lote en tubería
+                char lista[4096];
+                char extension[16];
+                int operacion;
+                printf("Rutas de entrada (separadas por espacios): ");
+                if (fgets(lista, sizeof(lista), stdin) == NULL) {
+                    printf("Error al leer rutas.\n");
+                    continue;
+                }
+                lista[strcspn(lista, "\n")] = 0;
+                printf("Operación (0 = solo convertir, 1 = blur 5x5 sigma 1.0, 2 = Sobel): ");
+                if (scanf("%d", &operacion) != 1 || operacion < 0 || operacion > 2) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                printf("Formato de salida (png, qoi, qoip, ppm): ");
+                if (fgets(extension, sizeof(extension), stdin) == NULL) {
+                    printf("Error al leer formato.\n");
+                    continue;
+                }
+                extension[strcspn(extension, "\n")] = 0;
+
+                // QUÉ: Separar las rutas y construir results/<nombre>_lote.<ext>.
+                const char* entradas[256];
+                char* salidas[256];
+                int numArchivos = 0;
+                for (char* token = strtok(lista, " \t"); token && numArchivos < 256; token = strtok(NULL, " \t")) {
+                    const char* nombre = strrchr(token, '/');
+                    nombre = nombre ? nombre + 1 : token;
+                    size_t largo = strcspn(nombre, ".");
+                    salidas[numArchivos] = (char*)malloc(largo + strlen(extension) + 32);
+                    if (!salidas[numArchivos]) break;
+                    sprintf(salidas[numArchivos], "results/%.*s_lote.%s", (int)largo, nombre, extension);
+                    // Dos entradas con el mismo nombre (foto.png, foto.ppm) no deben
+                    // escribir el mismo archivo a la vez
+                    for (int j = 0; j < numArchivos; j++) {
+                        if (strcmp(salidas[j], salidas[numArchivos]) == 0) {
+                            sprintf(salidas[numArchivos], "results/%.*s_lote%d.%s", (int)largo, nombre,
+                                    numArchivos, extension);
+                            break;
+                        }
+                    }
+                    entradas[numArchivos++] = token;
+                }
+                if (numArchivos == 0) {
+                    printf("No se indicaron archivos.\n");
+                    continue;
+                }
+
+                OpcionesLote opciones;
+                memset(&opciones, 0, sizeof(opciones));
+                opciones.entradas = entradas;
+                opciones.salidas = (const char* const*)salidas;
+                opciones.numArchivos = numArchivos;
+                opciones.procesar = operacion == 1 ? loteDesenfocar : operacion == 2 ? loteSobel : NULL;
+                // Sobel solo usa luma: se decodifica directamente a grises
+                opciones.canalesEntrada = (operacion == 2) ? 1 : 0;
+                // Los filtros ya reparten cada imagen entre NUM_HILOS_GLOBAL hilos;
+                // la lectura y la escritura se solapan con dos hilos cada una.
+                opciones.hilos[ETAPA_DECODIFICAR] = 2;
+                opciones.hilos[ETAPA_PROCESAR] = 1;
+                opciones.hilos[ETAPA_CODIFICAR] = 2;
+                opciones.capacidadCola = 2;
+                opciones.presupuestoMemoria = (size_t)512 * 1024 * 1024;
+                // Lectura anticipada y escritura en segundo plano (io_uring o hilos)
+                opciones.modoES = ES_AUTOMATICA;
+                ResumenLote resumen;
+                ejecutarLote(&opciones, &resumen);
+                imprimirResumenLote(&resumen);
+                for (int i = 0; i < numArchivos; i++) {
+                    free(salidas[i]);
+                }
+                break;
+            }
+            case 17: { // Paleta PNG
+                int modo, colores = COLORES_PALETA_GLOBAL;
+                printf("Modos:\n");
+                printf("  0. No (siempre 8 bits por canal)\n");
+                printf("  1. Exacta (indexar solo si cabe sin pérdida)\n");
+                printf("  2. Cuantizar (reducir RGB a N colores si no cabe)\n");
+                printf("Seleccione modo: ");
+                if (scanf("%d", &modo) != 1 || modo < PALETA_NO || modo > PALETA_CUANTIZAR) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                if (modo != PALETA_NO) {
+                    printf("Colores máximos (2-256): ");
+                    if (scanf("%d", &colores) != 1 || colores < 2 || colores > 256) {
+                        while (getchar() != '\n');
+                        printf("Entrada inválida.\n");
+                        continue;
+                    }
+                }
+                while (getchar() != '\n');
+                // El codificador de los guardados pendientes lee la paleta global
+                esperarGuardados();
+                MODO_PALETA_GLOBAL = (ModoPaleta)modo;
+                COLORES_PALETA_GLOBAL = colores;
+                printf("✓ Paleta PNG: %s, %d colores\n", nombreModoPaleta(MODO_PALETA_GLOBAL), COLORES_PALETA_GLOBAL);
+                break;
+            }
+            case 18: { // Evaluación perezosa
+                if (MODO_PEREZOSO_GLOBAL) {
+                    // Al desactivarlo, lo pendiente se aplica ya
+                    materializarImagen(&imagen);
+                }
+                MODO_PEREZOSO_GLOBAL = !MODO_PEREZOSO_GLOBAL;
+                printf("✓ Evaluación perezosa %s.\n", MODO_PEREZOSO_GLOBAL
+                           ? "activada: brillo, blur, Sobel, rotar y escalar se ejecutan al guardar o mostrar"
+                           : "desactivada");
+                break;
+            }
+            case 19: { // Brillo en una región
+                if (!imagenCargada(&imagen)) {
+                    printf("\n❌ Debes cargar una imagen primero (opción 1).\n");
+                    break;
+                }
+                int x, y, ancho, alto, delta;
+                printf("Región x y ancho alto (imagen de %dx%d): ", imagen.ancho, imagen.alto);
+                if (scanf("%d %d %d %d", &x, &y, &ancho, &alto) != 4) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                printf("Valor de ajuste de brillo (+ para más claro, - para más oscuro): ");
+                if (scanf("%d", &delta) != 1) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                // No se pospone: lo pendiente se aplica antes y la región se
+                // registra sola, para que el historial copie solo sus teselas
+                if (!materializarImagen(&imagen) || !prepararEdicion(&imagen, x, y, ancho, alto)) {
+                    break;
+                }
+                if (ajustarBrilloRegion(&imagen, x, y, ancho, alto, delta)) {
+                    char descripcion[96];
+                    snprintf(descripcion, sizeof(descripcion), "brillo %+d en %dx%d+%d+%d", delta, ancho, alto, x, y);
+                    registrarVersion(&imagen, descripcion, x, y, ancho, alto);
+                } else {
+                    restaurarVersionActual(&imagen);
+                }
+                break;
+            }
+            case 20: // Deshacer
+            case 21: // Rehacer
+                // Lo pendiente cuenta como la última edición
+                if (!materializarImagen(&imagen)) {
+                    break;
+                }
+                if (opcion == 20) {
+                    deshacer(&imagen);
+                } else {
+                    rehacer(&imagen);
+                }
+                break;
+            case 22: // Historial
+                imprimirHistorial();
+                break;
+            case 23: { // Caché de resultados
+                if (cacheActiva()) {
+                    configurarCache(0, NULL);
+                    printf("✓ Caché de resultados desactivada.\n");
+                    break;
+                }
+                int megas;
+                printf("Capacidad en memoria en MB (por ejemplo %d): ", CAPACIDAD_CACHE_MENU_MB);
+                if (scanf("%d", &megas) != 1 || megas <= 0) {
+                    while (getchar() != '\n');
+                    printf("Entrada inválida.\n");
+                    continue;
+                }
+                while (getchar() != '\n');
+                configurarCache((size_t)megas * 1024 * 1024, NULL);
+                printf("✓ Caché de resultados activada: %d MB en memoria\n", megas);
                 break;
             }
-            case 11: {// Salir (antes era case 7)
-                liberarImagen(&imagen);
+            case 24: { // Salir
+                esperarGuardados();
+                descartarPendientes();
+                liberarHistorial();
+                liberarCache();
+                soltarImagen(&imagen);
                 printf("¡Adiós!\n");
                 return EXIT_SUCCESS;
             }
@@ -206,6 +692,10 @@ int main(int argc, char* argv[]) {
                 printf("Opción inválida.\n");
         }
     }
-    liberarImagen(&imagen);
+    esperarGuardados();
+    descartarPendientes();
+    liberarHistorial();
+    liberarCache();
+    soltarImagen(&imagen);
     return EXIT_SUCCESS;
 }
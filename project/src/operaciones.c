@@ -0,0 +1,294 @@
+#include "operaciones.h"
+#include "filters.h"
+#include "image_rotation.h"
+#include "scaling.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* NOMBRES_MODO[4] = {"auto", "bilinear", "area", "nearest"};
+
+// QUÉ: Leer un entero o un real al principio de *p y avanzar *p.
+// Devuelve 1 si había un número.
+static int leerEntero(const char** p, int* valor) {
+    char* fin;
+    long v = strtol(*p, &fin, 10);
+    if (fin == *p || v < -1000000 || v > 1000000) return 0;
+    *valor = (int)v;
+    *p = fin;
+    return 1;
+}
+
+static int leerReal(const char** p, float* valor) {
+    char* fin;
+    float v = strtof(*p, &fin);
+    if (fin == *p) return 0;
+    *valor = v;
+    *p = fin;
+    return 1;
+}
+
+// QUÉ: Interpretar los parámetros de "scale": "AxB" o "P%", y el modo opcional.
+static int interpretarEscala(const char* p, Operacion* op) {
+    int ancho = 0, alto = 0;
+    float porcentaje = 0.0f;
+    const char* q = p;
+    if (leerEntero(&q, &ancho) && *q == 'x') {
+        q++;
+        if (!leerEntero(&q, &alto) || ancho < 0 || alto < 0 || (ancho == 0 && alto == 0)) return 0;
+    } else {
+        q = p;
+        if (!leerReal(&q, &porcentaje) || *q != '%' || porcentaje <= 0.0f) return 0;
+        q++;
+    }
+    op->entero[0] = ancho;
+    op->entero[1] = alto;
+    op->entero[2] = SCALE_AUTO;
+    op->real = porcentaje;
+    if (*q == 0) return 1;
+    if (*q != ',') return 0;
+    for (int m = 0; m < 4; m++) {
+        if (strcmp(q + 1, NOMBRES_MODO[m]) == 0) {
+            op->entero[2] = m;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// QUÉ: Interpretar una operación "nombre[:parámetros]".
+static int interpretarOperacion(char* texto, Operacion* op) {
+    // Quitar espacios alrededor
+    while (*texto == ' ') texto++;
+    size_t largo = strlen(texto);
+    while (largo > 0 && texto[largo - 1] == ' ') texto[--largo] = 0;
+
+    char* parametros = strchr(texto, ':');
+    if (parametros) *parametros++ = 0;
+    memset(op, 0, sizeof(*op));
+    const char* q = parametros;
+
+    if (strcmp(texto, "blur") == 0) {
+        op->tipo = OP_BLUR;
+        op->entero[0] = 5;
+        op->real = 1.0f;
+        if (q) {
+            if (!leerEntero(&q, &op->entero[0])) return 0;
+            if (*q == ',') {
+                q++;
+                if (!leerReal(&q, &op->real)) return 0;
+            }
+            if (*q) return 0;
+        }
+        return op->entero[0] >= 3 && op->entero[0] % 2 == 1 && op->real > 0.0f;
+    }
+    if (strcmp(texto, "sobel") == 0) {
+        op->tipo = OP_SOBEL;
+        return q == NULL;
+    }
+    if (strcmp(texto, "gray") == 0) {
+        op->tipo = OP_GRISES;
+        return q == NULL;
+    }
+    if (strcmp(texto, "brightness") == 0) {
+        op->tipo = OP_BRILLO;
+        return q && leerEntero(&q, &op->entero[0]) && *q == 0 &&
+               op->entero[0] >= -255 && op->entero[0] <= 255;
+    }
+    if (strcmp(texto, "rotate") == 0) {
+        op->tipo = OP_ROTAR;
+        return q && leerReal(&q, &op->real) && *q == 0;
+    }
+    if (strcmp(texto, "scale") == 0) {
+        op->tipo = OP_ESCALAR;
+        return q && interpretarEscala(q, op);
+    }
+    return 0;
+}
+
+// QUÉ: Interpretar el texto de la cadena.
+// CÓMO: Copia el texto, lo corta por '|' e interpreta cada trozo.
+int interpretarCadena(const char* texto, CadenaOperaciones* cadena) {
+    cadena->ops = NULL;
+    cadena->numOps = 0;
+    char* copia = strdup(texto);
+    if (!copia) {
+        fprintf(stderr, "Error de memoria al interpretar operaciones\n");
+        return 0;
+    }
+    int capacidad = 1;
+    for (const char* p = texto; *p; p++) {
+        if (*p == '|') capacidad++;
+    }
+    cadena->ops = (Operacion*)malloc((size_t)capacidad * sizeof(Operacion));
+    if (!cadena->ops) {
+        fprintf(stderr, "Error de memoria al interpretar operaciones\n");
+        free(copia);
+        return 0;
+    }
+
+    char* inicio = copia;
+    while (1) {
+        char* separador = strchr(inicio, '|');
+        if (separador) *separador = 0;
+        char original[128];
+        snprintf(original, sizeof(original), "%s", inicio);
+        if (!interpretarOperacion(inicio, &cadena->ops[cadena->numOps])) {
+            fprintf(stderr, "ERROR: Operación inválida: '%s' (operación %d)\n", original, cadena->numOps + 1);
+            free(copia);
+            liberarCadena(cadena);
+            return 0;
+        }
+        cadena->numOps++;
+        if (!separador) break;
+        inicio = separador + 1;
+    }
+    free(copia);
+    return 1;
+}
+
+// QUÉ: Dimensiones de salida de "scale".
+// CÓMO: Porcentaje, o un lado a 0 = proporcional; nunca menos de 1 píxel.
+void dimensionesEscala(const Operacion* op, int ancho, int alto, int* nuevoAncho, int* nuevoAlto) {
+    int w = op->entero[0];
+    int h = op->entero[1];
+    if (op->real > 0.0f) {
+        w = (int)(ancho * op->real / 100.0f + 0.5f);
+        h = (int)(alto * op->real / 100.0f + 0.5f);
+    } else if (w == 0) {
+        w = (int)((double)ancho * h / alto + 0.5);
+    } else if (h == 0) {
+        h = (int)((double)alto * w / ancho + 0.5);
+    }
+    *nuevoAncho = w < 1 ? 1 : w;
+    *nuevoAlto = h < 1 ? 1 : h;
+}
+
+// QUÉ: Añadir una operación al final de la cadena.
+int agregarOperacion(CadenaOperaciones* cadena, const Operacion* op) {
+    Operacion* ops = (Operacion*)realloc(cadena->ops, ((size_t)cadena->numOps + 1) * sizeof(Operacion));
+    if (!ops) {
+        fprintf(stderr, "Error de memoria al añadir una operación\n");
+        return 0;
+    }
+    ops[cadena->numOps++] = *op;
+    cadena->ops = ops;
+    return 1;
+}
+
+// QUÉ: Aplicar una operación a la imagen.
+int aplicarOperacion(ImagenInfo* imagen, const Operacion* op) {
+    switch (op->tipo) {
+        case OP_BLUR:
+            return aplicarConvolucionGaussiana(imagen, op->entero[0], op->real);
+        case OP_SOBEL:
+            return aplicarSobel(imagen);
+        case OP_GRISES:
+            return convertirAGrayscale(imagen);
+        case OP_BRILLO:
+            return ajustarBrilloConcurrente(imagen, op->entero[0]);
+        case OP_ROTAR:
+            return rotateImageConcurrent(imagen, op->real);
+        case OP_ESCALAR: {
+            int ancho, alto;
+            dimensionesEscala(op, imagen->ancho, imagen->alto, &ancho, &alto);
+            scaleImageWithMode(imagen, ancho, alto, (ScaleMode)op->entero[2]);
+            return imagen->pixeles && imagen->ancho == ancho && imagen->alto == alto;
+        }
+    }
+    return 0;
+}
+
+// QUÉ: ¿Escribe la operación en la imagen que recibe? (ver operaciones.h)
+// CÓMO: gray sobre grises y scale al mismo tamaño no la tocan; el resto de
+// filtros salvo brightness y sobel crean la imagen de salida aparte.
+int operacionEnSuSitio(const Operacion* op, int canales) {
+    switch (op->tipo) {
+        case OP_BRILLO:
+            return 1;
+        case OP_SOBEL:
+            return canales == 1;
+        case OP_BLUR:
+        case OP_GRISES:
+        case OP_ROTAR:
+        case OP_ESCALAR:
+            return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Aplicar todas las operaciones en orden.
+int aplicarCadena(ImagenInfo* imagen, const CadenaOperaciones* cadena) {
+    for (int i = 0; i < cadena->numOps; i++) {
+        if (!aplicarOperacion(imagen, &cadena->ops[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Canales con que conviene decodificar.
+// CÓMO: Recorre la cadena hasta la primera operación que no sea lineal por
+// canal. brightness satura en 0 y 255, así que no conmuta con la luma.
+int canalesNecesarios(const CadenaOperaciones* cadena) {
+    for (int i = 0; i < cadena->numOps; i++) {
+        switch (cadena->ops[i].tipo) {
+            case OP_SOBEL:
+            case OP_GRISES:
+                return 1;
+            case OP_BLUR:
+            case OP_ROTAR:
+            case OP_ESCALAR:
+                break;
+            case OP_BRILLO:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+// QUÉ: Escribir la cadena en forma canónica.
+void describirCadena(const CadenaOperaciones* cadena, char* salida, size_t tam) {
+    size_t usado = 0;
+    salida[0] = 0;
+    for (int i = 0; i < cadena->numOps && usado < tam; i++) {
+        const Operacion* op = &cadena->ops[i];
+        const char* separador = i ? "|" : "";
+        int n = 0;
+        switch (op->tipo) {
+            case OP_BLUR:
+                n = snprintf(salida + usado, tam - usado, "%sblur:%d,%g", separador, op->entero[0], op->real);
+                break;
+            case OP_SOBEL:
+                n = snprintf(salida + usado, tam - usado, "%ssobel", separador);
+                break;
+            case OP_GRISES:
+                n = snprintf(salida + usado, tam - usado, "%sgray", separador);
+                break;
+            case OP_BRILLO:
+                n = snprintf(salida + usado, tam - usado, "%sbrightness:%d", separador, op->entero[0]);
+                break;
+            case OP_ROTAR:
+                n = snprintf(salida + usado, tam - usado, "%srotate:%g", separador, op->real);
+                break;
+            case OP_ESCALAR:
+                if (op->real > 0.0f) {
+                    n = snprintf(salida + usado, tam - usado, "%sscale:%g%%,%s", separador, op->real,
+                                 NOMBRES_MODO[op->entero[2]]);
+                } else {
+                    n = snprintf(salida + usado, tam - usado, "%sscale:%dx%d,%s", separador, op->entero[0],
+                                 op->entero[1], NOMBRES_MODO[op->entero[2]]);
+                }
+                break;
+        }
+        if (n < 0) break;
+        usado += (size_t)n;
+    }
+}
+
+// QUÉ: Liberar la cadena.
+void liberarCadena(CadenaOperaciones* cadena) {
+    free(cadena->ops);
+    cadena->ops = NULL;
+    cadena->numOps = 0;
+}
@@ -0,0 +1,753 @@
+#include "paleta.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// QUÉ: Soporte de AVX2 con despacho en tiempo de ejecución (ver scaling.c).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PALETA_AVX2 1
+#include <immintrin.h>
+#endif
+
+ModoPaleta MODO_PALETA_GLOBAL = PALETA_EXACTA;
+int COLORES_PALETA_GLOBAL = 256;
+
+const char* nombreModoPaleta(ModoPaleta modo) {
+    static const char* nombres[] = {"no", "exacta", "cuantizar"};
+    return (modo >= PALETA_NO && modo <= PALETA_CUANTIZAR) ? nombres[modo] : "?";
+}
+
+// QUÉ: Tabla hash de colores empaquetados (hasta 256, direccionamiento abierto).
+// CÓMO: 1024 posiciones: con 256 colores la ocupación no pasa del 25% y las
+// búsquedas casi nunca prueban más de una posición. indices[i] < 0 = libre.
+#define TAM_TABLA 1024
+
+typedef struct {
+    uint32_t claves[TAM_TABLA];
+    int16_t indices[TAM_TABLA];
+} TablaColores;
+
+static void vaciarTabla(TablaColores* tabla) {
+    memset(tabla->indices, 0xff, sizeof(tabla->indices));
+}
+
+static inline unsigned posicionColor(uint32_t color) {
+    return (color * 2654435761u) >> 22;
+}
+
+// QUÉ: Empaquetar los canales de un píxel en un entero (el canal 0 en los bits bajos).
+static inline uint32_t leerColor(const unsigned char* p, int canales) {
+    switch (canales) {
+        case 1: return p[0];
+        case 2: return p[0] | (uint32_t)p[1] << 8;
+        case 3: return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+        default: return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+}
+
+// QUÉ: Índice del color en la tabla, o -1 si no está.
+static inline int buscarEnTabla(const TablaColores* tabla, uint32_t color) {
+    unsigned i = posicionColor(color);
+    while (tabla->indices[i] >= 0) {
+        if (tabla->claves[i] == color) return tabla->indices[i];
+        i = (i + 1) & (TAM_TABLA - 1);
+    }
+    return -1;
+}
+
+// QUÉ: Añadir el color si no estaba (también al final de lista).
+// Devuelve 0 si no estaba y la tabla ya tiene max colores.
+static inline int insertarEnTabla(TablaColores* tabla, uint32_t color, uint32_t* lista, int* num, int max) {
+    unsigned i = posicionColor(color);
+    while (tabla->indices[i] >= 0) {
+        if (tabla->claves[i] == color) return 1;
+        i = (i + 1) & (TAM_TABLA - 1);
+    }
+    if (*num >= max) return 0;
+    tabla->claves[i] = color;
+    tabla->indices[i] = (int16_t)*num;
+    lista[(*num)++] = color;
+    return 1;
+}
+
+// QUÉ: Rango de filas de la tarea i de numTareas.
+static void repartirFilas(int alto, int numTareas, int i, int* inicio, int* fin) {
+    int filasPorTarea = (alto + numTareas - 1) / numTareas;
+    *inicio = i * filasPorTarea < alto ? i * filasPorTarea : alto;
+    *fin = (i + 1) * filasPorTarea < alto ? (i + 1) * filasPorTarea : alto;
+}
+
+// QUÉ: Tareas para recorrer la imagen por rangos de filas (4 por hilo, como
+// el filtrado del codificador).
+static int numeroTareas(const ImagenInfo* info) {
+    int numTareas = NUM_HILOS_GLOBAL * 4;
+    return numTareas < info->alto ? numTareas : info->alto;
+}
+
+// ============================================================================
+// PALETA EXACTA
+// ============================================================================
+
+// QUÉ: Conteo de colores distintos de un rango de filas.
+typedef struct {
+    const ImagenInfo* info;
+    int filaInicio;
+    int filaFin;
+    int maxColores;
+    int* excedido;              // Compartido: alguna tarea pasó del límite
+    uint32_t colores[256];
+    int num;
+    int ok;
+} TareaConteo;
+
+// QUÉ: Tarea del pool: reunir los colores de un rango de filas.
+// CÓMO: Los píxeles iguales al anterior (fondos, trazos) no consultan la tabla.
+static void contarColoresTarea(void* arg) {
+    TareaConteo* t = (TareaConteo*)arg;
+    const ImagenInfo* info = t->info;
+    int canales = info->canales;
+    TablaColores tabla;
+    vaciarTabla(&tabla);
+    t->num = 0;
+    t->ok = 0;
+    for (int y = t->filaInicio; y < t->filaFin; y++) {
+        if (__atomic_load_n(t->excedido, __ATOMIC_RELAXED)) {
+            return;
+        }
+        const unsigned char* p = info->pixeles[y][0];
+        uint32_t ultimo = leerColor(p, canales);
+        int ok = insertarEnTabla(&tabla, ultimo, t->colores, &t->num, t->maxColores);
+        for (int x = 1; x < info->ancho && ok; x++) {
+            uint32_t color = leerColor(p + (size_t)x * canales, canales);
+            if (color != ultimo) {
+                ultimo = color;
+                ok = insertarEnTabla(&tabla, color, t->colores, &t->num, t->maxColores);
+            }
+        }
+        if (!ok) {
+            __atomic_store_n(t->excedido, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    t->ok = 1;
+}
+
+static int compararU64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+// QUÉ: Buscar la paleta exacta (ver paleta.h).
+int buscarPaletaExacta(const ImagenInfo* info, int maxColores, PoolHilos* pool, Paleta* paleta) {
+    if (!info->pixeles || info->canales < 1 || info->canales > 4 || maxColores < 1 || maxColores > 256) {
+        return 0;
+    }
+    int numTareas = numeroTareas(info);
+    TareaConteo* tareas = (TareaConteo*)calloc((size_t)numTareas, sizeof(TareaConteo));
+    if (!tareas) {
+        fprintf(stderr, "Error de memoria al buscar la paleta\n");
+        return 0;
+    }
+    int excedido = 0;
+    GrupoTareas grupo;
+    iniciarGrupo(&grupo);
+    for (int i = 0; i < numTareas; i++) {
+        tareas[i].info = info;
+        tareas[i].maxColores = maxColores;
+        tareas[i].excedido = &excedido;
+        repartirFilas(info->alto, numTareas, i, &tareas[i].filaInicio, &tareas[i].filaFin);
+        if (!enviarTarea(pool, contarColoresTarea, &tareas[i], &grupo)) break;
+    }
+    esperarGrupo(&grupo);
+    destruirGrupo(&grupo);
+
+    // QUÉ: Unir los conjuntos de las tareas.
+    int ok = !excedido;
+    TablaColores tabla;
+    uint32_t lista[256];
+    int num = 0;
+    vaciarTabla(&tabla);
+    for (int i = 0; i < numTareas && ok; i++) {
+        ok = tareas[i].ok;
+        for (int k = 0; k < tareas[i].num && ok; k++) {
+            ok = insertarEnTabla(&tabla, tareas[i].colores[k], lista, &num, maxColores);
+        }
+    }
+    free(tareas);
+    if (!ok) {
+        return 0;
+    }
+
+    // QUÉ: Orden por valor (independiente del número de hilos), translúcidos primero.
+    uint64_t orden[256];
+    for (int i = 0; i < num; i++) {
+        int opaco = info->canales == 4 && (lista[i] >> 24) == 255;
+        orden[i] = ((uint64_t)opaco << 32) | lista[i];
+    }
+    qsort(orden, (size_t)num, sizeof(uint64_t), compararU64);
+    memset(paleta, 0, sizeof(*paleta));
+    paleta->numColores = num;
+    paleta->canales = info->canales;
+    for (int i = 0; i < num; i++) {
+        for (int k = 0; k < 4; k++) {
+            paleta->colores[i][k] = (unsigned char)(orden[i] >> (8 * k));
+        }
+    }
+    return 1;
+}
+
+// ============================================================================
+// CUANTIZACIÓN (CORTE POR LA MEDIANA + K-MEANS)
+// ============================================================================
+
+// QUÉ: Histograma de 5 bits por canal y tamaño de la muestra.
+// CÓMO: 32768 celdas; cada una acumula cuántos píxeles caen en ella y la suma
+// de sus colores a 8 bits, así la media de la celda no pierde precisión.
+#define BITS_CELDA 5
+#define NUM_CELDAS (1 << (3 * BITS_CELDA))
+#define MUESTRAS_CUANTIZACION (1 << 20)
+#define ITERACIONES_KMEANS 2
+
+typedef struct {
+    uint32_t n, r, g, b;
+} CeldaHistograma;
+
+typedef struct {
+    const ImagenInfo* info;
+    int filaInicio;
+    int filaFin;
+    int paso;
+    CeldaHistograma* celdas;
+} TareaHistograma;
+
+// QUÉ: Tarea del pool: histograma de las filas y columnas múltiplo de paso.
+static void histogramaTarea(void* arg) {
+    TareaHistograma* t = (TareaHistograma*)arg;
+    const ImagenInfo* info = t->info;
+    int primera = (t->filaInicio + t->paso - 1) / t->paso * t->paso;
+    for (int y = primera; y < t->filaFin; y += t->paso) {
+        const unsigned char* p = info->pixeles[y][0];
+        for (int x = 0; x < info->ancho; x += t->paso) {
+            const unsigned char* q = p + (size_t)x * 3;
+            int celda = (q[0] >> 3) << 10 | (q[1] >> 3) << 5 | (q[2] >> 3);
+            CeldaHistograma* c = &t->celdas[celda];
+            c->n++;
+            c->r += q[0];
+            c->g += q[1];
+            c->b += q[2];
+        }
+    }
+}
+
+// QUÉ: Celda no vacía del histograma total: color medio y peso.
+typedef struct {
+    float m[3];
+    double n;
+} CeldaMedia;
+
+// QUÉ: Caja del corte por la mediana: rango de celdas, error y eje de corte.
+typedef struct {
+    int inicio;
+    int fin;
+    double error;
+    int eje;
+} Caja;
+
+static int compararEje0(const void* a, const void* b) {
+    float x = ((const CeldaMedia*)a)->m[0], y = ((const CeldaMedia*)b)->m[0];
+    return (x > y) - (x < y);
+}
+static int compararEje1(const void* a, const void* b) {
+    float x = ((const CeldaMedia*)a)->m[1], y = ((const CeldaMedia*)b)->m[1];
+    return (x > y) - (x < y);
+}
+static int compararEje2(const void* a, const void* b) {
+    float x = ((const CeldaMedia*)a)->m[2], y = ((const CeldaMedia*)b)->m[2];
+    return (x > y) - (x < y);
+}
+
+// QUÉ: Error cuadrático de la caja y eje de mayor varianza.
+static void medirCaja(const CeldaMedia* celdas, Caja* caja) {
+    double n = 0, suma[3] = {0, 0, 0}, cuadrados[3] = {0, 0, 0};
+    for (int i = caja->inicio; i < caja->fin; i++) {
+        double w = celdas[i].n;
+        n += w;
+        for (int k = 0; k < 3; k++) {
+            suma[k] += w * celdas[i].m[k];
+            cuadrados[k] += w * celdas[i].m[k] * celdas[i].m[k];
+        }
+    }
+    caja->error = 0;
+    caja->eje = 0;
+    double mayor = -1;
+    for (int k = 0; k < 3; k++) {
+        double varianza = cuadrados[k] - suma[k] * suma[k] / n;
+        caja->error += varianza;
+        if (varianza > mayor) {
+            mayor = varianza;
+            caja->eje = k;
+        }
+    }
+}
+
+// QUÉ: Media ponderada de las celdas de una caja.
+static void mediaCaja(const CeldaMedia* celdas, const Caja* caja, float media[3]) {
+    double n = 0, suma[3] = {0, 0, 0};
+    for (int i = caja->inicio; i < caja->fin; i++) {
+        n += celdas[i].n;
+        for (int k = 0; k < 3; k++) suma[k] += celdas[i].n * celdas[i].m[k];
+    }
+    for (int k = 0; k < 3; k++) media[k] = (float)(suma[k] / n);
+}
+
+static inline float distancia2(const float a[3], const float b[3]) {
+    float d0 = a[0] - b[0], d1 = a[1] - b[1], d2 = a[2] - b[2];
+    return d0 * d0 + d1 * d1 + d2 * d2;
+}
+
+// QUÉ: Cuantizar a numColores colores (ver paleta.h).
+// POR QUÉ: El corte por la mediana reparte los colores donde hay más píxeles
+// y más variación; las iteraciones de k-means corrigen sus cortes rectos. Las
+// dos fases trabajan sobre las celdas (como mucho 32768), no sobre los píxeles.
+int cuantizarPaleta(const ImagenInfo* info, int numColores, PoolHilos* pool, Paleta* paleta) {
+    if (!info->pixeles || info->canales != 3 || numColores < 2 || numColores > 256) {
+        return 0;
+    }
+    // QUÉ: Paso de muestreo en filas y columnas para quedarse en ~1M píxeles.
+    size_t total = (size_t)info->ancho * info->alto;
+    int paso = 1;
+    while (total / ((size_t)paso * paso) > MUESTRAS_CUANTIZACION) paso++;
+
+    int numTareas = NUM_HILOS_GLOBAL < info->alto ? NUM_HILOS_GLOBAL : info->alto;
+    TareaHistograma* tareas = (TareaHistograma*)calloc((size_t)numTareas, sizeof(TareaHistograma));
+    CeldaHistograma* histogramas = (CeldaHistograma*)calloc((size_t)numTareas * NUM_CELDAS,
+                                                            sizeof(CeldaHistograma));
+    CeldaMedia* celdas = (CeldaMedia*)malloc(NUM_CELDAS * sizeof(CeldaMedia));
+    Caja* cajas = (Caja*)malloc((size_t)numColores * sizeof(Caja));
+    if (!tareas || !histogramas || !celdas || !cajas) {
+        fprintf(stderr, "Error de memoria al cuantizar la paleta\n");
+        free(tareas);
+        free(histogramas);
+        free(celdas);
+        free(cajas);
+        return 0;
+    }
+    GrupoTareas grupo;
+    iniciarGrupo(&grupo);
+    int ok = 1;
+    for (int i = 0; i < numTareas && ok; i++) {
+        tareas[i].info = info;
+        tareas[i].paso = paso;
+        tareas[i].celdas = histogramas + (size_t)i * NUM_CELDAS;
+        repartirFilas(info->alto, numTareas, i, &tareas[i].filaInicio, &tareas[i].filaFin);
+        ok = enviarTarea(pool, histogramaTarea, &tareas[i], &grupo);
+    }
+    esperarGrupo(&grupo);
+    destruirGrupo(&grupo);
+
+    // QUÉ: Sumar los histogramas y quedarse con las celdas no vacías.
+    int numCeldas = 0;
+    for (int c = 0; c < NUM_CELDAS && ok; c++) {
+        uint64_t n = 0, suma[3] = {0, 0, 0};
+        for (int i = 0; i < numTareas; i++) {
+            const CeldaHistograma* h = &histogramas[(size_t)i * NUM_CELDAS + c];
+            n += h->n;
+            suma[0] += h->r;
+            suma[1] += h->g;
+            suma[2] += h->b;
+        }
+        if (n) {
+            for (int k = 0; k < 3; k++) celdas[numCeldas].m[k] = (float)((double)suma[k] / (double)n);
+            celdas[numCeldas].n = (double)n;
+            numCeldas++;
+        }
+    }
+    free(histogramas);
+    free(tareas);
+    if (!ok || numCeldas == 0) {
+        free(celdas);
+        free(cajas);
+        return 0;
+    }
+
+    // QUÉ: Corte por la mediana: partir la caja de más error por su eje de
+    // mayor varianza, en la mediana ponderada, hasta tener numColores cajas.
+    int numCajas = 1;
+    cajas[0].inicio = 0;
+    cajas[0].fin = numCeldas;
+    medirCaja(celdas, &cajas[0]);
+    while (numCajas < numColores) {
+        int elegida = -1;
+        for (int i = 0; i < numCajas; i++) {
+            if (cajas[i].fin - cajas[i].inicio > 1 && cajas[i].error > 0 &&
+                (elegida < 0 || cajas[i].error > cajas[elegida].error)) {
+                elegida = i;
+            }
+        }
+        if (elegida < 0) break;
+        Caja* caja = &cajas[elegida];
+        int (*comparar)(const void*, const void*) =
+            caja->eje == 0 ? compararEje0 : caja->eje == 1 ? compararEje1 : compararEje2;
+        qsort(celdas + caja->inicio, (size_t)(caja->fin - caja->inicio), sizeof(CeldaMedia), comparar);
+        double peso = 0, acumulado = 0;
+        for (int i = caja->inicio; i < caja->fin; i++) peso += celdas[i].n;
+        int corte = caja->inicio;
+        while (corte < caja->fin - 1 && acumulado + celdas[corte].n <= peso / 2) {
+            acumulado += celdas[corte++].n;
+        }
+        if (corte == caja->inicio) corte++;
+        Caja nueva = {corte, caja->fin, 0, 0};
+        caja->fin = corte;
+        medirCaja(celdas, caja);
+        medirCaja(celdas, &nueva);
+        cajas[numCajas++] = nueva;
+    }
+
+    // QUÉ: Refinar con k-means: asignar cada celda al color más cercano y
+    // mover cada color a la media de sus celdas.
+    float (*centros)[3] = (float (*)[3])malloc((size_t)numCajas * sizeof(*centros));
+    double (*sumas)[4] = (double (*)[4])malloc((size_t)numCajas * sizeof(*sumas));
+    if (!centros || !sumas) {
+        fprintf(stderr, "Error de memoria al cuantizar la paleta\n");
+        free(centros);
+        free(sumas);
+        free(celdas);
+        free(cajas);
+        return 0;
+    }
+    for (int j = 0; j < numCajas; j++) {
+        mediaCaja(celdas, &cajas[j], centros[j]);
+    }
+    for (int iteracion = 0; iteracion < ITERACIONES_KMEANS; iteracion++) {
+        memset(sumas, 0, (size_t)numCajas * sizeof(*sumas));
+        for (int i = 0; i < numCeldas; i++) {
+            int mejor = 0;
+            float mejorDistancia = distancia2(celdas[i].m, centros[0]);
+            for (int j = 1; j < numCajas; j++) {
+                float d = distancia2(celdas[i].m, centros[j]);
+                if (d < mejorDistancia) {
+                    mejorDistancia = d;
+                    mejor = j;
+                }
+            }
+            for (int k = 0; k < 3; k++) sumas[mejor][k] += celdas[i].n * celdas[i].m[k];
+            sumas[mejor][3] += celdas[i].n;
+        }
+        for (int j = 0; j < numCajas; j++) {
+            if (sumas[j][3] > 0) {
+                for (int k = 0; k < 3; k++) centros[j][k] = (float)(sumas[j][k] / sumas[j][3]);
+            }
+        }
+    }
+
+    memset(paleta, 0, sizeof(*paleta));
+    paleta->numColores = numCajas;
+    paleta->canales = 3;
+    for (int j = 0; j < numCajas; j++) {
+        for (int k = 0; k < 3; k++) {
+            float v = centros[j][k] + 0.5f;
+            paleta->colores[j][k] = (unsigned char)(v < 0 ? 0 : v > 255 ? 255 : v);
+        }
+        paleta->colores[j][3] = 255;
+    }
+    free(centros);
+    free(sumas);
+    free(celdas);
+    free(cajas);
+    return 1;
+}
+
+// ============================================================================
+// INDEXADO
+// ============================================================================
+
+// QUÉ: Paleta RGB preparada para buscar el color más cercano con SIMD.
+// CÓMO: Pares (R, G) y (B, 0) en enteros de 16 bits, de modo que
+// _mm_madd_epi16 sobre las diferencias da dR² + dG² y dB² en 32 bits para
+// 4 (SSE2) u 8 (AVX2) colores a la vez. El relleno hasta múltiplo de 8
+// repite el color 0: empata con él y gana siempre el índice menor.
+typedef struct {
+    int16_t rg[2 * 256];
+    int16_t b0[2 * 256];
+    int numRelleno;
+} PaletaCercana;
+
+static void prepararPaletaCercana(const Paleta* paleta, PaletaCercana* pc) {
+    pc->numRelleno = (paleta->numColores + 7) & ~7;
+    for (int j = 0; j < pc->numRelleno; j++) {
+        const unsigned char* c = paleta->colores[j < paleta->numColores ? j : 0];
+        pc->rg[2 * j] = c[0];
+        pc->rg[2 * j + 1] = c[1];
+        pc->b0[2 * j] = c[2];
+        pc->b0[2 * j + 1] = 0;
+    }
+}
+
+// QUÉ: Color más cercano, versión escalar (primer mínimo en caso de empate).
+static int colorCercanoEscalar(const PaletaCercana* pc, int r, int g, int b) {
+    int mejor = 0;
+    int mejorDistancia = 0x7fffffff;
+    for (int j = 0; j < pc->numRelleno; j++) {
+        int dr = pc->rg[2 * j] - r, dg = pc->rg[2 * j + 1] - g, db = pc->b0[2 * j] - b;
+        int d = dr * dr + dg * dg + db * db;
+        if (d < mejorDistancia) {
+            mejorDistancia = d;
+            mejor = j;
+        }
+    }
+    return mejor;
+}
+
+// QUÉ: Elegir, entre los mínimos por carril, el de menor distancia e índice.
+static inline int reducirMinimo(const int32_t* distancias, const int32_t* indices, int carriles) {
+    int mejor = 0;
+    for (int k = 1; k < carriles; k++) {
+        if (distancias[k] < distancias[mejor] ||
+            (distancias[k] == distancias[mejor] && indices[k] < indices[mejor])) {
+            mejor = k;
+        }
+    }
+    return indices[mejor];
+}
+
+#ifdef __SSE2__
+// QUÉ: Color más cercano con SSE2: 4 colores por iteración.
+// CÓMO: Cada carril guarda su mínimo estricto (el primer índice en empates);
+// al final se reducen los cuatro carriles.
+static int colorCercanoSSE2(const PaletaCercana* pc, int r, int g, int b) {
+    const __m128i pixelRG = _mm_set1_epi32((g << 16) | r);
+    const __m128i pixelB = _mm_set1_epi32(b);
+    const __m128i cuatro = _mm_set1_epi32(4);
+    __m128i mejor = _mm_set1_epi32(0x7fffffff);
+    __m128i mejorIndice = _mm_setzero_si128();
+    __m128i indice = _mm_setr_epi32(0, 1, 2, 3);
+    for (int j = 0; j < pc->numRelleno; j += 4) {
+        __m128i drg = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(pc->rg + 2 * j)), pixelRG);
+        __m128i db = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(pc->b0 + 2 * j)), pixelB);
+        __m128i d = _mm_add_epi32(_mm_madd_epi16(drg, drg), _mm_madd_epi16(db, db));
+        __m128i menor = _mm_cmplt_epi32(d, mejor);
+        mejor = _mm_or_si128(_mm_and_si128(menor, d), _mm_andnot_si128(menor, mejor));
+        mejorIndice = _mm_or_si128(_mm_and_si128(menor, indice), _mm_andnot_si128(menor, mejorIndice));
+        indice = _mm_add_epi32(indice, cuatro);
+    }
+    int32_t distancias[4], indices[4];
+    _mm_storeu_si128((__m128i*)distancias, mejor);
+    _mm_storeu_si128((__m128i*)indices, mejorIndice);
+    return reducirMinimo(distancias, indices, 4);
+}
+#endif
+
+#ifdef PALETA_AVX2
+// QUÉ: Color más cercano con AVX2: 8 colores por iteración.
+__attribute__((target("avx2")))
+static int colorCercanoAVX2(const PaletaCercana* pc, int r, int g, int b) {
+    const __m256i pixelRG = _mm256_set1_epi32((g << 16) | r);
+    const __m256i pixelB = _mm256_set1_epi32(b);
+    const __m256i ocho = _mm256_set1_epi32(8);
+    __m256i mejor = _mm256_set1_epi32(0x7fffffff);
+    __m256i mejorIndice = _mm256_setzero_si256();
+    __m256i indice = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    for (int j = 0; j < pc->numRelleno; j += 8) {
+        __m256i drg = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(pc->rg + 2 * j)), pixelRG);
+        __m256i db = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(pc->b0 + 2 * j)), pixelB);
+        __m256i d = _mm256_add_epi32(_mm256_madd_epi16(drg, drg), _mm256_madd_epi16(db, db));
+        __m256i menor = _mm256_cmpgt_epi32(mejor, d);
+        mejor = _mm256_blendv_epi8(mejor, d, menor);
+        mejorIndice = _mm256_blendv_epi8(mejorIndice, indice, menor);
+        indice = _mm256_add_epi32(indice, ocho);
+    }
+    int32_t distancias[8], indices[8];
+    _mm256_storeu_si256((__m256i*)distancias, mejor);
+    _mm256_storeu_si256((__m256i*)indices, mejorIndice);
+    return reducirMinimo(distancias, indices, 8);
+}
+
+static int cpuTieneAVX2(void) {
+    static int cache = -1;
+    int valor = __atomic_load_n(&cache, __ATOMIC_RELAXED);
+    if (valor < 0) {
+        __builtin_cpu_init();
+        valor = __builtin_cpu_supports("avx2") ? 1 : 0;
+        __atomic_store_n(&cache, valor, __ATOMIC_RELAXED);
+    }
+    return valor;
+}
+#endif
+
+// QUÉ: Caché por tarea de colores ya resueltos (correspondencia directa).
+// CÓMO: La clave lleva el bit 31 como marca de ocupada (los colores RGB usan 24 bits).
+#define TAM_CACHE_CERCANO 4096
+
+// QUÉ: Trabajo de indexado de un rango de filas.
+typedef struct {
+    const ImagenInfo* info;
+    const TablaColores* tabla;      // Paleta exacta
+    const PaletaCercana* cercana;   // Color más cercano (RGB)
+    const unsigned char* niveles;   // Grises: índice de cada nivel
+    int bits;
+    unsigned char* destino;
+    size_t bytesFila;
+    int filaInicio;
+    int filaFin;
+    int ok;
+} TareaIndexado;
+
+// QUÉ: Empaquetar índices de 8 bits a bits por píxel (el primero en los bits altos).
+static void empaquetarFila(const unsigned char* indices, int ancho, int bits, unsigned char* destino,
+                           size_t bytesFila) {
+    int porByte = 8 / bits;
+    memset(destino, 0, bytesFila);
+    for (int x = 0; x < ancho; x++) {
+        destino[x / porByte] |= (unsigned char)(indices[x] << (8 - bits - (x % porByte) * bits));
+    }
+}
+
+// QUÉ: Tarea del pool: indexar y empaquetar un rango de filas.
+static void indexarFilasTarea(void* arg) {
+    TareaIndexado* t = (TareaIndexado*)arg;
+    const ImagenInfo* info = t->info;
+    int canales = info->canales;
+    unsigned char* indices = (unsigned char*)malloc((size_t)info->ancho);
+    uint32_t* clavesCache = NULL;
+    unsigned char* indicesCache = NULL;
+    if (t->cercana) {
+        clavesCache = (uint32_t*)calloc(TAM_CACHE_CERCANO, sizeof(uint32_t));
+        indicesCache = (unsigned char*)malloc(TAM_CACHE_CERCANO);
+    }
+    t->ok = 0;
+    if (!indices || (t->cercana && (!clavesCache || !indicesCache))) {
+        free(indices);
+        free(clavesCache);
+        free(indicesCache);
+        return;
+    }
+    int (*cercano)(const PaletaCercana*, int, int, int) = colorCercanoEscalar;
+#ifdef __SSE2__
+    cercano = colorCercanoSSE2;
+#endif
+#ifdef PALETA_AVX2
+    if (cpuTieneAVX2()) cercano = colorCercanoAVX2;
+#endif
+
+    for (int y = t->filaInicio; y < t->filaFin; y++) {
+        const unsigned char* p = info->pixeles[y][0];
+        if (t->niveles) {
+            for (int x = 0; x < info->ancho; x++) indices[x] = t->niveles[p[x]];
+        } else if (t->tabla) {
+            uint32_t ultimo = leerColor(p, canales);
+            int indice = buscarEnTabla(t->tabla, ultimo);
+            for (int x = 0; x < info->ancho; x++) {
+                uint32_t color = leerColor(p + (size_t)x * canales, canales);
+                if (color != ultimo) {
+                    ultimo = color;
+                    indice = buscarEnTabla(t->tabla, color);
+                }
+                indices[x] = (unsigned char)(indice < 0 ? 0 : indice);
+            }
+        } else {
+            for (int x = 0; x < info->ancho; x++) {
+                const unsigned char* q = p + (size_t)x * 3;
+                uint32_t clave = leerColor(q, 3) | 0x80000000u;
+                unsigned posicion = (clave * 2654435761u) >> 20;
+                if (clavesCache[posicion] != clave) {
+                    clavesCache[posicion] = clave;
+                    indicesCache[posicion] = (unsigned char)cercano(t->cercana, q[0], q[1], q[2]);
+                }
+                indices[x] = indicesCache[posicion];
+            }
+        }
+        unsigned char* fila = t->destino + (size_t)y * t->bytesFila;
+        if (t->bits == 8) {
+            memcpy(fila, indices, (size_t)info->ancho);
+        } else {
+            empaquetarFila(indices, info->ancho, t->bits, fila, t->bytesFila);
+        }
+    }
+    free(indices);
+    free(clavesCache);
+    free(indicesCache);
+    t->ok = 1;
+}
+
+size_t bytesFilaIndexada(int ancho, int bits) {
+    return ((size_t)ancho * bits + 7) / 8;
+}
+
+// QUÉ: Indexar la imagen (ver paleta.h).
+int indexarImagen(const ImagenInfo* info, const Paleta* paleta, int exacta, int bits, PoolHilos* pool,
+                  unsigned char* destino) {
+    if (!info->pixeles || paleta->numColores < 1 || paleta->numColores > (1 << bits) ||
+        (bits != 1 && bits != 2 && bits != 4 && bits != 8) || paleta->canales != info->canales ||
+        (info->canales != 1 && info->canales != 3 && !(info->canales == 4 && exacta))) {
+        return 0;
+    }
+    TablaColores* tabla = NULL;
+    PaletaCercana* cercana = NULL;
+    unsigned char niveles[256];
+    int usarNiveles = (info->canales == 1);
+    if (usarNiveles) {
+        // Nivel más cercano de cada valor de gris (el primero en empates)
+        for (int v = 0; v < 256; v++) {
+            int mejor = 0;
+            for (int j = 1; j < paleta->numColores; j++) {
+                if (abs(paleta->colores[j][0] - v) < abs(paleta->colores[mejor][0] - v)) mejor = j;
+            }
+            niveles[v] = (unsigned char)mejor;
+        }
+    } else if (exacta) {
+        tabla = (TablaColores*)malloc(sizeof(TablaColores));
+        if (tabla) {
+            uint32_t lista[256];
+            int num = 0;
+            vaciarTabla(tabla);
+            for (int j = 0; j < paleta->numColores; j++) {
+                insertarEnTabla(tabla, leerColor(paleta->colores[j], info->canales), lista, &num, 256);
+            }
+        }
+    } else {
+        cercana = (PaletaCercana*)malloc(sizeof(PaletaCercana));
+        if (cercana) prepararPaletaCercana(paleta, cercana);
+    }
+    int numTareas = numeroTareas(info);
+    TareaIndexado* tareas = (TareaIndexado*)calloc((size_t)numTareas, sizeof(TareaIndexado));
+    if (!tareas || (!usarNiveles && !tabla && !cercana)) {
+        fprintf(stderr, "Error de memoria al indexar la imagen\n");
+        free(tareas);
+        free(tabla);
+        free(cercana);
+        return 0;
+    }
+
+    GrupoTareas grupo;
+    iniciarGrupo(&grupo);
+    int ok = 1;
+    for (int i = 0; i < numTareas && ok; i++) {
+        tareas[i].info = info;
+        tareas[i].tabla = tabla;
+        tareas[i].cercana = cercana;
+        tareas[i].niveles = usarNiveles ? niveles : NULL;
+        tareas[i].bits = bits;
+        tareas[i].destino = destino;
+        tareas[i].bytesFila = bytesFilaIndexada(info->ancho, bits);
+        repartirFilas(info->alto, numTareas, i, &tareas[i].filaInicio, &tareas[i].filaFin);
+        ok = enviarTarea(pool, indexarFilasTarea, &tareas[i], &grupo);
+    }
+    esperarGrupo(&grupo);
+    destruirGrupo(&grupo);
+    for (int i = 0; i < numTareas && ok; i++) {
+        ok = tareas[i].ok;
+    }
+    free(tareas);
+    free(tabla);
+    free(cercana);
+    if (!ok) {
+        fprintf(stderr, "Error de memoria al indexar la imagen\n");
+    }
+    return ok;
+}
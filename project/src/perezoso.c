@@ -0,0 +1,191 @@
+#include "perezoso.h"
+#include "cache.h"
+#include "filters.h"
+#include "grafo.h"
+#include "guardado.h"
+#include "historial.h"
+#include "threading.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+int MODO_PEREZOSO_GLOBAL = 0;
+
+// QUÉ: Estado del módulo (solo lo usa el hilo del menú).
+// CÓMO: pedidas cuenta las operaciones que llegaron desde la última
+// ejecución y evitadas las que la simplificación quitó.
+static CadenaOperaciones pendientes = {NULL, 0};
+static int pedidas = 0;
+static int evitadas = 0;
+
+// QUÉ: Añadir una operación a la cadena pendiente (ver perezoso.h).
+int posponerOperacion(const Operacion* op) {
+    Operacion* ultima = pendientes.numOps ? &pendientes.ops[pendientes.numOps - 1] : NULL;
+    int mismoTipo = ultima && ultima->tipo == op->tipo;
+    pedidas++;
+
+    switch (op->tipo) {
+        case OP_BLUR: {
+            KernelGaussiano kernel;
+            if (!crearKernelGaussiano(&kernel, op->entero[0], op->real)) {
+                pedidas--;
+                return 0;
+            }
+            liberarKernelGaussiano(&kernel);
+            break;
+        }
+        case OP_BRILLO: {
+            int delta = op->entero[0];
+            if (delta == 0) {
+                printf("brightness:0 no cambia la imagen; no se pospone.\n");
+                evitadas++;
+                return 1;
+            }
+            if (mismoTipo && (ultima->entero[0] > 0) == (delta > 0)) {
+                // Del mismo signo, la saturación de la suma es la de los dos pasos
+                int suma = ultima->entero[0] + delta;
+                ultima->entero[0] = suma > 255 ? 255 : (suma < -255 ? -255 : suma);
+                printf("Se suma al brillo pendiente: %+d\n", ultima->entero[0]);
+                evitadas++;
+                return 1;
+            }
+            break;
+        }
+        case OP_ROTAR: {
+            float total = fmodf((mismoTipo ? ultima->real : 0.0f) + op->real, 360.0f);
+            if (total == 0.0f) {
+                if (mismoTipo) {
+                    pendientes.numOps--;
+                    printf("Se anula con la rotación pendiente.\n");
+                    evitadas += 2;
+                } else {
+                    printf("Una vuelta completa no cambia la imagen; no se pospone.\n");
+                    evitadas++;
+                }
+                return 1;
+            }
+            if (mismoTipo) {
+                ultima->real = total;
+                printf("Se suma a la rotación pendiente: %g grados\n", total);
+                evitadas++;
+                return 1;
+            }
+            break;
+        }
+        case OP_ESCALAR:
+            if (mismoTipo) {
+                *ultima = *op;
+                printf("Sustituye al escalado pendiente (se escala una sola vez).\n");
+                evitadas++;
+                return 1;
+            }
+            break;
+        case OP_GRISES:
+            if (mismoTipo) {
+                evitadas++;
+                return 1;
+            }
+            break;
+        case OP_SOBEL:
+            break;
+    }
+
+    if (!agregarOperacion(&pendientes, op)) {
+        pedidas--;
+        return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Ejecutar las operaciones pendientes (ver perezoso.h).
+int materializarImagen(ImagenInfo* imagen) {
+    if (pendientes.numOps == 0) {
+        return 1;
+    }
+    if (!imagenCargada(imagen)) {
+        descartarPendientes();
+        return 0;
+    }
+    char descripcion[512];
+    describirCadena(&pendientes, descripcion, sizeof(descripcion));
+    printf("\nEjecutando %d operación(es) pendiente(s): %s\n", pendientes.numOps, descripcion);
+    if (evitadas > 0) {
+        printf("  (%d de %d pedidas se simplificaron sin calcularse)\n", evitadas, pedidas);
+    }
+
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+    // La cadena simplificada es la clave: pedir lo mismo con otros pasos
+    // intermedios que se anulan también acierta. Sin caché no se hashea.
+    int conCache = cacheActiva();
+    ClaveCache clave = {0, 0};
+    if (conCache) {
+        clave.pixeles = hashImagen(imagen);
+        clave.operacion = hashCadena(&pendientes);
+    }
+    ImagenInfo resultado = {0, 0, 0, 0, 0, NULL};
+    int ok = 1;
+    if (conCache && buscarEnCache(&clave, &resultado)) {
+        soltarImagen(imagen);
+        *imagen = resultado;
+        printf("Resultado reutilizado de la caché.\n");
+    } else {
+        PlanGrafo plan;
+        memset(&plan, 0, sizeof(plan));
+        // El plan no escribe en imágenes compartidas (historial, guardados)
+        ok = planificarCadena(&pendientes, &plan);
+        if (ok) {
+            explicarPlan(&plan);
+            ok = ejecutarPlan(imagen, &plan);
+        }
+        liberarPlan(&plan);
+        if (conCache && ok) {
+            guardarEnCache(&clave, imagen);
+        } else if (conCache) {
+            abandonarClaveCache(&clave);
+        }
+    }
+    gettimeofday(&fin, NULL);
+
+    if (ok) {
+        printf("✓ Imagen al día en %.4f seg: %dx%d (%s)\n", obtenerTiempoReal(inicio, fin), imagen->ancho,
+               imagen->alto, nombreFormatoImagen(imagen));
+    } else {
+        fprintf(stderr, "Error al ejecutar las operaciones pendientes; se descartan.\n");
+    }
+    // Se registra también si falló: el historial debe coincidir con la
+    // imagen, aunque haya quedado a medio procesar
+    char version[96];
+    snprintf(version, sizeof(version), "%s%.80s", ok ? "" : "(incompleto) ", descripcion);
+    registrarVersionCompleta(imagen, version);
+    descartarPendientes();
+    return ok;
+}
+
+// QUÉ: Olvidar las operaciones pendientes.
+void descartarPendientes(void) {
+    liberarCadena(&pendientes);
+    pedidas = 0;
+    evitadas = 0;
+}
+
+int numeroPendientes(void) {
+    return pendientes.numOps;
+}
+
+// QUÉ: Línea de estado para el menú (ver perezoso.h).
+void imprimirPendientes(void) {
+    if (pendientes.numOps > 0) {
+        char descripcion[512];
+        describirCadena(&pendientes, descripcion, sizeof(descripcion));
+        printf("  ⏸ Pendiente: %s", descripcion);
+        if (evitadas > 0) {
+            printf(" (%d de %d pedidas simplificadas)", evitadas, pedidas);
+        }
+        printf("\n");
+    } else if (MODO_PEREZOSO_GLOBAL) {
+        printf("  ⏸ Modo perezoso: sin operaciones pendientes\n");
+    }
+}
@@ -0,0 +1,816 @@
+#include "png_encoder.h"
+#include "deflate.h"
+#include "paleta.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// QUÉ: Tamaño nominal de cada trozo comprimido en paralelo.
+// CÓMO: Cada trozo pierde poco ratio porque arranca con los 32 KB previos
+// como diccionario; el coste fijo por trozo es un vaciado (5 bytes) y un
+// chunk IDAT (12 bytes).
+// POR QUÉ: 256 KB da trabajo suficiente por tarea y varios trozos por hilo
+// incluso en imágenes medianas.
+#define TAM_TROZO (256 * 1024)
+
+// QUÉ: Cómo se elige el filtro de cada fila.
+typedef enum {
+    FILTRO_FIJO,            // El mismo filtro en todas las filas
+    FILTRO_HEURISTICO,      // Menor suma de valores absolutos
+    FILTRO_PRUEBA           // Menor salida comprimiendo de prueba cada candidato
+} EleccionFiltro;
+
+// QUÉ: Configuración de cada perfil.
+typedef struct {
+    const char* nombre;
+    EleccionFiltro eleccion;
+    int filtroFijo;
+    ParametrosDeflate deflate;
+} ConfigPerfil;
+
+// CÓMO: Los parámetros deflate siguen de cerca los niveles 1, 6 y 9 de zlib
+// (cadena máxima, longitud "suficiente", evaluación perezosa).
+static const ConfigPerfil PERFILES[4] = {
+    {"almacenar", FILTRO_FIJO, 0, {0, 0, 0, 1}},
+    {"rápido", FILTRO_FIJO, 4, {1, 8, 0, 0}},
+    {"defecto", FILTRO_HEURISTICO, 0, {32, 128, 1, 0}},
+    {"máximo", FILTRO_PRUEBA, 0, {1024, 258, 1, 0}},
+};
+
+// QUÉ: Parámetros de las compresiones de prueba del perfil máximo.
+// CÓMO: Búsqueda corta: solo importa el orden entre candidatos, no el tamaño exacto.
+static const ParametrosDeflate PARAMETROS_PRUEBA = {8, 32, 0, 0};
+
+PerfilPNG PERFIL_PNG_GLOBAL = PNG_DEFECTO;
+
+const char* nombrePerfilPNG(PerfilPNG perfil) {
+    return (perfil >= PNG_ALMACENAR && perfil <= PNG_MAXIMO) ? PERFILES[perfil].nombre : "?";
+}
+
+// QUÉ: Trabajo de filtrado de un rango de filas.
+// CÓMO: origen son las filas sin filtrar, contiguas: los píxeles de la imagen
+// o sus índices de paleta empaquetados.
+typedef struct {
+    const unsigned char* origen;
+    int bpp;
+    unsigned char* filtrado;
+    size_t bytesFila;
+    int filaInicio;
+    int filaFin;
+    const ConfigPerfil* config;
+    int ok;
+} TareaFiltro;
+
+// QUÉ: Trabajo de compresión de un trozo de los datos filtrados.
+typedef struct {
+    const unsigned char* filtrado;
+    size_t inicio;
+    size_t fin;
+    int primero;
+    int final;
+    const ParametrosDeflate* parametros;
+    BufferBytes chunk;          // Chunk IDAT completo: longitud, tipo, datos y CRC
+    unsigned long adler;        // Adler-32 de filtrado[inicio, fin)
+    int ok;
+} TareaTrozo;
+
+static void escribirU32(unsigned char* p, unsigned long v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+// QUÉ: Predictor de Paeth (especificación PNG).
+static inline int paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+// QUÉ: Filtrar una fila con el filtro f y devolver la suma de |valor con signo|.
+// CÓMO: La suma es la heurística de la especificación PNG para elegir filtro:
+// residuos pequeños (cerca de 0 o de 256) comprimen mejor. Cada filtro tiene
+// su propio bucle (los primeros bpp bytes no tienen vecino izquierdo) para
+// no decidir el tipo en cada byte.
+static unsigned long filtrarFila(int f, const unsigned char* fila, const unsigned char* previa,
+                                 size_t n, int bpp, unsigned char* salida) {
+    size_t izquierda = (size_t)bpp < n ? (size_t)bpp : n;
+    unsigned long suma = 0;
+    size_t i;
+
+#define ACUMULAR(valor) do { unsigned char v_ = (unsigned char)(valor); salida[i] = v_; \
+                             suma += (v_ < 128) ? v_ : 256 - v_; } while (0)
+    switch (f) {
+        case 0:
+            for (i = 0; i < n; i++) ACUMULAR(fila[i]);
+            break;
+        case 1:
+            for (i = 0; i < izquierda; i++) ACUMULAR(fila[i]);
+            for (; i < n; i++) ACUMULAR(fila[i] - fila[i - bpp]);
+            break;
+        case 2:
+            if (!previa) return filtrarFila(0, fila, previa, n, bpp, salida);
+            for (i = 0; i < n; i++) ACUMULAR(fila[i] - previa[i]);
+            break;
+        case 3:
+            if (!previa) {
+                for (i = 0; i < izquierda; i++) ACUMULAR(fila[i]);
+                for (; i < n; i++) ACUMULAR(fila[i] - (fila[i - bpp] >> 1));
+            } else {
+                for (i = 0; i < izquierda; i++) ACUMULAR(fila[i] - (previa[i] >> 1));
+                for (; i < n; i++) ACUMULAR(fila[i] - ((fila[i - bpp] + previa[i]) >> 1));
+            }
+            break;
+        default:
+            if (!previa) return filtrarFila(1, fila, previa, n, bpp, salida);
+            for (i = 0; i < izquierda; i++) ACUMULAR(fila[i] - previa[i]);
+            for (; i < n; i++) ACUMULAR(fila[i] - paeth(fila[i - bpp], previa[i], previa[i - bpp]));
+            break;
+    }
+#undef ACUMULAR
+    return suma;
+}
+
+// QUÉ: Tamaño comprimido de una fila filtrada a continuación de la anterior.
+// CÓMO: contexto contiene la fila anterior ya filtrada (n + 1 bytes, o nada en
+// la primera fila) seguida del candidato; solo se comprime el candidato, con
+// la fila anterior como diccionario.
+// POR QUÉ: Con el contexto se premian los filtros que repiten patrones de la
+// fila de arriba, algo que la suma de valores absolutos no ve.
+static size_t tamanoPrueba(const unsigned char* contexto, size_t inicio, size_t fin, BufferBytes* salida) {
+    salida->tam = 0;
+    if (!comprimirDeflate(contexto, inicio, fin, 1, &PARAMETROS_PRUEBA, salida)) {
+        return (size_t)-1;
+    }
+    return salida->tam;
+}
+
+// QUÉ: Búferes de trabajo para elegir filtro (dos filas candidatas y, en
+// modo prueba, el contexto de compresión).
+typedef struct {
+    unsigned char* candidatos;
+    unsigned char* contexto;
+    BufferBytes comprimido;
+} AuxiliarFiltro;
+
+static int iniciarAuxiliarFiltro(AuxiliarFiltro* aux, const ConfigPerfil* config, size_t n) {
+    aux->comprimido.datos = NULL;
+    aux->comprimido.tam = aux->comprimido.capacidad = 0;
+    aux->candidatos = NULL;
+    aux->contexto = NULL;
+    if (config->eleccion == FILTRO_FIJO) {
+        return 1;
+    }
+    aux->candidatos = (unsigned char*)malloc(2 * n);
+    if (config->eleccion == FILTRO_PRUEBA) {
+        aux->contexto = (unsigned char*)malloc(2 * (n + 1));
+    }
+    return aux->candidatos && (config->eleccion != FILTRO_PRUEBA || aux->contexto);
+}
+
+static void liberarAuxiliarFiltro(AuxiliarFiltro* aux) {
+    liberarBuffer(&aux->comprimido);
+    free(aux->contexto);
+    free(aux->candidatos);
+    aux->contexto = aux->candidatos = NULL;
+}
+
+// QUÉ: Elegir el filtro de una fila según el perfil y escribir tipo + fila filtrada.
+// CÓMO: Según el perfil, aplica un filtro fijo, o prueba los cinco filtros en
+// un búfer temporal y copia el mejor (heurística o compresión de prueba), con
+// su byte de tipo, a destino (n + 1 bytes). previa es la fila anterior sin
+// filtrar (NULL en la primera); anterior es la fila anterior ya filtrada, con
+// su tipo, que la compresión de prueba usa como diccionario (NULL = sin contexto).
+// Devuelve 1 si tuvo éxito, 0 si falló la compresión de prueba.
+static int filtrarFilaPerfil(const ConfigPerfil* config, AuxiliarFiltro* aux, const unsigned char* fila,
+                             const unsigned char* previa, const unsigned char* anterior,
+                             size_t n, int bpp, unsigned char* destino) {
+    if (config->eleccion == FILTRO_FIJO) {
+        // Sin fila previa, Up y Paeth equivalen a None y Sub
+        int f = config->filtroFijo;
+        if (!previa && f == 2) f = 0;
+        if (!previa && f == 4) f = 1;
+        destino[0] = (unsigned char)f;
+        if (f == 0) {
+            memcpy(destino + 1, fila, n);
+        } else {
+            filtrarFila(f, fila, previa, n, bpp, destino + 1);
+        }
+        return 1;
+    }
+
+    unsigned char* actual = aux->candidatos;
+    unsigned char* mejor = aux->candidatos + n;
+    int mejorFiltro = 0;
+    if (config->eleccion == FILTRO_HEURISTICO) {
+        unsigned long mejorSuma = filtrarFila(0, fila, previa, n, bpp, mejor);
+        for (int f = 1; f <= 4; f++) {
+            unsigned long suma = filtrarFila(f, fila, previa, n, bpp, actual);
+            if (suma < mejorSuma) {
+                mejorSuma = suma;
+                mejorFiltro = f;
+                unsigned char* tmp = mejor;
+                mejor = actual;
+                actual = tmp;
+            }
+        }
+    } else {
+        // En modo prueba, contexto = [fila anterior filtrada | tipo + candidato]
+        unsigned char* contexto = aux->contexto;
+        size_t inicio = anterior ? n + 1 : 0;
+        if (inicio) memcpy(contexto, anterior, n + 1);
+        size_t mejorTam = (size_t)-1;
+        for (int f = 0; f <= 4; f++) {
+            contexto[inicio] = (unsigned char)f;
+            filtrarFila(f, fila, previa, n, bpp, contexto + inicio + 1);
+            size_t tam = tamanoPrueba(contexto, inicio, inicio + n + 1, &aux->comprimido);
+            if (tam < mejorTam) {
+                mejorTam = tam;
+                mejorFiltro = f;
+                memcpy(mejor, contexto + inicio + 1, n);
+            }
+        }
+        if (mejorTam == (size_t)-1) {
+            return 0;
+        }
+    }
+    destino[0] = (unsigned char)mejorFiltro;
+    memcpy(destino + 1, mejor, n);
+    return 1;
+}
+
+// QUÉ: Tarea del pool: elegir filtro y filtrar un rango de filas.
+// CÓMO: Cada fila va a su posición en los datos filtrados. En modo prueba la
+// fila anterior (ya decidida) sirve de diccionario; la primera fila de cada
+// tarea se prueba sin contexto.
+static void filtrarFilasTarea(void* arg) {
+    TareaFiltro* t = (TareaFiltro*)arg;
+    size_t n = t->bytesFila;
+    AuxiliarFiltro aux;
+    if (!iniciarAuxiliarFiltro(&aux, t->config, n)) {
+        liberarAuxiliarFiltro(&aux);
+        t->ok = 0;
+        return;
+    }
+    int ok = 1;
+    for (int y = t->filaInicio; y < t->filaFin && ok; y++) {
+        const unsigned char* fila = t->origen + (size_t)y * n;
+        const unsigned char* previa = (y > 0) ? fila - n : NULL;
+        unsigned char* destino = t->filtrado + (size_t)y * (n + 1);
+        const unsigned char* anterior = (y > t->filaInicio) ? destino - (n + 1) : NULL;
+        ok = filtrarFilaPerfil(t->config, &aux, fila, previa, anterior, n, t->bpp, destino);
+    }
+    liberarAuxiliarFiltro(&aux);
+    t->ok = ok;
+}
+
+// QUÉ: Tarea del pool: comprimir un trozo y empaquetarlo en un chunk IDAT.
+// CÓMO: El primer trozo lleva la cabecera zlib; el último cierra con BFINAL y
+// los demás con vaciado de sincronización. El CRC del chunk y el Adler-32 del
+// trozo se calculan aquí, en paralelo.
+static void comprimirTrozoTarea(void* arg) {
+    TareaTrozo* t = (TareaTrozo*)arg;
+    BufferBytes* b = &t->chunk;
+    t->ok = 0;
+
+    if (!reservarBuffer(b, 10)) {
+        return;
+    }
+    memcpy(b->datos + 4, "IDAT", 4);
+    b->tam = 8;
+    if (t->primero) {
+        b->datos[b->tam++] = 0x78; // CMF: deflate, ventana de 32 KB
+        b->datos[b->tam++] = 0x9C; // FLG: nivel por defecto, sin diccionario
+    }
+    if (!comprimirDeflate(t->filtrado, t->inicio, t->fin, t->final, t->parametros, b)) {
+        return;
+    }
+    if (!reservarBuffer(b, 4)) {
+        return;
+    }
+    escribirU32(b->datos, (unsigned long)(b->tam - 8));
+    escribirU32(b->datos + b->tam, crc32Actualizar(0, b->datos + 4, b->tam - 4));
+    b->tam += 4;
+
+    t->adler = adler32Actualizar(1, t->filtrado + t->inicio, t->fin - t->inicio);
+    t->ok = 1;
+}
+
+// QUÉ: Escribir un chunk PNG pequeño (cabecera, Adler final, IEND).
+static int escribirChunk(FILE* f, const char* tipo, const unsigned char* datos, size_t n) {
+    unsigned char cabecera[8];
+    unsigned char crcBytes[4];
+    escribirU32(cabecera, (unsigned long)n);
+    memcpy(cabecera + 4, tipo, 4);
+    unsigned long crc = crc32Actualizar(0, (const unsigned char*)tipo, 4);
+    crc = crc32Actualizar(crc, datos, n);
+    escribirU32(crcBytes, crc);
+    return fwrite(cabecera, 1, 8, f) == 8 && (n == 0 || fwrite(datos, 1, n, f) == n) &&
+           fwrite(crcBytes, 1, 4, f) == 4;
+}
+
+// QUÉ: Formato de las muestras del archivo.
+// CÓMO: Sin índices, la profundidad de la imagen (8 o 16 bits) con el tipo de
+// color de los canales. Con índices,
+// las filas se reescriben a 1-8 bits por píxel: tipo 3 (PLTE) para RGB/RGBA
+// o tipo 0 (grises) cuando los niveles caben en 1, 2 o 4 bits.
+typedef struct {
+    int tipoColor;
+    int bits;
+    int indexada;
+    int exacta;
+    Paleta paleta;
+} FormatoPNG;
+
+// QUÉ: Formato sin índices: la profundidad de la imagen con el tipo de color
+// de los canales.
+static void formatoSinPaleta(const ImagenInfo* info, FormatoPNG* formato) {
+    static const unsigned char tipoColor[5] = {0, 0, 4, 2, 6}; // Por número de canales
+    memset(formato, 0, sizeof(*formato));
+    formato->tipoColor = tipoColor[info->canales];
+    formato->bits = 8 * bytesMuestra(info);
+}
+
+// QUÉ: Elegir formato según MODO_PALETA_GLOBAL (ver paleta.h).
+// CÓMO: Primero se busca una paleta exacta; solo si no existe y el modo lo
+// permite se cuantiza. Los grises nunca pasan a PLTE (al cargarse serían RGB):
+// solo se indexan si sus niveles están en la rejilla de 1, 2 o 4 bits (0/255,
+// múltiplos de 85 o de 17), y gris con alfa se deja siempre a 8 bits. Las
+// imágenes de 16 bits no se indexan: la paleta perdería su precisión.
+static void elegirFormatoPNG(const ImagenInfo* info, PoolHilos* pool, FormatoPNG* formato) {
+    formatoSinPaleta(info, formato);
+    ModoPaleta modo = MODO_PALETA_GLOBAL;
+    int maxColores = COLORES_PALETA_GLOBAL < 2 ? 2 : COLORES_PALETA_GLOBAL > 256 ? 256 : COLORES_PALETA_GLOBAL;
+    if (modo == PALETA_NO || info->canales == 2 || bytesMuestra(info) == 2) {
+        return;
+    }
+
+    if (info->canales == 1) {
+        int limite = (modo == PALETA_CUANTIZAR && maxColores < 16) ? maxColores : 16;
+        int bits = 0;
+        Paleta niveles;
+        if (buscarPaletaExacta(info, limite, pool, &niveles)) {
+            for (int b = 1; b <= 4 && !bits; b *= 2) {
+                int paso = 255 / ((1 << b) - 1);
+                int enRejilla = niveles.numColores <= (1 << b);
+                for (int j = 0; j < niveles.numColores && enRejilla; j++) {
+                    enRejilla = niveles.colores[j][0] % paso == 0;
+                }
+                if (enRejilla) bits = b;
+            }
+            formato->exacta = bits != 0;
+        }
+        if (!bits && modo == PALETA_CUANTIZAR && maxColores <= 16) {
+            bits = maxColores >= 16 ? 4 : maxColores >= 4 ? 2 : 1;
+        }
+        if (bits) {
+            // La "paleta" son los niveles de la rejilla: índice = muestra gris
+            formato->indexada = 1;
+            formato->bits = bits;
+            formato->paleta.canales = 1;
+            formato->paleta.numColores = 1 << bits;
+            for (int j = 0; j < (1 << bits); j++) {
+                formato->paleta.colores[j][0] = (unsigned char)(j * (255 / ((1 << bits) - 1)));
+            }
+        }
+        return;
+    }
+
+    if (buscarPaletaExacta(info, maxColores, pool, &formato->paleta)) {
+        formato->exacta = 1;
+    } else if (!(modo == PALETA_CUANTIZAR && info->canales == 3 &&
+                 cuantizarPaleta(info, maxColores, pool, &formato->paleta))) {
+        return;
+    }
+    int n = formato->paleta.numColores;
+    if ((size_t)info->ancho * info->alto < 4 * (size_t)n) {
+        // Imagen diminuta: el chunk PLTE ocuparía más de lo que ahorra
+        formatoSinPaleta(info, formato);
+        return;
+    }
+    formato->indexada = 1;
+    formato->tipoColor = 3;
+    formato->bits = n <= 2 ? 1 : n <= 4 ? 2 : n <= 16 ? 4 : 8;
+}
+
+// QUÉ: Escribir PLTE y, si hay entradas translúcidas, tRNS.
+// CÓMO: La paleta exacta pone las translúcidas primero, así tRNS solo
+// necesita sus alfas. Devuelve los bytes escritos (0 si falla).
+static size_t escribirChunksPaleta(FILE* f, const Paleta* paleta) {
+    unsigned char plte[3 * 256];
+    unsigned char trns[256];
+    int numTransparentes = 0;
+    for (int j = 0; j < paleta->numColores; j++) {
+        memcpy(plte + 3 * j, paleta->colores[j], 3);
+        if (paleta->canales == 4 && paleta->colores[j][3] != 255) {
+            trns[j] = paleta->colores[j][3];
+            numTransparentes = j + 1;
+        } else {
+            trns[j] = 255;
+        }
+    }
+    size_t n = 3 * (size_t)paleta->numColores;
+    if (!escribirChunk(f, "PLTE", plte, n)) return 0;
+    if (numTransparentes && !escribirChunk(f, "tRNS", trns, (size_t)numTransparentes)) return 0;
+    return 12 + n + (numTransparentes ? 12 + (size_t)numTransparentes : 0);
+}
+
+// QUÉ: Copiar las muestras de 16 bits de la imagen en orden big-endian.
+// CÓMO: PNG guarda las muestras de 16 bits con el byte alto primero; la
+// matriz las tiene en el orden nativo. La copia se filtra y comprime en
+// lugar de los píxeles, como los índices de paleta.
+// Devuelve el búfer (alto * ancho * canales * 2 bytes) o NULL si falta memoria.
+static unsigned char* muestrasBigEndian(const ImagenInfo* info) {
+    size_t muestras = (size_t)info->alto * info->ancho * info->canales;
+    unsigned char* datos = (unsigned char*)malloc(muestras * 2);
+    if (!datos) {
+        return NULL;
+    }
+    const unsigned short* origen = (const unsigned short*)info->pixeles[0][0];
+    for (size_t i = 0; i < muestras; i++) {
+        datos[2 * i] = (unsigned char)(origen[i] >> 8);
+        datos[2 * i + 1] = (unsigned char)origen[i];
+    }
+    return datos;
+}
+
+// QUÉ: Codificar en paralelo una imagen sin relleno (ver codificarPNGParalelo).
+static int codificarPNGSinRelleno(const ImagenInfo* info, const char* ruta, FILE* destino, PerfilPNG perfil,
+                                  EstadisticasPNG* estadisticas) {
+    static const unsigned char firma[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+    if (perfil < PNG_ALMACENAR || perfil > PNG_MAXIMO) {
+        perfil = PNG_DEFECTO;
+    }
+    const ConfigPerfil* config = &PERFILES[perfil];
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+
+    PoolHilos pool;
+    if (!crearPool(&pool, NUM_HILOS_GLOBAL, 2 * NUM_HILOS_GLOBAL)) {
+        return 0;
+    }
+
+    // QUÉ: Fase 0: paleta. Si la imagen se indexa, se filtran y comprimen los
+    // índices empaquetados en lugar de los píxeles.
+    // CÓMO: Con índices, la especificación PNG recomienda no filtrar (los
+    // filtros restan índices, que no son magnitudes); solo el perfil máximo,
+    // que comprime de prueba, sigue eligiendo filtro por fila.
+    FormatoPNG formato;
+    elegirFormatoPNG(info, &pool, &formato);
+    ConfigPerfil configIndexada = *config;
+    unsigned char* indices = NULL;
+    const unsigned char* origen = info->pixeles[0][0];
+    size_t bytesFila = (size_t)info->ancho * bytesPixel(info);
+    int bpp = bytesPixel(info);
+    if (bytesMuestra(info) == 2) {
+        // Los índices y las muestras big-endian comparten el búfer auxiliar
+        indices = muestrasBigEndian(info);
+        if (!indices) {
+            fprintf(stderr, "Error de memoria al codificar PNG\n");
+            destruirPool(&pool);
+            return 0;
+        }
+        origen = indices;
+    } else if (formato.indexada) {
+        bytesFila = bytesFilaIndexada(info->ancho, formato.bits);
+        indices = (unsigned char*)malloc((size_t)info->alto * bytesFila);
+        if (!indices || !indexarImagen(info, &formato.paleta, formato.exacta, formato.bits, &pool, indices)) {
+            // Sin memoria para los índices: se guarda sin paleta
+            free(indices);
+            indices = NULL;
+            formatoSinPaleta(info, &formato);
+            bytesFila = (size_t)info->ancho * info->canales;
+        } else {
+            origen = indices;
+            bpp = 1;
+            if (config->eleccion != FILTRO_PRUEBA) {
+                configIndexada.eleccion = FILTRO_FIJO;
+                configIndexada.filtroFijo = 0;
+            }
+            config = &configIndexada;
+        }
+    }
+
+    size_t total = (size_t)info->alto * (bytesFila + 1);
+    unsigned char* filtrado = (unsigned char*)malloc(total);
+    int numTrozos = (int)((total + TAM_TROZO - 1) / TAM_TROZO);
+    int numFiltros = NUM_HILOS_GLOBAL * 4;
+    if (numFiltros > info->alto) numFiltros = info->alto;
+    TareaFiltro* filtros = (TareaFiltro*)calloc((size_t)numFiltros, sizeof(TareaFiltro));
+    TareaTrozo* trozos = (TareaTrozo*)calloc((size_t)numTrozos, sizeof(TareaTrozo));
+    if (!filtrado || !filtros || !trozos) {
+        fprintf(stderr, "Error de memoria al codificar PNG\n");
+        destruirPool(&pool);
+        free(indices);
+        free(filtrado);
+        free(filtros);
+        free(trozos);
+        return 0;
+    }
+    GrupoTareas grupo;
+    iniciarGrupo(&grupo);
+    int ok = 1;
+
+    // QUÉ: Fase 1: elección de filtro y filtrado por rangos de filas.
+    int filasPorTarea = (info->alto + numFiltros - 1) / numFiltros;
+    for (int i = 0; i < numFiltros && ok; i++) {
+        filtros[i].origen = origen;
+        filtros[i].bpp = bpp;
+        filtros[i].filtrado = filtrado;
+        filtros[i].bytesFila = bytesFila;
+        filtros[i].config = config;
+        filtros[i].filaInicio = i * filasPorTarea;
+        filtros[i].filaFin = (i + 1) * filasPorTarea < info->alto ? (i + 1) * filasPorTarea : info->alto;
+        ok = enviarTarea(&pool, filtrarFilasTarea, &filtros[i], &grupo);
+    }
+    esperarGrupo(&grupo);
+    for (int i = 0; i < numFiltros; i++) {
+        if (filtros[i].filaInicio < filtros[i].filaFin && !filtros[i].ok) ok = 0;
+    }
+
+    // QUÉ: Fase 2: compresión de trozos con el trozo anterior como diccionario.
+    for (int i = 0; i < numTrozos && ok; i++) {
+        trozos[i].filtrado = filtrado;
+        trozos[i].inicio = (size_t)i * TAM_TROZO;
+        trozos[i].fin = (i == numTrozos - 1) ? total : (size_t)(i + 1) * TAM_TROZO;
+        trozos[i].primero = (i == 0);
+        trozos[i].final = (i == numTrozos - 1);
+        trozos[i].parametros = &config->deflate;
+        ok = enviarTarea(&pool, comprimirTrozoTarea, &trozos[i], &grupo);
+    }
+    esperarGrupo(&grupo);
+    destruirPool(&pool);
+    destruirGrupo(&grupo);
+
+    unsigned long adler = 1;
+    for (int i = 0; i < numTrozos && ok; i++) {
+        if (!trozos[i].ok) {
+            ok = 0;
+            break;
+        }
+        adler = (i == 0) ? trozos[i].adler :
+                combinarAdler32(adler, trozos[i].adler, trozos[i].fin - trozos[i].inicio);
+    }
+
+    // QUÉ: Ensamblar el archivo: firma, IHDR, IDAT de cada trozo, Adler-32, IEND.
+    size_t bytesArchivo = 8 + 25 + 16 + 12; // Firma, IHDR, IDAT del Adler-32, IEND
+    FILE* f = !ok ? NULL : destino ? destino : fopen(ruta, "wb");
+    if (ok && !f) {
+        fprintf(stderr, "Error al crear archivo: %s\n", ruta);
+        ok = 0;
+    }
+    if (ok) {
+        unsigned char ihdr[13];
+        escribirU32(ihdr, (unsigned long)info->ancho);
+        escribirU32(ihdr + 4, (unsigned long)info->alto);
+        ihdr[8] = (unsigned char)formato.bits; // Bits por muestra
+        ihdr[9] = (unsigned char)formato.tipoColor;
+        ihdr[10] = 0;                         // Compresión deflate
+        ihdr[11] = 0;                         // Filtros adaptativos
+        ihdr[12] = 0;                         // Sin entrelazado
+        ok = fwrite(firma, 1, 8, f) == 8 && escribirChunk(f, "IHDR", ihdr, 13);
+        if (ok && formato.tipoColor == 3) {
+            size_t bytesPaleta = escribirChunksPaleta(f, &formato.paleta);
+            ok = bytesPaleta > 0;
+            bytesArchivo += bytesPaleta;
+        }
+        for (int i = 0; i < numTrozos && ok; i++) {
+            ok = fwrite(trozos[i].chunk.datos, 1, trozos[i].chunk.tam, f) == trozos[i].chunk.tam;
+            bytesArchivo += trozos[i].chunk.tam;
+        }
+        unsigned char adlerBytes[4];
+        escribirU32(adlerBytes, adler);
+        ok = ok && escribirChunk(f, "IDAT", adlerBytes, 4) && escribirChunk(f, "IEND", NULL, 0);
+        if (!destino && fclose(f) != 0) ok = 0;
+        if (!ok) fprintf(stderr, "Error al escribir PNG: %s\n", ruta);
+    }
+    gettimeofday(&fin, NULL);
+    if (ok && estadisticas) {
+        estadisticas->segundos = obtenerTiempoReal(inicio, fin);
+        estadisticas->bytesCrudos = (size_t)info->alto * info->ancho * bytesPixel(info);
+        estadisticas->coloresPaleta = formato.indexada ? formato.paleta.numColores : 0;
+        estadisticas->bitsPixel = formato.bits;
+        estadisticas->paletaExacta = formato.exacta;
+        estadisticas->bytesArchivo = bytesArchivo;
+    }
+
+    for (int i = 0; i < numTrozos; i++) {
+        liberarBuffer(&trozos[i].chunk);
+    }
+    free(trozos);
+    free(filtros);
+    free(filtrado);
+    free(indices);
+    return ok;
+}
+
+// QUÉ: Codificar en paralelo y escribir en destino o, si es NULL, en ruta.
+// CÓMO: Ver png_encoder.h. El archivo de la ruta se crea solo cuando la
+// compresión ya terminó bien; destino no se cierra. PNG no tiene RGBX: una
+// imagen con relleno se codifica desde una copia RGB (imagenParaGuardar).
+// POR QUÉ: Ver png_encoder.h.
+static int codificarPNGParalelo(const ImagenInfo* info, const char* ruta, FILE* destino, PerfilPNG perfil,
+                                EstadisticasPNG* estadisticas) {
+    if (!info->pixeles || info->canales < 1 || info->canales > 4) {
+        fprintf(stderr, "ERROR: Imagen no válida para guardar como PNG\n");
+        return 0;
+    }
+    ImagenInfo compacta = {0, 0, 0, 0, 0, NULL};
+    if (!imagenParaGuardar(info, &compacta, 1)) {
+        fprintf(stderr, "Error de memoria al codificar PNG\n");
+        return 0;
+    }
+    int ok = codificarPNGSinRelleno(&compacta, ruta, destino, perfil, estadisticas);
+    liberarImagen(&compacta);
+    return ok;
+}
+
+int escribirPNGParalelo(const ImagenInfo* info, const char* ruta, PerfilPNG perfil,
+                        EstadisticasPNG* estadisticas) {
+    return codificarPNGParalelo(info, ruta, NULL, perfil, estadisticas);
+}
+
+// QUÉ: Codificar en paralelo a un búfer de memoria.
+// CÓMO: El mismo ensamblado que escribirPNGParalelo sobre un FILE* de
+// open_memstream, que hace crecer el búfer según se escribe.
+int codificarPNGParaleloMemoria(const ImagenInfo* info, PerfilPNG perfil, unsigned char** datos, size_t* tam,
+                                EstadisticasPNG* estadisticas) {
+    char* buffer = NULL;
+    size_t largo = 0;
+    FILE* f = open_memstream(&buffer, &largo);
+    if (!f) {
+        fprintf(stderr, "Error de memoria al codificar PNG\n");
+        return 0;
+    }
+    int ok = codificarPNGParalelo(info, "(memoria)", f, perfil, estadisticas);
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) {
+        free(buffer);
+        return 0;
+    }
+    *datos = (unsigned char*)buffer;
+    *tam = largo;
+    return 1;
+}
+
+// QUÉ: Tamaño de la ventana deflate que se conserva como diccionario.
+#define VENTANA_DEFLATE (32 * 1024)
+
+// QUÉ: Comprimir lo pendiente del codificador incremental y escribirlo como IDAT.
+// CÓMO: Como comprimirTrozoTarea, pero con el diccionario al principio del
+// búfer pendiente. El último trozo lleva BFINAL y el Adler-32 dentro del mismo
+// chunk. Después se conservan solo los últimos 32 KB.
+static int volcarPendientePNG(CodificadorPNG* cod, int final) {
+    BufferBytes* b = &cod->chunk;
+    b->tam = 0;
+    if (!reservarBuffer(b, 10)) {
+        return 0;
+    }
+    memcpy(b->datos + 4, "IDAT", 4);
+    b->tam = 8;
+    if (cod->trozos++ == 0) {
+        b->datos[b->tam++] = 0x78; // Primer IDAT: cabecera zlib
+        b->datos[b->tam++] = 0x9C;
+    }
+    if (!comprimirDeflate(cod->pendiente.datos, cod->inicioPendiente, cod->pendiente.tam, final,
+                          &PERFILES[cod->perfil].deflate, b) ||
+        !reservarBuffer(b, 8)) {
+        return 0;
+    }
+    if (final) {
+        escribirU32(b->datos + b->tam, cod->adler);
+        b->tam += 4;
+    }
+    escribirU32(b->datos, (unsigned long)(b->tam - 8));
+    escribirU32(b->datos + b->tam, crc32Actualizar(0, b->datos + 4, b->tam - 4));
+    b->tam += 4;
+    if (fwrite(b->datos, 1, b->tam, cod->archivo) != b->tam) {
+        return 0;
+    }
+    cod->bytesArchivo += b->tam;
+
+    size_t conservar = cod->pendiente.tam < VENTANA_DEFLATE ? cod->pendiente.tam : VENTANA_DEFLATE;
+    memmove(cod->pendiente.datos, cod->pendiente.datos + cod->pendiente.tam - conservar, conservar);
+    cod->pendiente.tam = conservar;
+    cod->inicioPendiente = conservar;
+    return 1;
+}
+
+// QUÉ: Abrir el archivo y escribir la cabecera del codificador incremental.
+int iniciarCodificadorPNG(CodificadorPNG* cod, const char* ruta, int ancho, int alto, int canales,
+                          PerfilPNG perfil) {
+    static const unsigned char firma[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    static const unsigned char tipoColor[5] = {0, 0, 4, 2, 6};
+
+    memset(cod, 0, sizeof(*cod));
+    if (ancho < 1 || alto < 1 || canales < 1 || canales > 4) {
+        fprintf(stderr, "ERROR: Imagen no válida para guardar como PNG\n");
+        return 0;
+    }
+    cod->perfil = (perfil >= PNG_ALMACENAR && perfil <= PNG_MAXIMO) ? perfil : PNG_DEFECTO;
+    cod->ancho = ancho;
+    cod->alto = alto;
+    cod->canales = canales;
+    cod->bytesFila = (size_t)ancho * canales;
+    cod->adler = 1;
+    cod->ruta = strdup(ruta);
+    cod->filaPrevia = (unsigned char*)malloc(cod->bytesFila);
+    AuxiliarFiltro* aux = (AuxiliarFiltro*)calloc(1, sizeof(AuxiliarFiltro));
+    cod->auxiliar = aux;
+    if (!cod->ruta || !cod->filaPrevia || !aux ||
+        !iniciarAuxiliarFiltro(aux, &PERFILES[cod->perfil], cod->bytesFila)) {
+        fprintf(stderr, "Error de memoria al codificar PNG\n");
+        terminarCodificadorPNG(cod);
+        return 0;
+    }
+    cod->archivo = fopen(ruta, "wb");
+    if (!cod->archivo) {
+        fprintf(stderr, "Error al crear archivo: %s\n", ruta);
+        terminarCodificadorPNG(cod);
+        return 0;
+    }
+
+    unsigned char ihdr[13];
+    escribirU32(ihdr, (unsigned long)ancho);
+    escribirU32(ihdr + 4, (unsigned long)alto);
+    ihdr[8] = 8;
+    ihdr[9] = tipoColor[canales];
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    cod->ok = fwrite(firma, 1, 8, cod->archivo) == 8 && escribirChunk(cod->archivo, "IHDR", ihdr, 13);
+    cod->bytesArchivo = 8 + 25;
+    if (!cod->ok) {
+        fprintf(stderr, "Error al escribir PNG: %s\n", ruta);
+        terminarCodificadorPNG(cod);
+        return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Filtrar la fila, añadirla a lo pendiente y volcar si ya hay un trozo.
+int escribirFilaPNG(CodificadorPNG* cod, const unsigned char* fila) {
+    if (!cod->ok || cod->filasEscritas >= cod->alto) {
+        cod->ok = 0;
+        return 0;
+    }
+    size_t n = cod->bytesFila;
+    if (!reservarBuffer(&cod->pendiente, n + 1)) {
+        fprintf(stderr, "Error de memoria al codificar PNG\n");
+        cod->ok = 0;
+        return 0;
+    }
+    unsigned char* destino = cod->pendiente.datos + cod->pendiente.tam;
+    // La fila anterior filtrada sigue en el búfer salvo que el volcado la haya recortado
+    const unsigned char* anterior = (cod->filasEscritas > 0 && cod->pendiente.tam >= n + 1) ? destino - (n + 1) : NULL;
+    const unsigned char* previa = cod->filasEscritas > 0 ? cod->filaPrevia : NULL;
+    if (!filtrarFilaPerfil(&PERFILES[cod->perfil], (AuxiliarFiltro*)cod->auxiliar, fila, previa, anterior, n,
+                           cod->canales, destino)) {
+        cod->ok = 0;
+        return 0;
+    }
+    cod->pendiente.tam += n + 1;
+    cod->adler = adler32Actualizar(cod->adler, destino, n + 1);
+    memcpy(cod->filaPrevia, fila, n);
+    cod->filasEscritas++;
+
+    if (cod->pendiente.tam - cod->inicioPendiente >= TAM_TROZO && !volcarPendientePNG(cod, 0)) {
+        fprintf(stderr, "Error al escribir PNG: %s\n", cod->ruta);
+        cod->ok = 0;
+        return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Terminar el PNG (o borrar el archivo incompleto) y liberar todo.
+int terminarCodificadorPNG(CodificadorPNG* cod) {
+    int ok = cod->ok && cod->archivo && cod->filasEscritas == cod->alto;
+    if (ok) {
+        ok = volcarPendientePNG(cod, 1) && escribirChunk(cod->archivo, "IEND", NULL, 0);
+        cod->bytesArchivo += 12;
+        if (!ok) fprintf(stderr, "Error al escribir PNG: %s\n", cod->ruta);
+    }
+    if (cod->archivo) {
+        if (fclose(cod->archivo) != 0) ok = 0;
+        if (!ok) remove(cod->ruta);
+    }
+    cod->archivo = NULL;
+    if (cod->auxiliar) liberarAuxiliarFiltro((AuxiliarFiltro*)cod->auxiliar);
+    free(cod->auxiliar);
+    free(cod->filaPrevia);
+    free(cod->ruta);
+    liberarBuffer(&cod->pendiente);
+    liberarBuffer(&cod->chunk);
+    cod->auxiliar = NULL;
+    cod->filaPrevia = NULL;
+    cod->ruta = NULL;
+    cod->ok = 0;
+    return ok;
+}
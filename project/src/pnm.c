@@ -0,0 +1,404 @@
+#include "pnm.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// QUÉ: Tamaño del búfer de cabecera.
+// CÓMO: Una cabecera PNM normal ocupa unos 15 bytes; 4 KB deja sitio para
+// comentarios. Lo que se lea de más ya es trama y se copia a la imagen.
+#define TAM_CABECERA_PNM 4096
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+int DESCRIPTOR_SALIDA_PNM = STDOUT_FILENO;
+
+// QUÉ: Leer exactamente n bytes (o hasta fin de archivo).
+// CÓMO: En archivos regulares basta una llamada; en tuberías read() devuelve
+// trozos y hay que repetir. Devuelve los bytes leídos o -1 si hay error.
+static long leerTodo(int fd, unsigned char* destino, size_t n) {
+    size_t total = 0;
+    while (total < n) {
+        ssize_t r = read(fd, destino + total, n - total);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) break;
+        total += (size_t)r;
+    }
+    return (long)total;
+}
+
+// QUÉ: Interpretar la cabecera PAM ("P7") de buf[0, n).
+// CÓMO: Líneas "CLAVE valor" (WIDTH, HEIGHT, DEPTH, MAXVAL; TUPLTYPE y los
+// comentarios se ignoran) hasta la línea "ENDHDR". DEPTH da los canales.
+// Mismos valores de retorno que interpretarCabecera.
+static int interpretarCabeceraPAM(const unsigned char* buf, size_t n, int* canales, int* ancho,
+                                  int* alto, int* maxval, size_t* tamCabecera) {
+    long valores[4] = {0, 0, 0, 0}; // ancho, alto, profundidad, maxval
+    static const char* claves[4] = {"WIDTH", "HEIGHT", "DEPTH", "MAXVAL"};
+    size_t pos = 2;
+    while (1) {
+        // Cada línea debe estar completa antes de interpretarla
+        size_t fin = pos;
+        while (fin < n && buf[fin] != '\n') fin++;
+        if (fin >= n) return 0;
+        const char* linea = (const char*)buf + pos;
+        size_t largo = fin - pos;
+        pos = fin + 1;
+        while (largo > 0 && (*linea == ' ' || *linea == '\t')) {
+            linea++;
+            largo--;
+        }
+        if (largo == 0 || linea[0] == '#') continue;
+        if (largo >= 6 && strncmp(linea, "ENDHDR", 6) == 0) break;
+        for (int i = 0; i < 4; i++) {
+            size_t lc = strlen(claves[i]);
+            if (largo > lc && strncmp(linea, claves[i], lc) == 0 && (linea[lc] == ' ' || linea[lc] == '\t')) {
+                long v = 0;
+                size_t k = lc;
+                while (k < largo && (linea[k] == ' ' || linea[k] == '\t')) k++;
+                if (k == largo || linea[k] < '0' || linea[k] > '9') return -1;
+                while (k < largo && linea[k] >= '0' && linea[k] <= '9') {
+                    v = v * 10 + (linea[k] - '0');
+                    if (v > 1000000) return -1;
+                    k++;
+                }
+                valores[i] = v;
+            }
+        }
+    }
+    if (valores[2] < 1 || valores[2] > 4) return -1;
+    *ancho = (int)valores[0];
+    *alto = (int)valores[1];
+    *canales = (int)valores[2];
+    *maxval = (int)valores[3];
+    *tamCabecera = pos;
+    return 1;
+}
+
+// QUÉ: Interpretar la cabecera PNM de buf[0, n).
+// CÓMO: Lee el número mágico y tres enteros separados por espacios (con
+// comentarios '#' hasta fin de línea) y un único espacio final. "P7" (PAM,
+// con alfa) tiene su propio formato de cabecera.
+// Devuelve 1 si está completa (tamCabecera = bytes que ocupa), 0 si faltan
+// bytes y -1 si no es un PNM válido.
+static int interpretarCabecera(const unsigned char* buf, size_t n, int* canales, int* ancho,
+                               int* alto, int* maxval, size_t* tamCabecera) {
+    if (n < 2) return 0;
+    if (buf[0] != 'P' || (buf[1] != '5' && buf[1] != '6' && buf[1] != '7')) return -1;
+    if (buf[1] == '7') {
+        return interpretarCabeceraPAM(buf, n, canales, ancho, alto, maxval, tamCabecera);
+    }
+    *canales = (buf[1] == '5') ? 1 : 3;
+
+    size_t pos = 2;
+    long valores[3];
+    for (int i = 0; i < 3; i++) {
+        // Saltar espacios y comentarios
+        while (1) {
+            if (pos >= n) return 0;
+            if (buf[pos] == '#') {
+                while (pos < n && buf[pos] != '\n') pos++;
+            } else if (buf[pos] == ' ' || buf[pos] == '\t' || buf[pos] == '\n' ||
+                       buf[pos] == '\r' || buf[pos] == '\v' || buf[pos] == '\f') {
+                pos++;
+            } else {
+                break;
+            }
+        }
+        if (buf[pos] < '0' || buf[pos] > '9') return -1;
+        long v = 0;
+        while (pos < n && buf[pos] >= '0' && buf[pos] <= '9') {
+            v = v * 10 + (buf[pos] - '0');
+            if (v > 1000000) return -1;
+            pos++;
+        }
+        if (pos >= n) return 0; // El número puede seguir en la siguiente lectura
+        valores[i] = v;
+    }
+    // Exactamente un espacio separa maxval de la trama
+    if (buf[pos] != ' ' && buf[pos] != '\t' && buf[pos] != '\n' && buf[pos] != '\r') return -1;
+    *ancho = (int)valores[0];
+    *alto = (int)valores[1];
+    *maxval = (int)valores[2];
+    *tamCabecera = pos + 1;
+    return 1;
+}
+
+int esArchivoPNM(const char* ruta) {
+    unsigned char firma[2];
+    FILE* f = fopen(ruta, "rb");
+    if (!f) {
+        return 0;
+    }
+    size_t leidos = fread(firma, 1, 2, f);
+    fclose(f);
+    return leidos == 2 && firma[0] == 'P' && (firma[1] == '5' || firma[1] == '6' || firma[1] == '7');
+}
+
+// QUÉ: Cargar un PGM/PPM/PAM binario; si avisar, informa de la carga.
+// CÓMO: Ver pnm.h.
+// POR QUÉ: Ver pnm.h.
+static int leerPNM(const char* ruta, ImagenInfo* info, int canalesDeseados, int avisar) {
+    int entradaEstandar = (strcmp(ruta, "-") == 0);
+    int fd = entradaEstandar ? STDIN_FILENO : open(ruta, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error al abrir archivo: %s\n", ruta);
+        return 0;
+    }
+
+    // QUÉ: Leer hasta tener la cabecera completa.
+    unsigned char cabecera[TAM_CABECERA_PNM];
+    size_t n = 0;
+    int canales = 0, ancho = 0, alto = 0, maxval = 0;
+    size_t tamCabecera = 0;
+    int estado = 0;
+    while (estado == 0 && n < sizeof(cabecera)) {
+        ssize_t r = read(fd, cabecera + n, sizeof(cabecera) - n);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) break;
+        n += (size_t)r;
+        estado = interpretarCabecera(cabecera, n, &canales, &ancho, &alto, &maxval, &tamCabecera);
+    }
+    if (estado != 1 || ancho <= 0 || alto <= 0 || ancho > 100000 || alto > 100000 ||
+        maxval < 1 || maxval > 65535) {
+        fprintf(stderr, "ERROR: Cabecera PNM inválida o no soportada: %s\n", ruta);
+        if (!entradaEstandar) close(fd);
+        return 0;
+    }
+
+    // QUÉ: Leer la trama.
+    // CÓMO: Las muestras de 16 bits (maxval > 255) dan una imagen de 16 bits.
+    // Con maxval 255 o 65535 van directamente al bloque de la imagen (las de
+    // 16 bits pasan luego de big-endian al orden nativo en su sitio); si no,
+    // o si se pide un PPM en grises, a un búfer temporal que luego se
+    // reescala a 255 o 65535 y se reduce a luma. Un PPM se ensancha al final
+    // a RGBX en el propio bloque (cabe: la trama RGB ocupa 3/4 de él).
+    int bytesMuestra = (maxval > 255) ? 2 : 1;
+    unsigned int maximo = (bytesMuestra == 2) ? 65535u : 255u;
+    size_t muestras = (size_t)ancho * alto * canales;
+    size_t bytesTrama = muestras * bytesMuestra;
+    int aGris = (canalesDeseados == 1 && canales >= 3);
+    int canalesImagen = aGris ? (canales == 4 ? 2 : 1) : (canales == 3 ? 4 : canales);
+    int relleno = (canales == 3 && canalesImagen == 4);
+    if (!crearImagenFormato(info, ancho, alto, canalesImagen, 8 * bytesMuestra, relleno)) {
+        if (!entradaEstandar) close(fd);
+        return 0;
+    }
+    int directo = ((unsigned int)maxval == maximo && !aGris);
+    unsigned char* trama = directo ? info->pixeles[0][0] : (unsigned char*)malloc(bytesTrama);
+    if (!trama) {
+        fprintf(stderr, "Error de memoria al cargar PNM\n");
+        liberarImagen(info);
+        if (!entradaEstandar) close(fd);
+        return 0;
+    }
+    size_t sobrante = n - tamCabecera;
+    if (sobrante > bytesTrama) sobrante = bytesTrama;
+    memcpy(trama, cabecera + tamCabecera, sobrante);
+    long leidos = leerTodo(fd, trama + sobrante, bytesTrama - sobrante);
+    if (!entradaEstandar) close(fd);
+    if (leidos < 0 || (size_t)leidos != bytesTrama - sobrante) {
+        fprintf(stderr, "ERROR: Trama PNM truncada: %s\n", ruta);
+        if (!directo) free(trama);
+        liberarImagen(info);
+        return 0;
+    }
+
+    // Muestras al orden nativo y a la escala 0..maximo, con redondeo
+    // (v * maximo / maxval). Se hace sobre la propia trama: la muestra i
+    // ocupa la misma posición antes y después.
+    if (bytesMuestra == 2 || (unsigned int)maxval != maximo) {
+        unsigned int mitad = (unsigned int)maxval / 2;
+        for (size_t i = 0; i < muestras; i++) {
+            unsigned int v = (bytesMuestra == 2) ? ((unsigned int)trama[2 * i] << 8) | trama[2 * i + 1]
+                                                 : trama[i];
+            if (v > (unsigned int)maxval) v = (unsigned int)maxval;
+            if ((unsigned int)maxval != maximo) {
+                v = (unsigned int)(((unsigned long)v * maximo + mitad) / (unsigned int)maxval);
+            }
+            escribirMuestra(trama, i, v, bytesMuestra);
+        }
+    }
+    if (!directo) {
+        if (aGris) {
+            for (int y = 0; y < alto; y++) {
+                const unsigned char* fila = trama + (size_t)y * ancho * canales * bytesMuestra;
+                if (canalesImagen == 2) {
+                    filaAGrisesConAlfaMuestras(fila, info->pixeles[y][0], ancho, bytesMuestra);
+                } else {
+                    filaAGrisesMuestras(fila, canales, info->pixeles[y][0], ancho, bytesMuestra);
+                }
+            }
+        } else {
+            memcpy(info->pixeles[0][0], trama, bytesTrama);
+        }
+        free(trama);
+    }
+    if (relleno) {
+        ensancharFilaRGBX(info->pixeles[0][0], info->pixeles[0][0], (size_t)ancho * alto, bytesMuestra);
+    }
+
+    // Con la salida estándar ocupada por datos, los avisos van a stderr
+    if (avisar) {
+        fprintf(entradaEstandar ? stderr : stdout, "Imagen cargada: %dx%d, %d canales (%s, PNM %d bits)\n",
+                info->ancho, info->alto, info->canales, nombreFormatoImagen(info),
+                bytesMuestra * 8);
+    }
+    return 1;
+}
+
+int cargarPNM(const char* ruta, ImagenInfo* info, int canalesDeseados) {
+    return leerPNM(ruta, info, canalesDeseados, 1);
+}
+
+int cargarPNMSinAviso(const char* ruta, ImagenInfo* info) {
+    return leerPNM(ruta, info, 0, 0);
+}
+
+// QUÉ: Escribir todos los iovec en el descriptor.
+// CÓMO: writev puede escribir menos de lo pedido (tuberías, señales): se
+// avanza por los iovec ya escritos y se repite. Modifica 'iov'.
+static int escribirIovec(int fd, struct iovec* iov, int numIov) {
+    int actual = 0;
+    while (actual < numIov) {
+        int lote = numIov - actual < IOV_MAX ? numIov - actual : IOV_MAX;
+        ssize_t escritos = writev(fd, iov + actual, lote);
+        if (escritos < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Error al escribir PNM: %s\n", strerror(errno));
+            return 0;
+        }
+        // Saltar los iovec completos y recortar el parcial
+        while (actual < numIov && (size_t)escritos >= iov[actual].iov_len) {
+            escritos -= (ssize_t)iov[actual].iov_len;
+            actual++;
+        }
+        if (actual < numIov) {
+            iov[actual].iov_base = (char*)iov[actual].iov_base + escritos;
+            iov[actual].iov_len -= (size_t)escritos;
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Escribir una imagen de 8 bits (ver pnm.h).
+// CÓMO: La cabecera y un iovec por fila de la matriz, sin copiar.
+static int escribirPNM8(const ImagenInfo* info, int fd, char* cabecera, int tamCabecera) {
+    size_t bytesFila = (size_t)info->ancho * info->canales;
+    int numIov = info->alto + 1;
+    struct iovec* iov = (struct iovec*)malloc((size_t)numIov * sizeof(struct iovec));
+    if (!iov) {
+        fprintf(stderr, "Error de memoria al escribir PNM\n");
+        return 0;
+    }
+    iov[0].iov_base = cabecera;
+    iov[0].iov_len = (size_t)tamCabecera;
+    for (int y = 0; y < info->alto; y++) {
+        iov[y + 1].iov_base = info->pixeles[y][0];
+        iov[y + 1].iov_len = bytesFila;
+    }
+    int ok = escribirIovec(fd, iov, numIov);
+    free(iov);
+    return ok;
+}
+
+// QUÉ: Escribir una imagen de 16 bits con las muestras en big-endian.
+// CÓMO: Las filas se pasan a big-endian en un búfer de unas cuantas filas
+// (TAM_LOTE_PNM16 bytes como poco una) que se escribe con una llamada; la
+// cabecera va delante del primer lote.
+// POR QUÉ: La matriz está en orden nativo. Darle la vuelta en su sitio
+// tocaría la imagen del llamador y una copia entera duplicaría la memoria.
+#define TAM_LOTE_PNM16 (1 << 20)
+static int escribirPNM16(const ImagenInfo* info, int fd, char* cabecera, int tamCabecera) {
+    size_t muestrasFila = (size_t)info->ancho * info->canales;
+    size_t bytesFila = muestrasFila * 2;
+    int filasLote = (int)(TAM_LOTE_PNM16 / bytesFila);
+    if (filasLote < 1) filasLote = 1;
+    if (filasLote > info->alto) filasLote = info->alto;
+    unsigned char* lote = (unsigned char*)malloc((size_t)filasLote * bytesFila);
+    if (!lote) {
+        fprintf(stderr, "Error de memoria al escribir PNM\n");
+        return 0;
+    }
+    struct iovec iov[2] = {{cabecera, (size_t)tamCabecera}, {lote, 0}};
+    int primero = 0;
+    int ok = 1;
+    for (int y0 = 0; ok && y0 < info->alto; y0 += filasLote) {
+        int y1 = (y0 + filasLote < info->alto) ? y0 + filasLote : info->alto;
+        unsigned char* salida = lote;
+        for (int y = y0; y < y1; y++) {
+            const unsigned short* fila = (const unsigned short*)info->pixeles[y][0];
+            for (size_t i = 0; i < muestrasFila; i++) {
+                *salida++ = (unsigned char)(fila[i] >> 8);
+                *salida++ = (unsigned char)fila[i];
+            }
+        }
+        iov[1].iov_base = lote;
+        iov[1].iov_len = (size_t)(y1 - y0) * bytesFila;
+        ok = escribirIovec(fd, iov + primero, 2 - primero);
+        primero = 1;
+    }
+    free(lote);
+    return ok;
+}
+
+int escribirPNM(const ImagenInfo* info, int fd) {
+    if (!info->pixeles || info->canales < 1 || info->canales > 4) {
+        fprintf(stderr, "ERROR: PNM solo admite imágenes de 1 a 4 canales\n");
+        return 0;
+    }
+    // Maxval 255 o 65535 según la profundidad; RGBX se escribe sin relleno
+    ImagenInfo salida = {0, 0, 0, 0, 0, NULL};
+    if (!imagenParaGuardar(info, &salida, 1)) {
+        return 0;
+    }
+    char cabecera[128];
+    int tamCabecera;
+    int maxval = maximoMuestra(&salida);
+    if (imagenConAlfa(&salida)) {
+        tamCabecera = snprintf(cabecera, sizeof(cabecera),
+                               "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL %d\nTUPLTYPE %s\nENDHDR\n",
+                               salida.ancho, salida.alto, salida.canales, maxval,
+                               salida.canales == 2 ? "GRAYSCALE_ALPHA" : "RGB_ALPHA");
+    } else {
+        tamCabecera = snprintf(cabecera, sizeof(cabecera), "P%d\n%d %d\n%d\n",
+                               salida.canales == 1 ? 5 : 6, salida.ancho, salida.alto, maxval);
+    }
+    int ok = (bytesMuestra(&salida) == 2) ? escribirPNM16(&salida, fd, cabecera, tamCabecera)
+                                          : escribirPNM8(&salida, fd, cabecera, tamCabecera);
+    liberarImagen(&salida);
+    return ok;
+}
+
+// QUÉ: Guardar la imagen como PGM/PPM (ruta "-" = salida estándar).
+int guardarPNM(const ImagenInfo* info, const char* ruta) {
+    if (!info->pixeles) {
+        fprintf(stderr, "No hay imagen para guardar.\n");
+        return 0;
+    }
+    if (strcmp(ruta, "-") == 0) {
+        return escribirPNM(info, DESCRIPTOR_SALIDA_PNM);
+    }
+    int fd = open(ruta, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Error al crear archivo: %s\n", ruta);
+        return 0;
+    }
+    int ok = escribirPNM(info, fd);
+    if (close(fd) != 0) ok = 0;
+    if (ok) {
+        printf("Imagen guardada en: %s (%s%s)\n", ruta,
+               imagenConAlfa(info) ? "PAM" : info->canales == 1 ? "PGM" : "PPM",
+               info->profundidad == 16 ? ", 16 bits" : "");
+    }
+    return ok;
+}
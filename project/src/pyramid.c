@@ -0,0 +1,574 @@
+#include "pyramid.h"
+#include "image.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <math.h>
+#include <sys/time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// QUÉ: Lado de las teselas del nivel 0 en la construcción fusionada (2^7).
+// CÓMO: Una tesela RGB de 128x128 ocupa 48 KB y sus niveles derivados 16 KB más.
+// POR QUÉ: Cabe en la caché L2, así cada nivel se lee justo después de escribirse.
+#define LOG2_TESELA 7
+#define TAM_TESELA (1 << LOG2_TESELA)
+
+// QUÉ: Niveles gaussianos que se encadenan dentro de cada tesela.
+// CÓMO: El binomial del píxel x lee los píxeles 2x - 1 .. 2x + 1 del nivel
+// anterior, así que n niveles de una tesela necesitan un halo de 2^n - 1
+// píxeles a la izquierda y arriba en el nivel base; con n = 3 son 7 píxeles
+// sobre 128 (~11% más trabajo en el primer nivel, menos en los siguientes).
+// POR QUÉ: Con más niveles el halo crece como la propia tesela y casi todo
+// se calcularía dos veces.
+#define NIVELES_FUSION_GAUSS 3
+
+// QUÉ: Estructura para pasar datos a los hilos de la pirámide.
+// CÓMO: Rango de filas de teselas (modo caja y grupos gaussianos) o de filas
+// destino (gaussiana nivel a nivel).
+// POR QUÉ: Cada hilo escribe regiones disjuntas, sin sincronización.
+typedef struct {
+    const ImagenInfo* original;
+    Piramide* piramide;
+    int nivel;              // Nivel destino (gaussiana) o base del grupo fusionado
+    int nivelesFusionados;  // Niveles calculados dentro de cada tesela
+    int inicio;
+    int fin;
+    int ok;                 // 0 si el hilo se quedó sin memoria
+} PiramideArgs;
+
+// QUÉ: Vista de una región de un nivel: el nivel entero de la pirámide o una
+// tesela con su halo en memoria temporal.
+// CÓMO: datos apunta al píxel (x0, y0) del nivel y paso es la distancia entre
+// filas; anchoNivel y altoNivel son los del nivel completo, para replicar los
+// bordes igual en las dos.
+typedef struct {
+    unsigned char* datos;
+    size_t paso;
+    int x0;
+    int y0;
+    int anchoNivel;
+    int altoNivel;
+    int canales;
+} VistaNivel;
+
+// QUÉ: Vista de un nivel completo de la pirámide.
+static VistaNivel vistaDeNivel(const ImagenInfo* nivel) {
+    VistaNivel vista = {nivel->pixeles[0][0], (size_t)nivel->ancho * nivel->canales, 0, 0,
+                        nivel->ancho, nivel->alto, nivel->canales};
+    return vista;
+}
+
+#ifdef __SSE2__
+// QUÉ: Cargar 4 bytes sin alineación como entero de 32 bits.
+static inline int cargar32(const unsigned char* p) {
+    int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// QUÉ: Sumar los píxeles pares e impares de dos vectores de 16 bits.
+// CÓMO: a y b tienen 2 píxeles de 4 canales cada uno (64 bits por píxel):
+// _mm_unpack*_epi64 separa los pares de los impares y se suman.
+static inline __m128i sumarParesRGBA16(__m128i a, __m128i b) {
+    return _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+}
+#endif
+
+// QUÉ: Reducir 2x un tramo de fila destino con promedio de caja 2x2.
+// CÓMO: El píxel x promedia las columnas 2x y 2x+1 (con clamping al borde) de
+// las dos filas origen, redondeando. Con SSE2, según los canales:
+//   - 1: suma bytes pares e impares por máscara y desplazamiento (8 píxeles);
+//   - 2 y 4: amplía a 16 bits, suma las dos filas y separa los píxeles pares
+//     de los impares con _mm_shuffle_epi32 y _mm_unpack*_epi64 (4 píxeles);
+//   - 3: carga cada píxel con 4 bytes (el cuarto, del vecino, va a un canal
+//     de relleno) y escribe 4 bytes por píxel en orden, de modo que cada
+//     escritura pisa el relleno de la anterior (4 píxeles).
+// Los bordes y el resto van por la ruta escalar.
+// POR QUÉ: Es el núcleo de todos los niveles; las mismas técnicas que la
+// reducción por bloques de scaling.c.
+static void reducirFilaCaja(const unsigned char* fila0, const unsigned char* fila1,
+                            unsigned char* salida, int xIni, int xFin,
+                            int anchoOrigen, int canales) {
+    int x = xIni;
+#ifdef __SSE2__
+    const __m128i dos = _mm_set1_epi16(2);
+    const __m128i cero = _mm_setzero_si128();
+    if (canales == 1) {
+        const __m128i mascara = _mm_set1_epi16(0x00FF);
+        for (; x + 8 <= xFin && 2 * x + 16 <= anchoOrigen; x += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(fila0 + 2 * x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(fila1 + 2 * x));
+            __m128i suma = _mm_add_epi16(_mm_and_si128(a, mascara), _mm_srli_epi16(a, 8));
+            suma = _mm_add_epi16(suma, _mm_and_si128(b, mascara));
+            suma = _mm_add_epi16(suma, _mm_srli_epi16(b, 8));
+            suma = _mm_srli_epi16(_mm_add_epi16(suma, dos), 2);
+            _mm_storel_epi64((__m128i*)(salida + x), _mm_packus_epi16(suma, suma));
+        }
+    } else if (canales == 2) {
+        for (; x + 4 <= xFin && 2 * x + 8 <= anchoOrigen; x += 4) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(fila0 + 4 * x));
+            __m128i b = _mm_loadu_si128((const __m128i*)(fila1 + 4 * x));
+            __m128i bajos = _mm_add_epi16(_mm_unpacklo_epi8(a, cero), _mm_unpacklo_epi8(b, cero));
+            __m128i altos = _mm_add_epi16(_mm_unpackhi_epi8(a, cero), _mm_unpackhi_epi8(b, cero));
+            bajos = _mm_shuffle_epi32(bajos, _MM_SHUFFLE(3, 1, 2, 0));
+            altos = _mm_shuffle_epi32(altos, _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i suma = sumarParesRGBA16(bajos, altos);
+            suma = _mm_srli_epi16(_mm_add_epi16(suma, dos), 2);
+            _mm_storel_epi64((__m128i*)(salida + 2 * x), _mm_packus_epi16(suma, suma));
+        }
+    } else if (canales == 4) {
+        for (; x + 4 <= xFin && 2 * x + 8 <= anchoOrigen; x += 4) {
+            __m128i a0 = _mm_loadu_si128((const __m128i*)(fila0 + 8 * x));
+            __m128i a1 = _mm_loadu_si128((const __m128i*)(fila0 + 8 * x + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i*)(fila1 + 8 * x));
+            __m128i b1 = _mm_loadu_si128((const __m128i*)(fila1 + 8 * x + 16));
+            __m128i s0 = sumarParesRGBA16(_mm_add_epi16(_mm_unpacklo_epi8(a0, cero), _mm_unpacklo_epi8(b0, cero)),
+                                          _mm_add_epi16(_mm_unpackhi_epi8(a0, cero), _mm_unpackhi_epi8(b0, cero)));
+            __m128i s1 = sumarParesRGBA16(_mm_add_epi16(_mm_unpacklo_epi8(a1, cero), _mm_unpacklo_epi8(b1, cero)),
+                                          _mm_add_epi16(_mm_unpackhi_epi8(a1, cero), _mm_unpackhi_epi8(b1, cero)));
+            s0 = _mm_srli_epi16(_mm_add_epi16(s0, dos), 2);
+            s1 = _mm_srli_epi16(_mm_add_epi16(s1, dos), 2);
+            _mm_storeu_si128((__m128i*)(salida + 4 * x), _mm_packus_epi16(s0, s1));
+        }
+    } else if (canales == 3) {
+        // 2x + 9 <= anchoOrigen: la carga de 4 bytes del último píxel no pasa
+        // del final de la fila. x + 4 < xFin: el byte de relleno de la última
+        // escritura es del píxel x + 4, que este tramo escribe después (no de
+        // otra tesela, que puede estar escribiéndose en otro hilo).
+        for (; x + 4 < xFin && 2 * x + 9 <= anchoOrigen; x += 4) {
+            const unsigned char* p = fila0 + 6 * x;
+            const unsigned char* q = fila1 + 6 * x;
+            __m128i pares0 = _mm_set_epi32(cargar32(p + 18), cargar32(p + 12), cargar32(p + 6), cargar32(p));
+            __m128i impares0 = _mm_set_epi32(cargar32(p + 21), cargar32(p + 15), cargar32(p + 9), cargar32(p + 3));
+            __m128i pares1 = _mm_set_epi32(cargar32(q + 18), cargar32(q + 12), cargar32(q + 6), cargar32(q));
+            __m128i impares1 = _mm_set_epi32(cargar32(q + 21), cargar32(q + 15), cargar32(q + 9), cargar32(q + 3));
+            __m128i bajos = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(pares0, cero), _mm_unpacklo_epi8(impares0, cero)),
+                                          _mm_add_epi16(_mm_unpacklo_epi8(pares1, cero), _mm_unpacklo_epi8(impares1, cero)));
+            __m128i altos = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(pares0, cero), _mm_unpackhi_epi8(impares0, cero)),
+                                          _mm_add_epi16(_mm_unpackhi_epi8(pares1, cero), _mm_unpackhi_epi8(impares1, cero)));
+            bajos = _mm_srli_epi16(_mm_add_epi16(bajos, dos), 2);
+            altos = _mm_srli_epi16(_mm_add_epi16(altos, dos), 2);
+            __m128i rgbx = _mm_packus_epi16(bajos, altos);
+            for (int k = 0; k < 4; k++) {
+                int v = _mm_cvtsi128_si32(rgbx);
+                memcpy(salida + 3 * (x + k), &v, sizeof(v));
+                rgbx = _mm_srli_si128(rgbx, 4);
+            }
+        }
+    }
+#endif
+    for (; x < xFin; x++) {
+        int x0 = 2 * x;
+        int x1 = (x0 + 1 < anchoOrigen) ? x0 + 1 : anchoOrigen - 1;
+        for (int c = 0; c < canales; c++) {
+            int suma = fila0[x0 * canales + c] + fila0[x1 * canales + c] +
+                       fila1[x0 * canales + c] + fila1[x1 * canales + c];
+            salida[x * canales + c] = (unsigned char)((suma + 2) >> 2);
+        }
+    }
+}
+
+// QUÉ: Reducir con caja una región rectangular del nivel destino.
+// CÓMO: Para cada fila y de [yIni, yFin) toma las filas 2y y 2y+1 del nivel
+// anterior (con clamping) y reduce las columnas [xIni, xFin).
+static void reducirRegionCaja(const ImagenInfo* origen, ImagenInfo* destino,
+                              int xIni, int xFin, int yIni, int yFin) {
+    for (int y = yIni; y < yFin; y++) {
+        int y0 = 2 * y;
+        int y1 = (y0 + 1 < origen->alto) ? y0 + 1 : origen->alto - 1;
+        reducirFilaCaja(origen->pixeles[y0][0], origen->pixeles[y1][0], destino->pixeles[y][0],
+                        xIni, xFin, origen->ancho, origen->canales);
+    }
+}
+
+// QUÉ: Reducir con caja las filas [yIni, yFin) de un nivel completo.
+// CÓMO: Envoltorio público de reducirRegionCaja con todo el ancho.
+// POR QUÉ: Lo usan otros módulos (exportación de teselas) para repartir las
+// filas de un nivel en tareas del pool.
+void reducirNivelCaja(const ImagenInfo* origen, ImagenInfo* destino, int yIni, int yFin) {
+    reducirRegionCaja(origen, destino, 0, destino->ancho, yIni, yFin);
+}
+
+// QUÉ: Hilo de construcción fusionada por teselas (filtro caja).
+// CÓMO: Para cada tesela copia su región del original al nivel 0 y encadena
+// las reducciones 1..nivelesFusionados sobre la misma región.
+// POR QUÉ: La región de cada nivel depende solo de la misma región del nivel
+// anterior, que se acaba de escribir y sigue en caché.
+static void* construirTeselasHilo(void* args) {
+    PiramideArgs* pArgs = (PiramideArgs*)args;
+    Piramide* p = pArgs->piramide;
+    const ImagenInfo* original = pArgs->original;
+    int teselasX = (original->ancho + TAM_TESELA - 1) / TAM_TESELA;
+    size_t bytesPixel = (size_t)original->canales;
+
+    for (int ty = pArgs->inicio; ty < pArgs->fin; ty++) {
+        for (int tx = 0; tx < teselasX; tx++) {
+            int X = tx * TAM_TESELA;
+            int Y = ty * TAM_TESELA;
+
+            // Nivel 0: copiar la región de la tesela
+            int xFin = (X + TAM_TESELA < original->ancho) ? X + TAM_TESELA : original->ancho;
+            int yFin = (Y + TAM_TESELA < original->alto) ? Y + TAM_TESELA : original->alto;
+            for (int y = Y; y < yFin; y++) {
+                memcpy(p->niveles[0].pixeles[y][X], original->pixeles[y][X],
+                       (size_t)(xFin - X) * bytesPixel);
+            }
+
+            // Niveles encadenados dentro de la tesela
+            for (int l = 1; l <= pArgs->nivelesFusionados; l++) {
+                ImagenInfo* destino = &p->niveles[l];
+                int xIni = X >> l;
+                int yIni = Y >> l;
+                int xf = (X + TAM_TESELA) >> l;
+                int yf = (Y + TAM_TESELA) >> l;
+                if (xf > destino->ancho) xf = destino->ancho;
+                if (yf > destino->alto) yf = destino->alto;
+                reducirRegionCaja(&p->niveles[l - 1], destino, xIni, xf, yIni, yf);
+            }
+        }
+    }
+    return NULL;
+}
+
+// QUÉ: Reducción gaussiana (binomial [1 2 1] por eje) de una región.
+// CÓMO: El píxel (x, y) de destino pondera el vecindario 3x3 centrado en
+// (2x, 2y) de origen con pesos 1-2-1 x 1-2-1 (suma 16), con clamping a los
+// bordes del nivel; origen debe contener esos píxeles ya recortados.
+// POR QUÉ: Atenúa frecuencias altas antes de submuestrear mejor que la caja.
+static void reducirRegionGaussiana(const VistaNivel* origen, VistaNivel* destino,
+                                   int xIni, int xFin, int yIni, int yFin) {
+    int canales = origen->canales;
+
+    for (int y = yIni; y < yFin; y++) {
+        const unsigned char* filas[3];
+        for (int j = 0; j < 3; j++) {
+            int sy = 2 * y + j - 1;
+            if (sy < 0) sy = 0;
+            if (sy >= origen->altoNivel) sy = origen->altoNivel - 1;
+            filas[j] = origen->datos + (size_t)(sy - origen->y0) * origen->paso;
+        }
+        unsigned char* salida = destino->datos + (size_t)(y - destino->y0) * destino->paso;
+        for (int x = xIni; x < xFin; x++) {
+            int sx0 = 2 * x - 1 > 0 ? 2 * x - 1 : 0;
+            int sx2 = 2 * x + 1 < origen->anchoNivel ? 2 * x + 1 : origen->anchoNivel - 1;
+            int izq = (sx0 - origen->x0) * canales;
+            int centro = (2 * x - origen->x0) * canales;
+            int der = (sx2 - origen->x0) * canales;
+            unsigned char* pixel = salida + (x - destino->x0) * canales;
+            // Separable: [1 2 1] en cada fila y luego entre las tres filas
+            for (int c = 0; c < canales; c++) {
+                int h0 = filas[0][izq + c] + 2 * filas[0][centro + c] + filas[0][der + c];
+                int h1 = filas[1][izq + c] + 2 * filas[1][centro + c] + filas[1][der + c];
+                int h2 = filas[2][izq + c] + 2 * filas[2][centro + c] + filas[2][der + c];
+                pixel[c] = (unsigned char)((h0 + 2 * h1 + h2 + 8) >> 4);
+            }
+        }
+    }
+}
+
+// QUÉ: Hilo de reducción gaussiana de un nivel completo (filas [inicio, fin)).
+static void* reducirGaussianaHilo(void* args) {
+    PiramideArgs* pArgs = (PiramideArgs*)args;
+    VistaNivel origen = vistaDeNivel(&pArgs->piramide->niveles[pArgs->nivel - 1]);
+    VistaNivel destino = vistaDeNivel(&pArgs->piramide->niveles[pArgs->nivel]);
+    reducirRegionGaussiana(&origen, &destino, 0, destino.anchoNivel, pArgs->inicio, pArgs->fin);
+    return NULL;
+}
+
+// QUÉ: Hilo de construcción fusionada por teselas (filtro gaussiano).
+// CÓMO: Las teselas son de TAM_TESELA en el nivel base (pArgs->nivel, ya
+// completo). Para cada una calcula, del último nivel del grupo hacia atrás,
+// la región que le toca más el halo que leen los niveles siguientes; luego
+// reduce nivel a nivel en memoria temporal (el primero lee del nivel base) y
+// copia a la pirámide solo la región propia.
+// POR QUÉ: Los píxeles del halo son de las teselas vecinas, que los escriben
+// ellas; recalcularlos es más barato que volver a leer cada nivel completo.
+static void* construirTeselasGaussianaHilo(void* args) {
+    PiramideArgs* pArgs = (PiramideArgs*)args;
+    Piramide* p = pArgs->piramide;
+    int base = pArgs->nivel;
+    int n = pArgs->nivelesFusionados;
+    const ImagenInfo* nivelBase = &p->niveles[base];
+    int canales = nivelBase->canales;
+    int teselasX = (nivelBase->ancho + TAM_TESELA - 1) / TAM_TESELA;
+
+    // Temporales por nivel del grupo: la tesela más el halo de ese nivel
+    unsigned char* temporales[NIVELES_FUSION_GAUSS + 1] = {NULL};
+    pArgs->ok = 1;
+    for (int r = 1; r <= n; r++) {
+        size_t lado = (size_t)(TAM_TESELA >> r) + ((size_t)1 << n);
+        temporales[r] = (unsigned char*)malloc(lado * lado * canales);
+        if (!temporales[r]) {
+            fprintf(stderr, "Error de memoria en hilo de pirámide gaussiana\n");
+            pArgs->ok = 0;
+        }
+    }
+
+    for (int ty = pArgs->inicio; ty < pArgs->fin && pArgs->ok; ty++) {
+        for (int tx = 0; tx < teselasX; tx++) {
+            int X = tx * TAM_TESELA;
+            int Y = ty * TAM_TESELA;
+
+            // Región propia [x0, x1) x [y0, y1) y región a calcular con halo
+            // [hx0, hx1) x [hy0, hy1) de cada nivel del grupo
+            int x0[NIVELES_FUSION_GAUSS + 1], x1[NIVELES_FUSION_GAUSS + 1];
+            int y0[NIVELES_FUSION_GAUSS + 1], y1[NIVELES_FUSION_GAUSS + 1];
+            int hx0[NIVELES_FUSION_GAUSS + 1], hx1[NIVELES_FUSION_GAUSS + 1];
+            int hy0[NIVELES_FUSION_GAUSS + 1], hy1[NIVELES_FUSION_GAUSS + 1];
+            for (int r = 1; r <= n; r++) {
+                const ImagenInfo* nivel = &p->niveles[base + r];
+                x0[r] = X >> r;
+                y0[r] = Y >> r;
+                x1[r] = ((X + TAM_TESELA) >> r < nivel->ancho) ? (X + TAM_TESELA) >> r : nivel->ancho;
+                y1[r] = ((Y + TAM_TESELA) >> r < nivel->alto) ? (Y + TAM_TESELA) >> r : nivel->alto;
+            }
+            hx0[n] = x0[n];
+            hx1[n] = x1[n];
+            hy0[n] = y0[n];
+            hy1[n] = y1[n];
+            for (int r = n - 1; r >= 1; r--) {
+                const ImagenInfo* nivel = &p->niveles[base + r];
+                int a = 2 * hx0[r + 1] - 1 > 0 ? 2 * hx0[r + 1] - 1 : 0;
+                int b = 2 * hx1[r + 1] < nivel->ancho ? 2 * hx1[r + 1] : nivel->ancho;
+                hx0[r] = a < x0[r] ? a : x0[r];
+                hx1[r] = b > x1[r] ? b : x1[r];
+                a = 2 * hy0[r + 1] - 1 > 0 ? 2 * hy0[r + 1] - 1 : 0;
+                b = 2 * hy1[r + 1] < nivel->alto ? 2 * hy1[r + 1] : nivel->alto;
+                hy0[r] = a < y0[r] ? a : y0[r];
+                hy1[r] = b > y1[r] ? b : y1[r];
+            }
+
+            VistaNivel origen = vistaDeNivel(nivelBase);
+            for (int r = 1; r <= n; r++) {
+                ImagenInfo* nivel = &p->niveles[base + r];
+                VistaNivel destino = {temporales[r], (size_t)(hx1[r] - hx0[r]) * canales, hx0[r], hy0[r],
+                                      nivel->ancho, nivel->alto, canales};
+                reducirRegionGaussiana(&origen, &destino, hx0[r], hx1[r], hy0[r], hy1[r]);
+                for (int y = y0[r]; y < y1[r]; y++) {
+                    memcpy(nivel->pixeles[y][x0[r]],
+                           destino.datos + (size_t)(y - hy0[r]) * destino.paso + (size_t)(x0[r] - hx0[r]) * canales,
+                           (size_t)(x1[r] - x0[r]) * canales);
+                }
+                origen = destino;
+            }
+        }
+    }
+
+    for (int r = 1; r <= n; r++) {
+        free(temporales[r]);
+    }
+    return NULL;
+}
+
+// QUÉ: Lanzar numHilos hilos sobre un trabajo y esperarlos.
+// CÓMO: Si falla pthread_create, espera los ya creados y reporta error.
+// POR QUÉ: La pirámide lanza varias rondas (teselas y niveles gaussianos).
+static int lanzarHilos(void* (*funcion)(void*), PiramideArgs* args, int numHilos) {
+    pthread_t hilos[numHilos];
+    int creados = 0;
+    for (int i = 0; i < numHilos; i++) {
+        if (pthread_create(&hilos[i], NULL, funcion, &args[i]) != 0) {
+            fprintf(stderr, "Error al crear hilo %d\n", i);
+            break;
+        }
+        creados++;
+    }
+    for (int i = 0; i < creados; i++) {
+        pthread_join(hilos[i], NULL);
+    }
+    return creados == numHilos;
+}
+
+// QUÉ: Repartir [0, total) en numHilos rangos contiguos.
+static void repartirRangos(PiramideArgs* args, int numHilos, int total) {
+    int porHilo = (int)ceil((double)total / numHilos);
+    for (int i = 0; i < numHilos; i++) {
+        args[i].inicio = i * porHilo;
+        args[i].fin = ((i + 1) * porHilo < total) ? (i + 1) * porHilo : total;
+        if (args[i].inicio > total) args[i].inicio = total;
+    }
+}
+
+// QUÉ: Reservar la memoria de todos los niveles y enlazar sus vistas.
+// CÓMO: Calcula las dimensiones de cada nivel (ceil de la mitad hasta 1x1),
+// suma tamaños y hace tres reservas totales (datos, punteros y filas).
+// POR QUÉ: Una sola reserva de datos para toda la pirámide.
+static int reservarPiramide(Piramide* p, int ancho, int alto, int canales) {
+    int anchos[MAX_NIVELES_PIRAMIDE];
+    int altos[MAX_NIVELES_PIRAMIDE];
+    size_t totalPixeles = 0;
+    size_t totalFilas = 0;
+    int n = 0;
+    int w = ancho, h = alto;
+    while (n < MAX_NIVELES_PIRAMIDE) {
+        anchos[n] = w;
+        altos[n] = h;
+        totalPixeles += (size_t)w * h;
+        totalFilas += (size_t)h;
+        n++;
+        if (w == 1 && h == 1) break;
+        w = (w + 1) / 2;
+        h = (h + 1) / 2;
+    }
+
+    p->datos = (unsigned char*)malloc(totalPixeles * canales);
+    p->punteros = (unsigned char**)malloc(totalPixeles * sizeof(unsigned char*));
+    p->filas = (unsigned char***)malloc(totalFilas * sizeof(unsigned char**));
+    if (!p->datos || !p->punteros || !p->filas) {
+        fprintf(stderr, "Error de memoria al reservar pirámide (%zu píxeles)\n", totalPixeles);
+        liberarPiramide(p);
+        return 0;
+    }
+
+    size_t desplazamientoPixeles = 0;
+    size_t desplazamientoFilas = 0;
+    for (int l = 0; l < n; l++) {
+        ImagenInfo* nivel = &p->niveles[l];
+        nivel->ancho = anchos[l];
+        nivel->alto = altos[l];
+        nivel->canales = canales;
+        nivel->profundidad = 8;
+        nivel->relleno = 0;
+        nivel->pixeles = p->filas + desplazamientoFilas;
+        enlazarMatriz(nivel->pixeles, p->punteros + desplazamientoPixeles,
+                      p->datos + desplazamientoPixeles * canales,
+                      anchos[l], altos[l], canales);
+        desplazamientoPixeles += (size_t)anchos[l] * altos[l];
+        desplazamientoFilas += (size_t)altos[l];
+    }
+    p->numNiveles = n;
+    p->totalBytes = totalPixeles * canales;
+    return 1;
+}
+
+// QUÉ: Construir la pirámide de una imagen de 8 bits.
+// CÓMO: Caja o gaussiana fusionadas por teselas.
+static int construirPiramide8(const ImagenInfo* origen, Piramide* piramide, FiltroPiramide filtro) {
+
+    struct timeval tiempo_inicio, tiempo_fin;
+    gettimeofday(&tiempo_inicio, NULL);
+
+    if (!reservarPiramide(piramide, origen->ancho, origen->alto, origen->canales)) {
+        return 0;
+    }
+    // Caja y gaussiana conservan un relleno constante al máximo
+    for (int l = 0; l < piramide->numNiveles; l++) {
+        piramide->niveles[l].relleno = origen->relleno;
+    }
+
+    int numHilos = NUM_HILOS_GLOBAL;
+    PiramideArgs args[numHilos];
+    int ok = 1;
+    int nivelesRestantesDesde = 1;
+
+    if (filtro == PIRAMIDE_CAJA) {
+        // Fase 1: teselas del nivel 0 con sus niveles encadenados
+        int nivelesFusionados = LOG2_TESELA;
+        if (nivelesFusionados > piramide->numNiveles - 1) {
+            nivelesFusionados = piramide->numNiveles - 1;
+        }
+        int teselasY = (origen->alto + TAM_TESELA - 1) / TAM_TESELA;
+        int hilos = (numHilos < teselasY) ? numHilos : teselasY;
+        repartirRangos(args, hilos, teselasY);
+        for (int i = 0; i < hilos; i++) {
+            args[i].original = origen;
+            args[i].piramide = piramide;
+            args[i].nivel = 0;
+            args[i].nivelesFusionados = nivelesFusionados;
+            args[i].ok = 1;
+        }
+        ok = lanzarHilos(construirTeselasHilo, args, hilos);
+
+        // Fase 2: niveles menores que una tesela (pocos píxeles, un hilo)
+        for (int l = nivelesFusionados + 1; ok && l < piramide->numNiveles; l++) {
+            reducirRegionCaja(&piramide->niveles[l - 1], &piramide->niveles[l],
+                              0, piramide->niveles[l].ancho, 0, piramide->niveles[l].alto);
+        }
+        nivelesRestantesDesde = piramide->numNiveles;
+    } else {
+        // Nivel 0: copia por filas contiguas
+        for (int y = 0; y < origen->alto; y++) {
+            memcpy(piramide->niveles[0].pixeles[y][0], origen->pixeles[y][0],
+                   (size_t)origen->ancho * origen->canales);
+        }
+
+        // Grupos de NIVELES_FUSION_GAUSS niveles encadenados por teselas del
+        // nivel base, mientras haya al menos una fila de teselas por hilo
+        int base = 0;
+        while (ok && base + NIVELES_FUSION_GAUSS < piramide->numNiveles) {
+            int teselasY = (piramide->niveles[base].alto + TAM_TESELA - 1) / TAM_TESELA;
+            if (teselasY < numHilos) {
+                break;
+            }
+            repartirRangos(args, numHilos, teselasY);
+            for (int i = 0; i < numHilos; i++) {
+                args[i].original = origen;
+                args[i].piramide = piramide;
+                args[i].nivel = base;
+                args[i].nivelesFusionados = NIVELES_FUSION_GAUSS;
+                args[i].ok = 1;
+            }
+            ok = lanzarHilos(construirTeselasGaussianaHilo, args, numHilos);
+            for (int i = 0; i < numHilos; i++) {
+                ok = ok && args[i].ok;
+            }
+            base += NIVELES_FUSION_GAUSS;
+        }
+        nivelesRestantesDesde = base + 1;
+    }
+
+    // Gaussiana, niveles pequeños: nivel a nivel, repartiendo filas destino
+    for (int l = nivelesRestantesDesde; ok && l < piramide->numNiveles; l++) {
+        int alto = piramide->niveles[l].alto;
+        int hilos = (numHilos < alto) ? numHilos : alto;
+        repartirRangos(args, hilos, alto);
+        for (int i = 0; i < hilos; i++) {
+            args[i].original = origen;
+            args[i].piramide = piramide;
+            args[i].nivel = l;
+            args[i].nivelesFusionados = 0;
+            args[i].ok = 1;
+        }
+        ok = lanzarHilos(reducirGaussianaHilo, args, hilos);
+    }
+
+    if (!ok) {
+        liberarPiramide(piramide);
+        return 0;
+    }
+
+    gettimeofday(&tiempo_fin, NULL);
+    printf("Pirámide construida: %d niveles (%dx%d → 1x1), %.2f MB, filtro %s, %d hilos, %.4f seg\n",
+           piramide->numNiveles, origen->ancho, origen->alto,
+           piramide->totalBytes / (1024.0 * 1024.0),
+           filtro == PIRAMIDE_CAJA ? "caja" : "gaussiano", numHilos,
+           obtenerTiempoReal(tiempo_inicio, tiempo_fin));
+    return 1;
+}
+
+// QUÉ: Construir la pirámide completa de una imagen usando NUM_HILOS_GLOBAL hilos.
+// CÓMO: Ver pyramid.h; una imagen de 16 bits se redondea antes a 8.
+// POR QUÉ: Evita llamar al escalado una vez por nivel desde el original.
+int construirPiramide(const ImagenInfo* origen, Piramide* piramide, FiltroPiramide filtro) {
+    memset(piramide, 0, sizeof(*piramide));
+    ImagenInfo ocho = {0, 0, 0, 0, 0, NULL};
+    if (!imagenCargada(origen) || !imagenEn8Bits(origen, &ocho)) {
+        return 0;
+    }
+    int ok = construirPiramide8(&ocho, piramide, filtro);
+    liberarImagen(&ocho);
+    return ok;
+}
+
+// QUÉ: Liberar la memoria de una pirámide y reiniciar la estructura.
+void liberarPiramide(Piramide* piramide) {
+    free(piramide->datos);
+    free(piramide->punteros);
+    free(piramide->filas);
+    memset(piramide, 0, sizeof(*piramide));
+}
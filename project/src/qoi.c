@@ -0,0 +1,628 @@
+#include "qoi.h"
+#include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+// QUÉ: Códigos de operación de QOI (especificación 1.0).
+#define QOI_OP_INDEX 0x00   // 00xxxxxx
+#define QOI_OP_DIFF  0x40   // 01xxxxxx
+#define QOI_OP_LUMA  0x80   // 10xxxxxx
+#define QOI_OP_RUN   0xC0   // 11xxxxxx
+#define QOI_OP_RGB   0xFE
+#define QOI_OP_RGBA  0xFF
+#define QOI_MASCARA  0xC0
+
+#define QOI_CABECERA 14
+#define QOI_RELLENO 8       // Marca de fin: siete 0x00 y un 0x01
+#define QOIP_CABECERA 18
+#define QOIP_ENTRADA 12
+
+// QUÉ: Píxeles por franja del contenedor (aprox.).
+// CÓMO: Cada franja reinicia el índice de colores y cuesta 34 bytes fijos
+// (cabecera, relleno y entrada de tabla), despreciable a este tamaño.
+#define PIXELES_FRANJA (256 * 1024)
+
+typedef union {
+    struct { unsigned char r, g, b, a; } c;
+    unsigned int v;
+} PixelQOI;
+
+static inline int hashQOI(PixelQOI p) {
+    return (p.c.r * 3 + p.c.g * 5 + p.c.b * 7 + p.c.a * 11) & 63;
+}
+
+static void escribirU32BE(unsigned char* p, unsigned long v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+static unsigned long leerU32BE(const unsigned char* p) {
+    return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16) |
+           ((unsigned long)p[2] << 8) | (unsigned long)p[3];
+}
+
+// QUÉ: Canales del flujo QOI para una imagen: 4 si tiene alfa, 3 si no
+// (RGBX se guarda como RGB).
+static int canalesQOI(const ImagenInfo* info) {
+    return imagenConAlfa(info) ? 4 : 3;
+}
+
+// QUÉ: Tamaño máximo de un flujo QOI de 'filas' filas de la imagen.
+static size_t tamMaximoQOI(const ImagenInfo* info, int filas) {
+    return QOI_CABECERA + (size_t)info->ancho * filas * (canalesQOI(info) + 1) + QOI_RELLENO;
+}
+
+// QUÉ: Codificar las filas [fila0, fila0 + filas) como flujo QOI completo.
+// CÓMO: Recorre los píxeles en orden comparando con el anterior y con la
+// tabla de 64 colores recientes. Grises (1 o 2 canales) se expanden a R = G = B
+// y el relleno de RGBX no se lee (el alfa queda en 255, como en RGB).
+// salida debe tener tamMaximoQOI bytes. Devuelve los bytes escritos.
+static size_t codificarFlujoQOI(const ImagenInfo* info, int fila0, int filas, unsigned char* salida) {
+    int canales = info->canales;
+    int conAlfa = imagenConAlfa(info);
+    int gris = (canales <= 2);
+    PixelQOI indice[64];
+    memset(indice, 0, sizeof(indice));
+    PixelQOI previo;
+    previo.c.r = previo.c.g = previo.c.b = 0;
+    previo.c.a = 255;
+
+    unsigned char* p = salida;
+    memcpy(p, "qoif", 4);
+    escribirU32BE(p + 4, (unsigned long)info->ancho);
+    escribirU32BE(p + 8, (unsigned long)filas);
+    p[12] = (unsigned char)canalesQOI(info);
+    p[13] = 0; // sRGB con alfa lineal
+    p += QOI_CABECERA;
+
+    int repeticion = 0;
+    for (int y = fila0; y < fila0 + filas; y++) {
+        const unsigned char* fila = info->pixeles[y][0];
+        for (int x = 0; x < info->ancho; x++, fila += canales) {
+            PixelQOI px;
+            px.c.r = fila[0];
+            px.c.g = gris ? fila[0] : fila[1];
+            px.c.b = gris ? fila[0] : fila[2];
+            px.c.a = conAlfa ? fila[canales - 1] : 255;
+
+            if (px.v == previo.v) {
+                if (++repeticion == 62) {
+                    *p++ = (unsigned char)(QOI_OP_RUN | (repeticion - 1));
+                    repeticion = 0;
+                }
+                continue;
+            }
+            if (repeticion > 0) {
+                *p++ = (unsigned char)(QOI_OP_RUN | (repeticion - 1));
+                repeticion = 0;
+            }
+
+            int h = hashQOI(px);
+            if (indice[h].v == px.v) {
+                *p++ = (unsigned char)(QOI_OP_INDEX | h);
+            } else {
+                indice[h] = px;
+                if (px.c.a == previo.c.a) {
+                    signed char vr = (signed char)(px.c.r - previo.c.r);
+                    signed char vg = (signed char)(px.c.g - previo.c.g);
+                    signed char vb = (signed char)(px.c.b - previo.c.b);
+                    signed char vgR = (signed char)(vr - vg);
+                    signed char vgB = (signed char)(vb - vg);
+                    if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        *p++ = (unsigned char)(QOI_OP_DIFF | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2));
+                    } else if (vgR > -9 && vgR < 8 && vg > -33 && vg < 32 && vgB > -9 && vgB < 8) {
+                        *p++ = (unsigned char)(QOI_OP_LUMA | (vg + 32));
+                        *p++ = (unsigned char)(((vgR + 8) << 4) | (vgB + 8));
+                    } else {
+                        p[0] = QOI_OP_RGB;
+                        p[1] = px.c.r;
+                        p[2] = px.c.g;
+                        p[3] = px.c.b;
+                        p += 4;
+                    }
+                } else {
+                    p[0] = QOI_OP_RGBA;
+                    p[1] = px.c.r;
+                    p[2] = px.c.g;
+                    p[3] = px.c.b;
+                    p[4] = px.c.a;
+                    p += 5;
+                }
+            }
+            previo = px;
+        }
+    }
+    if (repeticion > 0) {
+        *p++ = (unsigned char)(QOI_OP_RUN | (repeticion - 1));
+    }
+    memset(p, 0, QOI_RELLENO - 1);
+    p[QOI_RELLENO - 1] = 1;
+    p += QOI_RELLENO;
+    return (size_t)(p - salida);
+}
+
+// QUÉ: Decodificar un flujo QOI completo en las filas [fila0, fila0 + filas).
+// CÓMO: Valida la cabecera contra el ancho de la imagen y el número de filas
+// esperado; escribe los canales que tenga la imagen destino (1 o 2 toman R
+// como gris).
+// Devuelve 1 si el flujo es válido, 0 si está truncado o no coincide.
+static int decodificarFlujoQOI(const unsigned char* datos, size_t tam, ImagenInfo* info,
+                               int fila0, int filas, int aGris) {
+    if (tam < QOI_CABECERA + QOI_RELLENO || memcmp(datos, "qoif", 4) != 0 ||
+        leerU32BE(datos + 4) != (unsigned long)info->ancho || leerU32BE(datos + 8) != (unsigned long)filas ||
+        (datos[12] != 3 && datos[12] != 4)) {
+        return 0;
+    }
+    int canales = info->canales;
+    int conAlfa = (canales == 2 || canales == 4);
+    int relleno = info->relleno;
+    int gris = (canales <= 2);
+    // Con aGris (imagen en grises, flujo en color) cada fila se decodifica en
+    // RGBA a un búfer pequeño y se reduce a luma (con alfa si la imagen tiene
+    // 2 canales) al terminarla
+    unsigned char* filaColor = NULL;
+    if (aGris) {
+        filaColor = (unsigned char*)malloc((size_t)info->ancho * 4);
+        if (!filaColor) {
+            return 0;
+        }
+        canales = 4;
+        conAlfa = 1;
+        gris = 0;
+    }
+    PixelQOI indice[64];
+    memset(indice, 0, sizeof(indice));
+    PixelQOI px;
+    px.c.r = px.c.g = px.c.b = 0;
+    px.c.a = 255;
+
+    // Los códigos de hasta 5 bytes nunca leen más allá del relleno final
+    size_t pos = QOI_CABECERA;
+    size_t limite = tam - QOI_RELLENO;
+    int repeticion = 0;
+    for (int y = fila0; y < fila0 + filas; y++) {
+        unsigned char* fila = aGris ? filaColor : info->pixeles[y][0];
+        for (int x = 0; x < info->ancho; x++, fila += canales) {
+            if (repeticion > 0) {
+                repeticion--;
+            } else {
+                if (pos >= limite) {
+                    free(filaColor);
+                    return 0;
+                }
+                int b1 = datos[pos++];
+                if (b1 == QOI_OP_RGB) {
+                    px.c.r = datos[pos];
+                    px.c.g = datos[pos + 1];
+                    px.c.b = datos[pos + 2];
+                    pos += 3;
+                } else if (b1 == QOI_OP_RGBA) {
+                    px.c.r = datos[pos];
+                    px.c.g = datos[pos + 1];
+                    px.c.b = datos[pos + 2];
+                    px.c.a = datos[pos + 3];
+                    pos += 4;
+                } else if ((b1 & QOI_MASCARA) == QOI_OP_INDEX) {
+                    px = indice[b1];
+                } else if ((b1 & QOI_MASCARA) == QOI_OP_DIFF) {
+                    px.c.r += ((b1 >> 4) & 0x03) - 2;
+                    px.c.g += ((b1 >> 2) & 0x03) - 2;
+                    px.c.b += (b1 & 0x03) - 2;
+                } else if ((b1 & QOI_MASCARA) == QOI_OP_LUMA) {
+                    int b2 = datos[pos++];
+                    int vg = (b1 & 0x3F) - 32;
+                    px.c.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                    px.c.g += vg;
+                    px.c.b += vg - 8 + (b2 & 0x0F);
+                } else {
+                    repeticion = b1 & 0x3F;
+                }
+                indice[hashQOI(px)] = px;
+            }
+
+            if (gris) {
+                fila[0] = px.c.r;
+            } else {
+                fila[0] = px.c.r;
+                fila[1] = px.c.g;
+                fila[2] = px.c.b;
+            }
+            if (conAlfa) {
+                fila[canales - 1] = relleno ? 255 : px.c.a;
+            }
+        }
+        if (aGris && info->canales == 2) {
+            filaAGrisesConAlfa(filaColor, info->pixeles[y][0], info->ancho);
+        } else if (aGris) {
+            filaAGrises(filaColor, 4, info->pixeles[y][0], info->ancho);
+        }
+    }
+    free(filaColor);
+    return 1;
+}
+
+// QUÉ: Leer un archivo entero a memoria con una sola lectura.
+// Devuelve el búfer (liberar con free) o NULL en caso de error.
+static unsigned char* leerArchivoCompleto(const char* ruta, size_t* tam) {
+    FILE* f = fopen(ruta, "rb");
+    if (!f) {
+        fprintf(stderr, "Error al abrir archivo: %s\n", ruta);
+        return NULL;
+    }
+    unsigned char* datos = NULL;
+    long largo = -1;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        largo = ftell(f);
+    }
+    if (largo > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        datos = (unsigned char*)malloc((size_t)largo);
+        if (datos && fread(datos, 1, (size_t)largo, f) != (size_t)largo) {
+            free(datos);
+            datos = NULL;
+        }
+    }
+    fclose(f);
+    if (!datos) {
+        fprintf(stderr, "Error al leer archivo: %s\n", ruta);
+        return NULL;
+    }
+    *tam = (size_t)largo;
+    return datos;
+}
+
+int esArchivoQOI(const char* ruta) {
+    unsigned char firma[4];
+    FILE* f = fopen(ruta, "rb");
+    if (!f) {
+        return 0;
+    }
+    size_t leidos = fread(firma, 1, 4, f);
+    fclose(f);
+    return leidos == 4 && (memcmp(firma, "qoif", 4) == 0 || memcmp(firma, "qoip", 4) == 0);
+}
+
+// QUÉ: Trabajo de una franja del contenedor (codificar o decodificar).
+typedef struct {
+    ImagenInfo* info;
+    int fila0;
+    int filas;
+    unsigned char* datos;   // Flujo QOI de la franja
+    size_t tam;
+    int aGris;              // Decodificar a luma (ver decodificarFlujoQOI)
+    int ok;
+} TareaFranjaQOI;
+
+static void decodificarFranjaTarea(void* arg) {
+    TareaFranjaQOI* t = (TareaFranjaQOI*)arg;
+    t->ok = decodificarFlujoQOI(t->datos, t->tam, t->info, t->fila0, t->filas, t->aGris);
+}
+
+static void codificarFranjaTarea(void* arg) {
+    TareaFranjaQOI* t = (TareaFranjaQOI*)arg;
+    t->datos = (unsigned char*)malloc(tamMaximoQOI(t->info, t->filas));
+    if (!t->datos) {
+        t->ok = 0;
+        return;
+    }
+    t->tam = codificarFlujoQOI(t->info, t->fila0, t->filas, t->datos);
+    t->ok = 1;
+}
+
+// QUÉ: Ejecutar las tareas de franja en el pool y esperar a todas.
+// Devuelve 1 si todas terminaron bien.
+static int ejecutarFranjas(TareaFranjaQOI* tareas, int numFranjas, void (*funcion)(void*)) {
+    PoolHilos pool;
+    if (!crearPool(&pool, NUM_HILOS_GLOBAL, 2 * NUM_HILOS_GLOBAL)) {
+        return 0;
+    }
+    GrupoTareas grupo;
+    iniciarGrupo(&grupo);
+    int ok = 1;
+    for (int i = 0; i < numFranjas && ok; i++) {
+        ok = enviarTarea(&pool, funcion, &tareas[i], &grupo);
+    }
+    esperarGrupo(&grupo);
+    destruirPool(&pool);
+    destruirGrupo(&grupo);
+    for (int i = 0; i < numFranjas && ok; i++) {
+        if (!tareas[i].ok) ok = 0;
+    }
+    return ok;
+}
+
+// QUÉ: Decodificar un QOI estándar (un solo flujo).
+static int cargarQOIEstandar(const unsigned char* datos, size_t tam, ImagenInfo* info, int aGris) {
+    unsigned long ancho = leerU32BE(datos + 4);
+    unsigned long alto = leerU32BE(datos + 8);
+    if (ancho == 0 || alto == 0 || ancho > 100000 || alto > 100000) {
+        fprintf(stderr, "ERROR: Dimensiones QOI inválidas (%lux%lu)\n", ancho, alto);
+        return 0;
+    }
+    // RGB se decodifica como RGBX: en color la imagen siempre tiene 4 canales
+    int canales = datos[12] == 4 ? 4 : 3;
+    if (!crearImagenFormato(info, (int)ancho, (int)alto, aGris ? canales - 2 : 4, 8, !aGris && canales == 3)) {
+        return 0;
+    }
+    if (!decodificarFlujoQOI(datos, tam, info, 0, (int)alto, aGris)) {
+        fprintf(stderr, "ERROR: Flujo QOI truncado o inválido\n");
+        liberarImagen(info);
+        return 0;
+    }
+    if (aGris) {
+        return 1;
+    }
+    // Si ningún píxel tiene color, la imagen se compacta a 1 canal (2 con alfa)
+    unsigned int distintos = 0;
+    for (int y = 0; y < info->alto && !distintos; y++) {
+        const unsigned char* fila = info->pixeles[y][0];
+        for (int x = 0; x < info->ancho; x++, fila += 4) {
+            distintos |= (unsigned int)((fila[0] ^ fila[1]) | (fila[0] ^ fila[2]));
+        }
+    }
+    if (!distintos) {
+        ImagenInfo gris;
+        if (crearImagen(&gris, info->ancho, info->alto, canales - 2)) {
+            const unsigned char* origen = info->pixeles[0][0];
+            unsigned char* salida = gris.pixeles[0][0];
+            size_t total = (size_t)info->ancho * info->alto;
+            for (size_t i = 0; i < total; i++) {
+                salida[(canales - 2) * i] = origen[4 * i];
+                if (canales == 4) {
+                    salida[2 * i + 1] = origen[4 * i + 3];
+                }
+            }
+            liberarImagen(info);
+            *info = gris;
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Decodificar un contenedor de franjas en paralelo.
+static int cargarQOIContenedor(const unsigned char* datos, size_t tam, ImagenInfo* info, int aGris) {
+    if (tam < QOIP_CABECERA) {
+        fprintf(stderr, "ERROR: Contenedor QOI truncado\n");
+        return 0;
+    }
+    unsigned long ancho = leerU32BE(datos + 4);
+    unsigned long alto = leerU32BE(datos + 8);
+    int canales = datos[12];
+    unsigned long numFranjas = leerU32BE(datos + 14);
+    if (ancho == 0 || alto == 0 || ancho > 100000 || alto > 100000 || canales < 1 || canales > 4 ||
+        numFranjas == 0 || numFranjas > alto ||
+        (tam - QOIP_CABECERA) / QOIP_ENTRADA < numFranjas) {
+        fprintf(stderr, "ERROR: Cabecera de contenedor QOI inválida\n");
+        return 0;
+    }
+
+    // Solo hay que reducir a luma si la imagen guardada tiene color
+    aGris = aGris && canales >= 3;
+    TareaFranjaQOI* tareas = (TareaFranjaQOI*)calloc(numFranjas, sizeof(TareaFranjaQOI));
+    int relleno = !aGris && canales == 3;
+    int canalesImagen = aGris ? canales - 2 : (relleno ? 4 : canales);
+    if (!tareas || !crearImagenFormato(info, (int)ancho, (int)alto, canalesImagen, 8, relleno)) {
+        fprintf(stderr, "Error de memoria al cargar QOI\n");
+        free(tareas);
+        return 0;
+    }
+
+    // QUÉ: Recorrer la tabla y validar que franjas y datos cubren la imagen.
+    size_t desplazamiento = QOIP_CABECERA + (size_t)numFranjas * QOIP_ENTRADA;
+    unsigned long fila = 0;
+    int ok = 1;
+    for (unsigned long i = 0; i < numFranjas && ok; i++) {
+        const unsigned char* entrada = datos + QOIP_CABECERA + i * QOIP_ENTRADA;
+        unsigned long filas = leerU32BE(entrada);
+        unsigned long long bytes = ((unsigned long long)leerU32BE(entrada + 4) << 32) | leerU32BE(entrada + 8);
+        if (filas == 0 || filas > alto - fila || bytes > tam - desplazamiento) {
+            ok = 0;
+            break;
+        }
+        tareas[i].info = info;
+        tareas[i].fila0 = (int)fila;
+        tareas[i].filas = (int)filas;
+        tareas[i].datos = (unsigned char*)datos + desplazamiento;
+        tareas[i].tam = (size_t)bytes;
+        tareas[i].aGris = aGris;
+        fila += filas;
+        desplazamiento += (size_t)bytes;
+    }
+    if (ok && fila != alto) ok = 0;
+    if (ok) {
+        ok = ejecutarFranjas(tareas, (int)numFranjas, decodificarFranjaTarea);
+    }
+    free(tareas);
+    if (!ok) {
+        fprintf(stderr, "ERROR: Contenedor QOI truncado o inválido\n");
+        liberarImagen(info);
+        return 0;
+    }
+    return 1;
+}
+
+// QUÉ: Cargar un archivo QOI o un contenedor de franjas QOI.
+// CÓMO: Ver qoi.h.
+// POR QUÉ: Ver qoi.h.
+int cargarQOI(const char* ruta, ImagenInfo* info, int canalesDeseados) {
+    size_t tam = 0;
+    unsigned char* datos = leerArchivoCompleto(ruta, &tam);
+    if (!datos) {
+        return 0;
+    }
+    int ok = cargarQOIMemoria(datos, tam, ruta, info, canalesDeseados);
+    free(datos);
+    return ok;
+}
+
+// QUÉ: Decodificar un QOI o contenedor que ya está en memoria.
+// CÓMO: Ver qoi.h.
+int cargarQOIMemoria(const unsigned char* datos, size_t tam, const char* ruta, ImagenInfo* info,
+                     int canalesDeseados) {
+    int ok = 0;
+    if (tam >= QOI_CABECERA + QOI_RELLENO && memcmp(datos, "qoif", 4) == 0) {
+        ok = cargarQOIEstandar(datos, tam, info, canalesDeseados == 1);
+    } else if (tam >= 4 && memcmp(datos, "qoip", 4) == 0) {
+        ok = cargarQOIContenedor(datos, tam, info, canalesDeseados == 1);
+    } else {
+        fprintf(stderr, "ERROR: %s no es un archivo QOI\n", ruta);
+    }
+    if (ok) {
+        printf("Imagen cargada: %dx%d, %d canales (%s, QOI)\n", info->ancho, info->alto,
+               info->canales, nombreFormatoImagen(info));
+    }
+    return ok;
+}
+
+// QUÉ: Escribir bloques en un archivo y cerrarlo. Devuelve 1 si todo se escribió.
+static int escribirArchivo(const char* ruta, const unsigned char* cabecera, size_t tamCabecera,
+                           const TareaFranjaQOI* franjas, int numFranjas, size_t* total) {
+    FILE* f = fopen(ruta, "wb");
+    if (!f) {
+        fprintf(stderr, "Error al crear archivo: %s\n", ruta);
+        return 0;
+    }
+    int ok = (tamCabecera == 0 || fwrite(cabecera, 1, tamCabecera, f) == tamCabecera);
+    *total = tamCabecera;
+    for (int i = 0; i < numFranjas && ok; i++) {
+        ok = fwrite(franjas[i].datos, 1, franjas[i].tam, f) == franjas[i].tam;
+        *total += franjas[i].tam;
+    }
+    if (fclose(f) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error al escribir QOI: %s\n", ruta);
+    return ok;
+}
+
+// QUÉ: Versión de 8 bits de una imagen a guardar como QOI.
+// CÓMO: imagenEn8Bits; si la imagen era de 16 bits se avisa del redondeo.
+// Devuelve 1 si 'ocho' quedó lista (se suelta con liberarImagen).
+static int prepararImagenQOI(const ImagenInfo* info, ImagenInfo* ocho) {
+    if (!info->pixeles) {
+        fprintf(stderr, "No hay imagen para guardar.\n");
+        return 0;
+    }
+    if (bytesMuestra(info) == 2) {
+        printf("AVISO: QOI solo admite 8 bits por muestra; la imagen de 16 bits se redondea.\n");
+    }
+    return imagenEn8Bits(info, ocho);
+}
+
+// QUÉ: Guardar la imagen (ya de 8 bits) como QOI estándar.
+static int escribirQOI(const ImagenInfo* info, const char* ruta) {
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+
+    TareaFranjaQOI unica = {(ImagenInfo*)info, 0, info->alto, NULL, 0, 0, 0};
+    unica.datos = (unsigned char*)malloc(tamMaximoQOI(info, info->alto));
+    if (!unica.datos) {
+        fprintf(stderr, "Error de memoria al codificar QOI\n");
+        return 0;
+    }
+    unica.tam = codificarFlujoQOI(info, 0, info->alto, unica.datos);
+    size_t total = 0;
+    int ok = escribirArchivo(ruta, NULL, 0, &unica, 1, &total);
+    free(unica.datos);
+
+    gettimeofday(&fin, NULL);
+    if (ok) {
+        size_t crudos = (size_t)info->ancho * info->alto * canalesVisibles(info);
+        printf("Imagen guardada en: %s (QOI, %.3f s, %zu -> %zu bytes, ratio %.2f:1)\n", ruta,
+               obtenerTiempoReal(inicio, fin), crudos, total, (double)crudos / (double)total);
+    }
+    return ok;
+}
+
+// QUÉ: Guardar la imagen como QOI estándar.
+// CÓMO: Ver qoi.h.
+int guardarQOI(const ImagenInfo* info, const char* ruta) {
+    ImagenInfo ocho = {0, 0, 0, 0, 0, NULL};
+    if (!prepararImagenQOI(info, &ocho)) {
+        return 0;
+    }
+    int ok = escribirQOI(&ocho, ruta);
+    liberarImagen(&ocho);
+    return ok;
+}
+
+// QUÉ: Guardar la imagen (ya de 8 bits) como contenedor de franjas QOI.
+static int escribirQOIParalelo(const ImagenInfo* info, const char* ruta) {
+    struct timeval inicio, fin;
+    gettimeofday(&inicio, NULL);
+
+    // Franjas: unos PIXELES_FRANJA píxeles cada una y al menos 4 por hilo
+    size_t pixeles = (size_t)info->ancho * info->alto;
+    size_t porTamano = (pixeles + PIXELES_FRANJA - 1) / PIXELES_FRANJA;
+    size_t numFranjas = (size_t)NUM_HILOS_GLOBAL * 4;
+    if (porTamano > numFranjas) numFranjas = porTamano;
+    if (numFranjas > (size_t)info->alto) numFranjas = (size_t)info->alto;
+    int filasPorFranja = (int)((info->alto + numFranjas - 1) / numFranjas);
+    numFranjas = (size_t)((info->alto + filasPorFranja - 1) / filasPorFranja);
+
+    size_t tamCabecera = QOIP_CABECERA + numFranjas * QOIP_ENTRADA;
+    TareaFranjaQOI* tareas = (TareaFranjaQOI*)calloc(numFranjas, sizeof(TareaFranjaQOI));
+    unsigned char* cabecera = (unsigned char*)malloc(tamCabecera);
+    if (!tareas || !cabecera) {
+        fprintf(stderr, "Error de memoria al codificar QOI\n");
+        free(tareas);
+        free(cabecera);
+        return 0;
+    }
+    for (size_t i = 0; i < numFranjas; i++) {
+        tareas[i].info = (ImagenInfo*)info;
+        tareas[i].fila0 = (int)i * filasPorFranja;
+        tareas[i].filas = (tareas[i].fila0 + filasPorFranja <= info->alto) ? filasPorFranja
+                                                                            : info->alto - tareas[i].fila0;
+    }
+    int ok = ejecutarFranjas(tareas, (int)numFranjas, codificarFranjaTarea);
+
+    size_t total = 0;
+    if (ok) {
+        memcpy(cabecera, "qoip", 4);
+        escribirU32BE(cabecera + 4, (unsigned long)info->ancho);
+        escribirU32BE(cabecera + 8, (unsigned long)info->alto);
+        cabecera[12] = (unsigned char)canalesVisibles(info);
+        cabecera[13] = 0;
+        escribirU32BE(cabecera + 14, (unsigned long)numFranjas);
+        for (size_t i = 0; i < numFranjas; i++) {
+            unsigned char* entrada = cabecera + QOIP_CABECERA + i * QOIP_ENTRADA;
+            unsigned long long bytes = tareas[i].tam;
+            escribirU32BE(entrada, (unsigned long)tareas[i].filas);
+            escribirU32BE(entrada + 4, (unsigned long)(bytes >> 32));
+            escribirU32BE(entrada + 8, (unsigned long)(bytes & 0xFFFFFFFFUL));
+        }
+        ok = escribirArchivo(ruta, cabecera, tamCabecera, tareas, (int)numFranjas, &total);
+    } else {
+        fprintf(stderr, "Error de memoria al codificar QOI\n");
+    }
+
+    for (size_t i = 0; i < numFranjas; i++) {
+        free(tareas[i].datos);
+    }
+    free(tareas);
+    free(cabecera);
+
+    gettimeofday(&fin, NULL);
+    if (ok) {
+        size_t crudos = pixeles * canalesVisibles(info);
+        printf("Imagen guardada en: %s (QOI en %zu franjas, %.3f s, %zu -> %zu bytes, ratio %.2f:1)\n",
+               ruta, numFranjas, obtenerTiempoReal(inicio, fin), crudos, total,
+               (double)crudos / (double)total);
+    }
+    return ok;
+}
+
+// QUÉ: Guardar la imagen como contenedor de franjas QOI.
+// CÓMO: Ver qoi.h.
+// POR QUÉ: Ver qoi.h.
+int guardarQOIParalelo(const ImagenInfo* info, const char* ruta) {
+    ImagenInfo ocho = {0, 0, 0, 0, 0, NULL};
+    if (!prepararImagenQOI(info, &ocho)) {
+        return 0;
+    }
+    int ok = escribirQOIParalelo(&ocho, ruta);
+    liberarImagen(&ocho);
+    return ok;
+}
@@ -1,45 +1,172 @@
-// Implementación pendiente de scaleImageConcurrently.
-// Dividir el trabajo entre 2-4 hilos, cada uno procesa un rango de filas de la imagen destino.
-// Utilizar interpolación bilineal y reemplazar la imagen original por la redimensionada.
+// Escalado concurrente de imágenes: remuestreo bilineal separable, reducción
+// por promedio de área (box) para factores grandes y vecino más cercano.
+// El trabajo se reparte entre NUM_HILOS_GLOBAL hilos, cada uno procesa un rango
+// de filas de la imagen destino, y la imagen original se reemplaza por la
+// redimensionada.
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <math.h>
+#include <string.h>
+#include <sys/time.h>
 #include "scaling.h"
+#include "threading.h"
+#include "srgb.h"
 
-// Función que calcula interpolación bilineal
-static unsigned char interpolatePixel(ImagenInfo* img, float x, float y, int channel) {
-    int x0 = (int)floor(x);
-    int y0 = (int)floor(y);
-    int x1 = x0 + 1;
-    int y1 = y0 + 1;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-    // Clamp to image boundaries
-    if (x1 >= img->ancho)  x1 = img->ancho - 1;
-    if (y1 >= img->alto) y1 = img->alto - 1;
-    if (x0 < 0) x0 = 0;
-    if (y0 < 0) y0 = 0;
+// QUÉ: Soporte de SSSE3 (pshufb) con despacho en tiempo de ejecución.
+// CÓMO: La función se compila con __attribute__((target("ssse3"))) y solo se
+// llama si __builtin_cpu_supports("ssse3") lo confirma.
+// POR QUÉ: El binario se sigue compilando para x86-64 base (solo SSE2).
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ESCALADO_SSSE3 1
+#include <tmmintrin.h>
+#endif
 
-    float dx = x - x0;
-    float dy = y - y0;
+// QUÉ: Precisión de los pesos en punto fijo (11 bits por eje).
+// CÓMO: Cada peso está en [0, 2048]; tras las dos pasadas el valor queda
+// escalado por 2^22 y cabe holgadamente en 32 bits (255 * 2^22 < 2^31).
+// POR QUÉ: Aritmética entera exacta y suficiente precisión para coincidir con
+// la interpolación en float (diferencia máxima de ±1).
+#define ESCALA_BITS 11
+#define ESCALA_UNO (1 << ESCALA_BITS)
 
-    // Get pixel values
-    float TL = img->pixeles[y0][x0][channel];
-    float TR = img->pixeles[y0][x1][channel];
-    float BL = img->pixeles[y1][x0][channel];
-    float BR = img->pixeles[y1][x1][channel];
+// QUÉ: Muestra i de una fila llevada a la escala intermedia de 16 bits.
+// CÓMO: Con 8 bits (solo en luz lineal) pasa por la tabla de su canal; con 16
+// bits ya está en esa escala y en luz lineal pasa por SRGB16_A_LINEAL (el
+// alfa, sin curva). Los núcleos la llaman con bytes constante.
+// POR QUÉ: Luz lineal e imágenes de 16 bits comparten así los mismos núcleos
+// de 16 bits intermedios.
+__attribute__((always_inline))
+static inline unsigned int muestraIntermedia(const unsigned char* fila, size_t i, int canales, int c,
+                                             int canalAlfa, int lineal, const int bytes) {
+    if (bytes == 1) {
+        return tablaALineal(canales, c)[fila[i]];
+    }
+    unsigned int v = ((const unsigned short*)fila)[i];
+    return lineal ? muestra16ALineal(v, c == canalAlfa) : v;
+}
+
+// QUÉ: Escribir un valor intermedio de 16 bits como muestra de salida (el
+// camino inverso de muestraIntermedia).
+__attribute__((always_inline))
+static inline void escribirIntermedia(unsigned char* salida, size_t i, unsigned int v, int c, int canalAlfa,
+                                      int lineal, const int bytes) {
+    if (bytes == 1) {
+        salida[i] = linealACanal(v, c == canalAlfa);
+    } else {
+        ((unsigned short*)salida)[i] = lineal ? linealACanal16(v, c == canalAlfa) : (unsigned short)v;
+    }
+}
+
+// QUÉ: Construir la tabla de coeficientes de un eje.
+// CÓMO: Para cada coordenada destino calcula floor(d * factor), el vecino
+// siguiente con clamping al borde y el peso fraccional en punto fijo.
+// POR QUÉ: floor, clamping y pesos se calculan una vez por fila/columna en
+// lugar de una vez por canal de cada píxel.
+static int construirTablaEje(TablaEje* tabla, int tamDestino, int tamOrigen, int bytesPorPixel) {
+    tabla->indice0 = (int*)malloc(tamDestino * sizeof(int));
+    tabla->indice1 = (int*)malloc(tamDestino * sizeof(int));
+    tabla->peso = (int*)malloc(tamDestino * sizeof(int));
+    if (!tabla->indice0 || !tabla->indice1 || !tabla->peso) {
+        liberarTablaEje(tabla);
+        return 0;
+    }
+
+    float factor = (float)tamOrigen / tamDestino;
+    for (int d = 0; d < tamDestino; d++) {
+        float s = d * factor;
+        int i0 = (int)floorf(s);
+        int i1 = i0 + 1;
+        if (i0 < 0) i0 = 0;
+        if (i0 > tamOrigen - 1) i0 = tamOrigen - 1;
+        if (i1 > tamOrigen - 1) i1 = tamOrigen - 1;
 
-    // Bilinear interpolation
-    float top = TL * (1 - dx) + TR * dx;
-    float bottom = BL * (1 - dx) + BR * dx;
-    float value = top * (1 - dy) + bottom * dy;
+        int peso = (int)((s - i0) * ESCALA_UNO + 0.5f);
+        if (peso < 0) peso = 0;
+        if (peso > ESCALA_UNO) peso = ESCALA_UNO;
 
-    // Clamp final result
-    if (value < 0) value = 0;
-    if (value > 255) value = 255;
+        // Los índices se guardan ya multiplicados por los bytes de cada píxel
+        tabla->indice0[d] = i0 * bytesPorPixel;
+        tabla->indice1[d] = i1 * bytesPorPixel;
+        tabla->peso[d] = peso;
+    }
+    return 1;
+}
+
+// QUÉ: Liberar una tabla de coeficientes.
+void liberarTablaEje(TablaEje* tabla) {
+    free(tabla->indice0);
+    free(tabla->indice1);
+    free(tabla->peso);
+    tabla->indice0 = tabla->indice1 = tabla->peso = NULL;
+}
 
-    return (unsigned char)value;
+// QUÉ: Pasada horizontal de una fila origen.
+// CÓMO: Interpola cada columna destino con los dos vecinos de la tabla X y
+// escribe el resultado (escalado por 2^11) en la fila temporal.
+// POR QUÉ: La fila filtrada se reutiliza para todas las filas destino que la
+// necesiten, así la pasada vertical solo combina dos filas ya listas.
+// En luz lineal o con muestras de 16 bits (bytes = 2) cada muestra pasa a la
+// escala intermedia (muestraIntermedia) y el resultado se redondea a 16 bits
+// para que la pasada vertical siga cabiendo en 32 bits (65535 * 2^11 * 2).
+__attribute__((always_inline))
+static inline void pasadaHorizontalIntermedia(const unsigned char* filaOrigen, unsigned int* temporal,
+                                              const TablaEje* tablaX, int anchoDestino, int canales,
+                                              int lineal, const int bytes) {
+    int canalAlfa = tieneAlfa(canales) ? canales - 1 : -1;
+    for (int x = 0; x < anchoDestino; x++) {
+        const unsigned char* p0 = filaOrigen + tablaX->indice0[x];
+        const unsigned char* p1 = filaOrigen + tablaX->indice1[x];
+        unsigned int w1 = (unsigned int)tablaX->peso[x];
+        unsigned int w0 = ESCALA_UNO - w1;
+        for (int c = 0; c < canales; c++) {
+            unsigned int v = muestraIntermedia(p0, c, canales, c, canalAlfa, lineal, bytes) * w0 +
+                             muestraIntermedia(p1, c, canales, c, canalAlfa, lineal, bytes) * w1;
+            temporal[x * canales + c] = (v + (ESCALA_UNO / 2)) >> ESCALA_BITS;
+        }
+    }
+}
+
+static void pasadaHorizontal(const unsigned char* filaOrigen, unsigned int* temporal,
+                             const TablaEje* tablaX, int anchoDestino, int canales, int lineal, int bytes) {
+    if (bytes == 2) {
+        pasadaHorizontalIntermedia(filaOrigen, temporal, tablaX, anchoDestino, canales, lineal, 2);
+        return;
+    }
+    if (lineal) {
+        pasadaHorizontalIntermedia(filaOrigen, temporal, tablaX, anchoDestino, canales, 1, 1);
+        return;
+    }
+    for (int x = 0; x < anchoDestino; x++) {
+        const unsigned char* p0 = filaOrigen + tablaX->indice0[x];
+        const unsigned char* p1 = filaOrigen + tablaX->indice1[x];
+        unsigned int w1 = (unsigned int)tablaX->peso[x];
+        unsigned int w0 = ESCALA_UNO - w1;
+        for (int c = 0; c < canales; c++) {
+            temporal[x * canales + c] = p0[c] * w0 + p1[c] * w1;
+        }
+    }
+}
+
+// QUÉ: Pasada vertical sobre dos filas intermedias de 16 bits.
+// CÓMO: Combina h0 y h1 con los pesos Y (o copia h0 si wy1 = 0) y escribe la
+// muestra de salida con escribirIntermedia.
+__attribute__((always_inline))
+static inline void combinarFilasIntermedias(const unsigned int* h0, const unsigned int* h1, unsigned int wy0,
+                                            unsigned int wy1, unsigned char* salida, int anchoFila,
+                                            int canales, int lineal, const int bytes) {
+    int canalAlfa = tieneAlfa(canales) ? canales - 1 : -1;
+    for (int i = 0, c = 0; i < anchoFila; i++) {
+        unsigned int v = (wy1 == 0) ? h0[i] :
+            (h0[i] * wy0 + h1[i] * wy1 + (ESCALA_UNO / 2)) >> ESCALA_BITS;
+        escribirIntermedia(salida, i, v, c, canalAlfa, lineal, bytes);
+        if (++c == canales) c = 0;
+    }
 }
 
 // Función que ejecutará cada hilo
@@ -48,68 +175,1012 @@ void* scaleThread(void* args) {
 
     ImagenInfo* src = threadArgs->originalImage;
     ImagenInfo* dst = threadArgs->resultImage;
+    const TablaEje* tablaX = threadArgs->tablaX;
+    const TablaEje* tablaY = threadArgs->tablaY;
+    int canales = src->canales;
+    int anchoFila = dst->ancho * canales;
+    int lineal = threadArgs->lineal;
+    int bytes = bytesMuestra(src);
+
+    // QUÉ: Dos filas temporales con la pasada horizontal ya aplicada.
+    // CÓMO: Cada ranura recuerda qué fila origen contiene; al avanzar hacia
+    // abajo solo se recalcula la fila que entra (las filas se "transmiten").
+    // POR QUÉ: La memoria temporal es O(ancho) por hilo y cada fila origen se
+    // filtra horizontalmente una sola vez por hilo.
+    unsigned int* ranura[2];
+    int filaEnRanura[2] = {-1, -1};
+    ranura[0] = (unsigned int*)malloc((size_t)anchoFila * sizeof(unsigned int));
+    ranura[1] = (unsigned int*)malloc((size_t)anchoFila * sizeof(unsigned int));
+    if (!ranura[0] || !ranura[1]) {
+        fprintf(stderr, "Error de memoria en hilo de escalado\n");
+        free(ranura[0]);
+        free(ranura[1]);
+        threadArgs->ok = 0;
+        return NULL;
+    }
+
+    for (int y = threadArgs->startRow; y < threadArgs->endRow; y++) {
+        int y0 = tablaY->indice0[y];
+        int y1 = tablaY->indice1[y];
+        unsigned int wy1 = (unsigned int)tablaY->peso[y];
+        unsigned int wy0 = ESCALA_UNO - wy1;
+
+        // Asegurar que y0 (y y1 si hace falta) estén filtradas en alguna ranura
+        if (filaEnRanura[0] != y0 && filaEnRanura[1] != y0) {
+            int libre = (filaEnRanura[0] == y1) ? 1 : 0;
+            pasadaHorizontal(src->pixeles[y0][0], ranura[libre], tablaX, dst->ancho, canales, lineal, bytes);
+            filaEnRanura[libre] = y0;
+        }
+        if (wy1 != 0 && filaEnRanura[0] != y1 && filaEnRanura[1] != y1) {
+            int libre = (filaEnRanura[0] == y0) ? 1 : 0;
+            pasadaHorizontal(src->pixeles[y1][0], ranura[libre], tablaX, dst->ancho, canales, lineal, bytes);
+            filaEnRanura[libre] = y1;
+        }
+
+        const unsigned int* h0 = ranura[filaEnRanura[0] == y0 ? 0 : 1];
+        unsigned char* salida = dst->pixeles[y][0];
+        const unsigned int redondeo = 1u << (2 * ESCALA_BITS - 1);
+
+        if (bytes == 2 || lineal) {
+            // Luz lineal o 16 bits: las ranuras ya están en 16 bits
+            const unsigned int* h1 = ranura[filaEnRanura[0] == y1 ? 0 : 1];
+            if (bytes == 2) {
+                combinarFilasIntermedias(h0, h1, wy0, wy1, salida, anchoFila, canales, lineal, 2);
+            } else {
+                combinarFilasIntermedias(h0, h1, wy0, wy1, salida, anchoFila, canales, 1, 1);
+            }
+        } else if (wy1 == 0) {
+            // Fila destino alineada con una fila origen: solo la pasada horizontal
+            for (int i = 0; i < anchoFila; i++) {
+                salida[i] = (unsigned char)((h0[i] + (1u << (ESCALA_BITS - 1))) >> ESCALA_BITS);
+            }
+        } else {
+            const unsigned int* h1 = ranura[filaEnRanura[0] == y1 ? 0 : 1];
+            for (int i = 0; i < anchoFila; i++) {
+                unsigned int v = h0[i] * wy0 + h1[i] * wy1;
+                salida[i] = (unsigned char)((v + redondeo) >> (2 * ESCALA_BITS));
+            }
+        }
+    }
+
+    free(ranura[0]);
+    free(ranura[1]);
+    threadArgs->ok = 1;
+    return NULL;
+}
+
+// QUÉ: Precisión de los pesos de área (16 bits por eje).
+// CÓMO: Los pesos de cada huella suman exactamente 2^16. La pasada horizontal
+// se reduce a 16 bits antes de la vertical para que la suma quepa en 32 bits
+// (65280 * 2^16 + redondeo < 2^32).
+// POR QUÉ: Acumulación entera sin desbordes aun con huellas de cientos de píxeles.
+#define AREA_BITS 16
+#define AREA_UNO (1u << AREA_BITS)
+
+// QUÉ: Construir la tabla de huellas de un eje para el promedio de área.
+// CÓMO: El píxel destino d cubre [d*f, (d+1)*f) en el origen (f = origen/destino).
+// Cada píxel origen tocado recibe un peso proporcional a su cobertura; el
+// último peso absorbe el error de redondeo para que la suma sea 2^16 exacta.
+// POR QUÉ: Promediar toda la huella elimina el aliasing al reducir mucho, y
+// las coberturas parciales se calculan una vez por eje.
+static int construirTablaArea(TablaArea* tabla, int tamDestino, int tamOrigen) {
+    double factor = (double)tamOrigen / tamDestino;
+    int maxCuenta = (int)ceil(factor) + 1;
+
+    tabla->inicio = (int*)malloc(tamDestino * sizeof(int));
+    tabla->cuenta = (int*)malloc(tamDestino * sizeof(int));
+    tabla->pesos = (unsigned int*)malloc((size_t)tamDestino * maxCuenta * sizeof(unsigned int));
+    tabla->maxCuenta = maxCuenta;
+    if (!tabla->inicio || !tabla->cuenta || !tabla->pesos) {
+        liberarTablaArea(tabla);
+        return 0;
+    }
+
+    for (int d = 0; d < tamDestino; d++) {
+        double a = d * factor;
+        double b = (d + 1) * factor;
+        int i0 = (int)floor(a);
+        int i1 = (int)ceil(b);
+        if (i1 > tamOrigen) i1 = tamOrigen;
+        if (i0 >= i1) i0 = i1 - 1;
+
+        unsigned int* pesos = tabla->pesos + (size_t)d * maxCuenta;
+        unsigned int acumulado = 0;
+        int cuenta = i1 - i0;
+        for (int i = i0; i < i1; i++) {
+            double izq = (i > a) ? i : a;
+            double der = (i + 1 < b) ? i + 1 : b;
+            unsigned int w = (unsigned int)((der - izq) / factor * AREA_UNO + 0.5);
+            if (acumulado + w > AREA_UNO) {
+                w = AREA_UNO - acumulado;
+            }
+            if (i == i1 - 1) {
+                w = AREA_UNO - acumulado; // Cierre exacto de la suma
+            }
+            pesos[i - i0] = w;
+            acumulado += w;
+        }
+        tabla->inicio[d] = i0;
+        tabla->cuenta[d] = cuenta;
+    }
+    return 1;
+}
+
+// QUÉ: Liberar una tabla de huellas.
+void liberarTablaArea(TablaArea* tabla) {
+    free(tabla->inicio);
+    free(tabla->cuenta);
+    free(tabla->pesos);
+    tabla->inicio = tabla->cuenta = NULL;
+    tabla->pesos = NULL;
+}
+
+// QUÉ: Pasada horizontal del promedio de área sobre una fila origen.
+// CÓMO: Suma ponderada de la huella X de cada píxel destino, reducida a 16 bits
+// (>> 8) para que la acumulación vertical quepa en 32 bits. En luz lineal o
+// con 16 bits las muestras ya están en la escala intermedia de 16 bits
+// (muestraIntermedia) y la suma se reduce con >> 16.
+__attribute__((always_inline))
+static inline void pasadaHorizontalAreaIntermedia(const unsigned char* filaOrigen, unsigned int* filaH,
+                                                  const TablaArea* tablaX, int anchoDestino, int canales,
+                                                  int lineal, const int bytes) {
+    int canalAlfa = tieneAlfa(canales) ? canales - 1 : -1;
+    for (int x = 0; x < anchoDestino; x++) {
+        const unsigned char* p = filaOrigen + (size_t)tablaX->inicio[x] * canales * bytes;
+        const unsigned int* pesosX = tablaX->pesos + (size_t)x * tablaX->maxCuenta;
+        int cuenta = tablaX->cuenta[x];
+        for (int c = 0; c < canales; c++) {
+            unsigned int suma = 0;
+            for (int i = 0; i < cuenta; i++) {
+                suma += muestraIntermedia(p, (size_t)i * canales + c, canales, c, canalAlfa, lineal, bytes) *
+                        pesosX[i];
+            }
+            filaH[x * canales + c] = (suma + (AREA_UNO / 2)) >> AREA_BITS;
+        }
+    }
+}
+
+static void pasadaHorizontalArea(const unsigned char* filaOrigen, unsigned int* filaH,
+                                 const TablaArea* tablaX, int anchoDestino, int canales, int lineal,
+                                 int bytes) {
+    if (bytes == 2) {
+        pasadaHorizontalAreaIntermedia(filaOrigen, filaH, tablaX, anchoDestino, canales, lineal, 2);
+        return;
+    }
+    if (lineal) {
+        pasadaHorizontalAreaIntermedia(filaOrigen, filaH, tablaX, anchoDestino, canales, 1, 1);
+        return;
+    }
+    for (int x = 0; x < anchoDestino; x++) {
+        const unsigned char* p = filaOrigen + tablaX->inicio[x] * canales;
+        const unsigned int* pesosX = tablaX->pesos + (size_t)x * tablaX->maxCuenta;
+        int cuenta = tablaX->cuenta[x];
+        for (int c = 0; c < canales; c++) {
+            unsigned int suma = 0;
+            for (int i = 0; i < cuenta; i++) {
+                suma += p[i * canales + c] * pesosX[i];
+            }
+            filaH[x * canales + c] = (suma + 128) >> 8;
+        }
+    }
+}
+
+// QUÉ: Convertir una fila de acumuladores de área a muestras.
+// CÓMO: En modo normal (escala 2^24) redondea y divide por 2^24; en luz lineal
+// o con 16 bits (entrada de 16 bits ponderada por 2^16) vuelve a 16 bits y
+// escribe con escribirIntermedia (en luz lineal, de vuelta a sRGB; el alfa,
+// si lo hay, sin curva).
+__attribute__((always_inline))
+static inline void cerrarFilaAreaIntermedia(const unsigned int* acumulador, unsigned char* salida, int n,
+                                            int canales, int lineal, const int bytes) {
+    int canalAlfa = tieneAlfa(canales) ? canales - 1 : -1;
+    for (int i = 0, c = 0; i < n; i++) {
+        escribirIntermedia(salida, i, (acumulador[i] + (AREA_UNO / 2)) >> AREA_BITS, c, canalAlfa, lineal, bytes);
+        if (++c == canales) c = 0;
+    }
+}
+
+static void cerrarFilaArea(const unsigned int* acumulador, unsigned char* salida, int n, int canales,
+                           int lineal, int bytes) {
+    if (bytes == 2) {
+        cerrarFilaAreaIntermedia(acumulador, salida, n, canales, lineal, 2);
+        return;
+    }
+    if (lineal) {
+        cerrarFilaAreaIntermedia(acumulador, salida, n, canales, 1, 1);
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        salida[i] = (unsigned char)((acumulador[i] + (1u << 23)) >> 24);
+    }
+}
+
+// QUÉ: Hilo de reducción por área con factores arbitrarios.
+// CÓMO: Para cada fila destino recorre las filas de su huella; cada fila se
+// reduce horizontalmente con la tabla X (a 16 bits) y se acumula con su peso Y.
+// POR QUÉ: Todo el origen contribuye al resultado y solo se necesita una fila
+// temporal y un acumulador por hilo.
+static void* scaleAreaThread(void* args) {
+    ScaleArgs* threadArgs = (ScaleArgs*)args;
+    ImagenInfo* src = threadArgs->originalImage;
+    ImagenInfo* dst = threadArgs->resultImage;
+    const TablaArea* tablaX = threadArgs->areaX;
+    const TablaArea* tablaY = threadArgs->areaY;
+    int canales = src->canales;
+    int anchoFila = dst->ancho * canales;
+    int bytes = bytesMuestra(src);
+
+    unsigned int* filaH = (unsigned int*)malloc((size_t)anchoFila * sizeof(unsigned int));
+    unsigned int* acumulador = (unsigned int*)malloc((size_t)anchoFila * sizeof(unsigned int));
+    if (!filaH || !acumulador) {
+        fprintf(stderr, "Error de memoria en hilo de escalado por área\n");
+        free(filaH);
+        free(acumulador);
+        threadArgs->ok = 0;
+        return NULL;
+    }
+
+    for (int y = threadArgs->startRow; y < threadArgs->endRow; y++) {
+        memset(acumulador, 0, (size_t)anchoFila * sizeof(unsigned int));
+        const unsigned int* pesosY = tablaY->pesos + (size_t)y * tablaY->maxCuenta;
+
+        for (int k = 0; k < tablaY->cuenta[y]; k++) {
+            const unsigned char* filaOrigen = src->pixeles[tablaY->inicio[y] + k][0];
+
+            pasadaHorizontalArea(filaOrigen, filaH, tablaX, dst->ancho, canales, threadArgs->lineal, bytes);
+
+            unsigned int wy = pesosY[k];
+            for (int i = 0; i < anchoFila; i++) {
+                acumulador[i] += filaH[i] * wy;
+            }
+        }
+
+        cerrarFilaArea(acumulador, dst->pixeles[y][0], anchoFila, canales, threadArgs->lineal, bytes);
+    }
+
+    free(filaH);
+    free(acumulador);
+    threadArgs->ok = 1;
+    return NULL;
+}
+
+// QUÉ: Preparar un reductor de área en flujo hacia una imagen ya creada.
+// CÓMO: Construye las tablas de huellas de ambos ejes y dos acumuladores de
+// fila destino (par e impar). Solo admite reducción: con factor >= 1 cada
+// fila origen cae como mucho en dos huellas consecutivas. bytes es el tamaño
+// de cada muestra (1 u 2) de las filas origen y destino.
+static int prepararReductorArea(ReductorArea* reductor, int anchoOrigen, int altoOrigen,
+                                int anchoDestino, int altoDestino, int canales, int bytes) {
+    if (anchoDestino < 1 || altoDestino < 1 || anchoDestino > anchoOrigen || altoDestino > altoOrigen) {
+        fprintf(stderr, "ERROR: El reductor de área solo admite reducción (%dx%d -> %dx%d)\n",
+                anchoOrigen, altoOrigen, anchoDestino, altoDestino);
+        return 0;
+    }
+    reductor->lineal = LUZ_LINEAL_GLOBAL;
+    if (reductor->lineal) {
+        inicializarTablasSRGB();
+        if (bytes == 2) {
+            inicializarTablasSRGB16();
+        }
+    }
+    reductor->bytes = bytes;
+    reductor->anchoOrigen = anchoOrigen;
+    reductor->altoOrigen = altoOrigen;
+    reductor->anchoDestino = anchoDestino;
+    reductor->altoDestino = altoDestino;
+    reductor->canales = canales;
+
+    size_t anchoFila = (size_t)anchoDestino * canales;
+    reductor->filaH = (unsigned int*)malloc(anchoFila * sizeof(unsigned int));
+    reductor->acumuladores[0] = (unsigned int*)calloc(anchoFila, sizeof(unsigned int));
+    reductor->acumuladores[1] = (unsigned int*)calloc(anchoFila, sizeof(unsigned int));
+    if (!reductor->filaH || !reductor->acumuladores[0] || !reductor->acumuladores[1] ||
+        !construirTablaArea(&reductor->tablaX, anchoDestino, anchoOrigen) ||
+        !construirTablaArea(&reductor->tablaY, altoDestino, altoOrigen)) {
+        fprintf(stderr, "Error de memoria al crear reductor de área\n");
+        liberarReductorArea(reductor);
+        return 0;
+    }
+    return 1;
+}
+
+int iniciarReductorArea(ReductorArea* reductor, int anchoOrigen, int altoOrigen, ImagenInfo* destino) {
+    memset(reductor, 0, sizeof(*reductor));
+    if (!destino->pixeles) {
+        fprintf(stderr, "ERROR: El reductor de área necesita una imagen destino\n");
+        return 0;
+    }
+    reductor->destino = destino;
+    return prepararReductorArea(reductor, anchoOrigen, altoOrigen, destino->ancho, destino->alto,
+                                destino->canales, bytesMuestra(destino));
+}
+
+// QUÉ: Preparar un reductor que entrega cada fila destino a un callback.
+// CÓMO: Igual que iniciarReductorArea, más una fila de salida propia que se
+// reutiliza para cada fila entregada.
+int iniciarReductorAreaFlujo(ReductorArea* reductor, int anchoOrigen, int altoOrigen, int anchoDestino,
+                             int altoDestino, int canales, AlCerrarFilaArea alFila, void* contexto) {
+    memset(reductor, 0, sizeof(*reductor));
+    if (!prepararReductorArea(reductor, anchoOrigen, altoOrigen, anchoDestino, altoDestino, canales, 1)) {
+        return 0;
+    }
+    reductor->filaSalida = (unsigned char*)malloc((size_t)anchoDestino * canales);
+    if (!reductor->filaSalida) {
+        fprintf(stderr, "Error de memoria al crear reductor de área\n");
+        liberarReductorArea(reductor);
+        return 0;
+    }
+    reductor->alFila = alFila;
+    reductor->contexto = contexto;
+    return 1;
+}
+
+// QUÉ: Acumular la siguiente fila origen y emitir las filas destino completas.
+// CÓMO: La fila se reduce horizontalmente una sola vez y se suma con su peso Y
+// a cada fila destino pendiente cuya huella la contiene; cuando es la última
+// fila de una huella, esa fila destino se redondea y su acumulador se reinicia.
+int empujarFilaArea(ReductorArea* reductor, const unsigned char* fila) {
+    int y = reductor->filaOrigen;
+    if (y >= reductor->altoOrigen) {
+        return 0;
+    }
+    reductor->filaOrigen++;
+
+    const TablaArea* tablaY = &reductor->tablaY;
+    int canales = reductor->canales;
+    int anchoFila = reductor->anchoDestino * canales;
+    pasadaHorizontalArea(fila, reductor->filaH, &reductor->tablaX, reductor->anchoDestino, canales,
+                         reductor->lineal, reductor->bytes);
+
+    int primera = reductor->siguienteSalida;
+    for (int d = primera; d < primera + 2 && d < reductor->altoDestino; d++) {
+        int inicio = tablaY->inicio[d];
+        if (y < inicio || y >= inicio + tablaY->cuenta[d]) {
+            continue;
+        }
+        unsigned int wy = tablaY->pesos[(size_t)d * tablaY->maxCuenta + (y - inicio)];
+        unsigned int* acumulador = reductor->acumuladores[d & 1];
+        for (int i = 0; i < anchoFila; i++) {
+            acumulador[i] += reductor->filaH[i] * wy;
+        }
+        if (y == inicio + tablaY->cuenta[d] - 1) {
+            unsigned char* salida = reductor->alFila ? reductor->filaSalida : reductor->destino->pixeles[d][0];
+            cerrarFilaArea(acumulador, salida, anchoFila, canales, reductor->lineal, reductor->bytes);
+            memset(acumulador, 0, (size_t)anchoFila * sizeof(unsigned int));
+            reductor->siguienteSalida = d + 1;
+            if (reductor->alFila && !reductor->alFila(reductor->contexto, salida)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Liberar tablas y acumuladores del reductor (no libera el destino).
+void liberarReductorArea(ReductorArea* reductor) {
+    liberarTablaArea(&reductor->tablaX);
+    liberarTablaArea(&reductor->tablaY);
+    free(reductor->filaH);
+    free(reductor->acumuladores[0]);
+    free(reductor->acumuladores[1]);
+    free(reductor->filaSalida);
+    reductor->filaSalida = NULL;
+    reductor->filaH = NULL;
+    reductor->acumuladores[0] = reductor->acumuladores[1] = NULL;
+}
+
+// QUÉ: Canales por píxel de las filas intermedias de 16 bits de la reducción
+// exacta: RGB se rellena a RGBX; los demás formatos no cambian.
+// POR QUÉ: Con 1, 2 o 4 valores de 16 bits por píxel, un par de píxeles
+// ocupa 4, 8 o 16 bytes y se separa con desplazamientos de 32 y 64 bits de
+// SSE2; con 3 (12 bytes) haría falta pshufb.
+static int pasoParesPixeles(int canales) {
+    return (canales == 3) ? 4 : canales;
+}
+
+// QUÉ: Cargar 4 bytes sin alineación como entero de 32 bits.
+static inline int cargar32(const unsigned char* p) {
+    int v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// QUÉ: Sumar los canales de pares de píxeles adyacentes de una fila de bytes.
+// CÓMO: destino recibe numPares píxeles de pasoParesPixeles(canales) valores
+// de 16 bits. Con SSE2, según los canales:
+//   - 1: separa bytes pares e impares de 16 bytes (máscara y desplazamiento
+//     de 8 bits) y los suma como 8 enteros de 16 bits;
+//   - 2 y 4: amplía a 16 bits y separa los píxeles pares de los impares con
+//     _mm_shuffle_epi32 y _mm_unpack*_epi64 (píxeles de 32 o 64 bits);
+//   - 3: carga cada píxel con 4 bytes (el cuarto es del vecino y va al
+//     canal de relleno, que nunca se escribe en la salida) y suma como RGBX.
+// El resto se hace escalar.
+// POR QUÉ: Es el núcleo de la reducción 2x; procesa 16 bytes por iteración.
+static void sumarParesU8(const unsigned char* origen, unsigned short* destino, int numPares, int canales) {
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i cero = _mm_setzero_si128();
+    if (canales == 1) {
+        const __m128i mascara = _mm_set1_epi16(0x00FF);
+        for (; i + 8 <= numPares; i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(origen + 2 * i));
+            __m128i pares = _mm_and_si128(v, mascara);
+            __m128i impares = _mm_srli_epi16(v, 8);
+            _mm_storeu_si128((__m128i*)(destino + i), _mm_add_epi16(pares, impares));
+        }
+    } else if (canales == 2) {
+        for (; i + 4 <= numPares; i += 4) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(origen + 4 * i));
+            __m128i a = _mm_shuffle_epi32(_mm_unpacklo_epi8(v, cero), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i b = _mm_shuffle_epi32(_mm_unpackhi_epi8(v, cero), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i sumas = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(destino + 2 * i), sumas);
+        }
+    } else if (canales == 4) {
+        for (; i + 2 <= numPares; i += 2) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(origen + 8 * i));
+            __m128i a = _mm_unpacklo_epi8(v, cero);
+            __m128i b = _mm_unpackhi_epi8(v, cero);
+            __m128i sumas = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(destino + 4 * i), sumas);
+        }
+    } else if (canales == 3) {
+        // i + 4 < numPares: la carga de 4 bytes del último píxel no pasa del
+        // final de la fila (ni del bloque, en la última)
+        for (; i + 4 < numPares; i += 4) {
+            const unsigned char* p = origen + 6 * i;
+            __m128i pares = _mm_set_epi32(cargar32(p + 18), cargar32(p + 12), cargar32(p + 6), cargar32(p));
+            __m128i impares = _mm_set_epi32(cargar32(p + 21), cargar32(p + 15), cargar32(p + 9), cargar32(p + 3));
+            __m128i bajos = _mm_add_epi16(_mm_unpacklo_epi8(pares, cero), _mm_unpacklo_epi8(impares, cero));
+            __m128i altos = _mm_add_epi16(_mm_unpackhi_epi8(pares, cero), _mm_unpackhi_epi8(impares, cero));
+            _mm_storeu_si128((__m128i*)(destino + 4 * i), bajos);
+            _mm_storeu_si128((__m128i*)(destino + 4 * i + 8), altos);
+        }
+    }
+#endif
+    int paso = pasoParesPixeles(canales);
+    for (; i < numPares; i++) {
+        const unsigned char* p = origen + (size_t)2 * i * canales;
+        for (int c = 0; c < canales; c++) {
+            destino[i * paso + c] = (unsigned short)(p[c] + p[canales + c]);
+        }
+        for (int c = canales; c < paso; c++) {
+            destino[i * paso + c] = 0;
+        }
+    }
+}
+
+// QUÉ: Sumar pares de píxeles adyacentes de 16 bits (en el mismo arreglo).
+// CÓMO: paso es el número de valores por píxel (1, 2 o 4). Con SSE2, en
+// grises _mm_madd_epi16 contra unos suma cada par en 32 bits y
+// _mm_packs_epi32 vuelve a 16 bits (las sumas de 8 bytes caben de sobra);
+// con 2 y 4 los píxeles pares e impares se separan como en sumarParesU8.
+// POR QUÉ: Encadenado tras sumarParesU8 da las sumas de 4 y 8 píxeles.
+static void sumarParesU16(unsigned short* datos, int numPares, int paso) {
+    int i = 0;
+#ifdef __SSE2__
+    if (paso == 1) {
+        const __m128i unos = _mm_set1_epi16(1);
+        for (; i + 8 <= numPares; i += 8) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(datos + 2 * i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(datos + 2 * i + 8));
+            __m128i sumas = _mm_packs_epi32(_mm_madd_epi16(a, unos), _mm_madd_epi16(b, unos));
+            _mm_storeu_si128((__m128i*)(datos + i), sumas);
+        }
+    } else if (paso == 2) {
+        for (; i + 4 <= numPares; i += 4) {
+            __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(datos + 4 * i)), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(datos + 4 * i + 8)), _MM_SHUFFLE(3, 1, 2, 0));
+            __m128i sumas = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(datos + 2 * i), sumas);
+        }
+    } else if (paso == 4) {
+        for (; i + 2 <= numPares; i += 2) {
+            __m128i a = _mm_loadu_si128((const __m128i*)(datos + 8 * i));
+            __m128i b = _mm_loadu_si128((const __m128i*)(datos + 8 * i + 8));
+            __m128i sumas = _mm_add_epi16(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+            _mm_storeu_si128((__m128i*)(datos + 4 * i), sumas);
+        }
+    }
+#endif
+    for (; i < numPares; i++) {
+        for (int c = 0; c < paso; c++) {
+            datos[i * paso + c] = (unsigned short)(datos[2 * i * paso + c] + datos[(2 * i + 1) * paso + c]);
+        }
+    }
+}
+
+// QUÉ: Hilo de reducción exacta 2x/4x/8x.
+// CÓMO: Cada fila origen se reduce horizontalmente por sumas de pares
+// sucesivas (SIMD en todos los formatos; RGB se rellena a RGBX en las filas
+// de 16 bits) y las k filas de cada bloque se acumulan en 16 bits; al final
+// se divide por k*k con un desplazamiento y se quita el relleno.
+// POR QUÉ: Con factor entero no hacen falta pesos ni multiplicaciones.
+static void* scaleBoxThread(void* args) {
+    ScaleArgs* threadArgs = (ScaleArgs*)args;
+    ImagenInfo* src = threadArgs->originalImage;
+    ImagenInfo* dst = threadArgs->resultImage;
+    int k = threadArgs->factor;
+    int log2k = (k == 2) ? 1 : (k == 4) ? 2 : 3;
+    int canales = src->canales;
+    int paso = pasoParesPixeles(canales);
+    int anchoFila = dst->ancho * paso;
+
+    unsigned short* filaH = (unsigned short*)malloc((size_t)(src->ancho / 2) * paso * sizeof(unsigned short));
+    unsigned short* acumulador = (unsigned short*)malloc((size_t)anchoFila * sizeof(unsigned short));
+    if (!filaH || !acumulador) {
+        fprintf(stderr, "Error de memoria en hilo de escalado por bloques\n");
+        free(filaH);
+        free(acumulador);
+        threadArgs->ok = 0;
+        return NULL;
+    }
+
+    int desplazamiento = 2 * log2k;
+    unsigned int redondeo = 1u << (desplazamiento - 1);
+
+    for (int y = threadArgs->startRow; y < threadArgs->endRow; y++) {
+        memset(acumulador, 0, (size_t)anchoFila * sizeof(unsigned short));
+
+        for (int r = 0; r < k; r++) {
+            const unsigned char* filaOrigen = src->pixeles[y * k + r][0];
+            // Sumas de pares SIMD, log2(k) niveles
+            int n = src->ancho / 2;
+            sumarParesU8(filaOrigen, filaH, n, canales);
+            for (int nivel = 1; nivel < log2k; nivel++) {
+                n /= 2;
+                sumarParesU16(filaH, n, paso);
+            }
+            for (int i = 0; i < anchoFila; i++) {
+                acumulador[i] = (unsigned short)(acumulador[i] + filaH[i]);
+            }
+        }
+
+        unsigned char* salida = dst->pixeles[y][0];
+        if (paso == canales) {
+            for (int i = 0; i < anchoFila; i++) {
+                salida[i] = (unsigned char)((acumulador[i] + redondeo) >> desplazamiento);
+            }
+        } else {
+            for (int x = 0; x < dst->ancho; x++) {
+                for (int c = 0; c < canales; c++) {
+                    salida[x * canales + c] = (unsigned char)((acumulador[x * paso + c] + redondeo) >> desplazamiento);
+                }
+            }
+        }
+    }
+
+    free(filaH);
+    free(acumulador);
+    threadArgs->ok = 1;
+    return NULL;
+}
+
+// QUÉ: Reducción exacta 2x/4x/8x en la escala intermedia de 16 bits.
+// CÓMO: Suma los k*k valores de 16 bits de cada bloque (caben en 32 bits
+// hasta 8x8), divide con un desplazamiento y escribe con escribirIntermedia.
+// POR QUÉ: Las sumas de pares de bytes no sirven con muestras de 16 bits, pero
+// el bloque sigue sin necesitar pesos ni multiplicaciones.
+__attribute__((always_inline))
+static inline int reducirBloquesIntermedios(ScaleArgs* threadArgs, int lineal, const int bytes) {
+    ImagenInfo* src = threadArgs->originalImage;
+    ImagenInfo* dst = threadArgs->resultImage;
+    int k = threadArgs->factor;
+    int log2k = (k == 2) ? 1 : (k == 4) ? 2 : 3;
+    int canales = src->canales;
+    int anchoFila = dst->ancho * canales;
+    int canalAlfa = tieneAlfa(canales) ? canales - 1 : -1;
+
+    unsigned int* acumulador = (unsigned int*)malloc((size_t)anchoFila * sizeof(unsigned int));
+    if (!acumulador) {
+        fprintf(stderr, "Error de memoria en hilo de escalado por bloques\n");
+        return 0;
+    }
+    int desplazamiento = 2 * log2k;
+    unsigned int redondeo = 1u << (desplazamiento - 1);
+
+    for (int y = threadArgs->startRow; y < threadArgs->endRow; y++) {
+        memset(acumulador, 0, (size_t)anchoFila * sizeof(unsigned int));
+        for (int r = 0; r < k; r++) {
+            const unsigned char* filaOrigen = src->pixeles[y * k + r][0];
+            for (int x = 0; x < dst->ancho; x++) {
+                size_t primera = (size_t)x * k * canales;
+                for (int c = 0; c < canales; c++) {
+                    unsigned int suma = 0;
+                    for (int i = 0; i < k; i++) {
+                        suma += muestraIntermedia(filaOrigen, primera + (size_t)i * canales + c, canales, c,
+                                                  canalAlfa, lineal, bytes);
+                    }
+                    acumulador[x * canales + c] += suma;
+                }
+            }
+        }
+        unsigned char* salida = dst->pixeles[y][0];
+        for (int i = 0, c = 0; i < anchoFila; i++) {
+            escribirIntermedia(salida, i, (acumulador[i] + redondeo) >> desplazamiento, c, canalAlfa, lineal, bytes);
+            if (++c == canales) c = 0;
+        }
+    }
+
+    free(acumulador);
+    return 1;
+}
+
+// QUÉ: Hilo de reducción exacta 2x/4x/8x en luz lineal o con 16 bits.
+static void* scaleBox16Thread(void* args) {
+    ScaleArgs* threadArgs = (ScaleArgs*)args;
+    if (bytesMuestra(threadArgs->originalImage) == 2) {
+        threadArgs->ok = reducirBloquesIntermedios(threadArgs, threadArgs->lineal, 2);
+    } else {
+        threadArgs->ok = reducirBloquesIntermedios(threadArgs, 1, 1);
+    }
+    return NULL;
+}
+
+// QUÉ: Factor máximo de ampliación entera con réplica SIMD.
+#define MAX_FACTOR_REPLICA 16
+
+// QUÉ: Construir la tabla de vecino más cercano de un eje.
+// CÓMO: El destino d toma el origen floor((d + 0.5) * origen / destino),
+// calculado en enteros; indice0 guarda el desplazamiento en bytes (índice *
+// bytesPorPixel). indice1 y peso no se usan.
+// POR QUÉ: Con muestreo por centros una ampliación entera k replica cada
+// píxel exactamente k veces, y la tabla evita divisiones por píxel.
+static int construirTablaVecino(TablaEje* tabla, int tamDestino, int tamOrigen, int bytesPorPixel) {
+    tabla->indice0 = (int*)malloc(tamDestino * sizeof(int));
+    tabla->indice1 = NULL;
+    tabla->peso = NULL;
+    if (!tabla->indice0) {
+        return 0;
+    }
+    for (int d = 0; d < tamDestino; d++) {
+        long long s = ((2LL * d + 1) * tamOrigen) / (2LL * tamDestino);
+        if (s > tamOrigen - 1) s = tamOrigen - 1;
+        tabla->indice0[d] = (int)s * bytesPorPixel;
+    }
+    return 1;
+}
+
+// QUÉ: Replicar cada píxel de una fila k veces (versión escalar).
+// CÓMO: bytesPorPixel es canales * bytes por muestra.
+static void replicarFilaEscalar(const unsigned char* origen, unsigned char* destino,
+                                int desde, int ancho, int bytesPorPixel, int k) {
+    for (int x = desde; x < ancho; x++) {
+        const unsigned char* p = origen + x * bytesPorPixel;
+        unsigned char* d = destino + (size_t)x * bytesPorPixel * k;
+        if (bytesPorPixel == 1) {
+            memset(d, p[0], k);
+        } else {
+            for (int r = 0; r < k; r++) {
+                memcpy(d + r * bytesPorPixel, p, bytesPorPixel);
+            }
+        }
+    }
+}
+
+#ifdef __SSE2__
+// QUÉ: Ampliar 2x o 4x una fila en escala de grises con SSE2.
+// CÓMO: unpacklo/unpackhi_epi8(v, v) duplica cada byte de 16 píxeles; para 4x
+// se aplica dos veces. Devuelve el número de píxeles procesados.
+// POR QUÉ: Es el caso habitual (máscaras y pixel art) y no necesita pshufb.
+static int replicarGrisSSE2(const unsigned char* origen, unsigned char* destino, int ancho, int k) {
+    int x = 0;
+    for (; x + 16 <= ancho; x += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(origen + x));
+        __m128i lo = _mm_unpacklo_epi8(v, v);
+        __m128i hi = _mm_unpackhi_epi8(v, v);
+        if (k == 2) {
+            _mm_storeu_si128((__m128i*)(destino + 2 * x), lo);
+            _mm_storeu_si128((__m128i*)(destino + 2 * x + 16), hi);
+        } else {
+            unsigned char* d = destino + 4 * x;
+            _mm_storeu_si128((__m128i*)(d), _mm_unpacklo_epi8(lo, lo));
+            _mm_storeu_si128((__m128i*)(d + 16), _mm_unpackhi_epi8(lo, lo));
+            _mm_storeu_si128((__m128i*)(d + 32), _mm_unpacklo_epi8(hi, hi));
+            _mm_storeu_si128((__m128i*)(d + 48), _mm_unpackhi_epi8(hi, hi));
+        }
+    }
+    return x;
+}
+#endif
+
+#ifdef ESCALADO_SSSE3
+// QUÉ: Máscaras de pshufb para replicar píxeles de 'canales' bytes k veces
+// (canales es aquí el tamaño del píxel en bytes: hasta 8 con 16 bits).
+// CÓMO: El patrón de salida se repite cada mcm(16, canales * k) bytes; para cada
+// bloque de 16 bytes del periodo se guarda el desplazamiento de carga en el
+// origen y la máscara que elige el byte de cada posición.
+typedef struct {
+    unsigned char mascara[3 * MAX_FACTOR_REPLICA][16];
+    int base[3 * MAX_FACTOR_REPLICA];
+    int bloques;          // Bloques de 16 bytes por periodo
+    int avanceOrigen;     // Bytes de origen consumidos por periodo
+} MascarasReplica;
+
+// Devuelve 0 si algún byte de un bloque queda fuera de los 16 cargados (la
+// réplica se hace entonces con la versión escalar).
+static int prepararMascarasReplica(MascarasReplica* m, int canales, int k) {
+    int paso = canales * k;
+    int periodo = 16;
+    while (periodo % paso != 0) {
+        periodo += 16;
+    }
+    m->bloques = periodo / 16;
+    m->avanceOrigen = periodo / k;
+    for (int b = 0; b < m->bloques; b++) {
+        int o0 = b * 16;
+        m->base[b] = (o0 / paso) * canales;
+        for (int i = 0; i < 16; i++) {
+            int o = o0 + i;
+            int entrada = (o / paso) * canales + o % canales;
+            if (entrada - m->base[b] > 15) {
+                return 0;
+            }
+            m->mascara[b][i] = (unsigned char)(entrada - m->base[b]);
+        }
+    }
+    return 1;
+}
+
+// QUÉ: Ampliar una fila con factor entero usando pshufb (SSSE3).
+// CÓMO: Por cada bloque de 16 bytes de salida carga 16 bytes de origen y los
+// reordena con la máscara precalculada. Procesa periodos completos mientras la
+// carga no se salga de la fila y devuelve los píxeles origen consumidos.
+__attribute__((target("ssse3")))
+static int replicarFilaSSSE3(const unsigned char* origen, unsigned char* destino,
+                             int ancho, int canales, const MascarasReplica* m) {
+    int bytesOrigen = ancho * canales;
+    int entrada = 0;
+    unsigned char* salida = destino;
+    while (entrada + m->avanceOrigen + 16 <= bytesOrigen) {
+        for (int b = 0; b < m->bloques; b++) {
+            __m128i v = _mm_loadu_si128((const __m128i*)(origen + entrada + m->base[b]));
+            __m128i mascara = _mm_loadu_si128((const __m128i*)m->mascara[b]);
+            _mm_storeu_si128((__m128i*)(salida + b * 16), _mm_shuffle_epi8(v, mascara));
+        }
+        entrada += m->avanceOrigen;
+        salida += m->bloques * 16;
+    }
+    return entrada / canales;
+}
+
+static int cpuTieneSSSE3(void) {
+    static int cache = -1;
+    int valor = __atomic_load_n(&cache, __ATOMIC_RELAXED);
+    if (valor < 0) {
+        __builtin_cpu_init();
+        valor = __builtin_cpu_supports("ssse3") ? 1 : 0;
+        __atomic_store_n(&cache, valor, __ATOMIC_RELAXED);
+    }
+    return valor;
+}
+#endif
+
+// QUÉ: Hilo de escalado por vecino más cercano.
+// CÓMO: Si la fila origen de una fila destino coincide con la de la anterior
+// se copia la fila destino ya calculada con memcpy. Si no, la fila se arma
+// con la tabla de columnas, o por réplica SIMD cuando el ancho se amplía por
+// un factor entero k (threadArgs->factor).
+// POR QUÉ: Sin interpolación el coste es puro movimiento de memoria: en
+// ampliaciones enteras cada fila origen se expande una vez y el resto son
+// copias de filas completas.
+static void* scaleNearestThread(void* args) {
+    ScaleArgs* threadArgs = (ScaleArgs*)args;
+    ImagenInfo* src = threadArgs->originalImage;
+    ImagenInfo* dst = threadArgs->resultImage;
+    const int* columnas = threadArgs->tablaX->indice0;
+    const int* filas = threadArgs->tablaY->indice0;
+    // Sin interpolación el píxel es un bloque de bytes: 16 bits solo lo agranda
+    int canales = bytesPixel(src);
+    int k = threadArgs->factor;
+    size_t bytesFila = (size_t)dst->ancho * canales;
+
+#ifdef ESCALADO_SSSE3
+    MascarasReplica mascaras;
+    int usarSSSE3 = k > 1 && cpuTieneSSSE3() && prepararMascarasReplica(&mascaras, canales, k);
+#endif
 
     for (int y = threadArgs->startRow; y < threadArgs->endRow; y++) {
-        for (int x = 0; x < dst->ancho; x++) {
-            float srcX = x * threadArgs->scaleFactorX;
-            float srcY = y * threadArgs->scaleFactorY;
+        unsigned char* salida = dst->pixeles[y][0];
+        if (y > threadArgs->startRow && filas[y] == filas[y - 1]) {
+            memcpy(salida, dst->pixeles[y - 1][0], bytesFila);
+            continue;
+        }
+        const unsigned char* filaOrigen = src->pixeles[filas[y]][0];
 
-            for (int c = 0; c < src->canales; c++) {
-                dst->pixeles[y][x][c] = interpolatePixel(src, srcX, srcY, c);
+        if (k > 1) {
+            int x = 0;
+#ifdef __SSE2__
+            if (canales == 1 && (k == 2 || k == 4)) {
+                x = replicarGrisSSE2(filaOrigen, salida, src->ancho, k);
+            }
+#endif
+#ifdef ESCALADO_SSSE3
+            if (x == 0 && usarSSSE3) {
+                x = replicarFilaSSSE3(filaOrigen, salida, src->ancho, canales, &mascaras);
+            }
+#endif
+            replicarFilaEscalar(filaOrigen, salida, x, src->ancho, canales, k);
+        } else if (canales == 1) {
+            for (int x = 0; x < dst->ancho; x++) {
+                salida[x] = filaOrigen[columnas[x]];
+            }
+        } else {
+            for (int x = 0; x < dst->ancho; x++) {
+                const unsigned char* p = filaOrigen + columnas[x];
+                unsigned char* d = salida + x * canales;
+                for (int c = 0; c < canales; c++) {
+                    d[c] = p[c];
+                }
             }
         }
     }
 
-    pthread_exit(NULL);
+    threadArgs->ok = 1;
+    return NULL;
+}
+
+// QUÉ: Detectar ampliación horizontal por un factor entero (2..16).
+static int factorReplicaEntero(const ImagenInfo* info, int newancho) {
+    if (newancho % info->ancho != 0) {
+        return 0;
+    }
+    int k = newancho / info->ancho;
+    return (k >= 2 && k <= MAX_FACTOR_REPLICA) ? k : 0;
+}
+
+// QUÉ: Elegir el modo efectivo de escalado.
+// CÓMO: En modo automático usa área cuando ambos ejes se reducen y al menos uno
+// queda por debajo de 0.5; en otro caso bilineal.
+// POR QUÉ: Por debajo de 0.5 la bilineal ignora parte del origen y produce aliasing.
+ScaleMode resolverModoEscalado(int ancho, int alto, int newancho, int newalto, ScaleMode mode) {
+    if (mode != SCALE_AUTO) {
+        return mode;
+    }
+    double rx = (double)newancho / ancho;
+    double ry = (double)newalto / alto;
+    if (rx <= 1.0 && ry <= 1.0 && (rx < 0.5 || ry < 0.5)) {
+        return SCALE_AREA;
+    }
+    return SCALE_BILINEAR;
+}
+
+// QUÉ: Detectar reducción exacta por 2, 4 u 8 en ambos ejes.
+// CÓMO: Devuelve el factor k si origen == k * destino en los dos ejes, o 0.
+static int factorBloqueExacto(const ImagenInfo* info, int newancho, int newalto) {
+    for (int k = 2; k <= 8; k *= 2) {
+        if (info->ancho == newancho * k && info->alto == newalto * k) {
+            return k;
+        }
+    }
+    return 0;
 }
 
 // Función principal de escalado concurrente
 void scaleImageConcurrently(ImagenInfo* info, int newancho, int newalto) {
+    scaleImageWithMode(info, newancho, newalto, SCALE_AUTO);
+}
+
+// Escalado concurrente con modo explícito
+void scaleImageWithMode(ImagenInfo* info, int newancho, int newalto, ScaleMode mode) {
     if (!info->pixeles) {
         printf("No hay imagen cargada.\n");
         return;
     }
+    if (newancho <= 0 || newalto <= 0) {
+        fprintf(stderr, "ERROR: Dimensiones inválidas (%dx%d)\n", newancho, newalto);
+        return;
+    }
 
-    ImagenInfo resized;
-    resized.ancho = newancho;
-    resized.alto = newalto;
-    resized.canales = info->canales;
+    struct timeval tiempo_inicio, tiempo_fin;
+    gettimeofday(&tiempo_inicio, NULL);
 
-    // Reservar memoria para la nueva matriz
-    resized.pixeles = (unsigned char***)malloc(resized.alto * sizeof(unsigned char**));
-    for (int y = 0; y < resized.alto; y++) {
-        resized.pixeles[y] = (unsigned char**)malloc(resized.ancho * sizeof(unsigned char*));
-        for (int x = 0; x < resized.ancho; x++) {
-            resized.pixeles[y][x] = (unsigned char*)malloc(resized.canales * sizeof(unsigned char));
+    ScaleMode efectivo = resolverModoEscalado(info->ancho, info->alto, newancho, newalto, mode);
+    int lineal = LUZ_LINEAL_GLOBAL && efectivo != SCALE_NEAREST;
+    int bytes = bytesMuestra(info);
+    if (lineal) {
+        inicializarTablasSRGB();
+        if (bytes == 2) {
+            inicializarTablasSRGB16();
         }
     }
+    int factor = (efectivo == SCALE_AREA) ? factorBloqueExacto(info, newancho, newalto) :
+                 (efectivo == SCALE_NEAREST) ? factorReplicaEntero(info, newancho) : 0;
+    const char* nombreModo = "bilineal";
+    void* (*trabajador)(void*) = scaleThread;
+
+    // QUÉ: Tablas de coeficientes por eje, compartidas (solo lectura) por los hilos.
+    TablaEje tablaX = {NULL, NULL, NULL};
+    TablaEje tablaY = {NULL, NULL, NULL};
+    TablaArea areaX = {NULL, NULL, NULL, 0};
+    TablaArea areaY = {NULL, NULL, NULL, 0};
+    int tablasOk = 1;
+    if (efectivo == SCALE_NEAREST) {
+        nombreModo = factor ? "vecino más cercano, réplica entera" : "vecino más cercano";
+        trabajador = scaleNearestThread;
+        tablasOk = construirTablaVecino(&tablaX, newancho, info->ancho, bytesPixel(info)) &&
+                   construirTablaVecino(&tablaY, newalto, info->alto, 1);
+    } else if (efectivo == SCALE_AREA && factor) {
+        nombreModo = (factor == 2) ? "área 2x" : (factor == 4) ? "área 4x" : "área 8x";
+        trabajador = (lineal || bytes == 2) ? scaleBox16Thread : scaleBoxThread;
+    } else if (efectivo == SCALE_AREA) {
+        nombreModo = "área";
+        trabajador = scaleAreaThread;
+        tablasOk = construirTablaArea(&areaX, newancho, info->ancho) &&
+                   construirTablaArea(&areaY, newalto, info->alto);
+    } else {
+        tablasOk = construirTablaEje(&tablaX, newancho, info->ancho, bytesPixel(info)) &&
+                   construirTablaEje(&tablaY, newalto, info->alto, 1);
+    }
+    if (!tablasOk) {
+        fprintf(stderr, "Error de memoria al construir tablas de escalado\n");
+        liberarTablaEje(&tablaX);
+        liberarTablaEje(&tablaY);
+        liberarTablaArea(&areaX);
+        liberarTablaArea(&areaY);
+        return;
+    }
+
+    ImagenInfo resized;
+    if (!crearImagenComo(&resized, info, newancho, newalto)) {
+        liberarTablaEje(&tablaX);
+        liberarTablaEje(&tablaY);
+        liberarTablaArea(&areaX);
+        liberarTablaArea(&areaY);
+        return;
+    }
 
     // Preparar concurrencia
-    int threadCount = 4;
+    int threadCount = NUM_HILOS_GLOBAL;
+    if (threadCount > resized.alto) {
+        threadCount = resized.alto;
+    }
     pthread_t threads[threadCount];
     ScaleArgs args[threadCount];
 
     int rowsPerThread = (int)ceil((double)resized.alto / threadCount);
-    float scaleFactorX = (float)info->ancho / newancho;
-    float scaleFactorY = (float)info->alto / newalto;
-
+    int creados = 0;
     for (int i = 0; i < threadCount; i++) {
         args[i].originalImage = info;
         args[i].resultImage = &resized;
         args[i].startRow = i * rowsPerThread;
         args[i].endRow = ((i + 1) * rowsPerThread < resized.alto) ? (i + 1) * rowsPerThread : resized.alto;
-        args[i].scaleFactorX = scaleFactorX;
-        args[i].scaleFactorY = scaleFactorY;
-        pthread_create(&threads[i], NULL, scaleThread, &args[i]);
+        args[i].tablaX = &tablaX;
+        args[i].tablaY = &tablaY;
+        args[i].areaX = &areaX;
+        args[i].areaY = &areaY;
+        args[i].factor = factor;
+        args[i].lineal = lineal;
+        args[i].ok = 0;
+        if (pthread_create(&threads[i], NULL, trabajador, &args[i]) != 0) {
+            fprintf(stderr, "Error al crear hilo %d\n", i);
+            break;
+        }
+        creados++;
     }
 
-    for (int i = 0; i < threadCount; i++) {
+    int ok = (creados == threadCount);
+    for (int i = 0; i < creados; i++) {
         pthread_join(threads[i], NULL);
+        ok = ok && args[i].ok;
+    }
+    liberarTablaEje(&tablaX);
+    liberarTablaEje(&tablaY);
+    liberarTablaArea(&areaX);
+    liberarTablaArea(&areaY);
+
+    if (!ok) {
+        fprintf(stderr, "Error durante el escalado; la imagen no se modificó.\n");
+        liberarImagen(&resized);
+        return;
     }
 
     // Reemplazar imagen original
     liberarImagen(info);
     *info = resized;
 
-    printf("Imagen escalada concurrentemente a %dx%d con %d hilos.\n", newancho, newalto, threadCount);
+    gettimeofday(&tiempo_fin, NULL);
+    printf("Imagen escalada concurrentemente a %dx%d con %d hilos (%s%s, %.4f seg).\n",
+           newancho, newalto, threadCount, nombreModo, lineal ? ", luz lineal" : "",
+           obtenerTiempoReal(tiempo_inicio, tiempo_fin));
 }
@@ -18,60 +18,98 @@ typedef struct {
     int fin;
     int ancho;
     int alto;
+    int bytesMuestra;
 } SobelArgs;
 
-// QUÉ: Calcular gradientes Sobel en un rango de filas (para hilos).
-// CÓMO: Aplica kernels Gx y Gy con convolución, guarda en matrices float.
-// POR QUÉ: Permite paralelizar el cálculo de gradientes.
-static void* calcularSobelHilo(void* args) {
-    SobelArgs* sArgs = (SobelArgs*)args;
+// QUÉ: Definir kernels Sobel para Gx (horizontal) y Gy (vertical).
+// CÓMO: Gx detecta bordes verticales, Gy detecta bordes horizontales.
+// POR QUÉ: Son operadores de derivada optimizados con suavizado.
+static const int Gx[3][3] = {
+    {-1, 0, 1},
+    {-2, 0, 2},
+    {-1, 0, 1}
+};
+static const int Gy[3][3] = {
+    {-1, -2, -1},
+    { 0,  0,  0},
+    { 1,  2,  1}
+};
+
+// QUÉ: Gradientes Sobel de un píxel a partir de sus tres filas vecinas.
+// CÓMO: Multiplica el vecindario 3x3 por cada kernel; las filas ya vienen
+// recortadas al borde y las columnas se replican aquí.
+// bytes es el tamaño de la muestra (1 u 2) y se pasa como constante.
+// POR QUÉ: Lo comparten la versión de imagen completa y la de filas sueltas
+// (modo en flujo), así ambas dan exactamente el mismo resultado.
+__attribute__((always_inline))
+static inline void gradientesSobel(const unsigned char* const* filas, int x, int ancho,
+                                   float* sumX, float* sumY, const int bytes) {
+    float gx = 0.0f;
+    float gy = 0.0f;
+    for (int ky = 0; ky < 3; ky++) {
+        for (int kx = 0; kx < 3; kx++) {
+            // QUÉ: Manejo de bordes con replicación.
+            int ix = x + kx - 1;
+            if (ix < 0) ix = 0;
+            if (ix >= ancho) ix = ancho - 1;
+
+            float pixel = (float)leerMuestra(filas[ky], (size_t)ix, bytes);
+            gx += pixel * Gx[ky][kx];
+            gy += pixel * Gy[ky][kx];
+        }
+    }
+    *sumX = gx;
+    *sumY = gy;
+}
 
-    // QUÉ: Definir kernels Sobel para Gx (horizontal) y Gy (vertical).
-    // CÓMO: Gx detecta bordes verticales, Gy detecta bordes horizontales.
-    // POR QUÉ: Son operadores de derivada optimizados con suavizado.
-    int Gx[3][3] = {
-        {-1, 0, 1},
-        {-2, 0, 2},
-        {-1, 0, 1}
-    };
-    int Gy[3][3] = {
-        {-1, -2, -1},
-        { 0,  0,  0},
-        { 1,  2,  1}
-    };
+// QUÉ: Magnitud del gradiente redondeada y recortada a [0, maximo] (255 o 65535).
+static inline unsigned int magnitudSobel(float gx, float gy, int maximo) {
+    float magnitud = sqrtf(gx * gx + gy * gy);
+    int valor = (int)(magnitud + 0.5f);
+    if (valor > maximo) valor = maximo;
+    if (valor < 0) valor = 0;
+    return (unsigned int)valor;
+}
 
+// QUÉ: Gradientes de las filas [inicio, fin) con una copia por tipo de muestra.
+__attribute__((always_inline))
+static inline void calcularGradientesFilas(SobelArgs* sArgs, const int bytes) {
     for (int y = sArgs->inicio; y < sArgs->fin; y++) {
+        const unsigned char* filas[3];
+        for (int ky = 0; ky < 3; ky++) {
+            int iy = y + ky - 1;
+            if (iy < 0) iy = 0;
+            if (iy >= sArgs->alto) iy = sArgs->alto - 1;
+            filas[ky] = sArgs->pixelesOrigen[iy][0];
+        }
         for (int x = 0; x < sArgs->ancho; x++) {
-            float sumX = 0.0f;
-            float sumY = 0.0f;
-
-            // QUÉ: Aplicar convolución con kernels Sobel.
-            // CÓMO: Multiplica vecindario 3x3 por cada kernel.
-            // POR QUÉ: Calcula aproximación de derivadas parciales.
-            for (int ky = 0; ky < 3; ky++) {
-                for (int kx = 0; kx < 3; kx++) {
-                    int iy = y + ky - 1;
-                    int ix = x + kx - 1;
-
-                    // QUÉ: Manejo de bordes con replicación.
-                    if (iy < 0) iy = 0;
-                    if (iy >= sArgs->alto) iy = sArgs->alto - 1;
-                    if (ix < 0) ix = 0;
-                    if (ix >= sArgs->ancho) ix = sArgs->ancho - 1;
-
-                    float pixel = (float)sArgs->pixelesOrigen[iy][ix][0];
-                    sumX += pixel * Gx[ky][kx];
-                    sumY += pixel * Gy[ky][kx];
-                }
-            }
-
-            sArgs->gradienteX[y][x] = sumX;
-            sArgs->gradienteY[y][x] = sumY;
+            gradientesSobel(filas, x, sArgs->ancho, &sArgs->gradienteX[y][x], &sArgs->gradienteY[y][x], bytes);
         }
     }
+}
+
+// QUÉ: Calcular gradientes Sobel en un rango de filas (para hilos).
+// CÓMO: Aplica kernels Gx y Gy con convolución, guarda en matrices float.
+// POR QUÉ: Permite paralelizar el cálculo de gradientes.
+static void* calcularSobelHilo(void* args) {
+    SobelArgs* sArgs = (SobelArgs*)args;
+    if (sArgs->bytesMuestra == 2) {
+        calcularGradientesFilas(sArgs, 2);
+    } else {
+        calcularGradientesFilas(sArgs, 1);
+    }
     return NULL;
 }
 
+// QUÉ: Magnitud Sobel de una fila de 8 bits (modo en flujo).
+void sobelFila(const unsigned char* const* filas, int ancho, unsigned char* destino) {
+    for (int x = 0; x < ancho; x++) {
+        float gx, gy;
+        gradientesSobel(filas, x, ancho, &gx, &gy, 1);
+        destino[x] = (unsigned char)magnitudSobel(gx, gy, 255);
+    }
+}
+
 // QUÉ: Aplicar detector de bordes Sobel a la imagen.
 // CÓMO: Convierte a grayscale, calcula Gx y Gy, computa magnitud del gradiente.
 // POR QUÉ: Detecta bordes calculando cambios bruscos de intensidad en todas direcciones.
@@ -83,9 +121,9 @@ int aplicarSobel(ImagenInfo* info) {
     struct timeval tiempo_inicio, tiempo_fin;
     gettimeofday(&tiempo_inicio, NULL);
 
-    // QUÉ: Convertir a grayscale si es necesario.
-    if (info->canales == 3) {
-        if (!convertirAGrayscale(info)) {
+    // QUÉ: Convertir a grayscale si es necesario (el alfa no interviene).
+    if (info->canales != 1) {
+        if (!convertirALuma(info)) {
             return 0;
         }
     }
@@ -139,6 +177,7 @@ int aplicarSobel(ImagenInfo* info) {
         args[i].fin = ((i + 1) * filasPorHilo < info->alto) ? (i + 1) * filasPorHilo : info->alto;
         args[i].ancho = info->ancho;
         args[i].alto = info->alto;
+        args[i].bytesMuestra = bytesMuestra(info);
         printf("Lanzando hilos...\n");
         if (pthread_create(&hilos[i], NULL, calcularSobelHilo, &args[i]) != 0) {
             fprintf(stderr, "Error al crear hilo %d\n", i);
@@ -162,20 +201,14 @@ int aplicarSobel(ImagenInfo* info) {
     }
     printf("\nTodos los hilos completados.\n");
     // QUÉ: Calcular magnitud del gradiente y actualizar imagen.
-    // CÓMO: |∇I| = sqrt(Gx² + Gy²), clamp a [0, 255].
+    // CÓMO: |∇I| = sqrt(Gx² + Gy²), clamp a [0, 255] (o [0, 65535] con 16 bits).
     // POR QUÉ: La magnitud indica la intensidad del borde.
+    int bytes = bytesMuestra(info);
+    int maximo = maximoMuestra(info);
     for (int y = 0; y < info->alto; y++) {
         for (int x = 0; x < info->ancho; x++) {
-            float gx = gradienteX[y][x];
-            float gy = gradienteY[y][x];
-            float magnitud = sqrtf(gx * gx + gy * gy);
-
-            // QUÉ: Clamp a [0, 255].
-            int valor = (int)(magnitud + 0.5f);
-            if (valor > 255) valor = 255;
-            if (valor < 0) valor = 0;
-
-            info->pixeles[y][x][0] = (unsigned char)valor;
+            escribirMuestra(info->pixeles[y][0], (size_t)x, magnitudSobel(gradienteX[y][x], gradienteY[y][x], maximo),
+                            bytes);
         }
     }
 
@@ -0,0 +1,54 @@
+#include "srgb.h"
+#include <math.h>
+#include <pthread.h>
+
+// QUÉ: Interruptor global de interpolación en luz lineal (desactivado por defecto).
+int LUZ_LINEAL_GLOBAL = 0;
+
+unsigned short SRGB_A_LINEAL[256];
+unsigned short ALFA_A_LINEAL[256];
+unsigned char LINEAL_A_SRGB[4096];
+unsigned short SRGB16_A_LINEAL[65536];
+unsigned short LINEAL16_A_SRGB[65536];
+
+static pthread_once_t tablasListas = PTHREAD_ONCE_INIT;
+static pthread_once_t tablas16Listas = PTHREAD_ONCE_INIT;
+
+// QUÉ: Curvas de transferencia sRGB (IEC 61966-2-1) en [0, 1].
+static double srgbALineal(double s) {
+    return (s <= 0.04045) ? s / 12.92 : pow((s + 0.055) / 1.055, 2.4);
+}
+
+static double linealASrgbReal(double l) {
+    return (l <= 0.0031308) ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+}
+
+// QUÉ: Llenar las tablas (se ejecuta una sola vez con pthread_once).
+static void construirTablas(void) {
+    for (int b = 0; b < 256; b++) {
+        SRGB_A_LINEAL[b] = (unsigned short)lround(srgbALineal(b / 255.0) * 65535.0);
+        ALFA_A_LINEAL[b] = (unsigned short)(b * 257);
+    }
+    for (int i = 0; i < 4096; i++) {
+        double lineal = (i * 16 + 8) / 65535.0;
+        long s = lround(linealASrgbReal(lineal) * 255.0);
+        LINEAL_A_SRGB[i] = (unsigned char)(s > 255 ? 255 : s);
+    }
+}
+
+// QUÉ: Construir las tablas (idempotente y seguro entre hilos).
+void inicializarTablasSRGB(void) {
+    pthread_once(&tablasListas, construirTablas);
+}
+
+// QUÉ: Llenar las tablas de 16 bits (una sola vez con pthread_once).
+static void construirTablas16(void) {
+    for (int v = 0; v < 65536; v++) {
+        SRGB16_A_LINEAL[v] = (unsigned short)lround(srgbALineal(v / 65535.0) * 65535.0);
+        LINEAL16_A_SRGB[v] = (unsigned short)lround(linealASrgbReal(v / 65535.0) * 65535.0);
+    }
+}
+
+void inicializarTablasSRGB16(void) {
+    pthread_once(&tablas16Listas, construirTablas16);
+}
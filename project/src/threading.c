@@ -1,4 +1,6 @@
 #include "threading.h"
+#include <stdio.h>
+#include <stdlib.h>
 
 // QUÉ: Variable global para número de hilos configurable.
 // CÓMO: Se modifica desde el menú, se usa en todas las funciones paralelas.
@@ -13,3 +15,143 @@ double obtenerTiempoReal(struct timeval inicio, struct timeval fin) {
     long microsegundos = fin.tv_usec - inicio.tv_usec;
     return segundos + microsegundos / 1000000.0;
 }
+
+// QUÉ: Inicializar un grupo de tareas vacío.
+void iniciarGrupo(GrupoTareas* grupo) {
+    pthread_mutex_init(&grupo->mutex, NULL);
+    pthread_cond_init(&grupo->listo, NULL);
+    grupo->pendientes = 0;
+}
+
+// QUÉ: Esperar a que todas las tareas del grupo terminen.
+void esperarGrupo(GrupoTareas* grupo) {
+    pthread_mutex_lock(&grupo->mutex);
+    while (grupo->pendientes > 0) {
+        pthread_cond_wait(&grupo->listo, &grupo->mutex);
+    }
+    pthread_mutex_unlock(&grupo->mutex);
+}
+
+// QUÉ: Destruir un grupo (debe estar sin tareas pendientes).
+void destruirGrupo(GrupoTareas* grupo) {
+    pthread_mutex_destroy(&grupo->mutex);
+    pthread_cond_destroy(&grupo->listo);
+}
+
+// QUÉ: Bucle de cada hilo trabajador del pool.
+// CÓMO: Toma tareas de la cabeza de la cola; al terminar una descuenta su grupo.
+// Sale cuando el pool está cerrando y la cola quedó vacía.
+// POR QUÉ: Los hilos se crean una vez y se reutilizan para todas las tareas.
+static void* trabajadorPool(void* args) {
+    PoolHilos* pool = (PoolHilos*)args;
+    while (1) {
+        pthread_mutex_lock(&pool->mutex);
+        while (pool->cantidad == 0 && !pool->cerrando) {
+            pthread_cond_wait(&pool->hayTarea, &pool->mutex);
+        }
+        if (pool->cantidad == 0 && pool->cerrando) {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        TareaPool tarea = pool->cola[pool->cabeza];
+        pool->cabeza = (pool->cabeza + 1) % pool->capacidad;
+        pool->cantidad--;
+        pthread_cond_signal(&pool->hayEspacio);
+        pthread_mutex_unlock(&pool->mutex);
+
+        tarea.funcion(tarea.arg);
+
+        if (tarea.grupo) {
+            pthread_mutex_lock(&tarea.grupo->mutex);
+            tarea.grupo->pendientes--;
+            if (tarea.grupo->pendientes == 0) {
+                pthread_cond_broadcast(&tarea.grupo->listo);
+            }
+            pthread_mutex_unlock(&tarea.grupo->mutex);
+        }
+    }
+}
+
+// QUÉ: Crear un pool con numHilos trabajadores y una cola acotada.
+// CÓMO: Reserva la cola circular, inicializa la sincronización y lanza los hilos.
+// POR QUÉ: Ver threading.h.
+int crearPool(PoolHilos* pool, int numHilos, int capacidadCola) {
+    if (numHilos < MIN_HILOS) numHilos = MIN_HILOS;
+    if (numHilos > MAX_HILOS) numHilos = MAX_HILOS;
+    if (capacidadCola < 1) capacidadCola = 1;
+
+    pool->cola = (TareaPool*)malloc(capacidadCola * sizeof(TareaPool));
+    if (!pool->cola) {
+        fprintf(stderr, "Error de memoria al crear cola del pool\n");
+        return 0;
+    }
+    pool->capacidad = capacidadCola;
+    pool->cabeza = 0;
+    pool->cantidad = 0;
+    pool->cerrando = 0;
+    pool->numHilos = 0;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->hayTarea, NULL);
+    pthread_cond_init(&pool->hayEspacio, NULL);
+
+    for (int i = 0; i < numHilos; i++) {
+        if (pthread_create(&pool->hilos[i], NULL, trabajadorPool, pool) != 0) {
+            fprintf(stderr, "Error al crear hilo %d del pool\n", i);
+            destruirPool(pool);
+            return 0;
+        }
+        pool->numHilos++;
+    }
+    return 1;
+}
+
+// QUÉ: Encolar una tarea, bloqueando si la cola está llena.
+int enviarTarea(PoolHilos* pool, void (*funcion)(void*), void* arg, GrupoTareas* grupo) {
+    if (grupo) {
+        pthread_mutex_lock(&grupo->mutex);
+        grupo->pendientes++;
+        pthread_mutex_unlock(&grupo->mutex);
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->cantidad == pool->capacidad && !pool->cerrando) {
+        pthread_cond_wait(&pool->hayEspacio, &pool->mutex);
+    }
+    if (pool->cerrando) {
+        pthread_mutex_unlock(&pool->mutex);
+        if (grupo) {
+            pthread_mutex_lock(&grupo->mutex);
+            grupo->pendientes--;
+            pthread_cond_broadcast(&grupo->listo);
+            pthread_mutex_unlock(&grupo->mutex);
+        }
+        return 0;
+    }
+    int cola = (pool->cabeza + pool->cantidad) % pool->capacidad;
+    pool->cola[cola].funcion = funcion;
+    pool->cola[cola].arg = arg;
+    pool->cola[cola].grupo = grupo;
+    pool->cantidad++;
+    pthread_cond_signal(&pool->hayTarea);
+    pthread_mutex_unlock(&pool->mutex);
+    return 1;
+}
+
+// QUÉ: Terminar el pool tras procesar las tareas pendientes.
+void destruirPool(PoolHilos* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->cerrando = 1;
+    pthread_cond_broadcast(&pool->hayTarea);
+    pthread_cond_broadcast(&pool->hayEspacio);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->numHilos; i++) {
+        pthread_join(pool->hilos[i], NULL);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->hayTarea);
+    pthread_cond_destroy(&pool->hayEspacio);
+    free(pool->cola);
+    pool->cola = NULL;
+    pool->numHilos = 0;
+}
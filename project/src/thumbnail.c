@@ -0,0 +1,106 @@
+#include "thumbnail.h"
+#include "image_io.h"
+#include "png_decoder.h"
+#include "scaling.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// QUÉ: Estado compartido entre los callbacks del decodificador.
+typedef struct {
+    int ladoMaximo;
+    ImagenInfo* miniatura;
+    ReductorArea reductor;
+    int reductorListo;
+} ContextoMiniatura;
+
+// QUÉ: Calcular el tamaño de la miniatura conservando la proporción.
+static void tamanoMiniatura(int ancho, int alto, int ladoMaximo, int* anchoMin, int* altoMin) {
+    if (ancho <= ladoMaximo && alto <= ladoMaximo) {
+        *anchoMin = ancho;
+        *altoMin = alto;
+    } else if (ancho >= alto) {
+        *anchoMin = ladoMaximo;
+        *altoMin = (int)(((long long)alto * ladoMaximo + ancho / 2) / ancho);
+    } else {
+        *altoMin = ladoMaximo;
+        *anchoMin = (int)(((long long)ancho * ladoMaximo + alto / 2) / alto);
+    }
+    if (*anchoMin < 1) *anchoMin = 1;
+    if (*altoMin < 1) *altoMin = 1;
+}
+
+// QUÉ: Callback de cabecera: crear la miniatura y el reductor.
+// CÓMO: Un PNG de 16 bits se pide con filas de 16 bits y da una miniatura de
+// 16 bits, igual que cargarlo completo y reducirlo.
+static int alRecibirCabecera(void* contexto, CabeceraPNG* cabecera) {
+    ContextoMiniatura* ctx = (ContextoMiniatura*)contexto;
+    int ancho, alto;
+    tamanoMiniatura(cabecera->ancho, cabecera->alto, ctx->ladoMaximo, &ancho, &alto);
+    if (cabecera->profundidad == 16) {
+        cabecera->bytesMuestra = 2;
+    }
+    if (!crearImagenFormato(ctx->miniatura, ancho, alto, cabecera->canalesSalida, 8 * cabecera->bytesMuestra, 0)) {
+        return 0;
+    }
+    if (!iniciarReductorArea(&ctx->reductor, cabecera->ancho, cabecera->alto, ctx->miniatura)) {
+        liberarImagen(ctx->miniatura);
+        return 0;
+    }
+    ctx->reductorListo = 1;
+    return 1;
+}
+
+// QUÉ: Callback de fila: acumularla en el reductor.
+static int alRecibirFila(void* contexto, const unsigned char* fila, int y) {
+    (void)y; // Las filas llegan en orden
+    ContextoMiniatura* ctx = (ContextoMiniatura*)contexto;
+    return empujarFilaArea(&ctx->reductor, fila);
+}
+
+// QUÉ: Ruta alternativa: cargar completa y reducir por área.
+static int miniaturaDesdeImagenCompleta(const char* ruta, int ladoMaximo, ImagenInfo* miniatura) {
+    ImagenInfo completa = {0, 0, 0, 0, 0, NULL};
+    if (!cargarImagen(ruta, &completa)) {
+        return 0;
+    }
+    int ancho, alto;
+    tamanoMiniatura(completa.ancho, completa.alto, ladoMaximo, &ancho, &alto);
+    if (ancho != completa.ancho || alto != completa.alto) {
+        scaleImageWithMode(&completa, ancho, alto, SCALE_AREA);
+        if (completa.ancho != ancho || completa.alto != alto) {
+            liberarImagen(&completa);
+            return 0;
+        }
+    }
+    *miniatura = completa;
+    return 1;
+}
+
+// QUÉ: Generar una miniatura de un PNG sin cargar la imagen completa.
+// CÓMO: Ver thumbnail.h.
+// POR QUÉ: Ver thumbnail.h.
+int generarMiniatura(const char* ruta, int ladoMaximo, ImagenInfo* miniatura) {
+    if (ladoMaximo < 1) {
+        fprintf(stderr, "ERROR: Lado máximo de miniatura inválido (%d)\n", ladoMaximo);
+        return 0;
+    }
+    ContextoMiniatura ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.ladoMaximo = ladoMaximo;
+    ctx.miniatura = miniatura;
+    miniatura->pixeles = NULL;
+
+    int resultado = decodificarPNGPorFilas(ruta, alRecibirCabecera, alRecibirFila, &ctx);
+    if (ctx.reductorListo) {
+        liberarReductorArea(&ctx.reductor);
+    }
+    if (resultado == PNG_NO_SOPORTADO) {
+        return miniaturaDesdeImagenCompleta(ruta, ladoMaximo, miniatura);
+    }
+    if (resultado != PNG_OK) {
+        liberarImagen(miniatura);
+        return 0;
+    }
+    return 1;
+}